@@ -0,0 +1,45 @@
+#version 330 // define glsl version 330 Compatable with OpenGL 3.3
+
+// The instanced variant of "light.vert": the model matrix and its inverse transpose are read from the instance buffer
+
+
+// Varyings
+out Varyings {
+    vec4 color;
+    vec2 tex_coord;
+    vec3 normal;
+    vec3 view; // Vector from the Fragment to the Camera
+    vec3 world_position; // Position in the World Space
+} vs_out;
+
+
+// Attribute
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color; 
+layout(location = 2) in vec2 texcoord;
+layout(location = 3) in vec3 normal;
+// Instance Attributes
+// instance_M: Model Matrix (Takes the locations 4 to 7)
+layout(location = 4) in mat4 instance_M;
+// instance_M_IT: Inverse Transpose of the Model Matrix (Takes the locations 8 to 11)
+layout(location = 8) in mat4 instance_M_IT;
+
+// Uniforms
+// VP: View Projection Matrix (From world space to screen space)
+uniform mat4 VP;
+// camera_position: Position of the Camera in the World Space
+uniform vec3 camera_position;
+
+
+void main(){
+    // Set the Position of the Vertex from the Model Space to the World Space
+    vec3 vertix_world_position = (instance_M * vec4(position, 1.0)).xyz;
+    // Set the Position of the Vertex from the World Space to the Screen Space
+    gl_Position = VP * vec4(vertix_world_position, 1.0);
+
+    vs_out.color = color;
+    vs_out.tex_coord = texcoord;
+    vs_out.normal = normalize(instance_M_IT * vec4(normal,1.0)).xyz;
+    vs_out.view = camera_position - vertix_world_position;
+    vs_out.world_position = vertix_world_position;
+}
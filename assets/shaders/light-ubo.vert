@@ -0,0 +1,52 @@
+#version 330 // define glsl version 330 Compatable with OpenGL 3.3
+
+// The variant of "light.vert" used by the forward renderer: the camera is read from the "Frame" block and the model
+// matrices of each draw from the "Draw" block (both are ranges of the renderer's uniform ring) instead of uniforms
+
+
+// Varyings
+out Varyings {
+    vec4 color;
+    vec2 tex_coord;
+    vec3 normal;
+    vec3 view; // Vector from the Fragment to the Camera
+    vec3 world_position; // Position in the World Space
+} vs_out;
+
+
+// Attribute
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color; 
+layout(location = 2) in vec2 texcoord;
+layout(location = 3) in vec3 normal;
+
+// Uniform Blocks
+// They must match "FrameBlock" and "DrawBlock" in "systems/forward-renderer.hpp"
+layout(std140) uniform Frame {
+    // VP: View Projection Matrix (From world space to screen space)
+    mat4 VP;
+    // camera_position: Position of the Camera in the World Space
+    vec3 camera_position;
+};
+layout(std140) uniform Draw {
+    // transform: Model View Projection Matrix (unused here)
+    mat4 transform;
+    // M: Model Matrix
+    mat4 M;
+    // M_IT: Inverse Transpose of the Model Matrix (Used for transforming normals)
+    mat4 M_IT;
+};
+
+
+void main(){
+    // Set the Position of the Vertex from the Model Space to the World Space
+    vec3 vertix_world_position = (M * vec4(position, 1.0)).xyz;
+    // Set the Position of the Vertex from the World Space to the Screen Space
+    gl_Position = VP * vec4(vertix_world_position, 1.0);
+
+    vs_out.color = color;
+    vs_out.tex_coord = texcoord;
+    vs_out.normal = normalize(M_IT * vec4(normal,1.0)).xyz;
+    vs_out.view = camera_position - vertix_world_position;
+    vs_out.world_position = vertix_world_position;
+}
@@ -19,16 +19,16 @@ in Varyings {
 
 #define MAX_LIGHTS 8
 
+// The members are ordered so that each float fills the 4th component of the vec3 before it (std140 layout)
+// It must match "LightData" in "systems/forward-renderer.hpp"
 struct Light {
-    int type; // Type of the Light Source
     vec3 direction; // Direction of the Light Source
+    float inner_cone_angle; // Theta_p
     vec3 position; // Position of the Light Source
+    float outer_cone_angle; // Theta_u
     vec3 color; // Color of the Light
+    int type; // Type of the Light Source
     vec3 attenuation; // Attenuation of the Light
-
-    // Cone Angles
-    float inner_cone_angle; // Theta_p
-    float outer_cone_angle; // Theta_u
 };
 
 struct Material {
@@ -40,8 +40,11 @@ struct Material {
 };
 uniform Material material;
 uniform float alphaThreshold;
-uniform Light lights[MAX_LIGHTS];
-uniform int light_count;
+// The lights are uploaded once per frame by the renderer and shared by every draw
+layout(std140) uniform Lights {
+    Light lights[MAX_LIGHTS];
+    int light_count;
+};
 uniform vec3 ambient_light = vec3(1.0);
 
 
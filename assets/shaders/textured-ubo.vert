@@ -0,0 +1,25 @@
+#version 330 core
+
+// The variant of "textured.vert" used by the forward renderer: the transformation matrix of each draw is read from the
+// "Draw" block (a range of the renderer's uniform ring) instead of a uniform
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 tex_coord;
+
+out Varyings {
+    vec4 color;
+    vec2 tex_coord;
+} vs_out;
+
+// It must match "DrawBlock" in "systems/forward-renderer.hpp"
+layout(std140) uniform Draw {
+    mat4 transform;
+    mat4 M;
+    mat4 M_IT;
+};
+
+void main(){
+    gl_Position = transform * vec4(position, 1.0);
+    vs_out.color = color;
+    vs_out.tex_coord = tex_coord;
+}
@@ -0,0 +1,17 @@
+#version 330 core
+
+// The instanced variant of "tinted.vert": the model matrix of each instance is read from the instance buffer
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+layout(location = 4) in mat4 instance_M; // Takes the locations 4 to 7
+
+out Varyings {
+    vec4 color;
+} vs_out;
+
+uniform mat4 VP;
+
+void main(){
+    gl_Position = VP * instance_M * vec4(position, 1.0);
+    vs_out.color = color;
+}
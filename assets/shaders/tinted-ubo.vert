@@ -0,0 +1,22 @@
+#version 330 core
+
+// The variant of "tinted.vert" used by the forward renderer: the transformation matrix of each draw is read from the
+// "Draw" block (a range of the renderer's uniform ring) instead of a uniform
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 color;
+
+out Varyings {
+    vec4 color;
+} vs_out;
+
+// It must match "DrawBlock" in "systems/forward-renderer.hpp"
+layout(std140) uniform Draw {
+    mat4 transform;
+    mat4 M;
+    mat4 M_IT;
+};
+
+void main(){
+    gl_Position = transform * vec4(position, 1.0);
+    vs_out.color = color;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <json/json.hpp>
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+namespace our::benchmarks {
+
+    // A small stopwatch used by the benchmarks to measure elapsed wall-clock time
+    class Stopwatch {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    public:
+        // Restarts the stopwatch
+        void reset() { start = std::chrono::high_resolution_clock::now(); }
+        // Returns the time elapsed since the stopwatch was started (or reset) in milliseconds
+        double elapsedMilliseconds() const {
+            return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+    };
+
+    // Runs "function" "repetitions" times and returns the best (minimum) time in milliseconds
+    // Taking the minimum filters out the noise coming from the OS scheduler and cold caches
+    inline double bestOf(int repetitions, const std::function<void()>& function) {
+        double best = 0;
+        for(int repetition = 0; repetition < repetitions; repetition++){
+            Stopwatch stopwatch;
+            function();
+            double elapsed = stopwatch.elapsedMilliseconds();
+            if(repetition == 0 || elapsed < best) best = elapsed;
+        }
+        return best;
+    }
+
+    // Prints a line of the form "name: value unit" so the benchmark output is easy to grep
+    inline void report(const std::string& name, double value, const std::string& unit) {
+        std::cout << "[benchmark] " << name << ": " << value << " " << unit << std::endl;
+    }
+
+    // A benchmark receives its configuration (the "benchmark" object in the config file) and returns an exit code
+    using Benchmark = std::function<int(const nlohmann::json&)>;
+
+    // Returns the registry of all the benchmarks, each benchmark is identified by its name
+    // Benchmarks are registered in "benchmarks.hpp"
+    inline std::unordered_map<std::string, Benchmark>& getRegistry() {
+        static std::unordered_map<std::string, Benchmark> registry;
+        return registry;
+    }
+
+}
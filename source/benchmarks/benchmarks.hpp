@@ -0,0 +1,53 @@
+#pragma once
+
+#include "benchmark.hpp"
+#include "ecs-lookup-benchmark.hpp"
+#include "ecs-allocation-benchmark.hpp"
+#include "transform-hierarchy-benchmark.hpp"
+#include "transform-simd-benchmark.hpp"
+#include "scheduler-benchmark.hpp"
+#include "job-system-benchmark.hpp"
+#include "ecs-commands-benchmark.hpp"
+#include "scene-loading-benchmark.hpp"
+#include "world-snapshot-benchmark.hpp"
+#include "change-detection-benchmark.hpp"
+#include "prefab-benchmark.hpp"
+#include "update-lod-benchmark.hpp"
+#include "render-queue-benchmark.hpp"
+#include "frustum-culling-benchmark.hpp"
+#include "static-bvh-benchmark.hpp"
+#include "occlusion-culling-benchmark.hpp"
+
+namespace our::benchmarks {
+
+    // Registers all the benchmarks then runs the one selected by the "type" in the given config
+    // Benchmarks run headless (no window or OpenGL context is created) so they can run on any machine
+    inline int run(const nlohmann::json& config) {
+        auto& registry = getRegistry();
+        registry["ecs-lookup"] = ecsLookupBenchmark;
+        registry["ecs-allocation"] = ecsAllocationBenchmark;
+        registry["transform-hierarchy"] = transformHierarchyBenchmark;
+        registry["transform-simd"] = transformSimdBenchmark;
+        registry["scheduler"] = schedulerBenchmark;
+        registry["job-system"] = jobSystemBenchmark;
+        registry["ecs-commands"] = ecsCommandsBenchmark;
+        registry["scene-loading"] = sceneLoadingBenchmark;
+        registry["world-snapshot"] = worldSnapshotBenchmark;
+        registry["change-detection"] = changeDetectionBenchmark;
+        registry["prefab"] = prefabBenchmark;
+        registry["update-lod"] = updateLodBenchmark;
+        registry["render-queue"] = renderQueueBenchmark;
+        registry["frustum-culling"] = frustumCullingBenchmark;
+        registry["static-bvh"] = staticBvhBenchmark;
+        registry["occlusion-culling"] = occlusionCullingBenchmark;
+
+        std::string type = config.value("type", "");
+        if(auto it = registry.find(type); it != registry.end()){
+            std::cout << "Running benchmark: " << type << std::endl;
+            return it->second(config);
+        }
+        std::cerr << "Unknown benchmark: " << type << std::endl;
+        return -1;
+    }
+
+}
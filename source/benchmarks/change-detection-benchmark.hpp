@@ -0,0 +1,116 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <ecs/world.hpp>
+#include <components/movement.hpp>
+#include <components/race.hpp>
+
+#include <algorithm>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+namespace our::benchmarks {
+
+    // This benchmark simulates a system that reacts to a few changes per tick in a large world.
+    // Every tick, a few moving entities report a change and a few checkpoints are despawned and respawned. Then the system
+    // finds the changed components and keeps a set of the checkpoints up to date, once by walking the whole pools (like the
+    // race system used to do every frame) and once with the reactive queries ("World::changed", "added" and "removed").
+    // It fails if both ways don't find the same components.
+    // Config:
+    //      "entities": the number of moving entities (default: 50000)
+    //      "checkpoints": the number of checkpoints (default: 5000)
+    //      "changes": the number of moving entities changed per tick (default: 100)
+    //      "respawns": the number of checkpoints despawned and respawned per tick (default: 10)
+    //      "ticks": the number of simulated ticks (default: 200)
+    inline int changeDetectionBenchmark(const nlohmann::json& config) {
+        int entityCount = config.value("entities", 50000);
+        int checkpointCount = config.value("checkpoints", 5000);
+        int changeCount = config.value("changes", 100);
+        int respawnCount = config.value("respawns", 10);
+        int ticks = config.value("ticks", 200);
+
+        World world;
+        std::vector<Entity*> movers, checkpoints;
+        for(int index = 0; index < entityCount; index++){
+            Entity* entity = world.add();
+            entity->addComponent<MovementComponent>();
+            movers.push_back(entity);
+        }
+        auto spawnCheckpoint = [&](){
+            Entity* entity = world.add();
+            entity->addComponent<CheckpointComponent>()->checkpointIndex = int(checkpoints.size());
+            checkpoints.push_back(entity);
+        };
+        for(int index = 0; index < checkpointCount; index++) spawnCheckpoint();
+        world.advanceTick();
+
+        std::mt19937 generator(42);
+        std::vector<Component*> scanned, reacted;
+        std::unordered_set<Entity*> scannedCheckpoints, cachedCheckpoints;
+        Tick lastRun = 0;
+        double scanTime = 0, reactiveTime = 0;
+        size_t visited = 0;
+        bool valid = true;
+        for(int tick = 0; tick < ticks; tick++){
+            // The gameplay changes a few movers and respawns a few checkpoints
+            for(int change = 0; change < changeCount && !movers.empty(); change++){
+                auto movement = movers[generator() % movers.size()]->getComponent<MovementComponent>();
+                movement->linearVelocity.x += 1.0f;
+                movement->markChanged();
+            }
+            for(int respawn = 0; respawn < respawnCount && !checkpoints.empty(); respawn++){
+                size_t index = generator() % checkpoints.size();
+                world.markForRemoval(checkpoints[index]);
+                checkpoints[index] = checkpoints.back();
+                checkpoints.pop_back();
+            }
+            world.deleteMarkedEntities();
+            for(int respawn = 0; respawn < respawnCount; respawn++) spawnCheckpoint();
+
+            Tick since = lastRun;
+            lastRun = world.getTick();
+
+            // The pools are walked and the checkpoint set is collected again
+            Stopwatch stopwatch;
+            scanned.clear();
+            for(auto [entity, movement] : world.view<MovementComponent>()){
+                if(movement->getChangedTick() >= since) scanned.push_back(movement);
+            }
+            scannedCheckpoints.clear();
+            for(auto [entity, checkpoint] : world.view<CheckpointComponent>()) scannedCheckpoints.insert(entity);
+            scanTime += stopwatch.elapsedMilliseconds();
+
+            // Only the changes are visited (the removals first since the memory of a removed entity may be reused by a new one)
+            stopwatch.reset();
+            reacted.clear();
+            if(world.hasChangeHistory(since)){
+                for(auto [entity, movement] : world.changed<MovementComponent>(since)) reacted.push_back(movement);
+                for(auto entity : world.removed<CheckpointComponent>(since)) cachedCheckpoints.erase(entity);
+                for(auto [entity, checkpoint] : world.added<CheckpointComponent>(since)) cachedCheckpoints.insert(entity);
+            } else {
+                for(auto [entity, movement] : world.view<MovementComponent>()) reacted.push_back(movement);
+                cachedCheckpoints.clear();
+                for(auto [entity, checkpoint] : world.view<CheckpointComponent>()) cachedCheckpoints.insert(entity);
+            }
+            reactiveTime += stopwatch.elapsedMilliseconds();
+            visited += reacted.size();
+
+            // On the first tick, there is no history yet so every mover counts as changed for both
+            std::sort(scanned.begin(), scanned.end());
+            std::sort(reacted.begin(), reacted.end());
+            valid = valid && scanned == reacted;
+            valid = valid && scannedCheckpoints == cachedCheckpoints;
+            world.advanceTick();
+        }
+
+        report("entities", double(entityCount + checkpointCount), "");
+        report("changes visited per tick", double(visited) / ticks, "");
+        report("full scan per tick", scanTime / ticks, "ms");
+        report("reactive per tick", reactiveTime / ticks, "ms");
+        report("valid", valid ? 1 : 0, "");
+        return valid ? 0 : -1;
+    }
+
+}
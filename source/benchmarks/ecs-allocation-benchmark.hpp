@@ -0,0 +1,148 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <ecs/world.hpp>
+#include <components/mesh-renderer.hpp>
+#include <components/movement.hpp>
+#include <components/light.hpp>
+#include <components/collider.hpp>
+
+#include <iomanip>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <random>
+#include <vector>
+
+namespace our::benchmarks {
+
+    // This benchmark measures the cost of populating and clearing a world, and of spawning/despawning at runtime.
+    // The slab pools of the world are compared against allocating the same objects one by one with new/delete.
+    // Config:
+    //      "entities": the number of entities in the scene (default: 20000)
+    //      "churn": the fraction of the entities that are despawned then respawned (default: 0.25)
+    //      "repetitions": how many runs are timed (the best one is reported) (default: 5)
+    inline int ecsAllocationBenchmark(const nlohmann::json& config) {
+        int entityCount = config.value("entities", 20000);
+        float churn = config.value("churn", 0.25f);
+        int repetitions = config.value("repetitions", 5);
+
+        // The component types each entity gets are picked once so that both variants allocate the same objects
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+        std::vector<int> kinds(entityCount);
+        for(auto& kind : kinds){
+            kind = 0;
+            if(chance(generator) < 0.8f) kind |= 1;
+            if(chance(generator) < 0.3f) kind |= 2;
+            if(chance(generator) < 0.1f) kind |= 4;
+            if(chance(generator) < 0.05f) kind |= 8;
+        }
+        auto populate = [&](World& world, std::vector<Entity*>& entities, int begin, int end){
+            for(int index = begin; index < end; index++){
+                Entity* entity = world.add();
+                if(kinds[index] & 1) entity->addComponent<MeshRendererComponent>();
+                if(kinds[index] & 2) entity->addComponent<MovementComponent>();
+                if(kinds[index] & 4) entity->addComponent<ColliderComponent>();
+                if(kinds[index] & 8) entity->addComponent<LightComponent>();
+                entities[index] = entity;
+            }
+        };
+
+        int churnCount = int(entityCount * churn);
+        World world;
+        std::vector<Entity*> entities(entityCount);
+        double populateTime = 0, churnTime = 0, clearTime = 0;
+        for(int repetition = 0; repetition < repetitions; repetition++){
+            Stopwatch stopwatch;
+            populate(world, entities, 0, entityCount);
+            double populated = stopwatch.elapsedMilliseconds();
+            stopwatch.reset();
+            for(int index = 0; index < churnCount; index++) world.markForRemoval(entities[index]);
+            world.deleteMarkedEntities();
+            populate(world, entities, 0, churnCount);
+            double churned = stopwatch.elapsedMilliseconds();
+            if(repetition == repetitions - 1) {
+                for(auto& stats : world.getMemoryStats()){
+                    std::cout << "[benchmark] pool " << std::setw(14) << stats.name
+                              << " live: " << stats.liveObjects << " allocations: " << stats.totalAllocations
+                              << " slabs: " << stats.slabs << " in use: " << stats.bytesInUse
+                              << " B reserved: " << stats.bytesReserved << " B" << std::endl;
+                }
+            }
+            stopwatch.reset();
+            world.clear();
+            double cleared = stopwatch.elapsedMilliseconds();
+            if(repetition == 0 || populated < populateTime) populateTime = populated;
+            if(repetition == 0 || churned < churnTime) churnTime = churned;
+            if(repetition == 0 || cleared < clearTime) clearTime = cleared;
+        }
+
+        // The allocators alone: the same components are created and destroyed with new/delete then with slab pools
+        // (this isolates the allocation cost from the rest of the entity bookkeeping)
+        // Each component is stored with the pool it came from (null if it was allocated by new)
+        std::vector<std::vector<std::pair<Component*, SlabPool*>>> components(entityCount);
+        SlabPool meshRendererSlab("Mesh Renderer", sizeof(MeshRendererComponent), alignof(MeshRendererComponent));
+        SlabPool movementSlab("Movement", sizeof(MovementComponent), alignof(MovementComponent));
+        SlabPool colliderSlab("Collider", sizeof(ColliderComponent), alignof(ColliderComponent));
+        SlabPool lightSlab("Light", sizeof(LightComponent), alignof(LightComponent));
+        auto make = [](auto* tag, SlabPool* slab) -> std::pair<Component*, SlabPool*> {
+            using T = std::remove_pointer_t<decltype(tag)>;
+            return { slab ? new (slab->allocate()) T() : new T(), slab };
+        };
+        auto create = [&](int begin, int end, bool useSlabs){
+            for(int index = begin; index < end; index++){
+                auto& list = components[index];
+                if(kinds[index] & 1) list.push_back(make((MeshRendererComponent*)nullptr, useSlabs ? &meshRendererSlab : nullptr));
+                if(kinds[index] & 2) list.push_back(make((MovementComponent*)nullptr, useSlabs ? &movementSlab : nullptr));
+                if(kinds[index] & 4) list.push_back(make((ColliderComponent*)nullptr, useSlabs ? &colliderSlab : nullptr));
+                if(kinds[index] & 8) list.push_back(make((LightComponent*)nullptr, useSlabs ? &lightSlab : nullptr));
+            }
+        };
+        // If "bulk" is true, the destructors run but the memory is returned by releasing the slabs afterwards
+        auto destroy = [&](int begin, int end, bool bulk){
+            for(int index = begin; index < end; index++){
+                for(auto [component, slab] : components[index]){
+                    if(!slab) { delete component; continue; }
+                    component->~Component();
+                    if(!bulk) slab->deallocate(component);
+                }
+                components[index].clear();
+            }
+            if(bulk) { meshRendererSlab.release(); movementSlab.release(); colliderSlab.release(); lightSlab.release(); }
+        };
+        double heapTimes[3] = {}, slabTimes[3] = {};
+        for(bool slab : {false, true}){
+            double* times = slab ? slabTimes : heapTimes;
+            for(int repetition = 0; repetition < repetitions; repetition++){
+                Stopwatch stopwatch;
+                create(0, entityCount, slab);
+                double created = stopwatch.elapsedMilliseconds();
+                stopwatch.reset();
+                destroy(0, churnCount, false);
+                create(0, churnCount, slab);
+                double churned = stopwatch.elapsedMilliseconds();
+                stopwatch.reset();
+                destroy(0, entityCount, slab);
+                double cleared = stopwatch.elapsedMilliseconds();
+                if(repetition == 0 || created < times[0]) times[0] = created;
+                if(repetition == 0 || churned < times[1]) times[1] = churned;
+                if(repetition == 0 || cleared < times[2]) times[2] = cleared;
+            }
+        }
+
+        report("entities", entityCount, "");
+        report("world populate (slab pools)", populateTime, "ms");
+        report("world churn (slab pools)", churnTime, "ms");
+        report("world clear (slab pools)", clearTime, "ms");
+        report("components create (new)", heapTimes[0], "ms");
+        report("components create (slab pools)", slabTimes[0], "ms");
+        report("components churn (new/delete)", heapTimes[1], "ms");
+        report("components churn (slab pools)", slabTimes[1], "ms");
+        report("components clear (delete)", heapTimes[2], "ms");
+        report("components clear (slab pools bulk release)", slabTimes[2], "ms");
+        return 0;
+    }
+
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <ecs/world.hpp>
+#include <jobs/job-system.hpp>
+#include <components/movement.hpp>
+#include <components/collider.hpp>
+
+#include <algorithm>
+#include <atomic>
+
+namespace our::benchmarks {
+
+    // This benchmark spawns bursts of effect-like entities (a parent with a few moving children) then despawns them.
+    // It compares direct world edits on one thread against command buffers recorded from the job system workers
+    // and played back at the sync point ("World::deleteMarkedEntities"). It fails if the played back world is wrong.
+    // It also times the despawn of "effects" then "scale" times as many root entities sharing one name (the name index
+    // drops an entity in constant time, so the time per entity should stay flat). The index is checked separately by
+    // despawning named entities one by one: it fails if the list of the name or the slots of its entities are wrong.
+    // Config:
+    //      "workers": the number of worker threads (default: -1, one less than the hardware threads)
+    //      "effects": the number of effects spawned per burst (default: 5000)
+    //      "children": the number of children of each effect (default: 3)
+    //      "scale": how many times more entities the second named despawn has (default: 4)
+    //      "checkedDespawns": how many named entities are despawned one by one to check the name index (default: 1000)
+    //      "repetitions": how many bursts are timed (the best one is reported) (default: 5)
+    inline int ecsCommandsBenchmark(const nlohmann::json& config) {
+        int effectCount = config.value("effects", 5000);
+        int childCount = config.value("children", 3);
+        int scale = std::max(2, config.value("scale", 4));
+        int checkedDespawns = config.value("checkedDespawns", 1000);
+        int repetitions = config.value("repetitions", 5);
+
+        JobSystem jobs;
+        jobs.configure({{"workers", config.value("workers", -1)}});
+
+        auto velocity = [](int effect, int child){ return glm::vec3(float(child), float(effect % 7), 1.0f); };
+
+        // Direct edits (only possible on one thread)
+        World direct;
+        double directSpawn = 0, directDespawn = 0;
+        for(int repetition = 0; repetition < repetitions; repetition++){
+            std::vector<Entity*> roots(effectCount);
+            Stopwatch stopwatch;
+            for(int effect = 0; effect < effectCount; effect++){
+                Entity* root = direct.add();
+                root->setName("effect");
+                root->addComponent<ColliderComponent>();
+                for(int child = 0; child < childCount; child++){
+                    Entity* particle = direct.add();
+                    particle->setParent(root);
+                    particle->addComponent<MovementComponent>()->linearVelocity = velocity(effect, child);
+                }
+                roots[effect] = root;
+            }
+            double spawned = stopwatch.elapsedMilliseconds();
+            stopwatch.reset();
+            for(auto root : roots){
+                for(auto child : root->getChildren()) direct.markForRemoval(child);
+                direct.markForRemoval(root);
+            }
+            direct.deleteMarkedEntities();
+            double despawned = stopwatch.elapsedMilliseconds();
+            if(repetition == 0 || spawned < directSpawn) directSpawn = spawned;
+            if(repetition == 0 || despawned < directDespawn) directDespawn = despawned;
+        }
+
+        // Recorded from the workers then played back
+        World deferred;
+        double recordTime = 0, playbackTime = 0, despawnTime = 0;
+        bool valid = true;
+        for(int repetition = 0; repetition < repetitions; repetition++){
+            Stopwatch stopwatch;
+            jobs.parallelFor(size_t(effectCount), [&](size_t begin, size_t end){
+                auto& commands = deferred.getCommandBuffer();
+                for(size_t effect = begin; effect < end; effect++){
+                    auto root = commands.create("effect");
+                    commands.addComponent<ColliderComponent>(root);
+                    for(int child = 0; child < childCount; child++){
+                        auto particle = commands.create();
+                        commands.setParent(particle, root);
+                        glm::vec3 linearVelocity = velocity(int(effect), child);
+                        commands.addComponent<MovementComponent>(particle, [linearVelocity](MovementComponent* movement){
+                            movement->linearVelocity = linearVelocity;
+                        });
+                    }
+                }
+            }, 64);
+            double recorded = stopwatch.elapsedMilliseconds();
+            stopwatch.reset();
+            deferred.deleteMarkedEntities();
+            double played = stopwatch.elapsedMilliseconds();
+
+            valid = valid && deferred.getEntities().size() == size_t(effectCount) * (childCount + 1);
+            valid = valid && deferred.count<ColliderComponent>() == size_t(effectCount);
+            valid = valid && deferred.count<MovementComponent>() == size_t(effectCount) * childCount;
+            for(auto [entity, collider] : deferred.view<ColliderComponent>()){
+                valid = valid && entity->getName() == "effect" && entity->getChildren().size() == size_t(childCount);
+            }
+
+            // The despawn is recorded from the workers too
+            stopwatch.reset();
+            const auto& colliders = deferred.getPool<ColliderComponent>();
+            jobs.parallelFor(colliders.size(), [&](size_t begin, size_t end){
+                auto& commands = deferred.getCommandBuffer();
+                for(size_t index = begin; index < end; index++){
+                    Entity* root = colliders[index]->getOwner();
+                    for(auto child : root->getChildren()) commands.destroy(child);
+                    commands.destroy(root);
+                }
+            }, 64);
+            deferred.deleteMarkedEntities();
+            double despawned = stopwatch.elapsedMilliseconds();
+            valid = valid && deferred.getEntities().empty();
+
+            if(repetition == 0 || recorded < recordTime) recordTime = recorded;
+            if(repetition == 0 || played < playbackTime) playbackTime = played;
+            if(repetition == 0 || despawned < despawnTime) despawnTime = despawned;
+        }
+
+        // Named despawns: all the entities share one name and leave in spawn order (the worst order for a scan of the list,
+        // since the marked entities are erased in the order they were marked)
+        World named;
+        auto namedDespawn = [&](int count){
+            double best = 0;
+            for(int repetition = 0; repetition < repetitions; repetition++){
+                std::vector<Entity*> debris(count);
+                for(auto& entity : debris){
+                    entity = named.add();
+                    entity->setName("debris");
+                }
+                valid = valid && named.findAllByName(hashSymbol("debris")).size() == size_t(count);
+                Stopwatch stopwatch;
+                for(auto entity : debris) named.markForRemoval(entity);
+                named.deleteMarkedEntities();
+                double despawned = stopwatch.elapsedMilliseconds();
+                valid = valid && named.findByName("debris") == nullptr;
+                if(repetition == 0 || despawned < best) best = despawned;
+            }
+            return best;
+        };
+        double smallDespawn = namedDespawn(effectCount), largeDespawn = namedDespawn(effectCount * scale);
+        double smallPerEntity = smallDespawn / effectCount, largePerEntity = largeDespawn / (double(effectCount) * scale);
+        // The timing is only reported (a loaded machine would make a threshold flaky)
+        double growth = smallPerEntity > 0 ? largePerEntity / smallPerEntity : 1.0;
+
+        // After each despawn, the list of the name must hold exactly the remaining entities and each of them must know
+        // its slot in the list (the despawned one was swapped with the last one)
+        bool nameIndexValid = true;
+        {
+            std::vector<Entity*> remaining(checkedDespawns);
+            for(auto& entity : remaining){
+                entity = named.add();
+                entity->setName("debris");
+            }
+            while(!remaining.empty()){
+                named.markForRemoval(remaining.front());
+                named.deleteMarkedEntities();
+                remaining.erase(remaining.begin());
+                std::vector<Entity*> listed = named.findAllByName(hashSymbol("debris"));
+                for(size_t slot = 0; slot < listed.size(); slot++)
+                    nameIndexValid = nameIndexValid && listed[slot]->getNameSlot() == slot;
+                std::vector<Entity*> expected = remaining;
+                std::sort(listed.begin(), listed.end());
+                std::sort(expected.begin(), expected.end());
+                nameIndexValid = nameIndexValid && listed == expected;
+            }
+            nameIndexValid = nameIndexValid && named.findByName("debris") == nullptr;
+        }
+        valid = valid && nameIndexValid;
+
+        report("workers", double(jobs.getWorkerCount()), "");
+        report("entities per burst", double(effectCount) * (childCount + 1), "");
+        report("spawn (direct)", directSpawn, "ms");
+        report("spawn (record)", recordTime, "ms");
+        report("spawn (playback)", playbackTime, "ms");
+        report("spawn (record + playback)", recordTime + playbackTime, "ms");
+        report("despawn (direct)", directDespawn, "ms");
+        report("despawn (record + playback)", despawnTime, "ms");
+        report("named despawn", smallDespawn, "ms");
+        report("named despawn (x scale)", largeDespawn, "ms");
+        report("named despawn growth per entity", growth, "x");
+        report("named despawn index checked", nameIndexValid ? 1 : 0, "");
+        report("valid", valid ? 1 : 0, "");
+        return valid ? 0 : -1;
+    }
+
+}
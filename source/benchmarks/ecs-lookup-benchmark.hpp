@@ -0,0 +1,98 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <ecs/world.hpp>
+#include <components/camera.hpp>
+#include <components/mesh-renderer.hpp>
+#include <components/movement.hpp>
+#include <components/light.hpp>
+#include <components/rigidbody.hpp>
+#include <components/collider.hpp>
+
+#include <list>
+#include <random>
+#include <vector>
+
+namespace our::benchmarks {
+
+    // This benchmark measures the cost of "Entity::getComponent" on a scene with many entities.
+    // It compares the slot table lookup against the list walk with a "dynamic_cast" per node that was used before.
+    // Config:
+    //      "entities": the number of entities in the scene (default: 10000)
+    //      "iterations": how many times every entity is queried per run (default: 20)
+    //      "repetitions": how many runs are timed (the best one is reported) (default: 5)
+    inline int ecsLookupBenchmark(const nlohmann::json& config) {
+        int entityCount = config.value("entities", 10000);
+        int iterations = config.value("iterations", 20);
+        int repetitions = config.value("repetitions", 5);
+
+        World world;
+        std::vector<Entity*> entities;
+        // The old storage is emulated by a list that holds the same components in the same order
+        std::vector<std::list<Component*>> lists;
+        entities.reserve(entityCount);
+        lists.reserve(entityCount);
+
+        // Populate the scene with a mix of components similar to a game scene where most entities are static props
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+        for(int index = 0; index < entityCount; index++){
+            Entity* entity = world.add();
+            std::list<Component*> list;
+            if(chance(generator) < 0.6f) list.push_back(entity->addComponent<MeshRendererComponent>());
+            if(chance(generator) < 0.2f) list.push_back(entity->addComponent<MovementComponent>());
+            if(chance(generator) < 0.1f) list.push_back(entity->addComponent<ColliderComponent>());
+            if(chance(generator) < 0.05f) list.push_back(entity->addComponent<LightComponent>());
+            if(chance(generator) < 0.05f) list.push_back(entity->addComponent<RigidbodyComponent>());
+            if(index == 0) list.push_back(entity->addComponent<CameraComponent>());
+            entities.push_back(entity);
+            lists.push_back(std::move(list));
+        }
+
+        // Each query asks every entity for the component types that the systems ask for every frame
+        size_t found = 0;
+        auto querySlots = [&](){
+            for(int iteration = 0; iteration < iterations; iteration++){
+                for(auto entity : entities){
+                    found += entity->getComponent<CameraComponent>() != nullptr;
+                    found += entity->getComponent<MeshRendererComponent>() != nullptr;
+                    found += entity->getComponent<LightComponent>() != nullptr;
+                    found += entity->getComponent<MovementComponent>() != nullptr;
+                    found += entity->getComponent<RigidbodyComponent>() != nullptr;
+                    found += entity->getComponent<ColliderComponent>() != nullptr;
+                }
+            }
+        };
+        auto find = [](std::list<Component*>& list, auto* tag) -> Component* {
+            using T = std::remove_pointer_t<decltype(tag)>;
+            for(auto component : list) if(auto cast = dynamic_cast<T*>(component)) return cast;
+            return nullptr;
+        };
+        auto queryLists = [&](){
+            for(int iteration = 0; iteration < iterations; iteration++){
+                for(auto& list : lists){
+                    found += find(list, (CameraComponent*)nullptr) != nullptr;
+                    found += find(list, (MeshRendererComponent*)nullptr) != nullptr;
+                    found += find(list, (LightComponent*)nullptr) != nullptr;
+                    found += find(list, (MovementComponent*)nullptr) != nullptr;
+                    found += find(list, (RigidbodyComponent*)nullptr) != nullptr;
+                    found += find(list, (ColliderComponent*)nullptr) != nullptr;
+                }
+            }
+        };
+
+        double lookups = double(entityCount) * iterations * 6;
+        double slotTime = bestOf(repetitions, querySlots);
+        double listTime = bestOf(repetitions, queryLists);
+
+        report("entities", entityCount, "");
+        report("slot table lookup", slotTime * 1e6 / lookups, "ns/lookup");
+        report("list + dynamic_cast lookup", listTime * 1e6 / lookups, "ns/lookup");
+        report("speedup", listTime / slotTime, "x");
+        // Printing the count keeps the compiler from optimizing the queries away
+        report("components found", double(found), "");
+        return 0;
+    }
+
+}
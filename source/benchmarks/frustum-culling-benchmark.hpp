@@ -0,0 +1,97 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <systems/frustum-culling.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace our::benchmarks {
+
+    // This benchmark culls random boxes against a camera frustum, once with the scalar test and once with the batch kernel
+    // (see "systems/frustum-culling.hpp"). The boxes are unit cubes moved, rotated and scaled around the camera.
+    // It fails if the two versions disagree, or if a culled box has a corner inside the frustum (checked in clip space).
+    // Config:
+    //      "boxes": the number of boxes culled per run (default: 50000)
+    //      "range": the boxes are spread in a cube of this half size around the camera (default: 200)
+    //      "far": the far plane of the camera (default: 150)
+    //      "repetitions": how many runs are timed (the best one is reported) (default: 10)
+    inline int frustumCullingBenchmark(const nlohmann::json& config) {
+        int count = config.value("boxes", 50000);
+        float range = config.value("range", 200.0f);
+        float far = config.value("far", 150.0f);
+        int repetitions = config.value("repetitions", 10);
+
+        // The camera stands at the origin looking at -z, like the default camera of the scenes
+        glm::mat4 VP = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, far);
+        Frustum frustum = Frustum::fromViewProjection(VP);
+
+        MeshBounds bounds;
+        bounds.min = glm::vec3(-0.5f);
+        bounds.max = glm::vec3(0.5f);
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> position(-range, range), angle(0.0f, glm::two_pi<float>()), scale(0.5f, 8.0f);
+        std::vector<glm::mat4> matrices(count);
+        for(auto& matrix : matrices){
+            matrix = glm::translate(glm::mat4(1.0f), glm::vec3(position(generator), position(generator), position(generator)));
+            matrix = glm::rotate(matrix, angle(generator), glm::normalize(glm::vec3(position(generator), position(generator), position(generator)) + 0.001f));
+            matrix = glm::scale(matrix, glm::vec3(scale(generator), scale(generator), scale(generator)));
+        }
+
+        std::vector<CullBox> boxes(count);
+        double boundsTime = bestOf(repetitions, [&](){
+            for(int index = 0; index < count; index++) boxes[index] = transformBounds(bounds, matrices[index]);
+        });
+        std::vector<char> scalarVisible(count), kernelVisible(count);
+        double scalarTime = bestOf(repetitions, [&](){
+            std::fill(scalarVisible.begin(), scalarVisible.end(), 1);
+            cullBoxesScalar(frustum, boxes.data(), count, scalarVisible.data());
+        });
+        double kernelTime = bestOf(repetitions, [&](){
+            std::fill(kernelVisible.begin(), kernelVisible.end(), 1);
+            cullBoxes(frustum, boxes.data(), count, kernelVisible.data());
+        });
+
+        // A culled box must have its 8 corners on the outer side of the same clip plane (with a small tolerance)
+        bool valid = scalarVisible == kernelVisible;
+        size_t visibleCount = 0;
+        for(int index = 0; index < count; index++){
+            if(kernelVisible[index]){
+                visibleCount++;
+                continue;
+            }
+            bool outside = false;
+            for(int axis = 0; axis < 3 && !outside; axis++){
+                for(float side : {-1.0f, 1.0f}){
+                    bool allOut = true;
+                    for(int corner = 0; corner < 8 && allOut; corner++){
+                        glm::vec3 local((corner & 1) ? 0.5f : -0.5f, (corner & 2) ? 0.5f : -0.5f, (corner & 4) ? 0.5f : -0.5f);
+                        glm::vec4 clip = VP * matrices[index] * glm::vec4(local, 1.0f);
+                        allOut = side * clip[axis] > clip.w - 1e-3f * std::abs(clip.w);
+                    }
+                    if(allOut){
+                        outside = true;
+                        break;
+                    }
+                }
+            }
+            if(!outside) valid = false;
+        }
+
+        std::cout << "[benchmark] kernel: " << getCullingKernelName() << std::endl;
+        report("boxes", count, "");
+        report("visible", double(visibleCount) / count * 100.0, "%");
+        report("transform bounds", boundsTime * 1000, "us");
+        report("scalar cull", scalarTime * 1000, "us");
+        report("batch kernel cull", kernelTime * 1000, "us");
+        report("speedup", kernelTime > 0 ? scalarTime / kernelTime : 0, "x");
+        report("valid", valid ? 1 : 0, "");
+        return valid ? 0 : -1;
+    }
+
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <jobs/job-system.hpp>
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+namespace our::benchmarks {
+
+    // This benchmark first stress tests the job system (every check must pass or the benchmark fails):
+    //      - a parallel for must visit every index exactly once
+    //      - parallel fors nested inside parallel fors must complete (waiting threads run the pending jobs)
+    //      - jobs that recursively submit and wait for more jobs must complete
+    //      - a flood of tiny jobs must all run
+    // Then it compares the time it takes to run many small jobs against std::async (one task per job, and one task per
+    // hardware thread like a hand-written parallel for would do) and against a single thread.
+    // Config:
+    //      "workers": the number of worker threads (default: -1, one less than the hardware threads)
+    //      "rounds": how many times the stress tests are repeated (default: 20)
+    //      "tasks": the number of jobs in the timed runs (default: 2048)
+    //      "work": the number of sqrt iterations each job performs (default: 5000)
+    //      "repetitions": how many times each timed run is repeated (the best time is reported) (default: 5)
+    inline int jobSystemBenchmark(const nlohmann::json& config) {
+        int rounds = config.value("rounds", 20);
+        size_t tasks = config.value("tasks", size_t(2048));
+        int work = config.value("work", 5000);
+        int repetitions = config.value("repetitions", 5);
+
+        JobSystem jobs;
+        jobs.configure({{"workers", config.value("workers", -1)}});
+        report("workers", double(jobs.getWorkerCount()), "");
+
+        // The stress tests
+        int failures = 0;
+        auto check = [&failures](bool passed, const char* name){
+            if(!passed){
+                std::cerr << "Job system check failed: " << name << std::endl;
+                failures++;
+            }
+        };
+        Stopwatch stressTime;
+        for(int round = 0; round < rounds; round++){
+            // Every index must be visited exactly once
+            const size_t count = size_t(1) << 20;
+            std::vector<std::uint8_t> visits(count, 0);
+            std::atomic<std::uint64_t> sum{0};
+            jobs.parallelFor(count, [&](size_t begin, size_t end){
+                std::uint64_t partial = 0;
+                for(size_t index = begin; index < end; index++){
+                    visits[index]++;
+                    partial += index;
+                }
+                sum += partial;
+            });
+            check(sum == std::uint64_t(count) * (count - 1) / 2, "parallel for sum");
+            bool visitedOnce = true;
+            for(auto visit : visits) visitedOnce = visitedOnce && visit == 1;
+            check(visitedOnce, "parallel for visits");
+
+            // Nested parallel fors
+            std::atomic<size_t> nested{0};
+            jobs.parallelFor(64, [&](size_t begin, size_t end){
+                for(size_t outer = begin; outer < end; outer++){
+                    jobs.parallelFor(1000, [&](size_t innerBegin, size_t innerEnd){ nested += innerEnd - innerBegin; });
+                }
+            });
+            check(nested == 64 * 1000, "nested parallel for");
+
+            // Jobs submitting jobs and waiting for them (a binary tree of depth 10)
+            std::atomic<size_t> leaves{0};
+            std::function<void(int)> spawn = [&](int depth){
+                if(depth == 0){ leaves++; return; }
+                JobCounter children;
+                jobs.submit([&, depth](){ spawn(depth - 1); }, children);
+                jobs.submit([&, depth](){ spawn(depth - 1); }, children);
+                jobs.wait(children);
+            };
+            JobCounter root;
+            jobs.submit([&](){ spawn(10); }, root);
+            jobs.wait(root);
+            check(leaves == 1024, "recursive jobs");
+
+            // A flood of tiny jobs
+            std::atomic<size_t> tiny{0};
+            JobCounter flood;
+            for(int job = 0; job < 100000; job++) jobs.submit([&tiny](){ tiny++; }, flood);
+            jobs.wait(flood);
+            check(tiny == 100000, "tiny jobs");
+        }
+        report("stress rounds", rounds, "");
+        report("stress time", stressTime.elapsedMilliseconds(), "ms");
+        report("stress failures", failures, "");
+
+        // The timed runs
+        auto burn = [work](size_t seed){
+            volatile float sink = 0;
+            for(int iteration = 0; iteration < work; iteration++) sink = sink + std::sqrt(float(iteration + seed));
+        };
+
+        double serialTime = bestOf(repetitions, [&](){
+            for(size_t task = 0; task < tasks; task++) burn(task);
+        });
+        double submitTime = bestOf(repetitions, [&](){
+            JobCounter counter;
+            for(size_t task = 0; task < tasks; task++) jobs.submit([&burn, task](){ burn(task); }, counter);
+            jobs.wait(counter);
+        });
+        double parallelForTime = bestOf(repetitions, [&](){
+            jobs.parallelFor(tasks, [&](size_t begin, size_t end){
+                for(size_t task = begin; task < end; task++) burn(task);
+            });
+        });
+        double asyncTime = bestOf(repetitions, [&](){
+            std::vector<std::future<void>> futures;
+            futures.reserve(tasks);
+            for(size_t task = 0; task < tasks; task++) futures.push_back(std::async(std::launch::async, burn, task));
+            for(auto& future : futures) future.get();
+        });
+        double asyncChunkedTime = bestOf(repetitions, [&](){
+            size_t threads = jobs.getThreadCount();
+            std::vector<std::future<void>> futures;
+            for(size_t thread = 0; thread < threads; thread++){
+                futures.push_back(std::async(std::launch::async, [&, thread](){
+                    for(size_t task = tasks * thread / threads; task < tasks * (thread + 1) / threads; task++) burn(task);
+                }));
+            }
+            for(auto& future : futures) future.get();
+        });
+
+        report("serial", serialTime, "ms");
+        report("job system (submit)", submitTime, "ms");
+        report("job system (parallel for)", parallelForTime, "ms");
+        report("std::async (one task per job)", asyncTime, "ms");
+        report("std::async (one task per thread)", asyncChunkedTime, "ms");
+        report("speedup vs std::async", asyncTime / submitTime, "x");
+        auto stats = jobs.getStats();
+        report("jobs executed", double(stats.executed), "");
+        report("jobs stolen", double(stats.stolen), "");
+        return failures == 0 ? 0 : -1;
+    }
+
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <systems/occlusion-culling.hpp>
+#include <jobs/job-system.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace our::benchmarks {
+
+    // This benchmark rasterizes a hilly terrain into the occlusion buffer of "systems/occlusion-culling.hpp" then tests
+    // the boxes of props scattered on it. The camera stands at the foot of a ridge so most of the props behind it are hidden.
+    // It reports how many props and how many of their triangles would not be drawn.
+    // It fails if the buffer depends on the number of threads, or if one of the checked hidden props has a corner or a
+    // center that is not behind the terrain (found by casting a ray from the eye through the terrain triangles).
+    // Config:
+    //      "props": the number of props (default: 5000)
+    //      "grid": the number of terrain cells along each side (default: 96, each cell is 2 triangles)
+    //      "width", "height": the resolution of the occlusion buffer (default: 256 x 128)
+    //      "checks": the number of hidden props checked by ray casts (default: 200)
+    //      "workers": the number of worker threads (default: -1, one less than the hardware threads)
+    //      "repetitions": how many runs are timed (the best one is reported) (default: 10)
+    inline int occlusionCullingBenchmark(const nlohmann::json& config) {
+        int count = config.value("props", 5000);
+        int grid = std::max(1, config.value("grid", 96));
+        int width = config.value("width", 256), height = config.value("height", 128);
+        int checks = config.value("checks", 200);
+        int repetitions = config.value("repetitions", 10);
+        JobSystem& jobs = JobSystem::get();
+        jobs.configure(config);
+
+        // The terrain covers [-200, 200] x [-400, 0] with a ridge across it 100 units in front of the camera
+        auto terrainHeight = [](float x, float z) {
+            float ridge = (z + 100.0f) / 20.0f;
+            return 25.0f * std::exp(-ridge * ridge) + 2.0f * std::sin(x * 0.05f) * std::cos(z * 0.07f);
+        };
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> elements;
+        for(int row = 0; row <= grid; row++)
+            for(int column = 0; column <= grid; column++) {
+                float x = -200.0f + 400.0f * column / grid, z = -400.0f * row / grid;
+                Vertex vertex{};
+                vertex.position = glm::vec3(x, terrainHeight(x, z), z);
+                vertices.push_back(vertex);
+            }
+        for(int row = 0; row < grid; row++)
+            for(int column = 0; column < grid; column++) {
+                unsigned int corner = row * (grid + 1) + column;
+                elements.insert(elements.end(), {corner, corner + 1, corner + grid + 2, corner, corner + grid + 2, corner + grid + 1});
+            }
+        OccluderGeometry terrain = OccluderGeometry::fromVertices(vertices, elements);
+
+        // The props stand on the terrain, each stands for a mesh of a few hundred to a few thousand triangles
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> across(-150.0f, 150.0f), along(-380.0f, -10.0f), size(0.5f, 4.0f);
+        std::uniform_int_distribution<int> triangleCount(200, 5000);
+        std::vector<CullBox> boxes(count);
+        std::vector<int> propTriangles(count);
+        size_t totalTriangles = 0;
+        for(int prop = 0; prop < count; prop++) {
+            CullBox& box = boxes[prop];
+            box.extents = glm::vec3(size(generator), size(generator), size(generator));
+            float x = across(generator), z = along(generator);
+            box.center = glm::vec3(x, terrainHeight(x, z) + box.extents.y, z);
+            propTriangles[prop] = triangleCount(generator);
+            totalTriangles += propTriangles[prop];
+        }
+
+        glm::vec3 eye(0.0f, 4.0f, 0.0f);
+        glm::mat4 VP = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f) *
+                       glm::lookAt(eye, glm::vec3(0.0f, 4.0f, -100.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        OcclusionBuffer buffer;
+        buffer.resize(width, height);
+        auto fill = [&](bool parallel) {
+            buffer.begin(VP);
+            buffer.addOccluder(terrain, glm::mat4(1.0f));
+            buffer.rasterize(parallel);
+        };
+        double serialTime = bestOf(repetitions, [&]() { fill(false); });
+        std::vector<float> serialDepth(buffer.getDepth(), buffer.getDepth() + size_t(buffer.getWidth()) * buffer.getHeight());
+        double parallelTime = bestOf(repetitions, [&]() { fill(true); });
+        // The buffer must not depend on how the tiles were shared between the threads
+        bool valid = std::memcmp(serialDepth.data(), buffer.getDepth(), serialDepth.size() * sizeof(float)) == 0;
+
+        std::vector<char> visible(count);
+        double testTime = bestOf(repetitions, [&]() {
+            std::fill(visible.begin(), visible.end(), 1);
+            buffer.cullBoxes(boxes.data(), count, visible.data());
+        });
+        size_t hiddenProps = 0, hiddenTriangles = 0;
+        for(int prop = 0; prop < count; prop++)
+            if(!visible[prop]) {
+                hiddenProps++;
+                hiddenTriangles += propTriangles[prop];
+            }
+
+        // The corners and the center of a hidden prop must be behind a terrain triangle (Moller-Trumbore ray casts)
+        auto isBehindTerrain = [&](const glm::vec3& point) {
+            glm::vec3 direction = point - eye;
+            const auto& positions = terrain.positions;
+            for(size_t element = 0; element < terrain.elements.size(); element += 3) {
+                const unsigned int* triangle = terrain.elements.data() + element;
+                glm::vec3 a = positions[triangle[0]], b = positions[triangle[1]], c = positions[triangle[2]];
+                glm::vec3 side1 = b - a, side2 = c - a;
+                glm::vec3 p = glm::cross(direction, side2);
+                float determinant = glm::dot(side1, p);
+                if(std::abs(determinant) < 1e-8f) continue;
+                glm::vec3 offset = eye - a;
+                float u = glm::dot(offset, p) / determinant;
+                if(u < 0.0f || u > 1.0f) continue;
+                glm::vec3 q = glm::cross(offset, side1);
+                float v = glm::dot(direction, q) / determinant;
+                if(v < 0.0f || u + v > 1.0f) continue;
+                float t = glm::dot(side2, q) / determinant;
+                if(t > 0.0f && t < 0.999f) return true;
+            }
+            return false;
+        };
+        int checked = 0;
+        for(int prop = 0; prop < count && checked < checks; prop++) {
+            if(visible[prop]) continue;
+            checked++;
+            const CullBox& box = boxes[prop];
+            bool hidden = isBehindTerrain(box.center);
+            for(int corner = 0; corner < 8 && hidden; corner++) {
+                glm::vec3 sign((corner & 1) ? 1.0f : -1.0f, (corner & 2) ? 1.0f : -1.0f, (corner & 4) ? 1.0f : -1.0f);
+                hidden = isBehindTerrain(box.center + sign * box.extents);
+            }
+            if(!hidden) valid = false;
+        }
+
+        std::cout << "[benchmark] kernel: " << getOcclusionKernelName() << std::endl;
+        report("threads", double(jobs.getThreadCount()), "");
+        report("resolution", double(buffer.getWidth()) * buffer.getHeight(), "pixels");
+        report("occluder triangles", double(buffer.getTriangleCount()), "");
+        report("rasterized triangles", double(buffer.getDrawnTriangleCount()), "");
+        report("rasterize (1 thread)", serialTime * 1000, "us");
+        report("rasterize (parallel)", parallelTime * 1000, "us");
+        report("parallel speedup", parallelTime > 0 ? serialTime / parallelTime : 0, "x");
+        report("box tests", testTime * 1000, "us");
+        report("props", count, "");
+        report("props culled", double(hiddenProps), "");
+        report("triangles", double(totalTriangles), "");
+        report("triangles culled", double(hiddenTriangles), "");
+        report("triangles culled ratio", totalTriangles > 0 ? double(hiddenTriangles) / totalTriangles * 100.0 : 0, "%");
+        report("checked props", checked, "");
+        report("valid", valid ? 1 : 0, "");
+        return valid ? 0 : -1;
+    }
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <ecs/world.hpp>
+#include <ecs/prefab.hpp>
+
+#include <cstring>
+#include <fstream>
+
+namespace our::benchmarks {
+
+    // This benchmark spawns many copies of an entity of a scene file (the kart of the race scene by default, with its
+    // children), once by deserializing its json for every copy and once by instantiating a prefab in bulk.
+    // The assets are not loaded so the mesh renderers get null assets.
+    // It fails if the two worlds differ.
+    // Config:
+    //      "scene": the path of the json scene file (default: "config/scenes/race.jsonc")
+    //      "entity": the index of the spawned entity in the scene file (default: 0)
+    //      "instances": the number of spawned copies (default: 1000)
+    //      "repetitions": how many times each spawn is timed (the best one is reported) (default: 5)
+    inline int prefabBenchmark(const nlohmann::json& config) {
+        std::string scenePath = config.value("scene", "config/scenes/race.jsonc");
+        size_t entityIndex = config.value("entity", 0);
+        int instanceCount = config.value("instances", 1000);
+        int repetitions = config.value("repetitions", 5);
+
+        std::ifstream sceneFile(scenePath);
+        if(!sceneFile){
+            std::cerr << "Couldn't open the scene file: " << scenePath << std::endl;
+            return -1;
+        }
+        nlohmann::json scene = nlohmann::json::parse(sceneFile, nullptr, true, true);
+        if(!scene.is_array() || entityIndex >= scene.size()){
+            std::cerr << "The scene file has no entity " << entityIndex << std::endl;
+            return -1;
+        }
+        const nlohmann::json& entityData = scene[entityIndex];
+
+        // Every copy stands at its own place on a grid
+        std::vector<Transform> transforms(instanceCount);
+        for(int index = 0; index < instanceCount; index++){
+            transforms[index].position = glm::vec3(float(index % 32) * 4.0f, 0, float(index / 32) * 4.0f);
+        }
+
+        World jsonWorld, prefabWorld;
+        double jsonTime = bestOf(repetitions, [&](){
+            jsonWorld.clear();
+            for(int index = 0; index < instanceCount; index++){
+                size_t first = jsonWorld.getEntities().size();
+                jsonWorld.deserialize(nlohmann::json::array({entityData}));
+                jsonWorld.getEntities()[first]->localTransform = transforms[index];
+            }
+        });
+
+        Prefab prefab;
+        Stopwatch stopwatch;
+        bool valid = prefab.deserialize(entityData);
+        double prefabBuildTime = stopwatch.elapsedMilliseconds();
+        std::vector<Entity*> roots;
+        double prefabTime = bestOf(repetitions, [&](){
+            prefabWorld.clear();
+            roots.clear();
+            prefab.instantiate(prefabWorld, size_t(instanceCount), transforms.data(), &roots);
+        });
+
+        // Both worlds must hold the same records (the entities are in the same order: every root followed by its children)
+        auto records = [](World& world, SceneWriter& writer, std::vector<SceneEntityRecord>& entities, std::vector<SceneComponentRecord>& components){
+            writeSceneRecords(world.getEntities(), writer, entities, components);
+        };
+        SceneWriter jsonWriter, prefabWriter;
+        std::vector<SceneEntityRecord> jsonEntities, prefabEntities;
+        std::vector<SceneComponentRecord> jsonComponents, prefabComponents;
+        records(jsonWorld, jsonWriter, jsonEntities, jsonComponents);
+        records(prefabWorld, prefabWriter, prefabEntities, prefabComponents);
+        valid = valid && roots.size() == size_t(instanceCount);
+        valid = valid && jsonEntities.size() == prefabEntities.size() && jsonComponents.size() == prefabComponents.size();
+        valid = valid && std::memcmp(jsonEntities.data(), prefabEntities.data(), jsonEntities.size() * sizeof(SceneEntityRecord)) == 0;
+        valid = valid && std::memcmp(jsonComponents.data(), prefabComponents.data(), jsonComponents.size() * sizeof(SceneComponentRecord)) == 0;
+        valid = valid && jsonWriter.getData() == prefabWriter.getData() && jsonWriter.getStrings() == prefabWriter.getStrings();
+
+        report("entities per instance", double(prefab.getEntityCount()), "");
+        report("components per instance", double(prefab.getComponentCount()), "");
+        report("json per instance", jsonTime * 1000.0 / instanceCount, "us");
+        report("prefab build", prefabBuildTime, "ms");
+        report("prefab per instance", prefabTime * 1000.0 / instanceCount, "us");
+        report("speedup", prefabTime > 0 ? jsonTime / prefabTime : 0, "x");
+        report("valid", valid ? 1 : 0, "");
+        return valid ? 0 : -1;
+    }
+
+}
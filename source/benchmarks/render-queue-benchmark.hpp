@@ -0,0 +1,130 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <systems/render-queue.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <random>
+#include <tuple>
+#include <vector>
+
+namespace our::benchmarks {
+
+    // This benchmark orders a frame of random draws, once by sorting the commands themselves with a comparator (like the
+    // renderer used to do for the transparent commands) and once by radix sorting their 64-bit keys with their indices
+    // (see "systems/render-queue.hpp"). It also counts the shader and texture switches before and after sorting.
+    // It fails if the radix sort disagrees with std::stable_sort on the keys, or if the transparent draws are not back to front.
+    // Config:
+    //      "draws": the number of draws per frame (default: 20000)
+    //      "shaders", "textures", "materials", "meshes": the number of distinct states (defaults: 8, 64, 256, 128)
+    //      "transparent": the fraction of transparent draws (default: 0.1)
+    //      "repetitions": how many times each sort is timed (the best one is reported) (default: 10)
+    inline int renderQueueBenchmark(const nlohmann::json& config) {
+        int drawCount = config.value("draws", 20000);
+        std::uint32_t shaderCount = std::max(config.value("shaders", 8u), 1u);
+        std::uint32_t textureCount = std::max(config.value("textures", 64u), 1u);
+        std::uint32_t materialCount = std::max(config.value("materials", 256u), 1u);
+        std::uint32_t meshCount = std::max(config.value("meshes", 128u), 1u);
+        float transparentFraction = config.value("transparent", 0.1f);
+        int repetitions = config.value("repetitions", 10);
+
+        // A draw as big as a render command (two matrices, a center, the state and the key)
+        struct Draw {
+            glm::mat4 localToWorld, normalMatrix;
+            glm::vec3 center;
+            std::uint32_t shader, texture, material, mesh;
+            float depth;
+            bool transparent;
+            std::uint64_t sortKey;
+        };
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> depthDistribution(0.5f, 500.0f), chance(0.0f, 1.0f);
+        std::vector<Draw> draws(drawCount);
+        for(auto& draw : draws){
+            draw.localToWorld = draw.normalMatrix = glm::mat4(1.0f);
+            draw.depth = depthDistribution(generator);
+            draw.center = glm::vec3(0, 0, -draw.depth);
+            // Every material has its own shader and texture, like the materials of the asset files
+            draw.material = 1 + generator() % materialCount;
+            draw.shader = 1 + draw.material % shaderCount;
+            draw.texture = 1 + draw.material % textureCount;
+            draw.mesh = 1 + generator() % meshCount;
+            draw.transparent = chance(generator) < transparentFraction;
+        }
+
+        // The comparator version moves the whole draws: opaque first (by state then front to back), then back to front
+        std::vector<Draw> sortedDraws;
+        double structTime = bestOf(repetitions, [&](){
+            sortedDraws = draws;
+            std::sort(sortedDraws.begin(), sortedDraws.end(), [](const Draw& first, const Draw& second){
+                if(first.transparent != second.transparent) return second.transparent;
+                if(first.transparent) return first.depth > second.depth;
+                return std::tie(first.shader, first.texture, first.material, first.mesh, first.depth) <
+                       std::tie(second.shader, second.texture, second.material, second.mesh, second.depth);
+            });
+        });
+
+        // The key version builds the keys then only sorts 16-byte entries
+        std::vector<RenderQueueEntry> queue, scratch;
+        double keyTime = bestOf(repetitions, [&](){
+            queue.clear();
+            for(std::uint32_t index = 0; index < draws.size(); index++){
+                Draw& draw = draws[index];
+                draw.sortKey = draw.transparent ? makeTransparentSortKey(draw.shader, draw.texture, draw.material, draw.mesh, draw.depth)
+                                                : makeOpaqueSortKey(draw.shader, draw.texture, draw.material, draw.mesh, draw.depth);
+                queue.push_back({draw.sortKey, index});
+            }
+            radixSort(queue, scratch);
+        });
+
+        // The radix sort must match a stable comparison sort of the same entries
+        std::vector<RenderQueueEntry> reference = queue;
+        std::stable_sort(reference.begin(), reference.end(), [](const RenderQueueEntry& first, const RenderQueueEntry& second){
+            return first.key < second.key;
+        });
+        bool valid = std::equal(queue.begin(), queue.end(), reference.begin(), [](const RenderQueueEntry& first, const RenderQueueEntry& second){
+            return first.key == second.key;
+        });
+        // The opaque draws come first and the transparent ones are back to front
+        bool seenTransparent = false;
+        float lastDepth = 0;
+        for(auto& entry : queue){
+            const Draw& draw = draws[entry.index];
+            if(draw.transparent){
+                if(seenTransparent && quantizeSortDepth(draw.depth) > quantizeSortDepth(lastDepth)) valid = false;
+                seenTransparent = true;
+                lastDepth = draw.depth;
+            } else if(seenTransparent) valid = false;
+        }
+
+        // Count the state switches of the opaque draws in the extraction order and in the sorted order
+        auto countSwitches = [&](auto drawAt, size_t count, std::uint32_t Draw::* state){
+            size_t switches = 0;
+            std::uint32_t last = 0;
+            for(size_t index = 0; index < count; index++){
+                const Draw& draw = drawAt(index);
+                if(draw.transparent) continue;
+                if(draw.*state != last) switches++;
+                last = draw.*state;
+            }
+            return switches;
+        };
+        auto unsorted = [&](size_t index) -> const Draw& { return draws[index]; };
+        auto sorted = [&](size_t index) -> const Draw& { return draws[queue[index].index]; };
+
+        report("draws", double(drawCount), "");
+        report("shader switches unsorted", double(countSwitches(unsorted, draws.size(), &Draw::shader)), "");
+        report("shader switches sorted", double(countSwitches(sorted, queue.size(), &Draw::shader)), "");
+        report("texture switches unsorted", double(countSwitches(unsorted, draws.size(), &Draw::texture)), "");
+        report("texture switches sorted", double(countSwitches(sorted, queue.size(), &Draw::texture)), "");
+        report("struct sort", structTime, "ms");
+        report("key radix sort", keyTime, "ms");
+        report("speedup", keyTime > 0 ? structTime / keyTime : 0, "x");
+        report("valid", valid ? 1 : 0, "");
+        return valid ? 0 : -1;
+    }
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <ecs/world.hpp>
+#include <ecs/compiled-scene.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+namespace our::benchmarks {
+
+    // This benchmark loads a scene file from its json and from its compiled version (see "ecs/compiled-scene.hpp").
+    // The scene is repeated to get a bigger world. The assets are not loaded so the mesh renderers get null assets.
+    // It fails if the two worlds differ, or if a compiled scene with a component that fails to read is not rejected.
+    // Config:
+    //      "scene": the path of the json scene file (default: "config/scenes/race.jsonc")
+    //      "copies": how many times the entities of the scene are repeated (default: 100)
+    //      "repetitions": how many times each load is timed (the best one is reported) (default: 5)
+    inline int sceneLoadingBenchmark(const nlohmann::json& config) {
+        std::string scenePath = config.value("scene", "config/scenes/race.jsonc");
+        int copies = config.value("copies", 100);
+        int repetitions = config.value("repetitions", 5);
+
+        std::ifstream sceneFile(scenePath);
+        if(!sceneFile){
+            std::cerr << "Couldn't open the scene file: " << scenePath << std::endl;
+            return -1;
+        }
+        nlohmann::json scene = nlohmann::json::parse(sceneFile, nullptr, true, true);
+        nlohmann::json repeated = nlohmann::json::array();
+        for(int copy = 0; copy < copies; copy++){
+            for(auto& entity : scene) repeated.push_back(entity);
+        }
+
+        // The repeated scene is written next to the working directory so both loads read a file
+        const std::string jsonPath = "scene-loading-benchmark.json";
+        const std::string compiledPath = getCompiledScenePath(jsonPath);
+        std::string source = repeated.dump(2);
+        std::ofstream(jsonPath, std::ios::binary) << source;
+        std::uint64_t hash = hashSceneSource(source);
+
+        World fromJson, fromBinary;
+        double jsonTime = bestOf(repetitions, [&](){
+            fromJson.clear();
+            std::ifstream file(jsonPath, std::ios::binary);
+            std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            fromJson.deserialize(nlohmann::json::parse(text, nullptr, true, true));
+        });
+
+        Stopwatch stopwatch;
+        bool compiled = compileScene(fromJson.getEntities(), hash, compiledPath);
+        double compileTime = stopwatch.elapsedMilliseconds();
+
+        bool loaded = true;
+        double binaryTime = bestOf(repetitions, [&](){
+            fromBinary.clear();
+            loaded = loadCompiledScene(fromBinary, compiledPath, hash) && loaded;
+        });
+
+        // The compiled scene keeps the order of the json (parents already come before their children)
+        const auto& expected = fromJson.getEntities();
+        const auto& actual = fromBinary.getEntities();
+        bool valid = compiled && loaded && expected.size() == actual.size();
+        std::unordered_map<Entity*, size_t> expectedIndices;
+        for(size_t index = 0; index < expected.size(); index++) expectedIndices[expected[index]] = index;
+        for(size_t index = 0; valid && index < expected.size(); index++){
+            Entity* a = expected[index];
+            Entity* b = actual[index];
+            valid = a->getName() == b->getName() && a->localTransform == b->localTransform
+                && a->getComponentMask() == b->getComponentMask() && a->getComponentCount() == b->getComponentCount();
+            if(valid && a->parent) valid = b->parent && b->parent == actual[expectedIndices[a->parent]];
+        }
+
+        // The component data must survive the round trip, so compiling the loaded world must give the same file
+        const std::string recompiledPath = "scene-loading-benchmark-2.bscene";
+        auto readFile = [](const std::string& path){
+            std::ifstream file(path, std::ios::binary);
+            return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        };
+        valid = valid && compileScene(fromBinary.getEntities(), hash, recompiledPath) && readFile(compiledPath) == readFile(recompiledPath);
+
+        // A component that fails to read makes the file invalid: the load fails and removes the entities it added
+        // (the data of the last component with data is cut so reading it runs out of bytes)
+        std::string corrupted = readFile(compiledPath);
+        CompiledSceneHeader header;
+        std::memcpy(&header, corrupted.data(), sizeof(header));
+        size_t componentsOffset = sizeof(header) + size_t(header.stringCount) * sizeof(SceneStringRecord)
+            + size_t(header.entityCount) * sizeof(SceneEntityRecord);
+        bool cut = false;
+        for(size_t index = header.componentCount; !cut && index > 0; index--){
+            SceneComponentRecord record;
+            char* position = corrupted.data() + componentsOffset + (index - 1) * sizeof(SceneComponentRecord);
+            std::memcpy(&record, position, sizeof(record));
+            if(record.dataSize == 0) continue;
+            record.dataSize = 0;
+            std::memcpy(position, &record, sizeof(record));
+            cut = true;
+        }
+        std::ofstream(recompiledPath, std::ios::binary | std::ios::trunc) << corrupted;
+        World rejected;
+        rejected.add();
+        bool rejectedCorruption = cut && !loadCompiledScene(rejected, recompiledPath, hash) && rejected.getEntities().size() == 1;
+        valid = valid && rejectedCorruption;
+
+        std::ifstream compiledFile(compiledPath, std::ios::binary | std::ios::ate);
+        report("entities", double(expected.size()), "");
+        report("json size", double(source.size()) / 1024.0, "KiB");
+        report("compiled size", double(compiledFile.tellg()) / 1024.0, "KiB");
+        report("load (json)", jsonTime, "ms");
+        report("compile", compileTime, "ms");
+        report("load (compiled)", binaryTime, "ms");
+        report("speedup", binaryTime > 0 ? jsonTime / binaryTime : 0, "x");
+        report("corrupted component rejected", rejectedCorruption ? 1 : 0, "");
+        report("valid", valid ? 1 : 0, "");
+
+        compiledFile.close();
+        std::remove(jsonPath.c_str());
+        std::remove(compiledPath.c_str());
+        std::remove(recompiledPath.c_str());
+        return valid ? 0 : -1;
+    }
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <ecs/world.hpp>
+#include <ecs/scheduler.hpp>
+#include <components/movement.hpp>
+#include <components/collider.hpp>
+#include <components/sound.hpp>
+#include <components/light.hpp>
+
+#include <cmath>
+
+namespace our::benchmarks {
+
+    // This benchmark runs a set of synthetic systems (each one burns a fixed amount of CPU time) through the scheduler.
+    // It compares the deterministic mode (one system after the other) against the worker threads, and checks that
+    // conflicting systems never overlap in the parallel runs.
+    // Config:
+    //      "workers": the number of worker threads in the parallel runs (default: -1, one less than the hardware threads)
+    //      "work": the number of sqrt iterations each system performs (default: 200000)
+    //      "frames": how many frames are timed (default: 100)
+    //      "timelinePath": if not empty, the timeline of the last frames is written there (default: "")
+    inline int schedulerBenchmark(const nlohmann::json& config) {
+        int workers = config.value("workers", -1);
+        int work = config.value("work", 200000);
+        int frames = config.value("frames", 100);
+        std::string timelinePath = config.value("timelinePath", "");
+
+        // A system that burns CPU time and keeps track of the overlaps with the systems that it conflicts with
+        struct Probe { std::atomic<int> running{0}; };
+        Probe probes[6];
+        std::atomic<int> overlaps{0};
+        auto burn = [work](){
+            volatile float sink = 0;
+            for(int iteration = 0; iteration < work; iteration++) sink = sink + std::sqrt(float(iteration));
+        };
+
+        // The systems mimic the play state: the first two and the last two conflict (Transform & sound) while the others don't
+        SystemAccess accesses[6] = {
+            SystemAccess().read<MovementComponent>().write<Transform>(),
+            SystemAccess().read<Transform>().write<ColliderComponent>(),
+            SystemAccess().write<SoundComponent>(),
+            SystemAccess().write<LightComponent>(),
+            SystemAccess().read<ColliderComponent>(),
+            SystemAccess().read<SoundComponent>().write<Transform>()
+        };
+        auto makeSystem = [&](int index){
+            return [&, index](World*, float){
+                probes[index].running++;
+                for(int other = 0; other < 6; other++){
+                    if(other != index && probes[other].running > 0 && accesses[index].conflictsWith(accesses[other])) overlaps++;
+                }
+                burn();
+                probes[index].running--;
+            };
+        };
+        auto runFrames = [&](SystemScheduler& scheduler){
+            World world;
+            for(int index = 0; index < 6; index++) scheduler.add("System " + std::to_string(index), accesses[index], makeSystem(index));
+            Stopwatch stopwatch;
+            for(int frame = 0; frame < frames; frame++) scheduler.run(&world, 1.0f / 60.0f);
+            return stopwatch.elapsedMilliseconds() / frames;
+        };
+
+        JobSystem::get().configure({{"workers", workers}});
+
+        SystemScheduler serial;
+        serial.setDeterministic(true);
+        double serialTime = runFrames(serial);
+
+        SystemScheduler parallel;
+        parallel.configure({{"timelineFrames", timelinePath.empty() ? 0 : 10}});
+        double parallelTime = runFrames(parallel);
+        if(!timelinePath.empty()) parallel.writeTimeline(timelinePath);
+
+        report("workers", double(parallel.getWorkerCount()), "");
+        report("deterministic", serialTime, "ms/frame");
+        report("parallel", parallelTime, "ms/frame");
+        report("speedup", serialTime / parallelTime, "x");
+        report("conflicting overlaps", overlaps.load(), "");
+        JobSystem::get().stop();
+        return overlaps == 0 ? 0 : -1;
+    }
+
+}
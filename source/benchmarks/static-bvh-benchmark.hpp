@@ -0,0 +1,138 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <systems/static-bvh.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace our::benchmarks {
+
+    // This benchmark scatters props along a circular track and compares the BVH of "systems/static-bvh.hpp" against
+    // testing every prop: frustum culling from a camera on the track, ray picks and proximity queries.
+    // It fails if the BVH and the linear tests don't return the same props (the ray picks must hit at the same distance).
+    // Config:
+    //      "props": the number of props (default: 20000)
+    //      "radius": the radius of the track (default: 500)
+    //      "far": the far plane of the camera (default: 200)
+    //      "rays": the number of random ray picks (default: 1000)
+    //      "repetitions": how many times each query is timed (the best one is reported) (default: 10)
+    inline int staticBvhBenchmark(const nlohmann::json& config) {
+        int count = config.value("props", 20000);
+        float trackRadius = config.value("radius", 500.0f);
+        float far = config.value("far", 200.0f);
+        int rayCount = config.value("rays", 1000);
+        int repetitions = config.value("repetitions", 10);
+
+        // The props stand on both sides of the track (a ring on the ground)
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> angle(0.0f, glm::two_pi<float>()), offset(-40.0f, 40.0f), size(0.5f, 4.0f);
+        std::vector<CullBox> boxes(count);
+        for(auto& box : boxes){
+            float around = angle(generator), across = trackRadius + offset(generator);
+            box.extents = glm::vec3(size(generator), size(generator), size(generator));
+            box.center = glm::vec3(std::cos(around) * across, box.extents.y, std::sin(around) * across);
+        }
+
+        BoundingVolumeHierarchy bvh;
+        double buildTime = bestOf(repetitions, [&](){ bvh.build(boxes); });
+        double refitTime = bestOf(repetitions, [&](){ bvh.refit(); });
+        // The reference tests use the boxes as the BVH stores them (min and max) so both round the same way
+        std::vector<glm::vec3> boxMin(count), boxMax(count);
+        for(int item = 0; item < count; item++){
+            CullBox& box = boxes[item];
+            boxMin[item] = box.center - box.extents;
+            boxMax[item] = box.center + box.extents;
+            box = {(boxMin[item] + boxMax[item]) * 0.5f, (boxMax[item] - boxMin[item]) * 0.5f};
+        }
+
+        // The camera drives on the track looking along it
+        glm::vec3 eye(trackRadius, 2.0f, 0.0f);
+        glm::mat4 VP = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, far) *
+                       glm::lookAt(eye, eye + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        Frustum frustum = Frustum::fromViewProjection(VP);
+
+        std::vector<char> visible(count);
+        double linearCullTime = bestOf(repetitions, [&](){
+            std::fill(visible.begin(), visible.end(), 1);
+            cullBoxesScalar(frustum, boxes.data(), count, visible.data());
+        });
+        std::vector<std::uint32_t> culled;
+        double bvhCullTime = bestOf(repetitions, [&](){
+            culled.clear();
+            bvh.cull(frustum, culled);
+        });
+        std::vector<std::uint32_t> expected;
+        for(int item = 0; item < count; item++) if(visible[item]) expected.push_back(std::uint32_t(item));
+        std::sort(culled.begin(), culled.end());
+        bool valid = culled == expected;
+
+        // Rays are cast from above the track toward random points on the ground
+        std::vector<glm::vec3> origins(rayCount), directions(rayCount);
+        for(int ray = 0; ray < rayCount; ray++){
+            float around = angle(generator);
+            origins[ray] = glm::vec3(std::cos(around) * trackRadius, 30.0f, std::sin(around) * trackRadius);
+            directions[ray] = glm::vec3(offset(generator), -30.0f, offset(generator));
+        }
+        auto linearRaycast = [&](const glm::vec3& origin, const glm::vec3& direction){
+            glm::vec3 inverseDirection = 1.0f / direction;
+            float nearest = std::numeric_limits<float>::infinity();
+            for(int item = 0; item < count; item++){
+                glm::vec3 t1 = (boxMin[item] - origin) * inverseDirection, t2 = (boxMax[item] - origin) * inverseDirection;
+                glm::vec3 lower = glm::min(t1, t2), upper = glm::max(t1, t2);
+                float enter = std::max({lower.x, lower.y, lower.z, 0.0f});
+                float exit = std::min({upper.x, upper.y, upper.z, nearest});
+                if(enter <= exit && enter < nearest) nearest = enter;
+            }
+            return nearest;
+        };
+        std::vector<float> linearHits(rayCount), bvhHits(rayCount);
+        double linearRayTime = bestOf(repetitions, [&](){
+            for(int ray = 0; ray < rayCount; ray++) linearHits[ray] = linearRaycast(origins[ray], directions[ray]);
+        });
+        double bvhRayTime = bestOf(repetitions, [&](){
+            for(int ray = 0; ray < rayCount; ray++) bvhHits[ray] = bvh.raycast(origins[ray], directions[ray]).distance;
+        });
+        size_t rayHits = 0;
+        for(int ray = 0; ray < rayCount; ray++){
+            if(linearHits[ray] != bvhHits[ray]) valid = false;
+            if(bvhHits[ray] < std::numeric_limits<float>::infinity()) rayHits++;
+        }
+
+        // The props within 50 units of the camera
+        std::vector<std::uint32_t> nearby;
+        double proximityTime = bestOf(repetitions, [&](){
+            nearby.clear();
+            bvh.queryRadius(eye, 50.0f, nearby);
+        });
+        size_t expectedNearby = 0;
+        for(int item = 0; item < count; item++){
+            glm::vec3 outside = glm::max(glm::max(boxMin[item] - eye, eye - boxMax[item]), glm::vec3(0.0f));
+            if(glm::dot(outside, outside) <= 50.0f * 50.0f) expectedNearby++;
+        }
+        valid = valid && nearby.size() == expectedNearby;
+
+        report("props", count, "");
+        report("nodes", double(bvh.getNodeCount()), "");
+        report("build", buildTime, "ms");
+        report("refit", refitTime, "ms");
+        report("visible", double(culled.size()), "");
+        report("linear cull", linearCullTime * 1000, "us");
+        report("bvh cull", bvhCullTime * 1000, "us");
+        report("cull speedup", bvhCullTime > 0 ? linearCullTime / bvhCullTime : 0, "x");
+        report("ray hits", double(rayHits), "");
+        report("linear ray pick", linearRayTime * 1000 / rayCount, "us");
+        report("bvh ray pick", bvhRayTime * 1000 / rayCount, "us");
+        report("nearby props", double(nearby.size()), "");
+        report("bvh proximity query", proximityTime * 1000, "us");
+        report("valid", valid ? 1 : 0, "");
+        return valid ? 0 : -1;
+    }
+
+}
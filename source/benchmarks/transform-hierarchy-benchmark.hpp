@@ -0,0 +1,99 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <ecs/world.hpp>
+
+#include <random>
+#include <vector>
+
+namespace our::benchmarks {
+
+    // This benchmark measures the cost of computing the local to world matrices of every entity in a scene.
+    // It compares the recursive "Entity::getLocalToWorldMatrix" (which walks the whole parent chain per call)
+    // against "World::updateTransforms" followed by reading the cached matrices.
+    // Config:
+    //      "entities": the number of entities in the scene (default: 10000)
+    //      "depth": the maximum depth of the hierarchy (default: 4)
+    //      "moving": the fraction of entities whose local transform changes every frame (default: 0.1)
+    //      "frames": how many frames are simulated per run (default: 20)
+    //      "repetitions": how many runs are timed (the best one is reported) (default: 5)
+    inline int transformHierarchyBenchmark(const nlohmann::json& config) {
+        int entityCount = config.value("entities", 10000);
+        int maxDepth = config.value("depth", 4);
+        float movingFraction = config.value("moving", 0.1f);
+        int frames = config.value("frames", 20);
+        int repetitions = config.value("repetitions", 5);
+
+        World world;
+        std::vector<Entity*> entities;
+        std::vector<int> depths;
+        std::vector<Entity*> moving;
+        entities.reserve(entityCount);
+
+        // Build a forest where each entity picks a random earlier entity (that is not too deep) as its parent
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+        std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+        for(int index = 0; index < entityCount; index++){
+            Entity* entity = world.add();
+            int depth = 0;
+            if(index > 0 && chance(generator) < 0.7f){
+                int parentIndex = std::uniform_int_distribution<int>(0, index - 1)(generator);
+                if(depths[parentIndex] < maxDepth){
+                    entity->setParent(entities[parentIndex]);
+                    depth = depths[parentIndex] + 1;
+                }
+            }
+            entity->localTransform.position = glm::vec3(offset(generator), offset(generator), offset(generator));
+            entity->localTransform.rotation = glm::vec3(offset(generator), offset(generator), offset(generator)) * 0.1f;
+            entities.push_back(entity);
+            depths.push_back(depth);
+            if(chance(generator) < movingFraction) moving.push_back(entity);
+        }
+
+        // Every frame, the moving entities are nudged then the matrices of all the entities are read
+        float sink = 0;
+        auto move = [&](){
+            for(auto entity : moving) entity->localTransform.rotation.y += 0.01f;
+        };
+        auto recursive = [&](){
+            for(int frame = 0; frame < frames; frame++){
+                move();
+                for(auto entity : entities) sink += entity->getLocalToWorldMatrix()[3][0];
+            }
+        };
+        auto cached = [&](){
+            for(int frame = 0; frame < frames; frame++){
+                move();
+                world.updateTransforms();
+                for(auto entity : entities) sink += entity->getCachedLocalToWorldMatrix()[3][0];
+            }
+        };
+
+        // Make sure the cache agrees with the recursive computation before timing anything
+        world.updateTransforms();
+        float maxError = 0;
+        for(auto entity : entities){
+            glm::mat4 expected = entity->getLocalToWorldMatrix();
+            const glm::mat4& actual = entity->getCachedLocalToWorldMatrix();
+            for(int column = 0; column < 4; column++)
+                for(int row = 0; row < 4; row++)
+                    maxError = std::max(maxError, std::abs(expected[column][row] - actual[column][row]));
+        }
+
+        double recursiveTime = bestOf(repetitions, recursive);
+        double cachedTime = bestOf(repetitions, cached);
+
+        report("entities", entityCount, "");
+        report("moving entities", double(moving.size()), "");
+        report("max cache error", maxError, "");
+        report("recursive getLocalToWorldMatrix", recursiveTime / frames, "ms/frame");
+        report("updateTransforms + cached read", cachedTime / frames, "ms/frame");
+        report("speedup", recursiveTime / cachedTime, "x");
+        // Printing the sum keeps the compiler from optimizing the reads away
+        report("checksum", sink, "");
+        return maxError < 1e-3f ? 0 : -1;
+    }
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <ecs/transform.hpp>
+#include <ecs/transform-simd.hpp>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace our::benchmarks {
+
+    // Returns the largest difference between the entries of two matrices
+    // The difference is relative for entries larger than 1 (e.g. translations) and absolute otherwise
+    inline float maxDifference(const glm::mat4& expected, const glm::mat4& actual) {
+        float difference = 0;
+        for(int column = 0; column < 4; column++)
+            for(int row = 0; row < 4; row++)
+                difference = std::max(difference, std::abs(expected[column][row] - actual[column][row]) / std::max(1.0f, std::abs(expected[column][row])));
+        return difference;
+    }
+
+    // This benchmark checks the batch transform kernel against "Transform::toMat4" then compares their speed.
+    // Config:
+    //      "transforms": the number of transforms composed per run (default: 50000)
+    //      "repetitions": how many runs are timed (the best one is reported) (default: 10)
+    //      "tolerance": the largest allowed difference between a kernel entry and the reference (default: 1e-4)
+    inline int transformSimdBenchmark(const nlohmann::json& config) {
+        int count = config.value("transforms", 50000);
+        int repetitions = config.value("repetitions", 10);
+        float tolerance = config.value("tolerance", 1e-4f);
+
+        // Random transforms with angles spanning a few turns (in both directions) and non-uniform scales
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> angle(-4.0f * glm::pi<float>(), 4.0f * glm::pi<float>());
+        std::uniform_real_distribution<float> scale(0.25f, 4.0f);
+        std::vector<Transform> transforms(count);
+        for(auto& transform : transforms){
+            transform.position = glm::vec3(position(generator), position(generator), position(generator));
+            transform.rotation = glm::vec3(angle(generator), angle(generator), angle(generator));
+            transform.scale = glm::vec3(scale(generator), scale(generator), scale(generator));
+        }
+        std::vector<glm::mat4> reference(count), matrices(count), normalMatrices(count);
+
+        // Correctness: the matrices are compared against "toMat4" and the normal matrices against a full inverse
+        composeTransforms(transforms.data(), count, matrices.data(), normalMatrices.data());
+        float matrixError = 0, normalError = 0;
+        for(int index = 0; index < count; index++){
+            glm::mat4 expected = transforms[index].toMat4();
+            matrixError = std::max(matrixError, maxDifference(expected, matrices[index]));
+            normalError = std::max(normalError, maxDifference(glm::transpose(glm::inverse(expected)), normalMatrices[index]));
+        }
+
+        // Speed: the reference only computes the matrices, so the kernel is timed with and without the normal matrices
+        double referenceTime = bestOf(repetitions, [&](){
+            for(int index = 0; index < count; index++) reference[index] = transforms[index].toMat4();
+        });
+        double referenceWithNormalsTime = bestOf(repetitions, [&](){
+            for(int index = 0; index < count; index++){
+                reference[index] = transforms[index].toMat4();
+                normalMatrices[index] = glm::transpose(glm::inverse(reference[index]));
+            }
+        });
+        double scalarTime = bestOf(repetitions, [&](){
+            composeTransformsScalar(transforms.data(), count, matrices.data());
+        });
+        double kernelTime = bestOf(repetitions, [&](){
+            composeTransforms(transforms.data(), count, matrices.data());
+        });
+        double kernelWithNormalsTime = bestOf(repetitions, [&](){
+            composeTransforms(transforms.data(), count, matrices.data(), normalMatrices.data());
+        });
+
+        std::cout << "[benchmark] kernel: " << getTransformKernelName() << std::endl;
+        report("transforms", count, "");
+        report("max matrix error", matrixError, "");
+        report("max normal matrix error", normalError, "");
+        report("toMat4", referenceTime * 1000, "us");
+        report("toMat4 + inverse transpose", referenceWithNormalsTime * 1000, "us");
+        report("closed form scalar", scalarTime * 1000, "us");
+        report("batch kernel", kernelTime * 1000, "us");
+        report("batch kernel + normal matrices", kernelWithNormalsTime * 1000, "us");
+        report("speedup", referenceTime / kernelTime, "x");
+        report("speedup with normal matrices", referenceWithNormalsTime / kernelWithNormalsTime, "x");
+        // Printing an entry keeps the compiler from optimizing the reference away
+        report("checksum", reference[count / 2][3][0] + matrices[count / 2][3][0], "");
+        return (matrixError <= tolerance && normalError <= tolerance) ? 0 : -1;
+    }
+
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <ecs/world.hpp>
+#include <systems/movement.hpp>
+
+#include <algorithm>
+#include <random>
+
+namespace our::benchmarks {
+
+    // This benchmark moves entities scattered around a camera with the movement system, once at full rate and once with
+    // update LOD tiers (see "systems/update-lod.hpp").
+    // Like in the play state, the transform cache is updated before the systems run and the tick advances after them,
+    // so the distances of the parented movers (and of the camera on its rig) are read from the cache.
+    // It fails if an entity moved by the LOD system lags behind the full rate one by more than its slowest interval.
+    // Config:
+    //      "entities": the number of moving entities (default: 50000)
+    //      "radius": the entities are scattered up to this distance from the camera (default: 500)
+    //      "anchors": every other mover is the child of one of these static entities (default: 16)
+    //      "churn": the number of movers despawned and replaced by new ones after every frame (default: 200)
+    //      "frames": the number of simulated frames (default: 120)
+    //      "lod": the update LOD tiers (default: 1 frame up to 60, 2 up to 150, then 4, and x2 off-screen)
+    inline int updateLodBenchmark(const nlohmann::json& config) {
+        int entityCount = config.value("entities", 50000);
+        float radius = config.value("radius", 500.0f);
+        int anchorCount = config.value("anchors", 16);
+        int churn = config.value("churn", 200);
+        int frames = config.value("frames", 120);
+        nlohmann::json lodConfig = config.value("lod", nlohmann::json{
+            {"tiers", {{{"distance", 60}, {"interval", 1}}, {{"distance", 150}, {"interval", 2}}, {{"interval", 4}}}},
+            {"viewAngle", 140},
+            {"offscreenMultiplier", 2}
+        });
+        const float deltaTime = 1.0f / 60.0f;
+
+        // Adds a mover somewhere around the origin (relative to its parent if any)
+        std::uniform_real_distribution<float> coordinate(-radius, radius), speed(-5.0f, 5.0f);
+        auto addMover = [&](World& world, std::mt19937& generator, Entity* parent){
+            Entity* entity = world.add();
+            if(parent) entity->setParent(parent);
+            entity->localTransform.position = glm::vec3(coordinate(generator), 0, coordinate(generator));
+            auto movement = entity->addComponent<MovementComponent>();
+            movement->linearVelocity = glm::vec3(speed(generator), 0, speed(generator));
+            movement->angularVelocity = glm::vec3(0, speed(generator) * 10.0f, 0);
+        };
+        // Both worlds hold the same entities: a camera on a rig at the origin looking down -Z, a few anchors and the movers
+        // around them (the anchors are near the origin so their children stay within the radius)
+        auto populate = [&](World& world){
+            Entity* rig = world.add();
+            Entity* camera = world.add();
+            camera->setParent(rig);
+            camera->addComponent<CameraComponent>();
+            std::mt19937 generator(42);
+            std::vector<Entity*> anchors;
+            for(int index = 0; index < anchorCount; index++){
+                anchors.push_back(world.add());
+                anchors.back()->localTransform.position = glm::vec3(coordinate(generator), 0, coordinate(generator)) * 0.1f;
+            }
+            for(int index = 0; index < entityCount; index++)
+                addMover(world, generator, !anchors.empty() && index % 2 == 1 ? anchors[index / 2 % anchors.size()] : nullptr);
+        };
+        // Both worlds despawn the same movers and spawn the same new ones (at the sync point, like the play state)
+        auto replaceMovers = [&](World& world, std::mt19937& generator){
+            const auto& entities = world.getEntities();
+            std::uniform_int_distribution<size_t> pick(0, entities.size() - 1);
+            for(int count = 0; count < churn; count++){
+                Entity* entity = entities[pick(generator)];
+                if(!entity->getComponent<MovementComponent>()) continue;
+                // One at a time, so the order of the entities stays the same in both worlds
+                world.markForRemoval(entity);
+                world.deleteMarkedEntities();
+            }
+            for(int count = 0; count < churn; count++) addMover(world, generator, nullptr);
+        };
+        World fullWorld, lodWorld;
+        populate(fullWorld);
+        populate(lodWorld);
+        std::mt19937 fullChurn(7), lodChurn(7);
+
+        MovementSystem fullSystem, lodSystem;
+        lodSystem.configure(lodConfig);
+        double fullTime = 0, lodTime = 0;
+        size_t lodUpdates = 0;
+        for(int frame = 0; frame < frames; frame++){
+            fullWorld.updateTransforms();
+            lodWorld.updateTransforms();
+            Stopwatch stopwatch;
+            fullSystem.update(&fullWorld, deltaTime);
+            fullTime += stopwatch.elapsedMilliseconds();
+            stopwatch.reset();
+            lodSystem.update(&lodWorld, deltaTime);
+            lodTime += stopwatch.elapsedMilliseconds();
+            lodUpdates += lodSystem.getUpdatedCount();
+            replaceMovers(fullWorld, fullChurn);
+            replaceMovers(lodWorld, lodChurn);
+            fullWorld.advanceTick();
+            lodWorld.advanceTick();
+        }
+
+        // An entity may miss at most the frames of its slowest interval
+        std::uint32_t slowest = 1;
+        for(auto& tier : lodConfig.value("tiers", nlohmann::json::array())) slowest = std::max(slowest, tier.value("interval", 1u));
+        slowest *= std::max(lodConfig.value("offscreenMultiplier", 1u), 1u);
+        bool valid = true;
+        const auto& fullEntities = fullWorld.getEntities();
+        const auto& lodEntities = lodWorld.getEntities();
+        for(size_t index = 0; index < fullEntities.size(); index++){
+            auto movement = fullEntities[index]->getComponent<MovementComponent>();
+            if(!movement) continue;
+            float tolerance = glm::length(movement->linearVelocity) * deltaTime * float(slowest) * 1.01f + 1e-3f;
+            float error = glm::length(fullEntities[index]->localTransform.position - lodEntities[index]->localTransform.position);
+            valid = valid && error <= tolerance;
+        }
+
+        report("entities", double(entityCount), "");
+        report("replaced per frame", double(churn), "");
+        report("full rate per frame", fullTime / frames, "ms");
+        report("lod per frame", lodTime / frames, "ms");
+        report("lod updates per frame", double(lodUpdates) / frames, "");
+        report("valid", valid ? 1 : 0, "");
+        return valid ? 0 : -1;
+    }
+
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "benchmark.hpp"
+
+#include <ecs/world.hpp>
+#include <ecs/world-snapshot.hpp>
+#include <components/movement.hpp>
+#include <components/race.hpp>
+#include <components/rigidbody.hpp>
+
+#include <btBulletDynamicsCommon.h>
+#include <memory>
+
+namespace our::benchmarks {
+
+    // This benchmark fills a world with falling karts (a Bullet body, race progress and a few child entities each),
+    // keeps a snapshot of every tick in a "SnapshotHistory" then rolls back a few ticks.
+    // It fails if a restored world differs from the captured one.
+    // Config:
+    //      "karts": the number of karts (default: 1000)
+    //      "children": the number of children of each kart (default: 4)
+    //      "ticks": the number of simulated ticks (each one is captured) (default: 120)
+    //      "history": the number of snapshots kept for rollback (default: 60)
+    //      "rollback": how many ticks are rolled back at the end (default: 30)
+    inline int worldSnapshotBenchmark(const nlohmann::json& config) {
+        int kartCount = config.value("karts", 1000);
+        int childCount = config.value("children", 4);
+        int ticks = config.value("ticks", 120);
+        int historySize = config.value("history", 60);
+        int rollbackTicks = config.value("rollback", 30);
+        const float deltaTime = 1.0f / 60.0f;
+
+        btDefaultCollisionConfiguration collisionConfiguration;
+        btCollisionDispatcher dispatcher(&collisionConfiguration);
+        btDbvtBroadphase broadphase;
+        btSequentialImpulseConstraintSolver solver;
+        btDiscreteDynamicsWorld dynamicsWorld(&dispatcher, &broadphase, &solver, &collisionConfiguration);
+        dynamicsWorld.setGravity(btVector3(0, -9.81f, 0));
+        btBoxShape shape(btVector3(1, 0.5f, 2));
+        std::vector<std::unique_ptr<btDefaultMotionState>> motionStates;
+        std::vector<std::unique_ptr<btRigidBody>> bodies;
+
+        World world;
+        for(int kart = 0; kart < kartCount; kart++){
+            Entity* entity = world.add();
+            entity->setName("kart");
+            entity->localTransform.position = glm::vec3(float(kart % 32) * 4.0f, 10.0f + float(kart / 32), 0);
+            entity->addComponent<MovementComponent>()->angularVelocity = glm::vec3(0, 1, 0);
+            entity->addComponent<RacePlayerComponent>();
+            auto rigidbody = entity->addComponent<RigidbodyComponent>();
+            rigidbody->position = entity->localTransform.position;
+
+            btVector3 inertia;
+            shape.calculateLocalInertia(1.0f, inertia);
+            btTransform start(btQuaternion::getIdentity(), btVector3(rigidbody->position.x, rigidbody->position.y, rigidbody->position.z));
+            motionStates.push_back(std::make_unique<btDefaultMotionState>(start));
+            bodies.push_back(std::make_unique<btRigidBody>(btRigidBody::btRigidBodyConstructionInfo(1.0f, motionStates.back().get(), &shape, inertia)));
+            dynamicsWorld.addRigidBody(bodies.back().get());
+            rigidbody->rigidbody = bodies.back().get();
+            rigidbody->addedToWorld = true;
+
+            for(int child = 0; child < childCount; child++){
+                Entity* tire = world.add();
+                tire->setParent(entity);
+                tire->localTransform.position = glm::vec3(float(child), 0, 0);
+            }
+        }
+
+        // A tick moves the bodies and copies their transforms to the entities, then updates the race progress
+        auto tick = [&](){
+            dynamicsWorld.stepSimulation(deltaTime, 1, deltaTime);
+            for(auto [entity, rigidbody, player] : world.view<RigidbodyComponent, RacePlayerComponent>()){
+                const btVector3& origin = rigidbody->rigidbody->getWorldTransform().getOrigin();
+                rigidbody->position = glm::vec3(origin.x(), origin.y(), origin.z());
+                entity->localTransform.position = rigidbody->position;
+                for(auto child : entity->getChildren()) child->localTransform.rotation.x += deltaTime;
+                player->raceTime += deltaTime;
+                player->currentLapTime += deltaTime;
+                if(player->currentLapTime > 0.5f){
+                    player->lapTimes.push_back(player->currentLapTime);
+                    player->currentLapTime = 0;
+                }
+            }
+        };
+
+        // Returns a checksum of the state touched by a tick
+        auto checksum = [&](){
+            double sum = 0;
+            for(auto entity : world.getEntities()){
+                sum += entity->localTransform.position.y + entity->localTransform.rotation.x;
+                if(auto player = entity->getComponent<RacePlayerComponent>()) sum += player->raceTime + double(player->lapTimes.size());
+                if(auto rigidbody = entity->getComponent<RigidbodyComponent>()){
+                    sum += rigidbody->rigidbody->getWorldTransform().getOrigin().y() + rigidbody->rigidbody->getLinearVelocity().y();
+                }
+            }
+            return sum;
+        };
+
+        SnapshotHistory history(size_t(historySize > 0 ? historySize : 1));
+        std::vector<double> checksums;
+        double captureTime = 0, simulationTime = 0;
+        for(int index = 0; index < ticks; index++){
+            Stopwatch stopwatch;
+            tick();
+            simulationTime += stopwatch.elapsedMilliseconds();
+            stopwatch.reset();
+            history.push(world);
+            captureTime += stopwatch.elapsedMilliseconds();
+            checksums.push_back(checksum());
+        }
+
+        size_t captured = history.size();
+        bool valid = rollbackTicks >= 0 && size_t(rollbackTicks) < captured;
+        double restoreTime = 0;
+        if(valid){
+            Stopwatch stopwatch;
+            valid = history.rollback(world, size_t(rollbackTicks));
+            restoreTime = stopwatch.elapsedMilliseconds();
+            valid = valid && checksum() == checksums[checksums.size() - 1 - rollbackTicks];
+            valid = valid && history.size() == captured - size_t(rollbackTicks);
+        }
+        // The snapshots must refuse to restore a world whose structure changed
+        WorldSnapshot latest;
+        latest.capture(world);
+        world.markForRemoval(world.getEntities().back());
+        world.deleteMarkedEntities();
+        valid = valid && !latest.restore(world);
+
+        for(auto& body : bodies) dynamicsWorld.removeRigidBody(body.get());
+
+        report("entities", double(kartCount) * (childCount + 1), "");
+        report("snapshot size", double(latest.getSize()) / 1024.0, "KiB");
+        report("simulation per tick", simulationTime / ticks, "ms");
+        report("capture per tick", captureTime / ticks, "ms");
+        report("restore", restoreTime, "ms");
+        report("valid", valid ? 1 : 0, "");
+        return valid ? 0 : -1;
+    }
+
+}
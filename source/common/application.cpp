@@ -23,6 +23,8 @@
 #endif
 
 #include "texture/screenshot.hpp"
+#include "jobs/job-system.hpp"
+#include "gl-state-cache.hpp"
 
 std::string default_screenshot_filepath() {
     std::stringstream stream;
@@ -210,6 +212,9 @@ int our::Application::run(int run_for_frames) {
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init("#version 330 core");
 
+    // Start the worker threads shared by the systems and the asset loaders (see the "jobs" section of the config)
+    JobSystem::get().configure(app_config.value("jobs", nlohmann::json::object()));
+
     // This part of the code extracts the list of requested screenshots and puts them into a priority queue
     using ScreenshotRequest = std::pair<int, std::string>;
     std::priority_queue<
@@ -267,6 +272,9 @@ int our::Application::run(int run_for_frames) {
         // Get the current time (the time at which we are starting the current frame).
         double current_frame_time = glfwGetTime();
 
+        // ImGui, the screenshots and the state changes use raw GL calls, so the state cache starts every frame from scratch
+        our::GLStateCache::get().invalidate();
+
         // Call onDraw, in which we will draw the current frame, and send to it the time difference between the last and current frame
         if(currentState) currentState->onDraw(current_frame_time - last_frame_time);
         last_frame_time = current_frame_time; // Then update the last frame start time (this frame is now the last frame)
@@ -329,6 +337,9 @@ int our::Application::run(int run_for_frames) {
     // Call for cleaning up
     if(currentState) currentState->onDestroy();
 
+    // Stop the job system workers
+    JobSystem::get().stop();
+
     // Shutdown ImGui & destroy the context
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
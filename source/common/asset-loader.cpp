@@ -8,12 +8,17 @@
 #include "mesh/mesh-utils.hpp"
 #include "material/material.hpp"
 #include "deserialize-utils.hpp"
+#include "jobs/job-system.hpp"
+#include "incremental-loader.hpp"
+
+#include <memory>
 
 namespace our {
 
     // This will load all the shaders defined in "data"
     // data must be in the form:
     //    { shader_name : { "vs" : "path/to/vertex-shader", "fs" : "path/to/fragment-shader" }, ... }
+    // A shader may add "instanced" : "path/to/instanced-vertex-shader" to get an instanced variant
     template<>
     void AssetLoader<ShaderProgram>::deserialize(const nlohmann::json& data) {
         if(data.is_object()){
@@ -24,6 +29,15 @@ namespace our {
                 shader->attach(vsPath, GL_VERTEX_SHADER);
                 shader->attach(fsPath, GL_FRAGMENT_SHADER);
                 shader->link();
+                // The optional instanced variant shares the fragment shader (see "ShaderProgram::getInstancedVariant")
+                std::string instancedPath = desc.value("instanced", "");
+                if(!instancedPath.empty()){
+                    auto variant = new ShaderProgram();
+                    variant->attach(instancedPath, GL_VERTEX_SHADER);
+                    variant->attach(fsPath, GL_FRAGMENT_SHADER);
+                    variant->link();
+                    shader->setInstancedVariant(variant);
+                }
                 assets[name] = shader;
             }
         }
@@ -32,12 +46,22 @@ namespace our {
     // This will load all the textures defined in "data"
     // data must be in the form:
     //    { texture_name : "path/to/image", ... }
+    // The images are decoded in parallel by the job system, then they are uploaded to OpenGL by the calling thread
     template<>
     void AssetLoader<Texture2D>::deserialize(const nlohmann::json& data) {
         if(data.is_object()){
+            std::vector<std::pair<std::string, std::string>> requests;
             for(auto& [name, desc] : data.items()){
-                std::string path = desc.get<std::string>();
-                assets[name] = texture_utils::loadImage(path);
+                requests.emplace_back(name, desc.get<std::string>());
+            }
+            std::vector<texture_utils::DecodedImage> images(requests.size());
+            JobSystem::get().parallelFor(requests.size(), [&](size_t begin, size_t end){
+                for(size_t index = begin; index < end; index++){
+                    images[index] = texture_utils::decodeImage(requests[index].second);
+                }
+            });
+            for(size_t index = 0; index < requests.size(); index++){
+                assets[requests[index].first] = texture_utils::uploadImage(images[index]);
             }
         }
     };
@@ -63,12 +87,23 @@ namespace our {
     // This will load all the meshes defined in "data"
     // data must be in the form:
     //    { mesh_name : "path/to/3d-model-file", ... }
+    // A mesh can also be given as { "path": "path/to/3d-model-file", "occluder": ... } to keep its triangles for the
+    // occlusion culling (see "systems/occlusion-culling.hpp"). "occluder" is either true (the whole mesh hides what is
+    // behind it) or the names of its opaque objects in the file (the others, e.g. the trees drawn on alpha tested
+    // quads, don't hide anything).
     template<>
     void AssetLoader<Mesh>::deserialize(const nlohmann::json& data) {
         if(data.is_object()){
             for(auto& [name, desc] : data.items()){
-                std::string path = desc.get<std::string>();
-                assets[name] = mesh_utils::loadOBJ(path);
+                if(desc.is_object()){
+                    auto occluder = desc.value("occluder", nlohmann::json(false));
+                    if(occluder.is_array())
+                        assets[name] = mesh_utils::loadOBJ(desc.value("path", ""), true, occluder.get<std::vector<std::string>>());
+                    else
+                        assets[name] = mesh_utils::loadOBJ(desc.value("path", ""), occluder.get<bool>());
+                } else {
+                    assets[name] = mesh_utils::loadOBJ(desc.get<std::string>());
+                }
             }
         }
     };
@@ -111,6 +146,73 @@ namespace our {
             AssetLoader<Material>::deserialize(assetData["materials"]);
     }
 
+    namespace {
+        // Queues one step per asset of type T. Each step deserializes an object holding only that asset.
+        template<typename T>
+        void queueAssets(IncrementalLoader& loader, const nlohmann::json& data, const std::string& kind){
+            if(!data.is_object()) return;
+            for(auto& [name, desc] : data.items()){
+                nlohmann::json single = nlohmann::json::object();
+                single[name] = desc;
+                loader.add("Loading " + kind + " \"" + name + "\"", [single = std::move(single)](){
+                    AssetLoader<T>::deserialize(single);
+                });
+            }
+        }
+
+        // The images of the queued textures (they are decoded by the job system while the other steps run)
+        struct TextureDecoding {
+            std::vector<std::pair<std::string, std::string>> requests; // The name and the path of each texture
+            std::vector<texture_utils::DecodedImage> images;
+            std::unique_ptr<JobCounter[]> decoded; // One counter per image
+
+            // If the loading is dropped before every image is uploaded, the remaining pixels are freed here
+            ~TextureDecoding(){
+                for(auto& image : images) texture_utils::freeImage(image);
+            }
+        };
+
+        void queueTextures(IncrementalLoader& loader, const nlohmann::json& data){
+            if(!data.is_object()) return;
+            auto decoding = std::make_shared<TextureDecoding>();
+            for(auto& [name, desc] : data.items()){
+                decoding->requests.emplace_back(name, desc.get<std::string>());
+            }
+            size_t count = decoding->requests.size();
+            decoding->images.resize(count);
+            decoding->decoded = std::make_unique<JobCounter[]>(count);
+            // The jobs are submitted from the last image to the first since the waiting thread runs the newest jobs first
+            // (so if there are no workers, each upload step only decodes its own image)
+            auto& jobs = JobSystem::get();
+            for(size_t index = count; index-- > 0;){
+                jobs.submit([decoding, index](){
+                    decoding->images[index] = texture_utils::decodeImage(decoding->requests[index].second);
+                }, decoding->decoded[index]);
+            }
+            for(size_t index = 0; index < count; index++){
+                loader.add("Loading texture \"" + decoding->requests[index].first + "\"", [decoding, index](){
+                    JobSystem::get().wait(decoding->decoded[index]);
+                    AssetLoader<Texture2D>::add(decoding->requests[index].first, texture_utils::uploadImage(decoding->images[index]));
+                });
+            }
+        }
+    }
+
+    void queueAllAssets(IncrementalLoader& loader, const nlohmann::json& assetData){
+        if(!assetData.is_object()) return;
+        // The textures start decoding first so the decoding overlaps the shader compilation
+        if(assetData.contains("textures"))
+            queueTextures(loader, assetData["textures"]);
+        if(assetData.contains("shaders"))
+            queueAssets<ShaderProgram>(loader, assetData["shaders"], "shader");
+        if(assetData.contains("samplers"))
+            queueAssets<Sampler>(loader, assetData["samplers"], "sampler");
+        if(assetData.contains("meshes"))
+            queueAssets<Mesh>(loader, assetData["meshes"], "mesh");
+        if(assetData.contains("materials"))
+            queueAssets<Material>(loader, assetData["materials"], "material");
+    }
+
     void clearAllAssets(){
         AssetLoader<ShaderProgram>::clear();
         AssetLoader<Texture2D>::clear();
@@ -6,6 +6,8 @@
 
 namespace our {
 
+    class IncrementalLoader; // A forward declaration of the IncrementalLoader Class
+
     // This static template class will hold the loaded assets
     // and can be called from anywhere to get an asset by its name.
     // Since we have different types of assets, this declared as a template class
@@ -32,6 +34,22 @@ namespace our {
             }
             return nullptr;
         };
+        // This function returns the name of the given asset (or an empty string if this loader doesn't hold it)
+        // It walks all the assets so it is meant for the tools (e.g. compiling a scene), not for the hot paths
+        static const std::string& getName(const T* asset) {
+            static const std::string empty;
+            for(auto& [name, held] : assets){
+                if(held == asset) return name;
+            }
+            return empty;
+        }
+        // This function adds an asset that was loaded outside of "deserialize" (e.g. by "queueAllAssets")
+        // The asset is then owned by the asset loader (and an asset with the same name is replaced)
+        static void add(const std::string& name, T* asset) {
+            auto& held = assets[name];
+            if(held && held != asset) delete held;
+            held = asset;
+        }
         // This function deletes all the assets held by this class and clear the assets map 
         static void clear(){
             for(auto& [name, asset] : assets){
@@ -46,6 +64,9 @@ namespace our {
     // For example, a json in the form {"shaders": ... , "textures": ... } will call "deserialize" for:
     // AssetLoader<ShaderProgram> and AssetLoader<Texture2D>
     void deserializeAllAssets(const nlohmann::json& assetData);
+    // Does the same as "deserializeAllAssets" but queues one loading step per asset in the given incremental loader
+    // The images of the textures are decoded by the job system in the background and uploaded one per step
+    void queueAllAssets(IncrementalLoader& loader, const nlohmann::json& assetData);
     // This will call "AssetLoader<T>::clear" for all the different asset types T
     void clearAllAssets();
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "camera.hpp"
+#include "../ecs/scene-stream.hpp"
 #include "../ecs/entity.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp> 
@@ -20,9 +21,10 @@ namespace our {
     }
 
     // Creates and returns the camera view matrix
+    // The owner's matrix comes from the world's transform cache, so the parent chain is not walked on every call
     glm::mat4 CameraComponent::getViewMatrix() const {
         auto owner = getOwner();
-        auto M = owner->getLocalToWorldMatrix();
+        const glm::mat4& M = owner->getCachedLocalToWorldMatrix();
         //TODO: (Req 8) Complete this function
         //HINT:
         // In the camera space:
@@ -58,4 +60,22 @@ namespace our {
             return glm::perspective(fovY, aspectRatio, near, far);
         }
     }
+
+    // Writes the camera parameters to a compiled scene
+    void CameraComponent::write(SceneWriter& writer) const {
+        writer.write(cameraType);
+        writer.write(near);
+        writer.write(far);
+        writer.write(fovY);
+        writer.write(orthoHeight);
+    }
+
+    // Reads the camera parameters from a compiled scene
+    void CameraComponent::read(SceneReader& reader) {
+        reader.read(cameraType);
+        reader.read(near);
+        reader.read(far);
+        reader.read(fovY);
+        reader.read(orthoHeight);
+    }
 }
\ No newline at end of file
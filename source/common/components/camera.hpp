@@ -22,12 +22,15 @@ namespace our {
         float orthoHeight; // The orthographic height of the camera if it is an orthographic camera
 
         // The ID of this component type is "Camera"
-        static std::string getID() { return "Camera"; }
+        static const std::string& getID() { static const std::string id = "Camera"; return id; }
 
         // Reads camera parameters from the given json object
         void deserialize(const nlohmann::json& data) override;
+        // Writes/reads the component to/from a compiled scene
+        void write(SceneWriter& writer) const override;
+        void read(SceneReader& reader) override;
 
-        // Creates and returns the camera view matrix
+        // Creates and returns the camera view matrix (from the cached transform, see "Entity::getCachedLocalToWorldMatrix")
         glm::mat4 getViewMatrix() const;
         
         // Creates and returns the camera projection matrix
@@ -1,4 +1,5 @@
 #include "collider.hpp"
+#include "../ecs/scene-stream.hpp"
 #include "../ecs/entity.hpp"
 #include "../deserialize-utils.hpp"
 
@@ -19,4 +20,36 @@ namespace our
         id = data.value("id", id);
         mesh = data.value("mesh", mesh);
     }
+
+    void ColliderComponent::write(SceneWriter &writer) const
+    {
+        writer.write(center);
+        writer.write(size);
+        writer.writeString(id);
+        writer.writeString(mesh);
+    }
+
+    void ColliderComponent::read(SceneReader &reader)
+    {
+        reader.read(center);
+        reader.read(size);
+        reader.readString(id);
+        reader.readString(mesh);
+    }
+
+    void ColliderComponent::saveState(SceneWriter &writer) const
+    {
+        write(writer);
+        writer.write(std::uint32_t(collidingWith.size()));
+        for (auto &other : collidingWith)
+            writer.writeString(other);
+    }
+
+    void ColliderComponent::loadState(SceneReader &reader)
+    {
+        read(reader);
+        collidingWith.resize(reader.read<std::uint32_t>());
+        for (auto &other : collidingWith)
+            reader.readString(other);
+    }
 }
@@ -14,7 +14,13 @@ namespace our
         std::string id;
         std::string mesh;
         std::vector<std::string> collidingWith;
-        static  std::string getID() { return "Collider"; }
+        static const std::string& getID() { static const std::string id = "Collider"; return id; }
         void deserialize(const nlohmann::json& data) override;
+        // Writes/reads the component to/from a compiled scene
+        void write(SceneWriter& writer) const override;
+        void read(SceneReader& reader) override;
+        // The snapshot state also holds the colliders it is touching
+        void saveState(SceneWriter& writer) const override;
+        void loadState(SceneReader& reader) override;
     };;
 } // namespace our
\ No newline at end of file
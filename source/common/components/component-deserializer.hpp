@@ -11,40 +11,75 @@
 #include "collider.hpp"
 #include "sound.hpp"
 #include "race.hpp"
+#include "tags.hpp"
+
+#include <array>
+#include <unordered_map>
+
 namespace our {
 
+    // Creates a component of type T in the given entity
+    using ComponentFactory = Component* (*)(Entity*);
+    template<typename T>
+    Component* createComponent(Entity* entity){
+        return entity->addComponent<T>();
+    }
+
+    namespace internal {
+        // The component types that can be read from the scene files (both the json and the compiled ones)
+        struct ComponentRegistry {
+            std::unordered_map<Symbol, ComponentFactory> factories; // Indexed by the symbol of the type name
+            std::array<Symbol, MAX_COMPONENT_TYPES> typeSymbols{}; // The symbol of the type name of each component type ID
+
+            template<typename T>
+            void add(){
+                Symbol symbol = intern(T::getID());
+                factories.emplace(symbol, createComponent<T>);
+                typeSymbols[getComponentTypeID<T>()] = symbol;
+            }
+        };
+
+        inline const ComponentRegistry& getComponentRegistry(){
+            static const ComponentRegistry registry = []{
+                ComponentRegistry registry;
+                registry.add<CameraComponent>();
+                registry.add<FreeCameraControllerComponent>();
+                registry.add<MovementComponent>();
+                registry.add<MeshRendererComponent>();
+                registry.add<LightComponent>();
+                registry.add<InputComponent>();
+                registry.add<RigidbodyComponent>();
+                registry.add<ColliderComponent>();
+                registry.add<SoundComponent>();
+                registry.add<CheckpointComponent>();
+                registry.add<RacePlayerComponent>();
+                registry.add<RaceManagerComponent>();
+                registry.add<TireTag>();
+                registry.add<SteeringTag>();
+                return registry;
+            }();
+            return registry;
+        }
+    }
+
+    // Returns the factories of the component types that can be read from the scene files, indexed by the symbol of their type name
+    inline const std::unordered_map<Symbol, ComponentFactory>& getComponentFactories(){
+        return internal::getComponentRegistry().factories;
+    }
+
+    // Returns the symbol of the type name of the given component type (or NO_SYMBOL if it can't be read from the scene files)
+    inline Symbol getComponentTypeSymbol(ComponentTypeID id){
+        return id < MAX_COMPONENT_TYPES ? internal::getComponentRegistry().typeSymbols[id] : NO_SYMBOL;
+    }
+
     // Given a json object, this function picks and creates a component in the given entity
     // based on the "type" specified in the json object which is later deserialized from the rest of the json object
     inline void deserializeComponent(const nlohmann::json& data, Entity* entity){
-        std::string type = data.value("type", "");
-        Component* component = nullptr;
-        //TODO: (Req 8) Add an option to deserialize a "MeshRendererComponent" to the following if-else statement
-     if(type == CameraComponent::getID()){
-            component = entity->addComponent<CameraComponent>();
-        } else if (type == FreeCameraControllerComponent::getID()) {
-            component = entity->addComponent<FreeCameraControllerComponent>();
-        } else if (type == MovementComponent::getID()) {
-            component = entity->addComponent<MovementComponent>();
-        } else if (type == MeshRendererComponent::getID()) {
-            component = entity->addComponent<MeshRendererComponent>();
-        } else if (type == LightComponent::getID()) {
-            component = entity->addComponent<LightComponent>();
-        } else if (type == InputComponent::getID()){
-            component = entity->addComponent<InputComponent>();
-        }else if (type == RigidbodyComponent::getID()){
-            component = entity->addComponent<RigidbodyComponent>();        }else if(type == ColliderComponent::getID()){
-            component = entity->addComponent<ColliderComponent>();
-        }else if (type == SoundComponent::getID()){
-            component = entity->addComponent<SoundComponent>();
-        }else if (type == CheckpointComponent::getID()){
-            component = entity->addComponent<CheckpointComponent>();
-        }else if (type == RacePlayerComponent::getID()){
-            component = entity->addComponent<RacePlayerComponent>();
-        }else if (type == RaceManagerComponent::getID()){
-            component = entity->addComponent<RaceManagerComponent>();
-        }
-
-        if(component) component->deserialize(data);
+        auto& factories = getComponentFactories();
+        auto factory = factories.find(hashSymbol(data.value("type", "")));
+        if(factory == factories.end()) return;
+        Component* component = factory->second(entity);
+        component->deserialize(data);
     }
 
-}
\ No newline at end of file
+}
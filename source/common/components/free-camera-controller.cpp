@@ -1,4 +1,5 @@
 #include "free-camera-controller.hpp"
+#include "../ecs/scene-stream.hpp"
 #include "../ecs/entity.hpp"
 #include "../deserialize-utils.hpp"
 
@@ -11,4 +12,20 @@ namespace our {
         positionSensitivity = data.value("positionSensitivity", positionSensitivity);
         speedupFactor = data.value("speedupFactor", speedupFactor);
     }
+
+    // Writes the sensitivities to a compiled scene
+    void FreeCameraControllerComponent::write(SceneWriter& writer) const {
+        writer.write(rotationSensitivity);
+        writer.write(fovSensitivity);
+        writer.write(positionSensitivity);
+        writer.write(speedupFactor);
+    }
+
+    // Reads the sensitivities from a compiled scene
+    void FreeCameraControllerComponent::read(SceneReader& reader) {
+        reader.read(rotationSensitivity);
+        reader.read(fovSensitivity);
+        reader.read(positionSensitivity);
+        reader.read(speedupFactor);
+    }
 }
\ No newline at end of file
@@ -20,10 +20,13 @@ namespace our {
         float speedupFactor = 5.0f; // A multiplier for the positionSensitivity if "Left Shift" is held.
 
         // The ID of this component type is "Free Camera Controller"
-        static std::string getID() { return "Free Camera Controller"; }
+        static const std::string& getID() { static const std::string id = "Free Camera Controller"; return id; }
 
         // Reads sensitivities & speedupFactor from the given json object
         void deserialize(const nlohmann::json& data) override;
+        // Writes/reads the component to/from a compiled scene
+        void write(SceneWriter& writer) const override;
+        void read(SceneReader& reader) override;
     };
 
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "input.hpp"
+#include "../ecs/scene-stream.hpp"
 #include "../ecs/entity.hpp"
 #include "../deserialize-utils.hpp"
 
@@ -7,4 +8,8 @@ namespace our {
     void InputComponent::deserialize(const nlohmann::json& data){
         
     }
+
+    // The input component has no data
+    void InputComponent::write(SceneWriter& writer) const {}
+    void InputComponent::read(SceneReader& reader) {}
 }
\ No newline at end of file
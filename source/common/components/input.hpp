@@ -10,9 +10,12 @@ namespace our
     class InputComponent : public Component
     {
     public:
-        static std::string getID() { return "InputMovement";}
+        static const std::string& getID() { static const std::string id = "InputMovement"; return id; }
 
         void deserialize(const nlohmann::json &data) override;
+        // Writes/reads the component to/from a compiled scene
+        void write(SceneWriter& writer) const override;
+        void read(SceneReader& reader) override;
         InputComponent() = default;
         ~InputComponent() override = default;
     };
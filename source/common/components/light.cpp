@@ -1,4 +1,5 @@
 #include "light.hpp"
+#include "../ecs/scene-stream.hpp"
 #include "../deserialize-utils.hpp"
 namespace our
 {  
@@ -28,4 +29,24 @@ namespace our
         outer_cone_angle = data.value("outerConeAngle", glm::radians(30.0f));  
         color = data.value("color", glm::vec3(1.0f, 0.0f, 1.0f));
     }
+
+    void LightComponent::write(SceneWriter &writer) const
+    {
+        writer.write(lightType);
+        writer.write(direction);
+        writer.write(color);
+        writer.write(attenuation);
+        writer.write(inner_cone_angle);
+        writer.write(outer_cone_angle);
+    }
+
+    void LightComponent::read(SceneReader &reader)
+    {
+        reader.read(lightType);
+        reader.read(direction);
+        reader.read(color);
+        reader.read(attenuation);
+        reader.read(inner_cone_angle);
+        reader.read(outer_cone_angle);
+    }
 } // namespace our
\ No newline at end of file
@@ -24,5 +24,8 @@ namespace our
         static const std::string& getID() { static const std::string id = "Light"; return id; }
         // Reads light parameters from the given json object
         void deserialize(const nlohmann::json& data) override;
+        // Writes/reads the component to/from a compiled scene
+        void write(SceneWriter& writer) const override;
+        void read(SceneReader& reader) override;
     };
 } // namespace our
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "mesh-renderer.hpp"
+#include "../ecs/scene-stream.hpp"
 #include "../asset-loader.hpp"
 
 namespace our {
@@ -14,4 +15,26 @@ namespace our {
         mesh = AssetLoader<Mesh>::get(data["mesh"].get<std::string>());
         material = AssetLoader<Material>::get(data["material"].get<std::string>());
     }
+
+    // The mesh and the material are written by name (the assets are loaded before the world)
+    void MeshRendererComponent::write(SceneWriter& writer) const {
+        writer.writeString(AssetLoader<Mesh>::getName(mesh));
+        writer.writeString(AssetLoader<Material>::getName(material));
+    }
+
+    void MeshRendererComponent::read(SceneReader& reader) {
+        mesh = AssetLoader<Mesh>::get(std::string(reader.readString()));
+        material = AssetLoader<Material>::get(std::string(reader.readString()));
+    }
+
+    // The snapshots live in the same run as the assets so the pointers are written as they are (no name lookups)
+    void MeshRendererComponent::saveState(SceneWriter& writer) const {
+        writer.write(mesh);
+        writer.write(material);
+    }
+
+    void MeshRendererComponent::loadState(SceneReader& reader) {
+        reader.read(mesh);
+        reader.read(material);
+    }
 }
\ No newline at end of file
@@ -14,10 +14,16 @@ namespace our {
         Material* material; // The material used to draw the mesh
 
         // The ID of this component type is "Mesh Renderer"
-        static std::string getID() { return "Mesh Renderer"; }
+        static const std::string& getID() { static const std::string id = "Mesh Renderer"; return id; }
 
         // Receives the mesh & material from the AssetLoader by the names given in the json object
         void deserialize(const nlohmann::json& data) override;
+        // Writes/reads the component to/from a compiled scene
+        void write(SceneWriter& writer) const override;
+        void read(SceneReader& reader) override;
+        // The snapshot state holds the asset pointers (a snapshot never outlives the assets)
+        void saveState(SceneWriter& writer) const override;
+        void loadState(SceneReader& reader) override;
     };
 
 }
\ No newline at end of file
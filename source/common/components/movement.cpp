@@ -1,4 +1,5 @@
 #include "movement.hpp"
+#include "../ecs/scene-stream.hpp"
 #include "../ecs/entity.hpp"
 #include "../deserialize-utils.hpp"
 
@@ -9,4 +10,16 @@ namespace our {
         linearVelocity = data.value("linearVelocity", linearVelocity);
         angularVelocity = glm::radians(data.value("angularVelocity", angularVelocity));
     }
+
+    // Writes the velocities to a compiled scene (the angular velocity is already in radians)
+    void MovementComponent::write(SceneWriter& writer) const {
+        writer.write(linearVelocity);
+        writer.write(angularVelocity);
+    }
+
+    // Reads the velocities from a compiled scene
+    void MovementComponent::read(SceneReader& reader) {
+        reader.read(linearVelocity);
+        reader.read(angularVelocity);
+    }
 }
\ No newline at end of file
@@ -16,10 +16,13 @@ namespace our {
         glm::vec3 angularVelocity = {0, 0, 0}; // Each frame, the entity should rotate as follows: rotation += angularVelocity * deltaTime
 
         // The ID of this component type is "Movement"
-        static std::string getID() { return "Movement"; }
+        static const std::string& getID() { static const std::string id = "Movement"; return id; }
 
         // Reads linearVelocity & angularVelocity from the given json object
         void deserialize(const nlohmann::json& data) override;
+        // Writes/reads the component to/from a compiled scene
+        void write(SceneWriter& writer) const override;
+        void read(SceneReader& reader) override;
     };
 
 }
\ No newline at end of file
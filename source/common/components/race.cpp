@@ -1,4 +1,5 @@
 #include "race.hpp"
+#include "../ecs/scene-stream.hpp"
 
 namespace our
 {
@@ -24,4 +25,87 @@ namespace our
         totalCheckpoints = data.value("totalCheckpoints", 0);
     }
 
+    void CheckpointComponent::write(SceneWriter &writer) const
+    {
+        writer.write(checkpointIndex);
+        writer.write(radius);
+        writer.write(isFinishLine);
+        writer.write(isVisible);
+    }
+
+    void CheckpointComponent::read(SceneReader &reader)
+    {
+        reader.read(checkpointIndex);
+        reader.read(radius);
+        reader.read(isFinishLine);
+        reader.read(isVisible);
+    }
+
+    void RacePlayerComponent::write(SceneWriter &writer) const
+    {
+        writer.write(maxLaps);
+        writer.write(currentLap);
+        writer.write(nextCheckpoint);
+        writer.write(position);
+    }
+
+    void RacePlayerComponent::read(SceneReader &reader)
+    {
+        reader.read(maxLaps);
+        reader.read(currentLap);
+        reader.read(nextCheckpoint);
+        reader.read(position);
+    }
+
+    void RaceManagerComponent::write(SceneWriter &writer) const
+    {
+        writer.write(countdownTime);
+        writer.write(totalCheckpoints);
+    }
+
+    void RaceManagerComponent::read(SceneReader &reader)
+    {
+        reader.read(countdownTime);
+        reader.read(totalCheckpoints);
+    }
+
+    void RacePlayerComponent::saveState(SceneWriter &writer) const
+    {
+        write(writer);
+        writer.write(raceTime);
+        writer.write(bestLapTime);
+        writer.write(currentLapTime);
+        writer.write(raceCompleted);
+        writer.write(std::uint32_t(lapTimes.size()));
+        for (float lapTime : lapTimes)
+            writer.write(lapTime);
+    }
+
+    void RacePlayerComponent::loadState(SceneReader &reader)
+    {
+        read(reader);
+        reader.read(raceTime);
+        reader.read(bestLapTime);
+        reader.read(currentLapTime);
+        reader.read(raceCompleted);
+        lapTimes.resize(reader.read<std::uint32_t>());
+        for (float &lapTime : lapTimes)
+            reader.read(lapTime);
+    }
+
+    void RaceManagerComponent::saveState(SceneWriter &writer) const
+    {
+        write(writer);
+        writer.write(state);
+        writer.write(raceStartTime);
+        writer.write(raceStarted);
+    }
+
+    void RaceManagerComponent::loadState(SceneReader &reader)
+    {
+        read(reader);
+        reader.read(state);
+        reader.read(raceStartTime);
+        reader.read(raceStarted);
+    }
 }
@@ -16,9 +16,12 @@ namespace our
 
         virtual ~CheckpointComponent() = default;
 
-        static std::string getID() { return "checkpoint"; }
+        static const std::string& getID() { static const std::string id = "checkpoint"; return id; }
 
         void deserialize(const nlohmann::json &data) override;
+        // Writes/reads the component to/from a compiled scene
+        void write(SceneWriter& writer) const override;
+        void read(SceneReader& reader) override;
     }; // Component to track player's race progress
     class RacePlayerComponent : public Component
     {
@@ -36,9 +39,15 @@ namespace our
 
         virtual ~RacePlayerComponent() = default;
 
-        static std::string getID() { return "race-player"; }
+        static const std::string& getID() { static const std::string id = "race-player"; return id; }
 
         void deserialize(const nlohmann::json &data) override;
+        // Writes/reads the component to/from a compiled scene
+        void write(SceneWriter& writer) const override;
+        void read(SceneReader& reader) override;
+        // The snapshot state also holds the timings and the lap times
+        void saveState(SceneWriter& writer) const override;
+        void loadState(SceneReader& reader) override;
     };
 
     // Component for race management and timing
@@ -61,9 +70,15 @@ namespace our
 
         virtual ~RaceManagerComponent() = default;
 
-        static std::string getID() { return "race-manager"; }
+        static const std::string& getID() { static const std::string id = "race-manager"; return id; }
 
         void deserialize(const nlohmann::json &data) override;
+        // Writes/reads the component to/from a compiled scene
+        void write(SceneWriter& writer) const override;
+        void read(SceneReader& reader) override;
+        // The snapshot state also holds the race timing
+        void saveState(SceneWriter& writer) const override;
+        void loadState(SceneReader& reader) override;
     };
 
 }
@@ -1,4 +1,5 @@
 #include "rigidbody.hpp"
+#include "../ecs/scene-stream.hpp"
 #include "../ecs/entity.hpp"
 #include "../deserialize-utils.hpp"
 
@@ -26,4 +27,143 @@ namespace our
         initialPosition = position;
         initialRotation = rotation;
     }
+
+    void RigidbodyComponent::write(SceneWriter &writer) const
+    {
+        writer.write(position);
+        writer.write(rotation);
+        writer.writeString(mesh);
+        writer.write(mass);
+        writer.write(scale);
+        writer.write(input);
+        writer.write(steeringAngle);
+    }
+
+    void RigidbodyComponent::read(SceneReader &reader)
+    {
+        reader.read(position);
+        reader.read(rotation);
+        reader.readString(mesh);
+        reader.read(mass);
+        reader.read(scale);
+        reader.read(input);
+        reader.read(steeringAngle);
+
+        // Store initial spawn position and rotation for race reset functionality
+        initialPosition = position;
+        initialRotation = rotation;
+    }
+
+    namespace
+    {
+        // Bullet's math types are not trivially copyable so their scalars are written one by one
+        void writeVector(SceneWriter &writer, const btVector3 &vector)
+        {
+            writer.write(vector.x());
+            writer.write(vector.y());
+            writer.write(vector.z());
+        }
+
+        btVector3 readVector(SceneReader &reader)
+        {
+            btScalar x = reader.read<btScalar>(), y = reader.read<btScalar>(), z = reader.read<btScalar>();
+            return btVector3(x, y, z);
+        }
+
+        void writeTransform(SceneWriter &writer, const btTransform &transform)
+        {
+            writeVector(writer, transform.getOrigin());
+            btQuaternion rotation = transform.getRotation();
+            writer.write(rotation.x());
+            writer.write(rotation.y());
+            writer.write(rotation.z());
+            writer.write(rotation.w());
+        }
+
+        btTransform readTransform(SceneReader &reader)
+        {
+            btVector3 origin = readVector(reader);
+            btScalar x = reader.read<btScalar>(), y = reader.read<btScalar>(), z = reader.read<btScalar>(), w = reader.read<btScalar>();
+            return btTransform(btQuaternion(x, y, z, w), origin);
+        }
+
+        // The part of a wheel's state that changes while driving
+        struct WheelState
+        {
+            btScalar steering, rotation, deltaRotation, engineForce, brake, suspensionLength, suspensionRelativeVelocity;
+        };
+    }
+
+    void RigidbodyComponent::saveState(SceneWriter &writer) const
+    {
+        writer.write(position);
+        writer.write(rotation);
+        writer.write(steeringAngle);
+        writer.write(engineForce);
+
+        // The body only exists once the rigidbody system added it to the physics world
+        bool hasBody = addedToWorld && rigidbody;
+        writer.write(hasBody);
+        if (!hasBody)
+            return;
+        writeTransform(writer, rigidbody->getWorldTransform());
+        writeVector(writer, rigidbody->getLinearVelocity());
+        writeVector(writer, rigidbody->getAngularVelocity());
+
+        int wheelCount = vehicle ? vehicle->getNumWheels() : 0;
+        writer.write(wheelCount);
+        for (int i = 0; i < wheelCount; i++)
+        {
+            const btWheelInfo &wheel = vehicle->getWheelInfo(i);
+            writer.write(WheelState{wheel.m_steering, wheel.m_rotation, wheel.m_deltaRotation, wheel.m_engineForce, wheel.m_brake,
+                                    wheel.m_raycastInfo.m_suspensionLength, wheel.m_suspensionRelativeVelocity});
+        }
+    }
+
+    void RigidbodyComponent::loadState(SceneReader &reader)
+    {
+        reader.read(position);
+        reader.read(rotation);
+        reader.read(steeringAngle);
+        reader.read(engineForce);
+
+        bool hasBody = reader.read<bool>();
+        if (!hasBody)
+            return;
+        btTransform transform = readTransform(reader);
+        btVector3 linearVelocity = readVector(reader);
+        btVector3 angularVelocity = readVector(reader);
+        int wheelCount = reader.read<int>();
+        // If the body was created after the snapshot was taken, the saved body state is skipped
+        bool restoreBody = addedToWorld && rigidbody;
+        if (restoreBody)
+        {
+            rigidbody->setWorldTransform(transform);
+            rigidbody->setInterpolationWorldTransform(transform);
+            if (btMotionState *motionState = rigidbody->getMotionState())
+                motionState->setWorldTransform(transform);
+            rigidbody->setLinearVelocity(linearVelocity);
+            rigidbody->setAngularVelocity(angularVelocity);
+            rigidbody->setInterpolationLinearVelocity(linearVelocity);
+            rigidbody->setInterpolationAngularVelocity(angularVelocity);
+            rigidbody->clearForces();
+            rigidbody->activate(true);
+        }
+
+        for (int i = 0; i < wheelCount; i++)
+        {
+            WheelState saved = reader.read<WheelState>();
+            if (!restoreBody || !vehicle || i >= vehicle->getNumWheels())
+                continue;
+            btWheelInfo &wheel = vehicle->getWheelInfo(i);
+            wheel.m_steering = saved.steering;
+            wheel.m_rotation = saved.rotation;
+            wheel.m_deltaRotation = saved.deltaRotation;
+            wheel.m_engineForce = saved.engineForce;
+            wheel.m_brake = saved.brake;
+            wheel.m_raycastInfo.m_suspensionLength = saved.suspensionLength;
+            wheel.m_suspensionRelativeVelocity = saved.suspensionRelativeVelocity;
+            vehicle->updateWheelTransform(i, true);
+        }
+    }
 }
@@ -28,12 +28,19 @@ public:
     std::string mesh = "";             // Path to the OBJ file
     bool addedToWorld = false;         // Has the rigid body been added to the world?
     int input = 0;                     // Is the rigid body controlled by input?
-    btRigidBody *rigidbody; 
-    btRaycastVehicle *vehicle;         // EASE ADDED
+    btRigidBody *rigidbody = nullptr;
+    btRaycastVehicle *vehicle = nullptr; // EASE ADDED
     float steeringAngle = 0.0f;        // Current steering angle
-    static std::string getID() {return "Rigidbody"; }   
+    float engineForce = 0.0f;          // Current engine force applied to the wheels
+    static const std::string& getID() { static const std::string id = "Rigidbody"; return id; }   
     
     void deserialize(const nlohmann::json& data) override;
+    // Writes/reads the component to/from a compiled scene
+    void write(SceneWriter& writer) const override;
+    void read(SceneReader& reader) override;
+    // The snapshot state also holds the body transform and velocities and the vehicle wheels
+    void saveState(SceneWriter& writer) const override;
+    void loadState(SceneReader& reader) override;
 };
 
 } 
@@ -1,4 +1,5 @@
 #include "sound.hpp"
+#include "../ecs/scene-stream.hpp"
 #include "../deserialize-utils.hpp"
 #include "../application.hpp"
 #define MINIAUDIO_IMPLEMENTATION
@@ -13,6 +14,22 @@ namespace our
         playing = data.value("playing", false);
         volume = data.value("volume", 100);
     }
+
+    void SoundComponent::write(SceneWriter &writer) const
+    {
+        writer.writeString(soundPath);
+        writer.write(looped);
+        writer.write(playing);
+        writer.write(volume);
+    }
+
+    void SoundComponent::read(SceneReader &reader)
+    {
+        reader.readString(soundPath);
+        reader.read(looped);
+        reader.read(playing);
+        reader.read(volume);
+    }
 }
 
 
@@ -14,9 +14,12 @@ namespace our
         ma_sound sound;
         int volume = 100;
 
-        static std::string getID() { return "Sound"; }
+        static const std::string& getID() { static const std::string id = "Sound"; return id; }
 
         // Load settings from JSON
         void deserialize(const nlohmann::json& data) override;
+        // Writes/reads the component to/from a compiled scene
+        void write(SceneWriter& writer) const override;
+        void read(SceneReader& reader) override;
     };
 } // namespace our
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../ecs/component.hpp"
+
+namespace our {
+
+    // A tag component holds no data, it only marks its entity as being of some kind.
+    // Checking for a tag ("entity->hasComponent<TireTag>()") is a bit test in the entity's component mask and the tagged
+    // entities can be iterated with a view, so tags replace the checks on entity names in the hot paths.
+    // "Tag" must have a static "NAME" which is the type used in the scene files, e.g. { "type": "Tire" }
+    template<typename Tag>
+    class TagComponent : public Component {
+    public:
+        static const std::string& getID() { static const std::string id = Tag::NAME; return id; }
+
+        // Tags have no data to read
+        void deserialize(const nlohmann::json&) override {}
+        void write(SceneWriter&) const override {}
+        void read(SceneReader&) override {}
+    };
+
+    // Marks the tires of a kart (they spin with the kart's speed)
+    struct TireTagName { static constexpr const char* NAME = "Tire"; };
+    using TireTag = TagComponent<TireTagName>;
+
+    // Marks the tires that turn with the steering
+    struct SteeringTagName { static constexpr const char* NAME = "Steering"; };
+    using SteeringTag = TagComponent<SteeringTagName>;
+
+}
@@ -0,0 +1,41 @@
+#include "command-buffer.hpp"
+#include "world.hpp"
+
+namespace our {
+
+    // Applies the recorded commands to the world then empties the buffer
+    void CommandBuffer::playback(World* world){
+        created.clear();
+        created.reserve(createdNames.size());
+        for(auto& command : commands){
+            switch(command.type){
+            case CommandType::Create: {
+                Entity* entity = world->add();
+                entity->setName(createdNames[command.target.pending]);
+                created.push_back(entity);
+                break;
+            }
+            case CommandType::Destroy:
+                world->markForRemoval(resolve(command.target));
+                break;
+            case CommandType::SetParent:
+                resolve(command.target)->setParent(resolve(command.parent));
+                break;
+            case CommandType::SetTransform:
+                resolve(command.target)->localTransform = transforms[command.data];
+                break;
+            case CommandType::AddComponent: {
+                Component* component = command.function(resolve(command.target));
+                if(command.data != NO_DATA) initializers[command.data](component);
+                break;
+            }
+            case CommandType::RemoveComponent:
+                command.function(resolve(command.target));
+                break;
+            }
+        }
+        created.clear();
+        clear();
+    }
+
+}
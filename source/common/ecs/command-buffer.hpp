@@ -0,0 +1,146 @@
+#pragma once
+
+#include "entity.hpp"
+
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace our {
+
+    class World; // A forward declaration of the World Class
+
+    // Refers to an entity from a command buffer. It is either an existing entity or an entity that the same command
+    // buffer will create during the playback (the value returned by "CommandBuffer::create").
+    class EntityRef {
+        Entity* entity = nullptr;
+        size_t pending = NONE; // The position of the entity in the buffer's list of created entities
+
+        static constexpr size_t NONE = static_cast<size_t>(-1);
+        friend class CommandBuffer;
+        explicit EntityRef(size_t pending) : pending(pending) {}
+    public:
+        EntityRef() = default;
+        EntityRef(Entity* entity) : entity(entity) {}
+
+        // Returns true if this refers to an entity that doesn't exist yet
+        bool isPending() const { return pending != NONE; }
+        // Returns true if this refers to nothing (the null parent for example)
+        bool isNull() const { return !entity && pending == NONE; }
+    };
+
+    // A command buffer records structural changes (creating/destroying entities, adding/removing components and changing
+    // parents) instead of applying them, so they can be issued while other threads iterate the world.
+    // The world keeps one command buffer per thread (see "World::getCommandBuffer") and plays all of them back at
+    // a single sync point per frame ("World::deleteMarkedEntities"), where the pool inserts are batched.
+    // NOTE: A command buffer must only be used by one thread. The pending entities only mean something in the
+    // buffer that created them.
+    class CommandBuffer {
+    public:
+        // Sets up a component right after it is added during the playback
+        template<typename T>
+        using Initializer = std::function<void(T*)>;
+
+    private:
+        enum class CommandType { Create, Destroy, SetParent, SetTransform, AddComponent, RemoveComponent };
+        // Adds (or removes) a component of a certain type to the entity. Adding returns the new component.
+        using ComponentFunction = Component* (*)(Entity*);
+        // The commands are kept small (the transforms and the initializers are stored aside) so the playback streams through them
+        struct Command {
+            CommandType type;
+            EntityRef target; // The entity the command applies to
+            EntityRef parent = nullptr; // The new parent (only for SetParent)
+            ComponentTypeID componentType = 0; // The component type (only for AddComponent and RemoveComponent)
+            ComponentFunction function = nullptr; // Adds or removes the component (only for AddComponent and RemoveComponent)
+            size_t data = NO_DATA; // The position of the transform (SetTransform) or of the initializer (AddComponent)
+        };
+        static constexpr size_t NO_DATA = static_cast<size_t>(-1);
+        std::vector<Command> commands;
+        std::vector<Transform> transforms; // The transforms of the SetTransform commands
+        std::vector<std::function<void(Component*)>> initializers; // The initializers of the AddComponent commands
+        std::vector<std::string> createdNames; // The names of the pending entities
+        std::vector<Entity*> created; // The pending entities once they are created (only used during the playback)
+        std::thread::id thread; // The thread this buffer belongs to
+
+        friend World;
+
+        // Returns the entity referred to by "ref" (only valid during the playback)
+        Entity* resolve(const EntityRef& ref) const {
+            return ref.isPending() ? created[ref.pending] : ref.entity;
+        }
+        // Applies the recorded commands to the world then empties the buffer
+        void playback(World* world);
+
+    public:
+        explicit CommandBuffer(std::thread::id thread = std::this_thread::get_id()) : thread(thread) {}
+
+        // Records the creation of an entity and returns a reference to it (it can be used by the next commands)
+        EntityRef create(const std::string& name = "") {
+            createdNames.push_back(name);
+            commands.push_back({CommandType::Create, EntityRef(createdNames.size() - 1)});
+            return EntityRef(createdNames.size() - 1);
+        }
+
+        // Records the destruction of an entity (it is marked for removal then deleted with the other marked entities)
+        void destroy(EntityRef entity) {
+            commands.push_back({CommandType::Destroy, entity});
+        }
+
+        // Records a parent change (a null parent makes the entity a root)
+        void setParent(EntityRef entity, EntityRef parent) {
+            commands.push_back({CommandType::SetParent, entity, parent});
+        }
+
+        // Records a change of the local transform
+        void setTransform(EntityRef entity, const Transform& transform) {
+            Command command{CommandType::SetTransform, entity};
+            command.data = transforms.size();
+            transforms.push_back(transform);
+            commands.push_back(command);
+        }
+
+        // Records the addition of a component of type T. If given, "initialize" is called on the new component.
+        template<typename T>
+        void addComponent(EntityRef entity, Initializer<T> initialize = nullptr) {
+            static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+            Command command{CommandType::AddComponent, entity};
+            command.componentType = getComponentTypeID<T>();
+            command.function = [](Entity* target) -> Component* { return target->addComponent<T>(); };
+            if(initialize) {
+                command.data = initializers.size();
+                initializers.emplace_back([initialize = std::move(initialize)](Component* component){
+                    initialize(static_cast<T*>(component));
+                });
+            }
+            commands.push_back(command);
+        }
+
+        // Records the removal of the first component of type T
+        template<typename T>
+        void removeComponent(EntityRef entity) {
+            static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+            Command command{CommandType::RemoveComponent, entity};
+            command.componentType = getComponentTypeID<T>();
+            command.function = [](Entity* target) -> Component* { target->deleteComponent<T>(); return nullptr; };
+            commands.push_back(command);
+        }
+
+        // Returns the number of recorded commands
+        size_t size() const { return commands.size(); }
+        bool empty() const { return commands.empty(); }
+
+        // Drops the recorded commands without applying them
+        void clear() {
+            commands.clear();
+            transforms.clear();
+            initializers.clear();
+            createdNames.clear();
+        }
+
+        // The buffer is tied to a thread so it should not be copyable
+        CommandBuffer(const CommandBuffer&) = delete;
+        CommandBuffer& operator=(const CommandBuffer&) = delete;
+    };
+
+}
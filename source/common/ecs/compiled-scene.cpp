@@ -0,0 +1,334 @@
+#include "compiled-scene.hpp"
+#include "world.hpp"
+#include "../components/component-deserializer.hpp"
+#include "../incremental-loader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <unordered_map>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace our {
+
+    namespace {
+        // A read-only view of a whole file mapped in memory (it is unmapped when the object is destroyed)
+        class MappedFile {
+            const char* bytes = nullptr;
+            size_t length = 0;
+#if defined(_WIN32)
+            HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+        public:
+            explicit MappedFile(const std::string& path){
+#if defined(_WIN32)
+                file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+                if(file == INVALID_HANDLE_VALUE) return;
+                LARGE_INTEGER size;
+                if(!GetFileSizeEx(file, &size) || size.QuadPart == 0) return;
+                mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if(!mapping) return;
+                bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                if(bytes) length = size_t(size.QuadPart);
+#else
+                int descriptor = open(path.c_str(), O_RDONLY);
+                if(descriptor < 0) return;
+                struct stat status;
+                if(fstat(descriptor, &status) == 0 && status.st_size > 0){
+                    void* address = mmap(nullptr, size_t(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+                    if(address != MAP_FAILED){
+                        bytes = static_cast<const char*>(address);
+                        length = size_t(status.st_size);
+                    }
+                }
+                // The mapping stays valid after the descriptor is closed
+                close(descriptor);
+#endif
+            }
+
+            ~MappedFile(){
+#if defined(_WIN32)
+                if(bytes) UnmapViewOfFile(bytes);
+                if(mapping) CloseHandle(mapping);
+                if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+                if(bytes) munmap(const_cast<char*>(bytes), length);
+#endif
+            }
+
+            const char* data() const { return bytes; }
+            size_t size() const { return length; }
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+        };
+
+        // Appends the bytes of an array of trivially copyable records to the file
+        template<typename T>
+        void writeRecords(std::ofstream& file, const std::vector<T>& records){
+            file.write(reinterpret_cast<const char*>(records.data()), std::streamsize(records.size() * sizeof(T)));
+        }
+
+        double millisecondsSince(std::chrono::steady_clock::time_point start){
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+
+    std::uint64_t hashSceneSource(std::string_view source){
+        std::uint64_t hash = 14695981039346656037ull;
+        for(char character : source){
+            hash ^= static_cast<unsigned char>(character);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::string getCompiledScenePath(const std::string& scenePath){
+        size_t dot = scenePath.find_last_of('.');
+        size_t slash = scenePath.find_last_of("/\\");
+        if(dot == std::string::npos || (slash != std::string::npos && dot < slash)) return scenePath + ".bscene";
+        return scenePath.substr(0, dot) + ".bscene";
+    }
+
+    void writeSceneRecords(const std::vector<Entity*>& entities, SceneWriter& writer,
+                           std::vector<SceneEntityRecord>& entityRecords, std::vector<SceneComponentRecord>& componentRecords){
+        entityRecords.reserve(entityRecords.size() + entities.size());
+
+        // The entities are written in the order of the list except that the parents are moved before their children
+        std::unordered_map<const Entity*, std::uint32_t> indices;
+        for(auto entity : entities) indices.emplace(entity, SceneEntityRecord::NO_PARENT);
+        std::vector<Entity*> chain;
+        for(auto entity : entities){
+            // Collect the ancestors that are not written yet (the entity first, its farthest unwritten ancestor last)
+            chain.clear();
+            for(Entity* current = entity; current; current = current->parent){
+                auto it = indices.find(current);
+                if(it == indices.end() || it->second != SceneEntityRecord::NO_PARENT) break;
+                chain.push_back(current);
+            }
+            for(auto it = chain.rbegin(); it != chain.rend(); ++it){
+                Entity* current = *it;
+                SceneEntityRecord record;
+                record.name = writer.addString(current->getName());
+                record.parent = SceneEntityRecord::NO_PARENT;
+                if(current->parent){
+                    if(auto parent = indices.find(current->parent); parent != indices.end()) record.parent = parent->second;
+                }
+                record.localTransform = current->localTransform;
+                record.firstComponent = std::uint32_t(componentRecords.size());
+                record.componentCount = 0;
+                for(auto component : current->getComponents()){
+                    Symbol type = getComponentTypeSymbol(component->getTypeID());
+                    if(type == NO_SYMBOL) continue; // This type can't be read back from a scene file
+                    std::uint32_t offset = std::uint32_t(writer.getData().size());
+                    component->write(writer);
+                    componentRecords.push_back({type, offset, std::uint32_t(writer.getData().size()) - offset});
+                    record.componentCount++;
+                }
+                indices[current] = std::uint32_t(entityRecords.size());
+                entityRecords.push_back(record);
+            }
+        }
+    }
+
+    bool compileScene(const std::vector<Entity*>& entities, std::uint64_t sourceHash, const std::string& path){
+        SceneWriter writer;
+        std::vector<SceneEntityRecord> entityRecords;
+        std::vector<SceneComponentRecord> componentRecords;
+        writeSceneRecords(entities, writer, entityRecords, componentRecords);
+
+        std::vector<SceneStringRecord> stringRecords;
+        std::string characters;
+        writer.packStrings(stringRecords, characters);
+        // Keep the data block 4-byte aligned
+        characters.resize((characters.size() + 3) & ~size_t(3), '\0');
+
+        CompiledSceneHeader header{};
+        std::copy(std::begin(CompiledSceneHeader::MAGIC), std::end(CompiledSceneHeader::MAGIC), header.magic);
+        header.version = CompiledSceneHeader::VERSION;
+        header.sourceHash = sourceHash;
+        header.stringCount = std::uint32_t(stringRecords.size());
+        header.entityCount = std::uint32_t(entityRecords.size());
+        header.componentCount = std::uint32_t(componentRecords.size());
+        header.characterCount = std::uint32_t(characters.size());
+        header.dataSize = std::uint32_t(writer.getData().size());
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if(!file){
+            std::cerr << "Couldn't write the compiled scene: " << path << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeRecords(file, stringRecords);
+        writeRecords(file, entityRecords);
+        writeRecords(file, componentRecords);
+        file.write(characters.data(), std::streamsize(characters.size()));
+        writeRecords(file, writer.getData());
+        return bool(file);
+    }
+
+    bool loadCompiledScene(World& world, const std::string& path, std::uint64_t sourceHash){
+        MappedFile file(path);
+        if(!file.data() || file.size() < sizeof(CompiledSceneHeader)) return false;
+
+        CompiledSceneHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if(!std::equal(std::begin(header.magic), std::end(header.magic), std::begin(CompiledSceneHeader::MAGIC))) return false;
+        if(header.version != CompiledSceneHeader::VERSION || header.sourceHash != sourceHash) return false;
+
+        // Check that the sections fit in the file before reading anything (a truncated file is simply recompiled)
+        size_t stringsOffset = sizeof(CompiledSceneHeader);
+        size_t entitiesOffset = stringsOffset + size_t(header.stringCount) * sizeof(SceneStringRecord);
+        size_t componentsOffset = entitiesOffset + size_t(header.entityCount) * sizeof(SceneEntityRecord);
+        size_t charactersOffset = componentsOffset + size_t(header.componentCount) * sizeof(SceneComponentRecord);
+        size_t dataOffset = charactersOffset + header.characterCount;
+        if(dataOffset + header.dataSize != file.size()) return false;
+
+        // The sections are aligned in the file and mmap returns page aligned memory, so the records are read in place
+        auto strings = reinterpret_cast<const SceneStringRecord*>(file.data() + stringsOffset);
+        auto entityRecords = reinterpret_cast<const SceneEntityRecord*>(file.data() + entitiesOffset);
+        auto componentRecords = reinterpret_cast<const SceneComponentRecord*>(file.data() + componentsOffset);
+        const char* characters = file.data() + charactersOffset;
+        const char* data = file.data() + dataOffset;
+
+        for(std::uint32_t index = 0; index < header.stringCount; index++){
+            if(size_t(strings[index].offset) + strings[index].length > header.characterCount) return false;
+        }
+        for(std::uint32_t index = 0; index < header.entityCount; index++){
+            const auto& record = entityRecords[index];
+            if(record.name >= header.stringCount) return false;
+            if(record.parent != SceneEntityRecord::NO_PARENT && record.parent >= index) return false;
+            if(size_t(record.firstComponent) + record.componentCount > header.componentCount) return false;
+        }
+        for(std::uint32_t index = 0; index < header.componentCount; index++){
+            const auto& record = componentRecords[index];
+            if(size_t(record.dataOffset) + record.dataSize > header.dataSize) return false;
+        }
+
+        auto& factories = getComponentFactories();
+        std::vector<Entity*> created(header.entityCount);
+        size_t firstEntity = world.getEntities().size();
+        for(std::uint32_t index = 0; index < header.entityCount; index++){
+            const auto& record = entityRecords[index];
+            Entity* entity = world.add();
+            if(record.parent != SceneEntityRecord::NO_PARENT) entity->setParent(created[record.parent]);
+            else entity->setParent(nullptr);
+            entity->localTransform = record.localTransform;
+            const SceneStringRecord& name = strings[record.name];
+            if(name.length > 0) entity->setName(std::string(characters + name.offset, name.length));
+            for(std::uint32_t component = 0; component < record.componentCount; component++){
+                const auto& componentRecord = componentRecords[record.firstComponent + component];
+                auto factory = factories.find(componentRecord.type);
+                if(factory == factories.end()) continue;
+                const char* begin = data + componentRecord.dataOffset;
+                SceneReader reader(begin, begin + componentRecord.dataSize, strings, characters, header.stringCount);
+                factory->second(entity)->read(reader);
+                if(reader.hasFailed()){
+                    // The file is invalid, so the entities read so far are removed and the caller loads the json instead
+                    std::cerr << "The compiled scene \"" << path << "\" has an invalid \"" << getSymbolName(componentRecord.type)
+                        << "\" component (it will be recompiled)" << std::endl;
+                    world.truncateEntities(firstEntity);
+                    return false;
+                }
+            }
+            created[index] = entity;
+        }
+        return true;
+    }
+
+    namespace {
+        // Reads the whole scene file into "source"
+        bool readSceneSource(const std::string& path, std::string& source){
+            std::ifstream file(path, std::ios::binary);
+            if(!file){
+                std::cerr << "Couldn't open the scene file: " << path << std::endl;
+                return false;
+            }
+            source.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            return true;
+        }
+
+        // Parses the json of a scene file (the result is discarded if the json is invalid)
+        nlohmann::json parseSceneSource(const std::string& path, const std::string& source){
+            nlohmann::json data = nlohmann::json::parse(source, nullptr, false, true);
+            if(data.is_discarded()) std::cerr << "Couldn't parse the scene file: " << path << std::endl;
+            return data;
+        }
+
+        // Compiles the entities that were loaded from the json (they were appended to the world's entity list)
+        void compileLoadedEntities(World& world, size_t firstEntity, std::uint64_t hash, const std::string& path){
+            const auto& entities = world.getEntities();
+            std::vector<Entity*> added(entities.begin() + std::min(firstEntity, entities.size()), entities.end());
+            std::string compiledPath = getCompiledScenePath(path);
+            if(compileScene(added, hash, compiledPath)){
+                std::cout << "[scene] Compiled " << path << " to " << compiledPath << std::endl;
+            }
+        }
+    }
+
+    bool loadScene(World& world, const std::string& path){
+        auto start = std::chrono::steady_clock::now();
+        std::string source;
+        if(!readSceneSource(path, source)) return false;
+        std::uint64_t hash = hashSceneSource(source);
+
+        std::string compiledPath = getCompiledScenePath(path);
+        if(loadCompiledScene(world, compiledPath, hash)){
+            std::cout << "[scene] Loaded " << compiledPath << " in " << millisecondsSince(start) << " ms" << std::endl;
+            return true;
+        }
+
+        // The compiled scene is missing or out of date, so the json is loaded then compiled for the next run
+        nlohmann::json data = parseSceneSource(path, source);
+        if(data.is_discarded()) return false;
+        size_t firstEntity = world.getEntities().size();
+        world.deserialize(data);
+        std::cout << "[scene] Loaded " << path << " in " << millisecondsSince(start) << " ms" << std::endl;
+        compileLoadedEntities(world, firstEntity, hash, path);
+        return true;
+    }
+
+    void queueSceneLoad(IncrementalLoader& loader, World& world, const std::string& path){
+        loader.add("Loading scene " + path, [&loader, &world, path](){
+            auto start = std::chrono::steady_clock::now();
+            std::string source;
+            if(!readSceneSource(path, source)) return;
+            std::uint64_t hash = hashSceneSource(source);
+
+            // The compiled scene is mapped in one step since it is made to load fast
+            std::string compiledPath = getCompiledScenePath(path);
+            if(loadCompiledScene(world, compiledPath, hash)){
+                std::cout << "[scene] Loaded " << compiledPath << " in " << millisecondsSince(start) << " ms" << std::endl;
+                return;
+            }
+
+            // Otherwise, each root entity (with its children) is deserialized in its own step, then the scene is compiled
+            auto data = std::make_shared<nlohmann::json>(parseSceneSource(path, source));
+            if(data->is_discarded() || !data->is_array()) return;
+            size_t firstEntity = world.getEntities().size();
+            for(size_t index = 0; index < data->size(); index++){
+                loader.add("Loading scene " + path, [&world, data, index](){
+                    world.deserialize(nlohmann::json::array({std::move((*data)[index])}));
+                });
+            }
+            loader.add("Compiling scene " + path, [&world, firstEntity, hash, path](){
+                compileLoadedEntities(world, firstEntity, hash, path);
+            });
+        });
+    }
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "transform.hpp"
+#include "scene-stream.hpp"
+#include "symbol.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace our {
+
+    class World; // A forward declaration of the World Class
+    class Entity; // A forward declaration of the Entity Class
+    class IncrementalLoader; // A forward declaration of the IncrementalLoader Class
+
+    // A compiled scene is a binary version of a json scene file. It is loaded by mapping the file in memory and reading
+    // the records where they are, so no json is parsed and no string is allocated except for the entity names.
+    // The file is laid out as follows (every section is 4-byte aligned):
+    //      CompiledSceneHeader
+    //      SceneStringRecord[stringCount]        The string table (entity names, asset names, component strings)
+    //      SceneEntityRecord[entityCount]        The entities, every parent comes before its children
+    //      SceneComponentRecord[componentCount]  The components, grouped by entity
+    //      char[characterCount]                  The characters of the strings (not null terminated)
+    //      char[dataSize]                        The data written by "Component::write" for each component
+    struct CompiledSceneHeader {
+        char magic[4]; // Always "OKSC"
+        std::uint32_t version; // Files with another version are recompiled
+        std::uint64_t sourceHash; // The hash of the json file the scene was compiled from (see "hashSceneSource")
+        std::uint32_t stringCount;
+        std::uint32_t entityCount;
+        std::uint32_t componentCount;
+        std::uint32_t characterCount;
+        std::uint32_t dataSize;
+        std::uint32_t padding;
+
+        static constexpr char MAGIC[4] = {'O', 'K', 'S', 'C'};
+        // Increase this whenever the layout or the data of any component changes
+        static constexpr std::uint32_t VERSION = 1;
+    };
+
+    struct SceneEntityRecord {
+        std::uint32_t name; // The index of the name in the string table
+        std::uint32_t parent; // The index of the parent entity (or NO_PARENT for root entities)
+        Transform localTransform;
+        std::uint32_t firstComponent; // The index of the first component record of this entity
+        std::uint32_t componentCount;
+
+        static constexpr std::uint32_t NO_PARENT = static_cast<std::uint32_t>(-1);
+    };
+
+    struct SceneComponentRecord {
+        Symbol type; // The symbol of the component type name (see "getComponentFactories")
+        std::uint32_t dataOffset; // The position of the component data in the data block
+        std::uint32_t dataSize;
+    };
+
+    // Hashes the bytes of a json scene file (64-bit FNV-1a). A compiled scene is only used if it holds the same hash.
+    std::uint64_t hashSceneSource(std::string_view source);
+
+    // Returns the path of the compiled version of the given scene file (the extension is replaced by ".bscene")
+    std::string getCompiledScenePath(const std::string& scenePath);
+
+    // Writes the records of the given entities (with their components) in memory, every parent before its children.
+    // Parents that are not in the list are dropped. The component data and the strings go to the writer.
+    // This is the content of a compiled scene (see "compileScene") and of a prefab (see "ecs/prefab.hpp").
+    void writeSceneRecords(const std::vector<Entity*>& entities, SceneWriter& writer,
+                           std::vector<SceneEntityRecord>& entityRecords, std::vector<SceneComponentRecord>& componentRecords);
+
+    // Writes the given entities (with their components) to a compiled scene file. Parents that are not in the list are dropped.
+    // Returns false if the file could not be written.
+    bool compileScene(const std::vector<Entity*>& entities, std::uint64_t sourceHash, const std::string& path);
+
+    // Maps the compiled scene file in memory and adds its entities to the world.
+    // Returns false (and adds nothing) if the file is missing, invalid (including a component that fails to read) or was
+    // compiled from another source (another hash).
+    bool loadCompiledScene(World& world, const std::string& path, std::uint64_t sourceHash);
+
+    // Adds the entities of a json scene file (an array of entities, see "World::deserialize") to the world.
+    // If the compiled version of the file is up to date, it is loaded instead of the json.
+    // Otherwise the json is parsed and the compiled version is written for the next run.
+    // Returns false if the scene file could not be read.
+    bool loadScene(World& world, const std::string& path);
+
+    // Does the same as "loadScene" but queues the loading in the given incremental loader.
+    // A compiled scene loads in one step, while each root entity of a json scene (with its children) gets its own step.
+    // The loader and the world must outlive the queued steps.
+    void queueSceneLoad(IncrementalLoader& loader, World& world, const std::string& path);
+
+}
@@ -2,10 +2,46 @@
 
 #include <json/json.hpp>
 #include <string>
+#include <bitset>
+#include <cstdint>
+#include <cassert>
+#include <atomic>
 
 namespace our {
 
     class Entity; // A forward declaration of the Entity Class
+    class World; // A forward declaration of the World Class
+    class SceneWriter; // A forward declaration of the SceneWriter Class
+    class SceneReader; // A forward declaration of the SceneReader Class
+
+    // Each component type is identified by a small integer ID which is used to index the entity's component slots.
+    // The IDs are handed out once per type (the first time the type is used) so no RTTI is needed to find a component.
+    using ComponentTypeID = std::uint32_t;
+    // The maximum number of distinct component types. Every entity keeps one slot per type, so keep this small.
+    constexpr ComponentTypeID MAX_COMPONENT_TYPES = 32;
+    // A bitmask where bit "i" is set if the entity holds a component whose type ID is "i"
+    using ComponentMask = std::bitset<MAX_COMPONENT_TYPES>;
+
+    // The world counts the frames in ticks (see "World::advanceTick"). The components remember the tick at which they were
+    // added and the tick of their last change so the systems can only visit what changed since they last ran.
+    using Tick = std::uint32_t;
+
+    namespace internal {
+        // Returns a new type ID every time it is called. Only used by "getComponentTypeID".
+        // The counter is atomic since systems may query new component types from worker threads
+        inline ComponentTypeID nextComponentTypeID() {
+            static std::atomic<ComponentTypeID> counter{0};
+            return counter++;
+        }
+    }
+
+    // Returns the type ID of the component type T. The ID is the same for every call with the same T.
+    template<typename T>
+    ComponentTypeID getComponentTypeID() {
+        static const ComponentTypeID id = internal::nextComponentTypeID();
+        assert(id < MAX_COMPONENT_TYPES && "Too many component types, increase MAX_COMPONENT_TYPES");
+        return id;
+    }
 
     // A component is a data container that can be added to an entity.
     // The role of the entity in the world is defined by the components it holds.
@@ -13,17 +49,45 @@ namespace our {
     // Thus any renderer system should look for an entity holding a camera component in order to compute the camera related uniforms (e.g. VP matrix)
     class Component {
         Entity* owner; // A pointer to the entity that owns this component
+        ComponentTypeID typeID; // The type ID of the most derived type (set by the entity when the component is added)
+        size_t poolIndex; // The position of this component in the world's pool of its type (only valid while it is pooled)
+        Tick addedTick = 0; // The world tick at which this component was added
+        Tick changedTick = 0; // The world tick of the last change (the added tick till "markChanged" is called)
+        size_t addedRecord = 0, changedRecord = 0; // The numbers of its latest records in the world's change logs
         friend Entity; // The entity is a friend since it is the only one allowed to set itself as an owner of a certain component.
+        friend World; // The world is a friend since it maintains the pool index.
     public:
         // This static method returns a unique string that identifies each type of components
-        // This ID will be used as the key to store a component into the entity's component map 
+        // This ID will be used as the key to store a component into the entity's component map
         // When you create a new type of components, override this function to return a new unique ID
-        static std::string getID() { return "Component"; }
+        // The string is built once and returned by reference so calling it doesn't allocate
+        static const std::string& getID() { static const std::string id = "Component"; return id; }
         // Reads the data of the component from a json object
         // It is abstract since it must be overriden by derived components
         virtual void deserialize(const nlohmann::json& data) = 0;
+        // Writes the data of the component to a compiled scene and reads it back (see "ecs/compiled-scene.hpp")
+        // "read" must read exactly what "write" wrote. They are abstract too since every component must support both.
+        virtual void write(SceneWriter& writer) const = 0;
+        virtual void read(SceneReader& reader) = 0;
+        // Writes/reads the runtime state of the component to/from a world snapshot (see "ecs/world-snapshot.hpp")
+        // By default, the state is the compiled scene data. Override them if the component changes more than that while playing.
+        virtual void saveState(SceneWriter& writer) const { write(writer); }
+        virtual void loadState(SceneReader& reader) { read(reader); }
         // Returns the owner of this component
         Entity* getOwner() const { return owner; }
+        // Returns the type ID of this component (see "getComponentTypeID")
+        ComponentTypeID getTypeID() const { return typeID; }
+        // Returns the position of this component in the world's pool of its type (only valid while it is pooled, e.g. while
+        // it is visited by a view). Systems may use it to keep per-component data in a dense side array.
+        size_t getPoolIndex() const { return poolIndex; }
+        // Returns the world tick at which this component was added and the tick of its last reported change
+        Tick getAddedTick() const { return addedTick; }
+        Tick getChangedTick() const { return changedTick; }
+        // Reports that the data of this component changed so the reactive queries pick it up (see "World::changed").
+        // The change isn't detected automatically, so call it after changing something that other systems react to.
+        // Fields that change every frame (like timers) are usually not reported since every component would match anyway.
+        // This is defined in "world.cpp" since it needs the complete World class.
+        void markChanged();
         // Define a virtual destructor
         virtual ~Component(){}
     };
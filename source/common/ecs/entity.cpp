@@ -1,4 +1,5 @@
 #include "entity.hpp"
+#include "world.hpp"
 #include "../deserialize-utils.hpp"
 #include "../components/component-deserializer.hpp"
 
@@ -17,10 +18,62 @@ namespace our {
         return matrix;
     }
 
+    // Returns the cached transformation from the entity's local space to the world space
+    const glm::mat4& Entity::getCachedLocalToWorldMatrix() const {
+        return world->getTransformNode(this).localToWorld;
+    }
+
+    // Returns the cached inverse transpose of the local to world matrix (used to transform normals)
+    const glm::mat4& Entity::getCachedNormalMatrix() const {
+        return world->getTransformNode(this).normalMatrix;
+    }
+
+    // Changes the parent of this entity and updates the world's children index
+    void Entity::setParent(Entity* newParent){
+        parent = newParent;
+        if(world) world->relinkParent(this);
+    }
+
+    // Renames the entity and updates the world's name index
+    void Entity::setName(const std::string& newName){
+        Symbol oldSymbol = nameSymbol;
+        name = newName;
+        nameSymbol = intern(newName);
+        if(world && oldSymbol != nameSymbol) world->reindexName(this, oldSymbol);
+    }
+
+    // Adds the component to the world's pool of its type
+    void Entity::attachToPool(Component* component){
+        if(world) world->attachComponent(component);
+    }
+
+    // Removes the component from the world's pool of its type
+    void Entity::detachFromPool(Component* component){
+        if(world) world->detachComponent(component);
+    }
+
+    // Allocates the memory of a new component from the world's slab pool of its type
+    void* Entity::allocateComponent(ComponentTypeID id, size_t size, size_t alignment, const std::string& typeName){
+        return world->getComponentSlab(id, size, alignment, typeName).allocate();
+    }
+
+    // Stamps the new component with the world's tick and logs its addition
+    void Entity::stampAdded(Component* component){
+        if(world) world->recordAdded(component);
+    }
+
+    // Destroys the component and returns its memory to the world's slab pool of its type
+    void Entity::destroyComponent(Component* component){
+        ComponentTypeID id = component->typeID;
+        world->recordRemoved(component);
+        component->~Component();
+        world->freeComponent(id, component);
+    }
+
     // Deserializes the entity data and components from a json object
     void Entity::deserialize(const nlohmann::json& data){
         if(!data.is_object()) return;
-        name = data.value("name", name);
+        setName(data.value("name", name));
         localTransform.deserialize(data);
         if(data.contains("components")){
             if(const auto& components = data["components"]; components.is_array()){
@@ -2,10 +2,12 @@
 
 #include "component.hpp"
 #include "transform.hpp"
-#include <list>
-#include <iterator>
+#include "symbol.hpp"
+#include <vector>
+#include <array>
 #include <string>
 #include <glm/glm.hpp>
+#include <new>
 
 namespace our {
 
@@ -13,21 +15,86 @@ namespace our {
 
     class Entity{
         World *world; // This defines what world own this entity
-        std::list<Component*> components; // A list of components that are owned by this entity
+        size_t worldIndex; // The position of this entity in the world's entity list
+        std::vector<Entity*> children; // The entities whose parent is this entity (maintained by the world)
+        Entity* indexedParent; // The parent under which this entity is listed in the children index
+        size_t transformIndex; // The position of this entity in the world's transform cache
+        std::vector<Component*> components; // The components owned by this entity in the order they were added
+        std::array<Component*, MAX_COMPONENT_TYPES> slots{}; // For each component type ID, the first component of that type (or null)
+        ComponentMask componentMask; // Bit "i" is set if "slots[i]" is not null
+        std::string name; // The name of the entity. It could be useful to refer to an entity by its name
+        Symbol nameSymbol = NO_SYMBOL; // The interned name (the key of the entity in the world's name index)
+        size_t nameSlot = 0; // The position of this entity in the world's list of the entities sharing its name
+        bool markedForRemoval = false; // True while the entity is in the world's "markedForRemoval" list
 
         friend World; // The world is a friend since it is the only class that is allowed to instantiate an entity
         Entity() = default; // The entity constructor is private since only the world is allowed to instantiate an entity
+
+        // Adds/Removes a component to/from the world's pool of its type.
+        // Only the component occupying the slot of its type is pooled, so each entity appears at most once per pool.
+        // These are defined in "entity.cpp" since they need the complete World class.
+        void attachToPool(Component* component);
+        void detachFromPool(Component* component);
+        // Allocates the memory of a new component from the world's slab pool of its type
+        void* allocateComponent(ComponentTypeID id, size_t size, size_t alignment, const std::string& typeName);
+        // Destroys the component and returns its memory to the world's slab pool of its type
+        void destroyComponent(Component* component);
+        // Stamps the new component with the world's tick and logs its addition (see "World::added")
+        void stampAdded(Component* component);
+
+        // Removes the component at the given position in "components" and deletes it
+        void eraseComponentAt(size_t position){
+            Component* component = components[position];
+            components.erase(components.begin() + position);
+            ComponentTypeID id = component->typeID;
+            if(slots[id] == component){
+                // If another component of the same type exists, it takes over the slot (and the pool entry)
+                detachFromPool(component);
+                slots[id] = nullptr;
+                for(auto other : components){
+                    if(other->typeID == id){
+                        slots[id] = other;
+                        attachToPool(other);
+                        break;
+                    }
+                }
+                componentMask.set(id, slots[id] != nullptr);
+            }
+            destroyComponent(component);
+        }
     public:
-        std::string name; // The name of the entity. It could be useful to refer to an entity by its name
         Entity* parent;   // The parent of the entity. The transform of the entity is relative to its parent.
                           // If parent is null, the entity is a root entity (has no parent).
         Transform localTransform; // The transform of this entity relative to its parent.
 
         World* getWorld() const { return world; } // Returns the world to which this entity belongs
 
+        // Returns the name of the entity and its interned symbol (compare symbols rather than strings in the hot paths)
+        const std::string& getName() const { return name; }
+        Symbol getNameSymbol() const { return nameSymbol; }
+        // Returns the position of the entity in the list of the entities sharing its name (see "World::findAllByName")
+        size_t getNameSlot() const { return nameSlot; }
+        // Renames the entity and updates the world's name index (see "World::findByName")
+        void setName(const std::string& newName);
+
         glm::mat4 getLocalToWorldMatrix() const; // Computes and returns the transformation from the entities local space to the world space
+        // Returns the local to world matrix (and its inverse transpose) computed by the last "World::updateTransforms" call.
+        // This is much cheaper than "getLocalToWorldMatrix" but changes made after the update are not reflected.
+        const glm::mat4& getCachedLocalToWorldMatrix() const;
+        const glm::mat4& getCachedNormalMatrix() const;
+        // Changes the parent of this entity and updates the world's children index
+        void setParent(Entity* newParent);
+        // Returns the entities whose parent is this entity
+        const std::vector<Entity*>& getChildren() const { return children; }
         void deserialize(const nlohmann::json&); // Deserializes the entity data and components from a json object
-        
+
+        // Returns a mask of the component types held by this entity (bit "getComponentTypeID<T>()" is set if it has a T)
+        const ComponentMask& getComponentMask() const { return componentMask; }
+        // Returns the number of components held by this entity
+        size_t getComponentCount() const { return components.size(); }
+        // Returns the components held by this entity in the order they were added
+        const std::vector<Component*>& getComponents() const { return components; }
+
         // This template method create a component of type T,
         // adds it to the components map and returns a pointer to it 
         template<typename T>
@@ -35,34 +102,48 @@ namespace our {
             static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
             //TODO: (Req 8) Create an component of type T, set its "owner" to be this entity, then push it into the component's list
             // Don't forget to return a pointer to the new component
-            T* component = new T();
+            ComponentTypeID id = getComponentTypeID<T>();
+            // The component lives in the world's slab pool of type T (value-initialized like "new T()" would do)
+            T* component = new (allocateComponent(id, sizeof(T), alignof(T), T::getID())) T();
             component->owner = this;
+            component->typeID = id;
+            stampAdded(component);
             components.push_back(component);
+            // Only the first component of each type occupies the slot (that is the one "getComponent" returns)
+            if(!slots[id]){
+                slots[id] = component;
+                componentMask.set(id);
+                attachToPool(component);
+            }
             return component;
         }
 
+        // This template method returns true if the entity holds a component of type T
+        template<typename T>
+        bool hasComponent() const {
+            return componentMask.test(getComponentTypeID<T>());
+        }
+
         // This template method searhes for a component of type T and returns a pointer to it
         // If no component of type T was found, it returns a nullptr 
         template<typename T>
         T* getComponent(){
             //TODO: (Req 8) Go through the components list and find the first component that can be dynamically cast to "T*".
             // Return the component you found, or return null of nothing was found.
-            for(auto it = components.begin(); it != components.end(); it++){
-                T* component = dynamic_cast<T*>(*it);
-                if(component) return component;
-            }
-            return nullptr;
+            // The slot table is indexed by the type ID so this is a single lookup (no list walk and no dynamic_cast)
+            static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+            return static_cast<T*>(slots[getComponentTypeID<T>()]);
         }
 
-        // This template method dynami and returns a pointer to it
-        // If no component of type T was found, it returns a nullptr 
+        // This template method returns the component at the given index if it is of type T
+        // If the index is out of range or the component is not a T, it returns a nullptr 
         template<typename T>
         T* getComponent(size_t index){
-            auto it = components.begin();
-            std::advance(it, index);
-            if(it != components.end())
-                return dynamic_cast<T*>(*it);
-            return nullptr;
+            static_assert(std::is_base_of<Component, T>::value, "T must inherit from Component");
+            if(index >= components.size()) return nullptr;
+            Component* component = components[index];
+            if(component->typeID != getComponentTypeID<T>()) return nullptr;
+            return static_cast<T*>(component);
         }
 
         // This template method searhes for a component of type T and deletes it
@@ -70,24 +151,12 @@ namespace our {
         void deleteComponent(){
             //TODO: (Req 8) Go through the components list and find the first component that can be dynamically cast to "T*".
             // If found, delete the found component and remove it from the components list
-            for(auto it = components.begin(); it != components.end(); it++){
-                T* component = dynamic_cast<T*>(*it);
-                if(component){
-                    delete component;
-                    components.erase(it);
-                    break;
-                }
-            }
+            deleteComponent(static_cast<T const*>(slots[getComponentTypeID<T>()]));
         }
 
         // This template method searhes for a component of type T and deletes it
         void deleteComponent(size_t index){
-            auto it = components.begin();
-            std::advance(it, index);
-            if(it != components.end()) {
-                delete *it;
-                components.erase(it);
-            }
+            if(index < components.size()) eraseComponentAt(index);
         }
 
         // This template method searhes for the given component and deletes it
@@ -95,10 +164,10 @@ namespace our {
         void deleteComponent(T const* component){
             //TODO: (Req 8) Go through the components list and find the given component "component".
             // If found, delete the found component and remove it from the components list
-            for(auto it = components.begin(); it != components.end(); it++){
-                if(*it == component){
-                    delete *it;
-                    components.erase(it);
+            if(!component) return;
+            for(size_t position = 0; position < components.size(); position++){
+                if(components[position] == component){
+                    eraseComponentAt(position);
                     break;
                 }
             }
@@ -108,9 +177,12 @@ namespace our {
         ~Entity(){
             //TODO: (Req 8) Delete all the components in "components".
             for(auto component : components){
-                delete component;
+                if(slots[component->typeID] == component) detachFromPool(component);
+                destroyComponent(component);
             }
             components.clear();
+            slots.fill(nullptr);
+            componentMask.reset();
         }
 
         // Entities should not be copyable
@@ -0,0 +1,106 @@
+#include "prefab.hpp"
+#include "world.hpp"
+#include "../components/component-deserializer.hpp"
+
+#include <array>
+
+namespace our {
+
+    bool Prefab::deserialize(const nlohmann::json& data){
+        clear();
+        if(!data.is_object()) return false;
+        // The entity is deserialized once in a scratch world, then its records are captured like a compiled scene
+        World scratch;
+        scratch.deserialize(nlohmann::json::array({data}));
+        if(scratch.getEntities().empty()) return false;
+        capture(scratch.getEntities().front());
+        return true;
+    }
+
+    void Prefab::capture(Entity* root){
+        clear();
+        if(!root) return;
+        // Collect the root and its descendants, parents first
+        std::vector<Entity*> hierarchy{root};
+        for(size_t index = 0; index < hierarchy.size(); index++){
+            const auto& children = hierarchy[index]->getChildren();
+            hierarchy.insert(hierarchy.end(), children.begin(), children.end());
+        }
+        writeSceneRecords(hierarchy, writer, entities, components);
+        writer.packStrings(strings, characters);
+        // The root doesn't keep the parent it had in its world
+        entities.front().parent = SceneEntityRecord::NO_PARENT;
+
+        // Resolve what each instance needs once: the factories, the type IDs and the names
+        auto& registry = getComponentFactories();
+        for(auto& record : components){
+            auto factory = registry.find(record.type);
+            factories.push_back(factory == registry.end() ? nullptr : factory->second);
+        }
+        for(auto entity : hierarchy){
+            for(auto component : entity->getComponents()){
+                if(getComponentTypeSymbol(component->getTypeID()) != NO_SYMBOL) componentTypes.push_back(component->getTypeID());
+            }
+        }
+        for(auto& record : entities){
+            const SceneStringRecord& name = strings[record.name];
+            names.emplace_back(characters, name.offset, name.length);
+        }
+    }
+
+    Entity* Prefab::instantiateOne(World& world, const Transform* transform, Entity* parent){
+        const char* data = writer.getData().data();
+        for(size_t index = 0; index < entities.size(); index++){
+            const auto& record = entities[index];
+            Entity* entity = world.add();
+            entity->setParent(record.parent == SceneEntityRecord::NO_PARENT ? parent : created[record.parent]);
+            entity->localTransform = (index == 0 && transform) ? *transform : record.localTransform;
+            if(!names[index].empty()) entity->setName(names[index]);
+            for(std::uint32_t component = record.firstComponent; component < record.firstComponent + record.componentCount; component++){
+                if(!factories[component]) continue;
+                const auto& componentRecord = components[component];
+                const char* begin = data + componentRecord.dataOffset;
+                SceneReader reader(begin, begin + componentRecord.dataSize, strings.data(), characters.data(), std::uint32_t(strings.size()));
+                factories[component](entity)->read(reader);
+            }
+            created[index] = entity;
+        }
+        return created.front();
+    }
+
+    Entity* Prefab::instantiate(World& world, const Transform* transform, Entity* parent){
+        if(entities.empty()) return nullptr;
+        created.resize(entities.size());
+        return instantiateOne(world, transform, parent);
+    }
+
+    void Prefab::instantiate(World& world, size_t count, const Transform* transforms, std::vector<Entity*>* roots){
+        if(entities.empty() || count == 0) return;
+        created.resize(entities.size());
+        // Grow the entity list and the pools once for all the instances
+        world.reserveEntities(count * entities.size());
+        std::array<size_t, MAX_COMPONENT_TYPES> perInstance{};
+        for(auto type : componentTypes) perInstance[type]++;
+        for(ComponentTypeID id = 0; id < MAX_COMPONENT_TYPES; id++){
+            if(perInstance[id] > 0) world.reserveComponents(id, count * perInstance[id]);
+        }
+        if(roots) roots->reserve(roots->size() + count);
+        for(size_t instance = 0; instance < count; instance++){
+            Entity* root = instantiateOne(world, transforms ? &transforms[instance] : nullptr, nullptr);
+            if(roots) roots->push_back(root);
+        }
+    }
+
+    void Prefab::clear(){
+        writer.clear();
+        strings.clear();
+        characters.clear();
+        entities.clear();
+        components.clear();
+        factories.clear();
+        componentTypes.clear();
+        names.clear();
+        created.clear();
+    }
+
+}
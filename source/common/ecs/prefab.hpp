@@ -0,0 +1,58 @@
+#pragma once
+
+#include "compiled-scene.hpp"
+#include "component.hpp"
+
+#include <json/json.hpp>
+#include <string>
+#include <vector>
+
+namespace our {
+
+    class World; // A forward declaration of the World Class
+    class Entity; // A forward declaration of the Entity Class
+
+    // A prefab is an entity (with its children) kept as a template that can be instantiated many times, e.g. a kart with
+    // its tires and driver. The json is only parsed once, when the prefab is created. The template holds the same records
+    // as a compiled scene (see "ecs/compiled-scene.hpp") so an instance only creates the entities, reads the component data
+    // back (see "Component::read") and remaps the parent indices to the new entities.
+    // NOTE: Only the root transform changes from one instance to the next. Components that keep their own copy of the
+    // position (like "RigidbodyComponent::position") keep the prefab's, so set them on the returned roots.
+    class Prefab {
+        SceneWriter writer; // The component data and the string table
+        std::vector<SceneStringRecord> strings;
+        std::string characters;
+        std::vector<SceneEntityRecord> entities; // Every parent comes before its children (the root is the first record)
+        std::vector<SceneComponentRecord> components;
+        std::vector<Component* (*)(Entity*)> factories; // The factory of each component record (see "ComponentFactory")
+        std::vector<ComponentTypeID> componentTypes; // The type ID of each component record (used to reserve the pools)
+        std::vector<std::string> names; // The name of each entity
+        std::vector<Entity*> created; // The entities of the instance being created (indexed like "entities")
+
+        // Creates one instance (the containers of the world were already reserved)
+        Entity* instantiateOne(World& world, const Transform* transform, Entity* parent);
+    public:
+        // Builds the template from the json of an entity as found in the scene files (with its "children").
+        // Returns false (and keeps the template empty) if the data is not an entity object.
+        bool deserialize(const nlohmann::json& data);
+        // Builds the template from an entity of a world and its descendants
+        void capture(Entity* root);
+
+        // Adds one instance to the world and returns its root. If given, "transform" replaces the local transform of the
+        // root and "parent" becomes its parent. Returns null if the prefab is empty.
+        Entity* instantiate(World& world, const Transform* transform = nullptr, Entity* parent = nullptr);
+        // Adds "count" instances to the world in one go. If "transforms" is not null, the root of the instance "i" gets the
+        // local transform "transforms[i]". The roots are appended to "roots" if it is not null.
+        // The entity list and the component pools of the world are grown once for all the instances.
+        void instantiate(World& world, size_t count, const Transform* transforms, std::vector<Entity*>* roots = nullptr);
+
+        // Returns true if there is nothing to instantiate
+        bool isEmpty() const { return entities.empty(); }
+        // Returns the number of entities and components of each instance
+        size_t getEntityCount() const { return entities.size(); }
+        size_t getComponentCount() const { return components.size(); }
+        // Empties the template
+        void clear();
+    };
+
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace our {
+
+    // A string in the string table of a compiled scene (the characters are stored back to back after the records)
+    struct SceneStringRecord {
+        std::uint32_t offset; // The position of the first character in the character block
+        std::uint32_t length;
+    };
+
+    // Writes the binary record of a component (see "Component::write").
+    // Plain values are copied as they are and strings are replaced by their index in the scene's string table.
+    class SceneWriter {
+        std::vector<char> data;
+        std::vector<std::string> strings;
+        std::unordered_map<std::string, std::uint32_t> stringIndices;
+    public:
+        // Appends a trivially copyable value (numbers, booleans, enums, glm vectors...)
+        template<typename T>
+        void write(const T& value) {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written as they are");
+            const char* bytes = reinterpret_cast<const char*>(&value);
+            data.insert(data.end(), bytes, bytes + sizeof(T));
+        }
+        // Appends the index of the string in the string table (the string is added if it is not there yet)
+        void writeString(const std::string& text) {
+            write(addString(text));
+        }
+
+        // Adds a string to the string table (if it is not there yet) and returns its index
+        std::uint32_t addString(const std::string& text) {
+            auto [it, inserted] = stringIndices.emplace(text, std::uint32_t(strings.size()));
+            if(inserted) strings.push_back(text);
+            return it->second;
+        }
+
+        // Empties the writer (the memory is kept so it can be reused)
+        void clear() {
+            data.clear();
+            strings.clear();
+            stringIndices.clear();
+        }
+
+        // The bytes written so far and the string table
+        const std::vector<char>& getData() const { return data; }
+        const std::vector<std::string>& getStrings() const { return strings; }
+
+        // Packs the string table the way the compiled scenes store it (one record per string, the characters back to back)
+        // so the data can be read back by a "SceneReader"
+        void packStrings(std::vector<SceneStringRecord>& records, std::string& characters) const {
+            records.clear();
+            characters.clear();
+            records.reserve(strings.size());
+            for(auto& text : strings){
+                records.push_back({std::uint32_t(characters.size()), std::uint32_t(text.size())});
+                characters += text;
+            }
+        }
+    };
+
+    // Reads the binary record of a component (see "Component::read") directly from the memory of a compiled scene.
+    // Reading past the end of the record returns default values and marks the reader as failed.
+    class SceneReader {
+        const char* cursor;
+        const char* end;
+        const SceneStringRecord* strings;
+        const char* characters;
+        std::uint32_t stringCount;
+        bool failed = false;
+    public:
+        SceneReader(const char* begin, const char* end, const SceneStringRecord* strings, const char* characters, std::uint32_t stringCount)
+            : cursor(begin), end(end), strings(strings), characters(characters), stringCount(stringCount) {}
+
+        // Reads a trivially copyable value
+        template<typename T>
+        T read() {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read as they are");
+            T value{};
+            if(size_t(end - cursor) < sizeof(T)) { failed = true; return value; }
+            std::memcpy(&value, cursor, sizeof(T));
+            cursor += sizeof(T);
+            return value;
+        }
+        // Reads a value into "value" (handy for the fields of a component)
+        template<typename T>
+        void read(T& value) { value = read<T>(); }
+
+        // Reads a string index and returns the string (it points into the compiled scene so copy it if it must outlive the load)
+        std::string_view readString() {
+            return getString(read<std::uint32_t>());
+        }
+        void readString(std::string& text) { text = std::string(readString()); }
+
+        // Returns the string at the given index of the string table
+        std::string_view getString(std::uint32_t index) {
+            if(index >= stringCount) { failed = true; return {}; }
+            return std::string_view(characters + strings[index].offset, strings[index].length);
+        }
+
+        // Returns true if a read went past the end of the record or used an invalid string
+        bool hasFailed() const { return failed; }
+    };
+
+}
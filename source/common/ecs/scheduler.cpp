@@ -0,0 +1,142 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+namespace our {
+
+    void SystemScheduler::add(const std::string& name, const SystemAccess& access, UpdateFunction update, bool mainThreadOnly){
+        SystemEntry entry;
+        entry.name = name;
+        entry.access = access;
+        entry.update = std::move(update);
+        entry.mainThreadOnly = mainThreadOnly;
+        // The new system depends on every earlier system it conflicts with
+        size_t index = systems.size();
+        for(auto& earlier : systems){
+            if(earlier.access.conflictsWith(access)){
+                earlier.dependents.push_back(index);
+                entry.dependencyCount++;
+            }
+        }
+        systems.push_back(std::move(entry));
+    }
+
+    void SystemScheduler::configure(const nlohmann::json& data){
+        setTimelineFrames(data.value("timelineFrames", size_t(0)));
+        timelinePath = timelineFrames > 0 ? data.value("timelinePath", std::string("scheduler-timeline.json")) : std::string();
+        setDeterministic(data.value("deterministic", false));
+    }
+
+    void SystemScheduler::clear(){
+        systems.clear();
+        timeline.clear();
+        frame = 0;
+    }
+
+    void SystemScheduler::dispatch(size_t system){
+        if(systems[system].mainThreadOnly) mainThreadReady.push_back(system);
+        else jobs.submit([this, system](){ execute(system); }, frameJobs);
+    }
+
+    bool SystemScheduler::takeMainThreadReady(size_t& system){
+        std::lock_guard<std::mutex> lock(mutex);
+        if(mainThreadReady.empty()) return false;
+        system = mainThreadReady.back();
+        mainThreadReady.pop_back();
+        return true;
+    }
+
+    void SystemScheduler::execute(size_t system){
+        double start = now();
+        systems[system].update(frameWorld, frameDeltaTime);
+        double end = now();
+        std::lock_guard<std::mutex> lock(mutex);
+        record(system, int(JobSystem::getCurrentThreadIndex()), start, end);
+        for(auto dependent : systems[system].dependents){
+            if(--pending[dependent] == 0) dispatch(dependent);
+        }
+        remaining--;
+    }
+
+    void SystemScheduler::record(size_t system, int thread, double start, double end){
+        if(timelineFrames == 0) return;
+        timeline.push_back({system, frame, thread, start, end});
+        while(!timeline.empty() && timeline.front().frame + timelineFrames <= frame) timeline.pop_front();
+    }
+
+    void SystemScheduler::run(World* world, float deltaTime){
+        frame++;
+        frameWorld = world;
+        frameDeltaTime = deltaTime;
+
+        // Without workers, the systems simply run in order (every earlier system is done before a later one starts)
+        if(deterministic || jobs.getWorkerCount() == 0){
+            for(size_t system = 0; system < systems.size(); system++){
+                double start = now();
+                systems[system].update(world, deltaTime);
+                record(system, 0, start, now());
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.resize(systems.size());
+            mainThreadReady.clear();
+            remaining = systems.size();
+            for(size_t system = 0; system < systems.size(); system++){
+                pending[system] = systems[system].dependencyCount;
+            }
+            for(size_t system = 0; system < systems.size(); system++){
+                if(pending[system] == 0) dispatch(system);
+            }
+        }
+
+        // The calling thread runs the main thread systems and helps with the other jobs while it waits
+        while(remaining > 0){
+            size_t system;
+            if(takeMainThreadReady(system)) execute(system);
+            else if(!jobs.runPendingJob()) std::this_thread::yield();
+        }
+        // The last jobs may still be returning from "execute"
+        jobs.wait(frameJobs);
+    }
+
+    bool SystemScheduler::writeTimeline(const std::string& path){
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ofstream file(path);
+        if(!file){
+            std::cerr << "Couldn't write the scheduler timeline to: " << path << std::endl;
+            return false;
+        }
+        nlohmann::json events = nlohmann::json::array();
+        for(auto& event : timeline){
+            events.push_back({
+                {"name", systems[event.system].name},
+                {"cat", "system"},
+                {"ph", "X"},
+                {"pid", 0},
+                {"tid", event.thread},
+                {"ts", event.start},
+                {"dur", event.end - event.start},
+                {"args", {{"frame", event.frame}}}
+            });
+        }
+        // Name the threads so the timeline is easier to read
+        for(int thread = 0; thread <= int(jobs.getWorkerCount()); thread++){
+            events.push_back({
+                {"name", "thread_name"},
+                {"ph", "M"},
+                {"pid", 0},
+                {"tid", thread},
+                {"args", {{"name", thread == 0 ? std::string("Main") : "Worker " + std::to_string(thread)}}}
+            });
+        }
+        file << nlohmann::json{{"traceEvents", events}}.dump(1);
+        std::cout << "Scheduler timeline written to: " << path << std::endl;
+        return true;
+    }
+
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+#include "../jobs/job-system.hpp"
+
+#include <json/json.hpp>
+
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cassert>
+
+namespace our {
+
+    class World; // A forward declaration of the World Class
+
+    // Every type a system can access (components, but also shared things like the Transform, the physics world or the input)
+    // is identified by a small integer ID. These IDs are independent from the component type IDs.
+    using AccessID = std::uint32_t;
+    constexpr AccessID MAX_ACCESS_IDS = 64;
+    using AccessMask = std::bitset<MAX_ACCESS_IDS>;
+
+    namespace internal {
+        // Returns a new access ID every time it is called. Only used by "getAccessID".
+        inline AccessID nextAccessID() {
+            static std::atomic<AccessID> counter{0};
+            return counter++;
+        }
+    }
+
+    // Returns the access ID of the type T. The ID is the same for every call with the same T.
+    template<typename T>
+    AccessID getAccessID() {
+        static const AccessID id = internal::nextAccessID();
+        assert(id < MAX_ACCESS_IDS && "Too many access types, increase MAX_ACCESS_IDS");
+        return id;
+    }
+
+    // The set of types that a system reads and writes during its update. For example:
+    //      SystemAccess().read<MovementComponent>().write<Transform>()
+    // Two systems conflict if one of them writes something that the other reads or writes.
+    // Conflicting systems never run at the same time, and they run in the order they were added to the scheduler.
+    struct SystemAccess {
+        AccessMask reads, writes;
+
+        template<typename... T>
+        SystemAccess& read() { (reads.set(getAccessID<T>()), ...); return *this; }
+        template<typename... T>
+        SystemAccess& write() { (writes.set(getAccessID<T>()), ...); return *this; }
+
+        bool conflictsWith(const SystemAccess& other) const {
+            return (writes & (other.reads | other.writes)).any() || (other.writes & reads).any();
+        }
+    };
+
+    // The scheduler runs the update of a list of systems every frame.
+    // From the declared accesses, it builds a dependency graph where every system waits for the earlier systems it conflicts with.
+    // The systems whose dependencies are done are submitted as jobs to the job system (the calling thread helps too).
+    // Systems that must run on the main thread (e.g. the ones using GLFW or OpenGL) are only picked by the calling thread.
+    // In deterministic mode, the systems run one after the other on the calling thread in the order they were added.
+    class SystemScheduler {
+    public:
+        using UpdateFunction = std::function<void(World*, float)>;
+
+        // One system update in the timeline
+        struct TimelineEvent {
+            size_t system; // The index of the system
+            size_t frame; // The frame in which it ran
+            int thread; // 0 is the calling thread, the job system workers are numbered from 1
+            double start, end; // In microseconds since the scheduler was created
+        };
+
+    private:
+        struct SystemEntry {
+            std::string name;
+            SystemAccess access;
+            UpdateFunction update;
+            bool mainThreadOnly;
+            std::vector<size_t> dependents; // The later systems that conflict with this one
+            size_t dependencyCount = 0; // The number of earlier systems that conflict with this one
+        };
+        std::vector<SystemEntry> systems;
+
+        // The job system that runs the systems and the state of the current frame (protected by "mutex")
+        JobSystem& jobs;
+        JobCounter frameJobs; // The jobs submitted during the current frame
+        std::mutex mutex;
+        std::vector<size_t> mainThreadReady; // The main thread systems whose dependencies are done
+        std::vector<size_t> pending; // For each system, the number of dependencies that are not done yet
+        std::atomic<size_t> remaining{0}; // The number of systems that are not done yet in this frame
+        World* frameWorld = nullptr;
+        float frameDeltaTime = 0;
+        bool deterministic = false;
+
+        // The timeline keeps the events of the last "timelineFrames" frames
+        std::deque<TimelineEvent> timeline;
+        size_t timelineFrames = 0;
+        std::string timelinePath; // Where "configure" asked the timeline to be written (empty if not requested)
+        size_t frame = 0;
+        std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+        double now() const {
+            return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+        }
+        // Submits a system whose dependencies are done (or hands it to the main thread) (the lock must be held)
+        void dispatch(size_t system);
+        // Takes a ready main thread system. Returns false if there is none.
+        bool takeMainThreadReady(size_t& system);
+        // Runs the system then dispatches its dependents (the lock must not be held)
+        void execute(size_t system);
+        // Appends an event to the timeline and drops the events of the frames that are too old (the lock must be held)
+        void record(size_t system, int thread, double start, double end);
+
+    public:
+        // The systems run on the given job system (by default, the one shared by the application)
+        explicit SystemScheduler(JobSystem& jobs = JobSystem::get()) : jobs(jobs) {}
+
+        // Adds a system to the end of the list. The order matters for conflicting systems (earlier systems run first).
+        void add(const std::string& name, const SystemAccess& access, UpdateFunction update, bool mainThreadOnly = false);
+
+        // Reads the scheduler options from a json object, for example:
+        //      { "deterministic": false, "timelineFrames": 120, "timelinePath": "timeline.json" }
+        // "timelineFrames" is the number of frames kept in the timeline (0 disables the recording)
+        // The number of threads is picked by the job system (see the "jobs" section of the app config)
+        void configure(const nlohmann::json& data);
+
+        // In deterministic mode, the systems run one after the other on the calling thread in the order they were added
+        void setDeterministic(bool deterministic) { this->deterministic = deterministic; }
+        // Removes all the systems and the recorded timeline
+        void clear();
+
+        // Runs the update of every system once
+        void run(World* world, float deltaTime);
+
+        // Keeps the schedule of the last "frames" frames so that it can be written by "writeTimeline" (0 disables the recording)
+        void setTimelineFrames(size_t frames) { timelineFrames = frames; }
+        // Writes the recorded timeline to a file in the Chrome tracing format (open it in chrome://tracing or Perfetto)
+        bool writeTimeline(const std::string& path);
+
+        // Returns the timeline path given to "configure" (empty if the timeline is not recorded)
+        const std::string& getTimelinePath() const { return timelinePath; }
+
+        size_t getWorkerCount() const { return jobs.getWorkerCount(); }
+        bool isDeterministic() const { return deterministic; }
+
+        // The scheduler refers to its running frame so it should not be copyable
+        SystemScheduler(const SystemScheduler&) = delete;
+        SystemScheduler& operator=(const SystemScheduler&) = delete;
+    };
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace our {
+
+    // The allocation statistics of a single pool (used by the memory dashboards)
+    struct MemoryPoolStats {
+        std::string name; // The name of the object type held by the pool
+        size_t objectSize = 0; // The size of each slot in bytes
+        size_t liveObjects = 0; // The number of objects currently allocated from the pool
+        size_t totalAllocations = 0; // The number of allocations since the pool was created
+        size_t slabs = 0; // The number of slabs requested from the system
+        size_t bytesInUse = 0; // The bytes occupied by the live objects
+        size_t bytesReserved = 0; // The bytes held by the slabs (in use or free)
+    };
+
+    // A slab pool hands out fixed-size slots carved out of large blocks (slabs) requested from the system.
+    // Freed slots are kept in an intrusive free list (the first bytes of a free slot point to the next free slot)
+    // so the slots are reused by the next allocations without going back to the system.
+    // The slabs are only returned to the system all at once by "release" (or when the pool is destroyed).
+    // NOTE: The pool only manages memory, the caller is responsible for constructing and destroying the objects.
+    class SlabPool {
+        std::string name;
+        size_t objectSize; // The slot size (at least a pointer so a free slot can hold the free list link)
+        size_t objectsPerSlab;
+        std::vector<char*> slabs;
+        void* freeList = nullptr; // The first free slot (or null if there are no freed slots)
+        size_t usedInLastSlab = 0; // The slots of the last slab that were handed out at least once
+        size_t liveObjects = 0;
+        size_t totalAllocations = 0;
+
+        // The slabs are allocated by "operator new" which guarantees this alignment
+        static constexpr size_t MAX_ALIGNMENT = alignof(std::max_align_t);
+        // The pool aims for slabs of this size (but each slab holds at least MIN_OBJECTS_PER_SLAB objects)
+        static constexpr size_t SLAB_BYTES = 16 * 1024;
+        static constexpr size_t MIN_OBJECTS_PER_SLAB = 16;
+
+    public:
+        SlabPool(std::string name, size_t size, size_t alignment) : name(std::move(name)) {
+            assert(alignment <= MAX_ALIGNMENT && "The slab pool does not support over-aligned types");
+            objectSize = std::max(size, sizeof(void*));
+            objectSize = (objectSize + alignment - 1) / alignment * alignment;
+            objectsPerSlab = std::max(MIN_OBJECTS_PER_SLAB, SLAB_BYTES / objectSize);
+            usedInLastSlab = objectsPerSlab;
+        }
+
+        // Returns an uninitialized slot big enough for one object
+        void* allocate() {
+            void* slot;
+            if(freeList) {
+                slot = freeList;
+                freeList = *static_cast<void**>(freeList);
+            } else {
+                if(usedInLastSlab == objectsPerSlab) {
+                    slabs.push_back(static_cast<char*>(::operator new(objectSize * objectsPerSlab)));
+                    usedInLastSlab = 0;
+                }
+                slot = slabs.back() + objectSize * usedInLastSlab++;
+            }
+            ++liveObjects;
+            ++totalAllocations;
+            return slot;
+        }
+
+        // Returns the slot to the free list so that it can be reused by the next allocation
+        void deallocate(void* slot) {
+            if(!slot) return;
+            *static_cast<void**>(slot) = freeList;
+            freeList = slot;
+            --liveObjects;
+        }
+
+        // Returns all the slabs to the system at once
+        // WARNING: Every object allocated from this pool must have been destroyed (or must be trivially destructible)
+        void release() {
+            for(auto slab : slabs) ::operator delete(slab);
+            slabs.clear();
+            freeList = nullptr;
+            usedInLastSlab = objectsPerSlab;
+            liveObjects = 0;
+        }
+
+        // Returns the allocation statistics of this pool
+        MemoryPoolStats getStats() const {
+            MemoryPoolStats stats;
+            stats.name = name;
+            stats.objectSize = objectSize;
+            stats.liveObjects = liveObjects;
+            stats.totalAllocations = totalAllocations;
+            stats.slabs = slabs.size();
+            stats.bytesInUse = liveObjects * objectSize;
+            stats.bytesReserved = slabs.size() * objectsPerSlab * objectSize;
+            return stats;
+        }
+
+        const std::string& getName() const { return name; }
+
+        ~SlabPool() { release(); }
+
+        // The pool owns its slabs so it should not be copyable
+        SlabPool(const SlabPool&) = delete;
+        SlabPool& operator=(const SlabPool&) = delete;
+    };
+
+}
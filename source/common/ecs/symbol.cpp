@@ -0,0 +1,55 @@
+#include "symbol.hpp"
+
+#include <iostream>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace our {
+
+    namespace {
+        // The symbols are already hashes so the table uses them as they are
+        struct SymbolHasher {
+            size_t operator()(Symbol symbol) const { return symbol; }
+        };
+
+        // The global symbol table (the strings are never removed so references to them stay valid)
+        struct SymbolTable {
+            std::shared_mutex mutex;
+            std::unordered_map<Symbol, std::string, SymbolHasher> names;
+        };
+
+        SymbolTable& getSymbolTable() {
+            static SymbolTable table;
+            return table;
+        }
+    }
+
+    Symbol intern(std::string_view text) {
+        Symbol symbol = hashSymbol(text);
+        if(symbol == NO_SYMBOL) return symbol;
+        auto& table = getSymbolTable();
+        {
+            // Most strings are already interned so the shared lock is enough
+            std::shared_lock<std::shared_mutex> lock(table.mutex);
+            if(auto it = table.names.find(symbol); it != table.names.end()) {
+                if(it->second != text) {
+                    std::cerr << "Symbol collision between \"" << it->second << "\" and \"" << text << "\"" << std::endl;
+                }
+                return symbol;
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(table.mutex);
+        table.names.emplace(symbol, std::string(text));
+        return symbol;
+    }
+
+    const std::string& getSymbolName(Symbol symbol) {
+        static const std::string empty;
+        auto& table = getSymbolTable();
+        std::shared_lock<std::shared_mutex> lock(table.mutex);
+        if(auto it = table.names.find(symbol); it != table.names.end()) return it->second;
+        return empty;
+    }
+
+}
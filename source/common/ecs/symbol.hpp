@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace our {
+
+    // A symbol is an interned string (an entity name, a tag, a component type name...) reduced to a 32-bit hash.
+    // Comparing two symbols is an integer compare, so the hot paths compare symbols computed once at load time
+    // instead of comparing strings every frame.
+    using Symbol = std::uint32_t;
+    // The symbol of the empty string (e.g. the name of an unnamed entity)
+    constexpr Symbol NO_SYMBOL = 0;
+
+    // Hashes a string into a symbol (32-bit FNV-1a). It is constexpr so symbols can be computed at compile time.
+    // NOTE: This does not register the string, use "intern" for strings that must be looked up by "getSymbolName".
+    constexpr Symbol hashSymbol(std::string_view text) {
+        if(text.empty()) return NO_SYMBOL;
+        Symbol hash = 2166136261u;
+        for(char character : text) {
+            hash ^= static_cast<unsigned char>(character);
+            hash *= 16777619u;
+        }
+        // No non-empty string may map to NO_SYMBOL
+        return hash == NO_SYMBOL ? 1 : hash;
+    }
+
+    // Returns the symbol of the given string and registers the string in the global symbol table.
+    // If two different strings hash to the same symbol, an error is printed (rename one of them).
+    // It is thread safe (but it takes a lock, so call it at load time and keep the result).
+    Symbol intern(std::string_view text);
+
+    // Returns the string that was interned as the given symbol (an empty string if it was never interned)
+    const std::string& getSymbolName(Symbol symbol);
+
+}
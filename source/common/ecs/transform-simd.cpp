@@ -0,0 +1,253 @@
+#include "transform-simd.hpp"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define OUR_TRANSFORM_KERNEL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OUR_TRANSFORM_KERNEL_SSE2
+#endif
+
+namespace our {
+
+    // Writes the matrix of a single transform given the sines and cosines of its euler angles
+    // The rotation part matches glm::yawPitchRoll(rotation.y, rotation.x, rotation.z)
+    static void composeTransform(const Transform& transform, float sh, float ch, float sp, float cp, float sb, float cb,
+                                 glm::mat4& matrix, glm::mat4* normalMatrix) {
+        glm::vec3 r0(ch * cb + sh * sp * sb, sb * cp, -sh * cb + ch * sp * sb);
+        glm::vec3 r1(-ch * sb + sh * sp * cb, cb * cp, sb * sh + ch * sp * cb);
+        glm::vec3 r2(sh * cp, -sp, ch * cp);
+        const glm::vec3& s = transform.scale;
+        const glm::vec3& t = transform.position;
+        matrix[0] = glm::vec4(r0 * s.x, 0.0f);
+        matrix[1] = glm::vec4(r1 * s.y, 0.0f);
+        matrix[2] = glm::vec4(r2 * s.z, 0.0f);
+        matrix[3] = glm::vec4(t, 1.0f);
+        if(normalMatrix) {
+            // Since the rotation is orthonormal, the inverse transpose of (T * R * S) is (T^-T * R * S^-1)
+            // The translation only shows up in the last row: -(R * S^-1)^T * t
+            glm::vec3 n0 = r0 / s.x, n1 = r1 / s.y, n2 = r2 / s.z;
+            (*normalMatrix)[0] = glm::vec4(n0, -glm::dot(t, n0));
+            (*normalMatrix)[1] = glm::vec4(n1, -glm::dot(t, n1));
+            (*normalMatrix)[2] = glm::vec4(n2, -glm::dot(t, n2));
+            (*normalMatrix)[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+
+    void composeTransformsScalar(const Transform* transforms, size_t count, glm::mat4* matrices, glm::mat4* normalMatrices) {
+        for(size_t index = 0; index < count; index++) {
+            const Transform& transform = transforms[index];
+            composeTransform(transform,
+                             std::sin(transform.rotation.y), std::cos(transform.rotation.y),
+                             std::sin(transform.rotation.x), std::cos(transform.rotation.x),
+                             std::sin(transform.rotation.z), std::cos(transform.rotation.z),
+                             matrices[index], normalMatrices ? normalMatrices + index : nullptr);
+        }
+    }
+
+#if defined(OUR_TRANSFORM_KERNEL_AVX2) || defined(OUR_TRANSFORM_KERNEL_SSE2)
+
+    // The SIMD kernel is written once against these thin wrappers so that the SSE2 and AVX2 versions share the math
+#if defined(OUR_TRANSFORM_KERNEL_AVX2)
+    struct Lanes {
+        using F = __m256;
+        using I = __m256i;
+        static constexpr int width = 8;
+        static F set(float value) { return _mm256_set1_ps(value); }
+        static I seti(int value) { return _mm256_set1_epi32(value); }
+        static F load(const float* data) { return _mm256_load_ps(data); }
+        static F add(F a, F b) { return _mm256_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+        static F div(F a, F b) { return _mm256_div_ps(a, b); }
+        static F mad(F a, F b, F c) { return _mm256_fmadd_ps(a, b, c); }
+        static F bitAnd(F a, F b) { return _mm256_and_ps(a, b); }
+        static F bitAndNot(F a, F b) { return _mm256_andnot_ps(a, b); }
+        static F bitXor(F a, F b) { return _mm256_xor_ps(a, b); }
+        static I toInt(F a) { return _mm256_cvttps_epi32(a); }
+        static F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+        static F asFloat(I a) { return _mm256_castsi256_ps(a); }
+        static I addi(I a, I b) { return _mm256_add_epi32(a, b); }
+        static I subi(I a, I b) { return _mm256_sub_epi32(a, b); }
+        static I andi(I a, I b) { return _mm256_and_si256(a, b); }
+        static I andNoti(I a, I b) { return _mm256_andnot_si256(a, b); }
+        static I equali(I a, I b) { return _mm256_cmpeq_epi32(a, b); }
+        static I shift29(I a) { return _mm256_slli_epi32(a, 29); }
+        // Writes one column (x, y, z, w held in 4 registers) of 8 consecutive matrices
+        static void storeColumn(F x, F y, F z, F w, glm::mat4* matrices, int column) {
+            __m128 low[4] = { _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z), _mm256_castps256_ps128(w) };
+            __m128 high[4] = { _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1) };
+            _MM_TRANSPOSE4_PS(low[0], low[1], low[2], low[3]);
+            _MM_TRANSPOSE4_PS(high[0], high[1], high[2], high[3]);
+            for(int lane = 0; lane < 4; lane++) {
+                _mm_storeu_ps(&matrices[lane][column][0], low[lane]);
+                _mm_storeu_ps(&matrices[lane + 4][column][0], high[lane]);
+            }
+        }
+    };
+#else
+    struct Lanes {
+        using F = __m128;
+        using I = __m128i;
+        static constexpr int width = 4;
+        static F set(float value) { return _mm_set1_ps(value); }
+        static I seti(int value) { return _mm_set1_epi32(value); }
+        static F load(const float* data) { return _mm_load_ps(data); }
+        static F add(F a, F b) { return _mm_add_ps(a, b); }
+        static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+        static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+        static F div(F a, F b) { return _mm_div_ps(a, b); }
+        static F mad(F a, F b, F c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+        static F bitAnd(F a, F b) { return _mm_and_ps(a, b); }
+        static F bitAndNot(F a, F b) { return _mm_andnot_ps(a, b); }
+        static F bitXor(F a, F b) { return _mm_xor_ps(a, b); }
+        static I toInt(F a) { return _mm_cvttps_epi32(a); }
+        static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+        static F asFloat(I a) { return _mm_castsi128_ps(a); }
+        static I addi(I a, I b) { return _mm_add_epi32(a, b); }
+        static I subi(I a, I b) { return _mm_sub_epi32(a, b); }
+        static I andi(I a, I b) { return _mm_and_si128(a, b); }
+        static I andNoti(I a, I b) { return _mm_andnot_si128(a, b); }
+        static I equali(I a, I b) { return _mm_cmpeq_epi32(a, b); }
+        static I shift29(I a) { return _mm_slli_epi32(a, 29); }
+        // Writes one column (x, y, z, w held in 4 registers) of 4 consecutive matrices
+        static void storeColumn(F x, F y, F z, F w, glm::mat4* matrices, int column) {
+            _MM_TRANSPOSE4_PS(x, y, z, w);
+            _mm_storeu_ps(&matrices[0][column][0], x);
+            _mm_storeu_ps(&matrices[1][column][0], y);
+            _mm_storeu_ps(&matrices[2][column][0], z);
+            _mm_storeu_ps(&matrices[3][column][0], w);
+        }
+    };
+#endif
+
+    using F = Lanes::F;
+    using I = Lanes::I;
+
+    // Computes the sine and cosine of every lane at once
+    // This is the single precision Cephes approximation: the angle is reduced to [-pi/4, pi/4] using extended precision
+    // then a minimax polynomial is evaluated for both functions and the results are swapped/negated per octant.
+    static void sincos(F x, F& sine, F& cosine) {
+        const F signMask = Lanes::asFloat(Lanes::seti(int(0x80000000)));
+        F sineSign = Lanes::bitAnd(x, signMask);
+        x = Lanes::bitAndNot(signMask, x); // |x|
+
+        // Find the octant: j = (int(x * 4 / pi) + 1) & ~1
+        I j = Lanes::toInt(Lanes::mul(x, Lanes::set(1.27323954473516f)));
+        j = Lanes::andi(Lanes::addi(j, Lanes::seti(1)), Lanes::seti(~1));
+        F y = Lanes::toFloat(j);
+
+        F sineSwap = Lanes::asFloat(Lanes::shift29(Lanes::andi(j, Lanes::seti(4))));
+        F polynomialMask = Lanes::asFloat(Lanes::equali(Lanes::andi(j, Lanes::seti(2)), Lanes::seti(0)));
+        F cosineSign = Lanes::asFloat(Lanes::shift29(Lanes::andNoti(Lanes::subi(j, Lanes::seti(2)), Lanes::seti(4))));
+        sineSign = Lanes::bitXor(sineSign, sineSwap);
+
+        // x = x - y * pi / 4 (using 3 parts of pi/4 to keep the precision)
+        x = Lanes::mad(y, Lanes::set(-0.78515625f), x);
+        x = Lanes::mad(y, Lanes::set(-2.4187564849853515625e-4f), x);
+        x = Lanes::mad(y, Lanes::set(-3.77489497744594108e-8f), x);
+
+        F z = Lanes::mul(x, x);
+        // The cosine polynomial
+        F c = Lanes::set(2.443315711809948e-5f);
+        c = Lanes::mad(c, z, Lanes::set(-1.388731625493765e-3f));
+        c = Lanes::mad(c, z, Lanes::set(4.166664568298827e-2f));
+        c = Lanes::mul(Lanes::mul(c, z), z);
+        c = Lanes::add(Lanes::sub(c, Lanes::mul(z, Lanes::set(0.5f))), Lanes::set(1.0f));
+        // The sine polynomial
+        F s = Lanes::set(-1.9515295891e-4f);
+        s = Lanes::mad(s, z, Lanes::set(8.3321608736e-3f));
+        s = Lanes::mad(s, z, Lanes::set(-1.6666654611e-1f));
+        s = Lanes::mad(Lanes::mul(s, z), x, x);
+
+        // Select which polynomial gives the sine and which gives the cosine in each lane
+        F sineFromSine = Lanes::bitAnd(polynomialMask, s);
+        F sineFromCosine = Lanes::bitAndNot(polynomialMask, c);
+        sine = Lanes::bitXor(Lanes::add(sineFromSine, sineFromCosine), sineSign);
+        cosine = Lanes::bitXor(Lanes::add(Lanes::sub(c, sineFromCosine), Lanes::sub(s, sineFromSine)), cosineSign);
+    }
+
+    // Computes the matrices of "Lanes::width" consecutive transforms
+    static void composeLanes(const Transform* transforms, glm::mat4* matrices, glm::mat4* normalMatrices) {
+        // Gather the transforms (array of structures) into one register per member (structure of arrays)
+        alignas(32) float lanes[9][Lanes::width];
+        for(int lane = 0; lane < Lanes::width; lane++) {
+            const Transform& transform = transforms[lane];
+            lanes[0][lane] = transform.position.x; lanes[1][lane] = transform.position.y; lanes[2][lane] = transform.position.z;
+            lanes[3][lane] = transform.rotation.x; lanes[4][lane] = transform.rotation.y; lanes[5][lane] = transform.rotation.z;
+            lanes[6][lane] = transform.scale.x; lanes[7][lane] = transform.scale.y; lanes[8][lane] = transform.scale.z;
+        }
+        F tx = Lanes::load(lanes[0]), ty = Lanes::load(lanes[1]), tz = Lanes::load(lanes[2]);
+        F sx = Lanes::load(lanes[6]), sy = Lanes::load(lanes[7]), sz = Lanes::load(lanes[8]);
+
+        // Yaw (y), Pitch (x) & Roll (z)
+        F sh, ch, sp, cp, sb, cb;
+        sincos(Lanes::load(lanes[4]), sh, ch);
+        sincos(Lanes::load(lanes[3]), sp, cp);
+        sincos(Lanes::load(lanes[5]), sb, cb);
+
+        // The rotation matrix columns (see "composeTransform" for the scalar equivalent)
+        F spsb = Lanes::mul(sp, sb), spcb = Lanes::mul(sp, cb);
+        F r00 = Lanes::mad(sh, spsb, Lanes::mul(ch, cb));
+        F r01 = Lanes::mul(sb, cp);
+        F r02 = Lanes::sub(Lanes::mul(ch, spsb), Lanes::mul(sh, cb));
+        F r10 = Lanes::sub(Lanes::mul(sh, spcb), Lanes::mul(ch, sb));
+        F r11 = Lanes::mul(cb, cp);
+        F r12 = Lanes::mad(ch, spcb, Lanes::mul(sb, sh));
+        F r20 = Lanes::mul(sh, cp);
+        F r21 = Lanes::sub(Lanes::set(0.0f), sp);
+        F r22 = Lanes::mul(ch, cp);
+
+        const F zero = Lanes::set(0.0f), one = Lanes::set(1.0f);
+        Lanes::storeColumn(Lanes::mul(r00, sx), Lanes::mul(r01, sx), Lanes::mul(r02, sx), zero, matrices, 0);
+        Lanes::storeColumn(Lanes::mul(r10, sy), Lanes::mul(r11, sy), Lanes::mul(r12, sy), zero, matrices, 1);
+        Lanes::storeColumn(Lanes::mul(r20, sz), Lanes::mul(r21, sz), Lanes::mul(r22, sz), zero, matrices, 2);
+        Lanes::storeColumn(tx, ty, tz, one, matrices, 3);
+
+        if(normalMatrices) {
+            F ix = Lanes::div(one, sx), iy = Lanes::div(one, sy), iz = Lanes::div(one, sz);
+            F n[3][3] = {
+                { Lanes::mul(r00, ix), Lanes::mul(r01, ix), Lanes::mul(r02, ix) },
+                { Lanes::mul(r10, iy), Lanes::mul(r11, iy), Lanes::mul(r12, iy) },
+                { Lanes::mul(r20, iz), Lanes::mul(r21, iz), Lanes::mul(r22, iz) }
+            };
+            for(int column = 0; column < 3; column++) {
+                F dot = Lanes::mad(tz, n[column][2], Lanes::mad(ty, n[column][1], Lanes::mul(tx, n[column][0])));
+                Lanes::storeColumn(n[column][0], n[column][1], n[column][2], Lanes::sub(zero, dot), normalMatrices, column);
+            }
+            Lanes::storeColumn(zero, zero, zero, one, normalMatrices, 3);
+        }
+    }
+
+    void composeTransforms(const Transform* transforms, size_t count, glm::mat4* matrices, glm::mat4* normalMatrices) {
+        size_t index = 0;
+        for(; index + Lanes::width <= count; index += Lanes::width) {
+            composeLanes(transforms + index, matrices + index, normalMatrices ? normalMatrices + index : nullptr);
+        }
+        // The remainder (less than a full register) is done using the scalar version
+        composeTransformsScalar(transforms + index, count - index, matrices + index, normalMatrices ? normalMatrices + index : nullptr);
+    }
+
+    const char* getTransformKernelName() {
+    #if defined(OUR_TRANSFORM_KERNEL_AVX2)
+        return "AVX2";
+    #else
+        return "SSE2";
+    #endif
+    }
+
+#else
+
+    void composeTransforms(const Transform* transforms, size_t count, glm::mat4* matrices, glm::mat4* normalMatrices) {
+        composeTransformsScalar(transforms, count, matrices, normalMatrices);
+    }
+
+    const char* getTransformKernelName() {
+        return "Scalar";
+    }
+
+#endif
+
+}
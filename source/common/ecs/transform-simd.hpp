@@ -0,0 +1,26 @@
+#pragma once
+
+#include "transform.hpp"
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+namespace our {
+
+    // Computes the matrices of "count" transforms at once. The result is identical (up to rounding) to "Transform::toMat4".
+    // Instead of building the translation, rotation and scale matrices then multiplying them, the matrix entries are
+    // written directly from the sines and cosines of the euler angles (which are computed for several transforms at once).
+    // "matrices[i]" receives the matrix of "transforms[i]".
+    // If "normalMatrices" is not null, "normalMatrices[i]" receives the inverse transpose of "matrices[i]"
+    // (this is computed from the same sines and cosines so no matrix inverse is needed).
+    // The kernel uses AVX2 if the compiler targets it (8 transforms per step), otherwise SSE2 (4 transforms per step).
+    // On other architectures, it falls back to the scalar version below.
+    void composeTransforms(const Transform* transforms, size_t count, glm::mat4* matrices, glm::mat4* normalMatrices = nullptr);
+
+    // The scalar version of "composeTransforms" (used for the remainder of the batch and on non x86 architectures)
+    void composeTransformsScalar(const Transform* transforms, size_t count, glm::mat4* matrices, glm::mat4* normalMatrices = nullptr);
+
+    // Returns the name of the instruction set used by "composeTransforms" ("AVX2", "SSE2" or "Scalar")
+    const char* getTransformKernelName();
+
+}
@@ -0,0 +1,93 @@
+#include "world-snapshot.hpp"
+#include "world.hpp"
+
+namespace our {
+
+    void WorldSnapshot::capture(World& world){
+        writer.clear();
+        entities.clear();
+        components.clear();
+
+        const auto& worldEntities = world.getEntities();
+        entities.assign(worldEntities.begin(), worldEntities.end());
+        for(auto entity : entities){
+            writer.write(entity->localTransform);
+            writer.write(entity->parent);
+            for(auto component : entity->getComponents()){
+                components.push_back(component);
+                component->saveState(writer);
+            }
+        }
+
+        // Pack the strings the same way the compiled scenes do so the state is read back with a "SceneReader"
+        writer.packStrings(strings, characters);
+        captured = true;
+    }
+
+    bool WorldSnapshot::matches(World& world) const {
+        const auto& worldEntities = world.getEntities();
+        if(worldEntities.size() != entities.size()) return false;
+        size_t next = 0;
+        for(size_t index = 0; index < entities.size(); index++){
+            Entity* entity = worldEntities[index];
+            if(entity != entities[index]) return false;
+            const auto& entityComponents = entity->getComponents();
+            if(next + entityComponents.size() > components.size()) return false;
+            for(auto component : entityComponents){
+                if(component != components[next++]) return false;
+            }
+        }
+        return next == components.size();
+    }
+
+    bool WorldSnapshot::restore(World& world) const {
+        if(!captured || !matches(world)) return false;
+        const auto& data = writer.getData();
+        SceneReader reader(data.data(), data.data() + data.size(), strings.data(), characters.data(), std::uint32_t(strings.size()));
+        size_t next = 0;
+        for(auto entity : entities){
+            reader.read(entity->localTransform);
+            Entity* parent = reader.read<Entity*>();
+            if(parent != entity->parent) entity->setParent(parent);
+            // The restored components are reported as changed so the reactive queries pick up the rollback
+            for(size_t count = entity->getComponentCount(); count > 0; count--){
+                Component* component = components[next++];
+                component->loadState(reader);
+                component->markChanged();
+            }
+        }
+        return !reader.hasFailed();
+    }
+
+    void WorldSnapshot::clear(){
+        writer.clear();
+        strings.clear();
+        characters.clear();
+        entities.clear();
+        components.clear();
+        captured = false;
+    }
+
+    void SnapshotHistory::push(World& world){
+        newest = count == 0 ? 0 : (newest + 1) % snapshots.size();
+        snapshots[newest].capture(world);
+        if(count < snapshots.size()) count++;
+    }
+
+    bool SnapshotHistory::rollback(World& world, size_t ticksAgo){
+        if(ticksAgo >= count) return false;
+        size_t position = (newest + snapshots.size() - ticksAgo) % snapshots.size();
+        if(!snapshots[position].restore(world)) return false;
+        // The restored snapshot becomes the newest so the next push doesn't overwrite it
+        newest = position;
+        count -= ticksAgo;
+        return true;
+    }
+
+    void SnapshotHistory::clear(){
+        for(auto& snapshot : snapshots) snapshot.clear();
+        newest = 0;
+        count = 0;
+    }
+
+}
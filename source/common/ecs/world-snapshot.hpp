@@ -0,0 +1,66 @@
+#pragma once
+
+#include "scene-stream.hpp"
+#include "transform.hpp"
+
+#include <vector>
+
+namespace our {
+
+    class World; // A forward declaration of the World Class
+    class Entity; // A forward declaration of the Entity Class
+    class Component; // A forward declaration of the Component Class
+
+    // A snapshot holds the state of a world at some point: the local transform and the parent of every entity, then the
+    // state of every component (see "Component::saveState") including the physics bodies, in one contiguous buffer.
+    // Restoring it puts the world back to that point in a single pass, so restarting a race or rolling back a few ticks
+    // doesn't have to know which fields each system changed.
+    // A snapshot only holds state, not structure: it can only be restored while the world has the same entities and
+    // components as when it was captured.
+    class WorldSnapshot {
+        SceneWriter writer; // The entity and component states (reused from one capture to the next)
+        std::vector<SceneStringRecord> strings; // The string table of the component states
+        std::string characters;
+        std::vector<Entity*> entities; // The entities in the order of the world's entity list
+        std::vector<Component*> components; // The components of these entities, entity after entity
+        bool captured = false;
+
+        // Returns true if the world still holds exactly the captured entities and components
+        bool matches(World& world) const;
+    public:
+        // Captures the state of the world. The buffers are kept between captures so capturing every tick doesn't allocate.
+        void capture(World& world);
+        // Restores the captured state. Returns false (and changes nothing) if nothing was captured or if entities or components
+        // were added or removed since the capture.
+        // WARNING: No other thread may use the world while this runs (call it at the sync point, after the systems are done).
+        bool restore(World& world) const;
+
+        // Returns true if nothing was captured yet
+        bool isEmpty() const { return !captured; }
+        // Returns the number of bytes of component state held by this snapshot
+        size_t getSize() const { return writer.getData().size(); }
+        // Forgets the captured state
+        void clear();
+    };
+
+    // Keeps the snapshots of the last few ticks in a ring so the world can be rolled back and resimulated.
+    class SnapshotHistory {
+        std::vector<WorldSnapshot> snapshots;
+        size_t newest = 0; // The position of the newest snapshot in the ring
+        size_t count = 0; // The number of captured snapshots (at most the capacity)
+    public:
+        explicit SnapshotHistory(size_t capacity) : snapshots(capacity > 0 ? capacity : 1) {}
+
+        // Captures the world in place of the oldest snapshot
+        void push(World& world);
+        // Restores the snapshot captured "ticksAgo" pushes ago (0 is the newest) and drops the snapshots that are newer.
+        // Returns false if there is no such snapshot or if the world structure changed since it was captured.
+        bool rollback(World& world, size_t ticksAgo = 0);
+
+        // Returns the number of snapshots that can be rolled back to
+        size_t size() const { return count; }
+        size_t capacity() const { return snapshots.size(); }
+        void clear();
+    };
+
+}
@@ -1,4 +1,6 @@
 #include "world.hpp"
+#include "transform-simd.hpp"
+#include <algorithm>
 
 namespace our {
 
@@ -10,7 +12,7 @@ namespace our {
         for(const auto& entityData : data){
             //TODO: (Req 8) Create an entity, make its parent "parent" and call its deserialize with "entityData".
             Entity* entity = add();
-            entity->parent = parent;
+            entity->setParent(parent);
             entity->deserialize(entityData);
             
             if(entityData.contains("children")){
@@ -21,4 +23,221 @@ namespace our {
         }
     }
 
-}
\ No newline at end of file
+    namespace {
+        // The command buffer last returned to this thread and the serial of the world it belongs to
+        // This saves the lock in "World::getCommandBuffer" when a thread records several commands in a row
+        struct CachedCommandBuffer {
+            std::uint64_t world = 0;
+            CommandBuffer* buffer = nullptr;
+        };
+        thread_local CachedCommandBuffer cachedCommandBuffer;
+
+        // Grows the capacity of the vector so that "extra" more elements fit (keeping the geometric growth)
+        template<typename T>
+        void reserveExtra(std::vector<T>& vector, size_t extra){
+            size_t required = vector.size() + extra;
+            if(required > vector.capacity()) vector.reserve(std::max(required, vector.capacity() * 2));
+        }
+    }
+
+    // Makes room for more entities in the entity list
+    void World::reserveEntities(size_t extra){
+        reserveExtra(entities, extra);
+    }
+
+    // Makes room for more components in the pool of the given type
+    void World::reserveComponents(ComponentTypeID id, size_t extra){
+        if(id < MAX_COMPONENT_TYPES) reserveExtra(pools[id], extra);
+    }
+
+    // Returns the command buffer of the calling thread (it is created on the first request)
+    CommandBuffer& World::getCommandBuffer(){
+        if(cachedCommandBuffer.world == serial) return *cachedCommandBuffer.buffer;
+        std::lock_guard<std::mutex> lock(commandBuffersMutex);
+        auto thread = std::this_thread::get_id();
+        CommandBuffer* found = nullptr;
+        for(auto& buffer : commandBuffers){
+            if(buffer->thread == thread) { found = buffer.get(); break; }
+        }
+        if(!found){
+            commandBuffers.push_back(std::make_unique<CommandBuffer>(thread));
+            found = commandBuffers.back().get();
+        }
+        cachedCommandBuffer = {serial, found};
+        return *found;
+    }
+
+    // Applies the commands recorded by every thread, buffer after buffer
+    void World::playbackCommands(){
+        std::lock_guard<std::mutex> lock(commandBuffersMutex);
+        // Count the new entities and components first so the containers grow once instead of once per insert
+        size_t creations = 0, commandCount = 0;
+        std::array<size_t, MAX_COMPONENT_TYPES> additions{};
+        for(auto& buffer : commandBuffers){
+            creations += buffer->createdNames.size();
+            commandCount += buffer->commands.size();
+            for(auto& command : buffer->commands){
+                if(command.type == CommandBuffer::CommandType::AddComponent) additions[command.componentType]++;
+            }
+        }
+        if(commandCount == 0) return;
+        reserveExtra(entities, creations);
+        for(ComponentTypeID id = 0; id < MAX_COMPONENT_TYPES; id++){
+            if(additions[id] > 0) reserveExtra(pools[id], additions[id]);
+        }
+        for(auto& buffer : commandBuffers) buffer->playback(this);
+    }
+
+    namespace {
+        // Nulls the record with the given number if it is still in the log and still refers to the component
+        void forgetRecord(std::vector<ChangeRecord>& records, size_t base, size_t number, const Component* component){
+            if(number < base) return;
+            size_t position = number - base;
+            if(position < records.size() && records[position].component == component) records[position].component = nullptr;
+        }
+
+        // Drops the records logged before the given tick (and counts them in "base")
+        template<typename Record>
+        void dropRecordsBefore(std::vector<Record>& records, size_t& base, Tick tick){
+            auto end = std::find_if(records.begin(), records.end(), [tick](const Record& record){ return record.tick >= tick; });
+            base += end - records.begin();
+            records.erase(records.begin(), end);
+        }
+    }
+
+    // Reports a change of this component to the world's change log
+    void Component::markChanged(){
+        owner->getWorld()->recordChanged(this);
+    }
+
+    // Stamps a new component with the current tick and logs it as added (and changed)
+    // Components are only added at the sync point (or by the main thread) so the logs are not locked here
+    void World::recordAdded(Component* component){
+        auto& log = changeLogs[component->typeID];
+        component->addedTick = component->changedTick = tick;
+        component->addedRecord = log.addedBase + log.added.size();
+        log.added.push_back({component, tick});
+        component->changedRecord = log.changedBase + log.changed.size();
+        log.changed.push_back({component, tick});
+    }
+
+    // Stamps the component with the current tick and logs it as changed
+    // Only its latest record is kept, so a component that changes every tick doesn't pile up records
+    void World::recordChanged(Component* component){
+        if(component->changedTick == tick) return;
+        component->changedTick = tick;
+        auto& log = changeLogs[component->typeID];
+        std::lock_guard<std::mutex> lock(log.mutex);
+        forgetRecord(log.changed, log.changedBase, component->changedRecord, component);
+        component->changedRecord = log.changedBase + log.changed.size();
+        log.changed.push_back({component, tick});
+    }
+
+    // Logs the removal of the component and forgets its records
+    void World::recordRemoved(Component* component){
+        if(releasing) return;
+        auto& log = changeLogs[component->typeID];
+        forgetRecord(log.added, log.addedBase, component->addedRecord, component);
+        forgetRecord(log.changed, log.changedBase, component->changedRecord, component);
+        log.removed.push_back({component->owner, component, tick});
+    }
+
+    // Moves to the next tick and drops the change records that are too old
+    void World::advanceTick(){
+        tick++;
+        if(tick <= CHANGE_HISTORY_TICKS) return;
+        historyStart = std::max(historyStart, tick - CHANGE_HISTORY_TICKS);
+        for(auto& log : changeLogs){
+            dropRecordsBefore(log.added, log.addedBase, historyStart);
+            dropRecordsBefore(log.changed, log.changedBase, historyStart);
+            size_t removedBase = 0;
+            dropRecordsBefore(log.removed, removedBase, historyStart);
+        }
+    }
+
+    // Moves the entity from the children list of its old parent to the children list of its current parent
+    void World::relinkParent(Entity* entity){
+        if(entity->indexedParent == entity->parent) return;
+        if(Entity* oldParent = entity->indexedParent; oldParent){
+            auto& siblings = oldParent->children;
+            siblings.erase(std::find(siblings.begin(), siblings.end(), entity));
+        }
+        if(entity->parent) entity->parent->children.push_back(entity);
+        entity->indexedParent = entity->parent;
+        hierarchyChanged = true;
+    }
+
+    // Sorts the transform nodes by depth (parents before children) using the children index
+    // This is a breadth first traversal starting from the root entities
+    void World::rebuildTransformNodes(){
+        transformNodes.clear();
+        transformNodes.reserve(entities.size());
+        for(auto entity : entities){
+            entity->transformIndex = TransformNode::NO_PARENT;
+            if(!entity->parent) {
+                entity->transformIndex = transformNodes.size();
+                transformNodes.push_back({entity, TransformNode::NO_PARENT});
+            }
+        }
+        for(size_t index = 0; index < transformNodes.size(); index++){
+            for(auto child : transformNodes[index].entity->children){
+                child->transformIndex = transformNodes.size();
+                transformNodes.push_back({child, index});
+            }
+        }
+    }
+
+    // This recomputes the cached local to world matrices of the entities whose local transform (or an ancestor's) changed
+    void World::updateTransforms(){
+        // Pick up the parents that were assigned directly (without "Entity::setParent")
+        for(auto entity : entities){
+            if(entity->parent != entity->indexedParent) relinkParent(entity);
+        }
+        // If the hierarchy changed, the nodes are sorted again and every matrix is recomputed
+        bool rebuilt = hierarchyChanged;
+        if(rebuilt){
+            rebuildTransformNodes();
+            hierarchyChanged = false;
+        }
+        // First, find the nodes that must be recomputed. Since the parents come before their children, a single pass is enough.
+        changedNodes.clear();
+        changedTransforms.clear();
+        movedEntities.clear();
+        for(size_t index = 0; index < transformNodes.size(); index++){
+            auto& node = transformNodes[index];
+            const Transform& local = node.entity->localTransform;
+            bool parentUpdated = node.parentNode != TransformNode::NO_PARENT && transformNodes[node.parentNode].updated;
+            node.updated = rebuilt || parentUpdated || local != node.lastLocal;
+            if(!node.updated) continue;
+            node.lastLocal = local;
+            changedNodes.push_back(index);
+            changedTransforms.push_back(local);
+            movedEntities.push_back(node.entity);
+        }
+        if(changedNodes.empty()) return;
+        // Then, the local matrices (and their inverse transpose) of all the changed nodes are computed in one SIMD batch
+        localMatrices.resize(changedNodes.size());
+        localNormalMatrices.resize(changedNodes.size());
+        composeTransforms(changedTransforms.data(), changedTransforms.size(), localMatrices.data(), localNormalMatrices.data());
+        // Finally, the local matrices are combined with the parents' matrices (still in depth order)
+        // Since (P * L)^-T = P^-T * L^-T, the normal matrices are combined the same way without inverting anything
+        for(size_t changed = 0; changed < changedNodes.size(); changed++){
+            auto& node = transformNodes[changedNodes[changed]];
+            if(node.parentNode != TransformNode::NO_PARENT){
+                const auto& parent = transformNodes[node.parentNode];
+                node.localToWorld = parent.localToWorld * localMatrices[changed];
+                node.normalMatrix = parent.normalMatrix * localNormalMatrices[changed];
+            } else {
+                node.localToWorld = localMatrices[changed];
+                node.normalMatrix = localNormalMatrices[changed];
+            }
+        }
+    }
+
+    // Returns the cache node of the entity (the cache is updated first if the entity is not in it yet)
+    const TransformNode& World::getTransformNode(const Entity* entity){
+        if(hierarchyChanged || entity->transformIndex >= transformNodes.size()) updateTransforms();
+        return transformNodes[entity->transformIndex];
+    }
+
+}
@@ -1,15 +1,217 @@
 #pragma once
 
-#include <unordered_set>
+#include <unordered_map>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
 #include "entity.hpp"
+#include "slab-pool.hpp"
+#include "command-buffer.hpp"
 
 namespace our {
 
+    // A pool holds the components of a single type densely packed in a vector.
+    // Systems that only care about one type (or a few types) iterate the pool instead of every entity in the world.
+    // Each component remembers its position in the pool ("Component::poolIndex") so removal is O(1) (swap with the last).
+    using ComponentPool = std::vector<Component*>;
+
+    template<typename... T> class View;
+    template<typename T> class ChangeView;
+    class RemovalView;
+
+    // The number of ticks the change logs are kept for. A system that didn't query the changes for longer than that must
+    // visit all its components again (see "World::hasChangeHistory").
+    constexpr Tick CHANGE_HISTORY_TICKS = 8;
+
+    // An entry of the world's change logs: a component that was added or changed at the given tick
+    // The component is null if it was removed (or changed again) since.
+    struct ChangeRecord {
+        Component* component;
+        Tick tick;
+    };
+
+    // An entry of the world's removal logs: a component that was removed at the given tick and its owner
+    // Both may be deleted by now, so only compare the pointers (e.g. to drop the entity from a cached list)
+    struct RemovalRecord {
+        Entity* entity;
+        Component* component;
+        Tick tick;
+    };
+
+    // A node in the world's transform cache. The nodes are sorted by depth so every parent comes before its children.
+    struct TransformNode {
+        Entity* entity;
+        size_t parentNode; // The index of the parent's node (or NO_PARENT for root entities)
+        Transform lastLocal; // The local transform used to compute the cached matrices (used to detect changes)
+        bool updated; // True if the matrices were recomputed in the last update (so the children must be recomputed too)
+        glm::mat4 localToWorld; // The cached local to world matrix
+        glm::mat4 normalMatrix; // The cached inverse transpose of "localToWorld"
+
+        static constexpr size_t NO_PARENT = static_cast<size_t>(-1);
+    };
+
     // This class holds a set of entities
     class World {
-        std::unordered_set<Entity*> entities; // These are the entities held by this world
-        std::unordered_set<Entity*> markedForRemoval; // These are the entities that are awaiting to be deleted
-                                                      // when deleteMarkedEntities is called
+        std::vector<Entity*> entities; // These are the entities held by this world
+        std::vector<Entity*> markedForRemoval; // These are the entities that are awaiting to be deleted
+                                               // when deleteMarkedEntities is called (in the order they were marked)
+        std::array<ComponentPool, MAX_COMPONENT_TYPES> pools; // For each component type ID, the components of that type
+        // The named entities indexed by their name symbol. Each entity knows its slot in the list of its name
+        // ("Entity::nameSlot"), so it leaves the list in constant time however many entities share the name.
+        std::unordered_map<Symbol, std::vector<Entity*>> nameIndex;
+        std::vector<TransformNode> transformNodes; // The transform cache sorted by depth (see "updateTransforms")
+        bool hierarchyChanged = true; // True if entities were added, removed or reparented since the cache was sorted
+        // Scratch buffers used by "updateTransforms" to compute the local matrices of the changed nodes in one batch
+        std::vector<size_t> changedNodes;
+        std::vector<Transform> changedTransforms;
+        std::vector<glm::mat4> localMatrices, localNormalMatrices;
+        std::vector<Entity*> movedEntities; // The entities whose matrices were recomputed by the last "updateTransforms"
+
+        // The change logs of a component type (see "added", "changed" and "removed")
+        // The records are appended in tick order and "advanceTick" drops the ones older than "CHANGE_HISTORY_TICKS".
+        // The records are numbered from the first one ever logged so a component can find its latest records in O(1)
+        // ("Component::addedRecord/changedRecord") and null them when it is removed or changed again.
+        struct ChangeLog {
+            std::vector<ChangeRecord> added, changed;
+            std::vector<RemovalRecord> removed;
+            size_t addedBase = 0, changedBase = 0; // The number of records dropped from the front of "added" and "changed"
+            std::mutex mutex; // The jobs of a parallel system may report changes of the same type at once
+        };
+        std::array<ChangeLog, MAX_COMPONENT_TYPES> changeLogs;
+        Tick tick = 1; // The current tick (advanced by "advanceTick")
+        Tick historyStart = 1; // The oldest tick whose changes are still all logged
+
+        // The memory of the entities and the components comes from these slab pools (one per type)
+        // So spawning/despawning reuses freed slots and "clear" returns the memory to the system in a few large blocks
+        SlabPool entitySlab{"Entity", sizeof(Entity), alignof(Entity)};
+        std::array<std::unique_ptr<SlabPool>, MAX_COMPONENT_TYPES> componentSlabs;
+        bool releasing = false; // True while "clear" is destroying everything (the pools are released in bulk afterwards)
+
+        // The command buffers of the threads that recorded structural changes for this world (see "getCommandBuffer")
+        std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+        std::mutex commandBuffersMutex;
+        // Identifies this world in the threads' command buffer caches (unlike the address, it is never reused)
+        const std::uint64_t serial = nextSerial();
+
+        static std::uint64_t nextSerial() {
+            static std::atomic<std::uint64_t> counter{1};
+            return counter++;
+        }
+
+        friend Entity; // The entity is a friend since it notifies the world when its components change
+        friend Component; // The component is a friend since it reports its changes to the world (see "Component::markChanged")
+
+        // Returns the slab pool of the given component type (it is created on the first request)
+        SlabPool& getComponentSlab(ComponentTypeID id, size_t size, size_t alignment, const std::string& typeName){
+            auto& slab = componentSlabs[id];
+            if(!slab) slab = std::make_unique<SlabPool>(typeName, size, alignment);
+            return *slab;
+        }
+
+        // Returns the memory of a destroyed component to the slab pool of its type
+        void freeComponent(ComponentTypeID id, void* memory){
+            if(!releasing) componentSlabs[id]->deallocate(memory);
+        }
+
+        // Destroys the entity and returns its memory to the entity slab pool
+        void destroyEntity(Entity* entity){
+            entity->~Entity();
+            if(!releasing) entitySlab.deallocate(entity);
+        }
+
+        // Adds the component to the end of the pool of its type
+        void attachComponent(Component* component){
+            ComponentPool& pool = pools[component->typeID];
+            component->poolIndex = pool.size();
+            pool.push_back(component);
+        }
+
+        // Removes the component from the pool of its type by moving the last component into its place
+        void detachComponent(Component* component){
+            if(releasing) return;
+            ComponentPool& pool = pools[component->typeID];
+            size_t index = component->poolIndex;
+            if(index >= pool.size() || pool[index] != component) return;
+            pool[index] = pool.back();
+            pool[index]->poolIndex = index;
+            pool.pop_back();
+        }
+
+        // Stamps a new component with the current tick and logs it as added (and changed)
+        void recordAdded(Component* component);
+        // Stamps the component with the current tick and logs it as changed (at most once per tick)
+        void recordChanged(Component* component);
+        // Logs the removal of the component and forgets its records (the component is about to be deleted)
+        void recordRemoved(Component* component);
+
+        // Returns the position of the first record logged at or after the given tick
+        template<typename Record>
+        static size_t firstRecordSince(const std::vector<Record>& records, Tick since){
+            return std::lower_bound(records.begin(), records.end(), since,
+                [](const Record& record, Tick tick){ return record.tick < tick; }) - records.begin();
+        }
+
+        // Moves the entity from the children list of its old parent to the children list of its current parent
+        void relinkParent(Entity* entity);
+        // Returns the cache node of the entity (the cache is updated first if the entity is not in it yet)
+        const TransformNode& getTransformNode(const Entity* entity);
+        // Sorts the transform nodes by depth (parents before children) using the children index
+        void rebuildTransformNodes();
+
+        // Applies the commands recorded by every thread, buffer after buffer
+        // The entity list and the component pools are grown once for all the recorded creations and additions
+        void playbackCommands();
+
+        // Moves the entity from its old name in the name index to its current one (unnamed entities are not indexed)
+        void reindexName(Entity* entity, Symbol oldSymbol){
+            if(oldSymbol != NO_SYMBOL){
+                auto list = nameIndex.find(oldSymbol);
+                if(list != nameIndex.end()){
+                    // The last entity of the list takes the place of the removed one
+                    auto& named = list->second;
+                    Entity* last = named.back();
+                    named[entity->nameSlot] = last;
+                    last->nameSlot = entity->nameSlot;
+                    named.pop_back();
+                    if(named.empty()) nameIndex.erase(list);
+                }
+            }
+            if(entity->nameSymbol != NO_SYMBOL){
+                auto& named = nameIndex[entity->nameSymbol];
+                entity->nameSlot = named.size();
+                named.push_back(entity);
+            }
+        }
+
+        // Removes the entity from the entity list by moving the last entity into its place, then deletes it
+        void eraseEntity(Entity* entity){
+            if(entity->nameSymbol != NO_SYMBOL){
+                Symbol symbol = entity->nameSymbol;
+                entity->nameSymbol = NO_SYMBOL;
+                reindexName(entity, symbol);
+            }
+            // The entity leaves the hierarchy and its children become roots
+            for(auto child : entity->children){
+                child->parent = nullptr;
+                child->indexedParent = nullptr;
+            }
+            entity->children.clear();
+            entity->parent = nullptr;
+            relinkParent(entity);
+            hierarchyChanged = true;
+            movedEntities.clear();
+            size_t index = entity->worldIndex;
+            entities[index] = entities.back();
+            entities[index]->worldIndex = index;
+            entities.pop_back();
+            destroyEntity(entity);
+        }
     public:
 
         World() = default;
@@ -21,39 +223,149 @@ namespace our {
 
         // This adds an entity to the entities set and returns a pointer to that entity
         // WARNING The entity is owned by this world so don't use "delete" to delete it, instead, call "markForRemoval"
-        // to put it in the "markedForRemoval" set. The elements in the "markedForRemoval" set will be removed and
+        // to put it in the "markedForRemoval" list. The elements in the "markedForRemoval" list will be removed and
         // deleted when "deleteMarkedEntities" is called.
         Entity* add() {
             //TODO: (Req 8) Create a new entity, set its world member variable to this,
             // and don't forget to insert it in the suitable container.
-            Entity* entity = new Entity();
+            Entity* entity = new (entitySlab.allocate()) Entity();
             entity->world = this;
-            entities.insert(entity);
+            entity->worldIndex = entities.size();
+            entities.push_back(entity);
+            hierarchyChanged = true;
             return entity;
         }
 
-        // This returns and immutable reference to the set of all entites in the world.
-        const std::unordered_set<Entity*>& getEntities() {
+        // These make room for "extra" more entities (or more components of the given type) so adding many of them at once
+        // grows the containers once (see "Prefab::instantiate")
+        void reserveEntities(size_t extra);
+        void reserveComponents(ComponentTypeID id, size_t extra);
+
+        // This returns the command buffer of the calling thread. The structural changes recorded in it are applied by
+        // the next call to "deleteMarkedEntities", so it is safe to use from the systems that run concurrently, e.g.:
+        //      auto& commands = world->getCommandBuffer();
+        //      auto spark = commands.create("spark");
+        //      commands.addComponent<MovementComponent>(spark, [](MovementComponent* movement){ movement->linearVelocity = {0, 5, 0}; });
+        CommandBuffer& getCommandBuffer();
+
+        // This returns and immutable reference to the list of all entites in the world.
+        const std::vector<Entity*>& getEntities() {
             return entities;
         }
 
-        // This marks an entity for removal by adding it to the "markedForRemoval" set.
-        // The elements in the "markedForRemoval" set will be removed and deleted when "deleteMarkedEntities" is called.
+        // This returns an entity with the given name (or null if there is none). It is a hash lookup, not a scan.
+        // If several entities share the name, any of them may be returned (use "findAllByName" to get all of them).
+        Entity* findByName(Symbol name) const {
+            auto it = nameIndex.find(name);
+            return it == nameIndex.end() ? nullptr : it->second.front();
+        }
+        Entity* findByName(std::string_view name) const {
+            return findByName(hashSymbol(name));
+        }
+
+        // This returns all the entities with the given name
+        std::vector<Entity*> findAllByName(Symbol name) const {
+            auto it = nameIndex.find(name);
+            return it == nameIndex.end() ? std::vector<Entity*>() : it->second;
+        }
+
+        // This returns the pool of components of type T (at most one per entity)
+        template<typename T>
+        const ComponentPool& getPool() const {
+            return pools[getComponentTypeID<T>()];
+        }
+
+        // This returns the number of entities holding a component of type T
+        template<typename T>
+        size_t count() const {
+            return getPool<T>().size();
+        }
+
+        // This returns a view over the entities holding all the component types T...
+        // Iterating the view yields a tuple (Entity*, T*...) for each of these entities, for example:
+        //      for(auto [entity, meshRenderer, light] : world->view<MeshRendererComponent, LightComponent>()) { ... }
+        // Only the smallest pool of the requested types is walked so the cost depends on the number of matches.
+        // WARNING: Don't add or remove components of the viewed types while iterating a view.
+        template<typename... T>
+        View<T...> view() {
+            static_assert(sizeof...(T) > 0, "A view needs at least one component type");
+            return View<T...>(this);
+        }
+
+        // This returns the current tick. Components added or changed now are stamped with it.
+        Tick getTick() const { return tick; }
+
+        // This moves to the next tick and drops the change records older than "CHANGE_HISTORY_TICKS".
+        // It is called once per frame at the sync point (after "deleteMarkedEntities").
+        void advanceTick();
+
+        // This returns true if every change made since the given tick is still logged. If it returns false (e.g. the
+        // system never ran or didn't run for a while), the reactive queries miss some changes so visit the whole pool instead.
+        bool hasChangeHistory(Tick since) const {
+            return since >= historyStart;
+        }
+
+        // These are the reactive queries. They yield a tuple (Entity*, T*) for each component of type T that was added
+        // (or changed, additions included) at or after the given tick, for example:
+        //      for(auto [entity, checkpoint] : world->added<CheckpointComponent>(lastRun)) { ... }
+        // A system usually passes the tick of its last run so it also sees what the later systems changed in that frame
+        // (it sees its own changes again, so handling a change must be idempotent). The cost depends on the number of
+        // changes, not on the number of components. Each component is visited once, even if it changed on several ticks.
+        // WARNING: Like views, don't add or remove components of type T while iterating, and only query the types that the
+        // system may read (see "SystemAccess").
+        template<typename T>
+        ChangeView<T> added(Tick since) const {
+            const auto& records = changeLogs[getComponentTypeID<T>()].added;
+            return ChangeView<T>(&records, firstRecordSince(records, since));
+        }
+        template<typename T>
+        ChangeView<T> changed(Tick since) const {
+            const auto& records = changeLogs[getComponentTypeID<T>()].changed;
+            return ChangeView<T>(&records, firstRecordSince(records, since));
+        }
+        // This yields the owners of the components of type T that were removed at or after the given tick
+        // (including the components deleted alongside their entity). The entities may be deleted already (see "RemovalRecord").
+        template<typename T>
+        RemovalView removed(Tick since) const;
+
+        // This returns the entities whose cached matrices were recomputed by the last "updateTransforms" (since their
+        // local transform changed, or an ancestor's did, or the hierarchy changed). The list is emptied when entities are removed.
+        const std::vector<Entity*>& getMovedEntities() const {
+            return movedEntities;
+        }
+
+        // This recomputes the cached local to world matrices (see "Entity::getCachedLocalToWorldMatrix").
+        // Only the entities whose local transform changed (and their descendants) are recomputed.
+        // Parent changes done through "Entity::setParent" or by assigning "Entity::parent" directly are both picked up here.
+        void updateTransforms();
+
+        // This marks an entity for removal by adding it to the "markedForRemoval" list (once, see "Entity::markedForRemoval").
+        // The elements in the "markedForRemoval" list will be removed and deleted when "deleteMarkedEntities" is called.
         void markForRemoval(Entity* entity){
             //TODO: (Req 8) If the entity is in this world, add it to the "markedForRemoval" set.
-            auto it = entities.find(entity);
-            if(it != entities.end()){
-                markedForRemoval.insert(entity);
+            if(entity && entity->world == this && !entity->markedForRemoval){
+                entity->markedForRemoval = true;
+                markedForRemoval.push_back(entity);
             }
         }
 
-        // This removes the elements in "markedForRemoval" from the "entities" set.
-        // Then each of these elements are deleted.
+        // This removes and deletes right away the entities added after the first "count" ones (the latest entities are
+        // erased first, so the others keep their place), e.g. to undo a load that failed half way.
+        // WARNING: Like "deleteMarkedEntities", no other thread may use the world while this runs.
+        void truncateEntities(size_t count){
+            while(entities.size() > count) eraseEntity(entities.back());
+        }
+
+        // This is the sync point of the structural changes: the commands recorded in the command buffers are applied,
+        // then the elements in "markedForRemoval" are removed from the "entities" set and deleted.
+        // They are erased in the order they were marked, so the order of the entities and the pools doesn't depend on
+        // their addresses (the deterministic scheduler and "WorldSnapshot" rely on it).
+        // WARNING: No other thread may use the world while this runs (and the component initializers must not record commands).
         void deleteMarkedEntities(){
+            playbackCommands();
             //TODO: (Req 8) Remove and delete all the entities that have been marked for removal
             for(auto entity : markedForRemoval){
-                entities.erase(entity);
-                delete entity;
+                eraseEntity(entity);
             }
             markedForRemoval.clear();
         }
@@ -61,11 +373,41 @@ namespace our {
         //This deletes all entities in the world
         void clear(){
             //TODO: (Req 8) Delete all the entites and make sure that the containers are empty
+            // The destructors still run (components may own resources) but the entities and components
+            // won't leave the component pools or return their memory one by one since everything is released below
+            releasing = true;
             for(auto entity : entities){
-                delete entity;
+                destroyEntity(entity);
             }
+            releasing = false;
             entities.clear();
             markedForRemoval.clear();
+            nameIndex.clear();
+            // The recorded commands may refer to the deleted entities (the buffers are kept since the threads cache them)
+            for(auto& buffer : commandBuffers) buffer->clear();
+            for(auto& pool : pools) pool.clear();
+            transformNodes.clear();
+            movedEntities.clear();
+            hierarchyChanged = true;
+            // The deleted components were not logged as removed, so the changes made before now can't be queried anymore
+            for(auto& log : changeLogs){
+                log.addedBase += log.added.size();
+                log.changedBase += log.changed.size();
+                log.added.clear();
+                log.changed.clear();
+                log.removed.clear();
+            }
+            historyStart = tick + 1;
+            entitySlab.release();
+            for(auto& slab : componentSlabs) if(slab) slab->release();
+        }
+
+        // Returns the allocation statistics of the entity pool followed by each component pool
+        std::vector<MemoryPoolStats> getMemoryStats() const {
+            std::vector<MemoryPoolStats> stats;
+            stats.push_back(entitySlab.getStats());
+            for(auto& slab : componentSlabs) if(slab) stats.push_back(slab->getStats());
+            return stats;
         }
 
         //Since the world owns all of its entities, they should be deleted alongside it.
@@ -78,4 +420,108 @@ namespace our {
         World &operator=(World const &) = delete;
     };
 
-}
\ No newline at end of file
+    // A view iterates over the entities that hold every one of the component types T...
+    // It walks the smallest of the pools and uses the entity's component mask to skip the non-matching entities.
+    template<typename... T>
+    class View {
+        const ComponentPool* pool = nullptr; // The pool that is walked (the smallest of the requested types)
+        ComponentMask mask; // The component types that an entity must hold to be visited
+    public:
+        explicit View(World* world) {
+            const ComponentPool* candidates[] = { &world->getPool<T>()... };
+            pool = candidates[0];
+            for(auto candidate : candidates) if(candidate->size() < pool->size()) pool = candidate;
+            (mask.set(getComponentTypeID<T>()), ...);
+        }
+
+        class Iterator {
+            const ComponentPool* pool;
+            size_t index;
+            ComponentMask mask;
+
+            // Moves forward till an entity holding all the requested types is found
+            void skip(){
+                while(index < pool->size() && ((*pool)[index]->getOwner()->getComponentMask() & mask) != mask) ++index;
+            }
+        public:
+            Iterator(const ComponentPool* pool, size_t index, const ComponentMask& mask) : pool(pool), index(index), mask(mask) { skip(); }
+            std::tuple<Entity*, T*...> operator*() const {
+                Entity* entity = (*pool)[index]->getOwner();
+                return { entity, entity->getComponent<T>()... };
+            }
+            Iterator& operator++() { ++index; skip(); return *this; }
+            bool operator!=(const Iterator& other) const { return index != other.index; }
+            bool operator==(const Iterator& other) const { return index == other.index; }
+        };
+
+        Iterator begin() const { return Iterator(pool, 0, mask); }
+        Iterator end() const { return Iterator(pool, pool->size(), mask); }
+    };
+
+    // A change view iterates over the records of a change log from a given position and skips the forgotten records
+    template<typename T>
+    class ChangeView {
+        const std::vector<ChangeRecord>* records;
+        size_t first;
+    public:
+        ChangeView(const std::vector<ChangeRecord>* records, size_t first) : records(records), first(first) {}
+
+        class Iterator {
+            const std::vector<ChangeRecord>* records;
+            size_t index;
+
+            // Moves forward till a record of a component that still exists is found
+            void skip(){
+                while(index < records->size() && !(*records)[index].component) ++index;
+            }
+        public:
+            Iterator(const std::vector<ChangeRecord>* records, size_t index) : records(records), index(index) { skip(); }
+            std::tuple<Entity*, T*> operator*() const {
+                Component* component = (*records)[index].component;
+                return { component->getOwner(), static_cast<T*>(component) };
+            }
+            Iterator& operator++() { ++index; skip(); return *this; }
+            bool operator!=(const Iterator& other) const { return index != other.index; }
+            bool operator==(const Iterator& other) const { return index == other.index; }
+        };
+
+        Iterator begin() const { return Iterator(records, first); }
+        Iterator end() const { return Iterator(records, records->size()); }
+        // Returns true if there is nothing to visit
+        bool empty() const { return begin() == end(); }
+    };
+
+    // A removal view iterates over the records of a removal log from a given position and yields the entities
+    class RemovalView {
+        const RemovalRecord* first;
+        const RemovalRecord* last;
+    public:
+        RemovalView(const RemovalRecord* first, const RemovalRecord* last) : first(first), last(last) {}
+
+        class Iterator {
+            const RemovalRecord* record;
+        public:
+            explicit Iterator(const RemovalRecord* record) : record(record) {}
+            Entity* operator*() const { return record->entity; }
+            Iterator& operator++() { ++record; return *this; }
+            bool operator!=(const Iterator& other) const { return record != other.record; }
+            bool operator==(const Iterator& other) const { return record == other.record; }
+        };
+
+        Iterator begin() const { return Iterator(first); }
+        Iterator end() const { return Iterator(last); }
+        // Returns true if there is nothing to visit
+        bool empty() const { return first == last; }
+        // Returns the number of records it visits and the record at the given position (to compare the components too)
+        size_t size() const { return last - first; }
+        const RemovalRecord& operator[](size_t index) const { return first[index]; }
+    };
+
+    template<typename T>
+    RemovalView World::removed(Tick since) const {
+        const auto& records = changeLogs[getComponentTypeID<T>()].removed;
+        const RemovalRecord* data = records.data();
+        return RemovalView(data + firstRecordSince(records, since), data + records.size());
+    }
+
+}
@@ -0,0 +1,22 @@
+#include "gl-state-cache.hpp"
+
+namespace our {
+
+    GLStateCache& GLStateCache::get() {
+        static GLStateCache cache;
+        return cache;
+    }
+
+    void GLStateCache::invalidate() {
+        cullFaceEnabled = depthTestEnabled = blendEnabled = -1;
+        culledFace = frontFace = depthFunction = blendEquation = blendSource = blendDestination = UNKNOWN_ENUM;
+        blendColor = glm::vec4(std::numeric_limits<float>::quiet_NaN());
+        for (auto& channel : colorMask) channel = -1;
+        depthMask = -1;
+        program = vertexArray = framebuffer = UNKNOWN_NAME;
+        activeUnit = UNKNOWN_NAME;
+        for (auto& texture : textures) texture = UNKNOWN_NAME;
+        for (auto& sampler : samplers) sampler = UNKNOWN_NAME;
+    }
+
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+
+namespace our {
+
+    // The number of GL calls that went through the state cache and the number of calls it skipped
+    struct GLStateStats {
+        std::uint64_t issued = 0;
+        std::uint64_t skipped = 0;
+    };
+
+    // The state cache shadows the parts of the OpenGL state that change from draw to draw (the capabilities, the blend,
+    // depth and cull settings, the masks and the bound program, vertex array, framebuffer, textures and samplers).
+    // A call that would set the state to the value it already has is skipped. Every piece of shadowed state starts unknown,
+    // so the first call always reaches the driver.
+    // The code that changes this state with raw GL calls leaves the cache stale, so the application calls "invalidate"
+    // at the start of every frame (ImGui and the screenshots draw between frames). The Bullet debug drawer is followed by
+    // an "invalidate" too.
+    // NOTE: Like OpenGL itself, it must only be used by the thread that owns the context.
+    class GLStateCache {
+    public:
+        // The number of texture units whose bindings are shadowed (the others always reach the driver)
+        static constexpr GLuint TEXTURE_UNITS = 16;
+
+    private:
+        static constexpr GLuint UNKNOWN_NAME = std::numeric_limits<GLuint>::max();
+        static constexpr GLenum UNKNOWN_ENUM = std::numeric_limits<GLenum>::max();
+        // A boolean state: 0, 1 or -1 while unknown
+        using Flag = signed char;
+
+        Flag cullFaceEnabled, depthTestEnabled, blendEnabled;
+        GLenum culledFace, frontFace, depthFunction, blendEquation, blendSource, blendDestination;
+        glm::vec4 blendColor; // NaN while unknown (NaN never compares equal)
+        Flag colorMask[4], depthMask;
+        GLuint program, vertexArray, framebuffer;
+        GLuint activeUnit; // An index (0 for GL_TEXTURE0)
+        GLuint textures[TEXTURE_UNITS]; // The GL_TEXTURE_2D bound to each unit
+        GLuint samplers[TEXTURE_UNITS];
+        GLStateStats stats;
+
+        GLStateCache() { invalidate(); }
+
+        // Returns true (and takes the new value) if the shadowed state differs from it, the call must then be issued
+        template<typename T>
+        bool update(T& shadow, const T& value) {
+            if (shadow == value) {
+                stats.skipped++;
+                return false;
+            }
+            shadow = value;
+            stats.issued++;
+            return true;
+        }
+
+        // Returns the shadow of a capability handled by "setEnabled" (null for the others)
+        Flag* findCapability(GLenum capability) {
+            switch (capability) {
+            case GL_CULL_FACE: return &cullFaceEnabled;
+            case GL_DEPTH_TEST: return &depthTestEnabled;
+            case GL_BLEND: return &blendEnabled;
+            default: return nullptr;
+            }
+        }
+
+    public:
+        // The cache shared by the application (there is a single GL context)
+        static GLStateCache& get();
+
+        // Forgets all the shadowed state (the next call for each piece of state reaches the driver)
+        void invalidate();
+
+        // Enables or disables a capability (only GL_CULL_FACE, GL_DEPTH_TEST and GL_BLEND are shadowed)
+        void setEnabled(GLenum capability, bool enabled) {
+            Flag* shadow = findCapability(capability);
+            if (shadow && !update(*shadow, Flag(enabled))) return;
+            if (!shadow) stats.issued++;
+            if (enabled) glEnable(capability);
+            else glDisable(capability);
+        }
+
+        void setCullFace(GLenum face) {
+            if (update(culledFace, face)) glCullFace(face);
+        }
+
+        void setFrontFace(GLenum winding) {
+            if (update(frontFace, winding)) glFrontFace(winding);
+        }
+
+        void setDepthFunc(GLenum function) {
+            if (update(depthFunction, function)) glDepthFunc(function);
+        }
+
+        void setBlendEquation(GLenum equation) {
+            if (update(blendEquation, equation)) glBlendEquation(equation);
+        }
+
+        void setBlendFunc(GLenum source, GLenum destination) {
+            // Both factors are shadowed together since they are set by one call
+            if (blendSource == source && blendDestination == destination) {
+                stats.skipped++;
+                return;
+            }
+            blendSource = source;
+            blendDestination = destination;
+            stats.issued++;
+            glBlendFunc(source, destination);
+        }
+
+        void setBlendColor(const glm::vec4& color) {
+            if (update(blendColor, color)) glBlendColor(color.r, color.g, color.b, color.a);
+        }
+
+        void setColorMask(glm::bvec4 mask) {
+            Flag flags[4] = {Flag(mask.r), Flag(mask.g), Flag(mask.b), Flag(mask.a)};
+            if (flags[0] == colorMask[0] && flags[1] == colorMask[1] && flags[2] == colorMask[2] && flags[3] == colorMask[3]) {
+                stats.skipped++;
+                return;
+            }
+            for (int channel = 0; channel < 4; channel++) colorMask[channel] = flags[channel];
+            stats.issued++;
+            glColorMask(mask.r, mask.g, mask.b, mask.a);
+        }
+
+        void setDepthMask(bool enabled) {
+            if (update(depthMask, Flag(enabled))) glDepthMask(enabled);
+        }
+
+        void useProgram(GLuint name) {
+            if (update(program, name)) glUseProgram(name);
+        }
+
+        void bindVertexArray(GLuint name) {
+            if (update(vertexArray, name)) glBindVertexArray(name);
+        }
+
+        // Binds the framebuffer to GL_FRAMEBUFFER (both the draw and the read targets)
+        void bindFramebuffer(GLuint name) {
+            if (update(framebuffer, name)) glBindFramebuffer(GL_FRAMEBUFFER, name);
+        }
+
+        // Selects the texture unit used by "bindTexture2D" (the unit is an index: 0 for GL_TEXTURE0)
+        void setActiveTexture(GLuint unit) {
+            if (update(activeUnit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+        }
+
+        // Binds the texture to GL_TEXTURE_2D on the active unit
+        void bindTexture2D(GLuint name) {
+            if (activeUnit < TEXTURE_UNITS) {
+                if (!update(textures[activeUnit], name)) return;
+            } else {
+                stats.issued++;
+            }
+            glBindTexture(GL_TEXTURE_2D, name);
+        }
+
+        void bindSampler(GLuint unit, GLuint name) {
+            if (unit < TEXTURE_UNITS) {
+                if (!update(samplers[unit], name)) return;
+            } else {
+                stats.issued++;
+            }
+            glBindSampler(unit, name);
+        }
+
+        // These must be called when an object is deleted since OpenGL unbinds it (and may give its name to a new object)
+        void forgetProgram(GLuint name) {
+            if (program == name) program = UNKNOWN_NAME;
+        }
+        void forgetVertexArray(GLuint name) {
+            if (vertexArray == name) vertexArray = 0;
+        }
+        void forgetFramebuffer(GLuint name) {
+            if (framebuffer == name) framebuffer = 0;
+        }
+        void forgetTexture(GLuint name) {
+            for (auto& texture : textures)
+                if (texture == name) texture = 0;
+        }
+        void forgetSampler(GLuint name) {
+            for (auto& sampler : samplers)
+                if (sampler == name) sampler = 0;
+        }
+
+        // Returns the number of calls issued and skipped since the last "resetStats"
+        GLStateStats getStats() const { return stats; }
+        void resetStats() { stats = {}; }
+
+        GLStateCache(const GLStateCache&) = delete;
+        GLStateCache& operator=(const GLStateCache&) = delete;
+    };
+
+}
@@ -0,0 +1,42 @@
+#include "incremental-loader.hpp"
+
+#include <chrono>
+#include <iterator>
+
+namespace our {
+
+    void IncrementalLoader::add(const std::string& label, Step step){
+        total++;
+        if(running) queuedByStep.push_back({label, std::move(step)});
+        else entries.push_back({label, std::move(step)});
+    }
+
+    bool IncrementalLoader::update(double budgetMilliseconds){
+        auto start = std::chrono::steady_clock::now();
+        while(!entries.empty()){
+            Entry entry = std::move(entries.front());
+            entries.pop_front();
+            status = entry.label;
+
+            running = true;
+            entry.step();
+            running = false;
+            completed++;
+            // The steps queued by this step run next, in the order they were queued
+            entries.insert(entries.begin(), std::make_move_iterator(queuedByStep.begin()), std::make_move_iterator(queuedByStep.end()));
+            queuedByStep.clear();
+
+            double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if(elapsed >= budgetMilliseconds) break;
+        }
+        return entries.empty();
+    }
+
+    void IncrementalLoader::clear(){
+        entries.clear();
+        queuedByStep.clear();
+        completed = total = 0;
+        status.clear();
+    }
+
+}
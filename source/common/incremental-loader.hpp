@@ -0,0 +1,52 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace our {
+
+    // Spreads a long loading (assets, entities, physics bodies...) over several frames so the window keeps drawing.
+    // The loading is split into small steps that run in order on the calling thread (so they may use OpenGL).
+    // Every frame, "update" runs steps until the frame's time budget is spent, then the frame can draw a loading screen.
+    // A step may queue more steps (e.g. a step that parses a scene queues one step per entity). These run right after
+    // it, before the steps that were queued earlier, so the order of the loading stays the order of the code.
+    class IncrementalLoader {
+    public:
+        using Step = std::function<void()>;
+
+    private:
+        struct Entry {
+            std::string label; // Describes the step on the loading screen
+            Step step;
+        };
+        std::deque<Entry> entries; // The steps that didn't run yet
+        std::vector<Entry> queuedByStep; // The steps queued by the running step (moved to the front once it returns)
+        bool running = false; // True while a step runs
+        size_t completed = 0, total = 0;
+        std::string status; // The label of the last step that ran
+
+    public:
+        // Queues a step (see the class comment for the order of the steps queued by a running step)
+        void add(const std::string& label, Step step);
+
+        // Runs steps till "budgetMilliseconds" is spent (at least one step runs, so a slow step delays the frame but the
+        // loading always moves forward). Returns true once every step is done.
+        bool update(double budgetMilliseconds);
+
+        // Returns true if every queued step is done
+        bool isDone() const { return entries.empty(); }
+        // Returns the ratio of the steps that are done (the total grows as steps queue more steps)
+        float getProgress() const { return total == 0 ? 1.0f : float(completed) / float(total); }
+        // Returns the label of the step that runs next (or of the last one if the loading is done)
+        const std::string& getStatus() const { return entries.empty() ? status : entries.front().label; }
+        // Returns the number of steps that are done and the number of steps queued so far
+        size_t getCompletedCount() const { return completed; }
+        size_t getTotalCount() const { return total; }
+
+        // Drops the steps that didn't run yet
+        void clear();
+    };
+
+}
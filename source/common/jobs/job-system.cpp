@@ -0,0 +1,130 @@
+#include "job-system.hpp"
+
+namespace our {
+
+    namespace {
+        // The job system and the queue owned by the calling thread (only set on worker threads)
+        thread_local const JobSystem* currentSystem = nullptr;
+        thread_local size_t currentIndex = 0;
+    }
+
+    size_t JobSystem::getOwnQueue() const {
+        return currentSystem == this ? currentIndex : 0;
+    }
+
+    size_t JobSystem::getCurrentThreadIndex() {
+        return currentIndex;
+    }
+
+    JobSystem& JobSystem::get() {
+        static JobSystem system;
+        return system;
+    }
+
+    void JobSystem::configure(const nlohmann::json& data){
+        int workerCount = data.value("workers", -1);
+        if(workerCount < 0) workerCount = std::max(0, int(std::thread::hardware_concurrency()) - 1);
+        start(workerCount);
+    }
+
+    void JobSystem::start(int workerCount){
+        stop();
+        stopping = false;
+        queues.resize(1);
+        for(int index = 1; index <= workerCount; index++) queues.push_back(std::make_unique<Queue>());
+        for(int index = 1; index <= workerCount; index++){
+            workers.emplace_back(&JobSystem::workerLoop, this, size_t(index));
+        }
+    }
+
+    void JobSystem::stop(){
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        // The workers only leave once every queue is empty
+        for(auto& worker : workers) worker.join();
+        workers.clear();
+        // Without workers, the jobs nobody waited for are still in the shared queue
+        while(runPendingJob());
+    }
+
+    void JobSystem::submit(Job job, JobCounter& counter){
+        counter.count.fetch_add(1, std::memory_order_relaxed);
+        // The task is counted before it is pushed so that the count never drops below the queued tasks
+        queuedTasks.fetch_add(1);
+        Queue& queue = *queues[getOwnQueue()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back({std::move(job), &counter});
+        }
+        if(!workers.empty()){
+            // Taking the lock makes sure that a worker that is about to sleep sees the new job
+            { std::lock_guard<std::mutex> lock(sleepMutex); }
+            wakeUp.notify_one();
+        }
+    }
+
+    bool JobSystem::popBack(size_t queue, Task& task){
+        Queue& own = *queues[queue];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(own.tasks.empty()) return false;
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        queuedTasks.fetch_sub(1);
+        return true;
+    }
+
+    bool JobSystem::steal(size_t thief, Task& task){
+        // Start from the next queue so that the thieves don't all go for the same victim
+        for(size_t offset = 1; offset < queues.size(); offset++){
+            Queue& victim = *queues[(thief + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if(victim.tasks.empty()) continue;
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queuedTasks.fetch_sub(1);
+            stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    void JobSystem::execute(Task& task){
+        task.job();
+        executed.fetch_add(1, std::memory_order_relaxed);
+        task.counter->count.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    bool JobSystem::runPendingJob(){
+        size_t own = getOwnQueue();
+        Task task;
+        if(!popBack(own, task) && !steal(own, task)) return false;
+        execute(task);
+        return true;
+    }
+
+    void JobSystem::wait(JobCounter& counter){
+        while(!counter.isDone()){
+            // Help with the pending jobs instead of sleeping (the jobs we wait for may be among them)
+            if(!runPendingJob()) std::this_thread::yield();
+        }
+    }
+
+    void JobSystem::workerLoop(size_t index){
+        currentSystem = this;
+        currentIndex = index;
+        while(true){
+            Task task;
+            if(popBack(index, task) || steal(index, task)){
+                execute(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            if(stopping && queuedTasks == 0) return;
+            wakeUp.wait(lock, [this](){ return stopping || queuedTasks > 0; });
+        }
+    }
+
+}
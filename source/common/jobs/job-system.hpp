@@ -0,0 +1,142 @@
+#pragma once
+
+#include <json/json.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace our {
+
+    // Counts the jobs of a group that are not done yet. Every job is submitted with a counter and "JobSystem::wait"
+    // returns once the counter drops to zero. A counter can be reused once it is done.
+    class JobCounter {
+        std::atomic<size_t> count{0};
+        friend class JobSystem;
+    public:
+        bool isDone() const { return count.load(std::memory_order_acquire) == 0; }
+    };
+
+    // The statistics of a job system (they are accumulated since the job system was created)
+    struct JobSystemStats {
+        size_t executed = 0; // The number of jobs that were run
+        size_t stolen = 0; // The number of jobs that were run by a thread other than the one that submitted them
+    };
+
+    // A work-stealing thread pool.
+    // Every worker owns a deque of jobs: the jobs it submits are pushed to the back of its own deque and it pops its
+    // next job from the back too (the most recent job is the most likely to still be in the cache).
+    // When a worker runs out of jobs, it steals from the front of the other deques (the oldest jobs, which are usually
+    // the biggest pieces of work). The threads that are not workers (e.g. the main thread) share one extra deque.
+    // A thread waiting for a counter does not sleep, it runs the pending jobs until the counter is done
+    // (so jobs can wait for the jobs they submit without deadlocking the pool).
+    // If no workers are started, the jobs are all run by the thread that waits for them.
+    class JobSystem {
+    public:
+        using Job = std::function<void()>;
+
+    private:
+        struct Task {
+            Job job;
+            JobCounter* counter;
+        };
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+        // Queue 0 is shared by the threads that are not workers, queue "i" belongs to the worker "i"
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+
+        // The idle workers sleep on this condition until a job is submitted
+        std::mutex sleepMutex;
+        std::condition_variable wakeUp;
+        std::atomic<size_t> queuedTasks{0};
+        std::atomic<bool> stopping{false};
+
+        std::atomic<size_t> executed{0}, stolen{0};
+
+        // A parallel for splits its range into this many chunks per thread so that stealing can balance uneven chunks
+        static constexpr size_t CHUNKS_PER_THREAD = 4;
+
+        // Returns the queue owned by the calling thread (0 if the calling thread is not one of our workers)
+        size_t getOwnQueue() const;
+        // Pops the newest task of the given queue
+        bool popBack(size_t queue, Task& task);
+        // Steals the oldest task from the queues of the other threads
+        bool steal(size_t thief, Task& task);
+        // Runs a task then signals its counter
+        void execute(Task& task);
+        // The loop run by each worker thread
+        void workerLoop(size_t index);
+
+    public:
+        JobSystem() { queues.push_back(std::make_unique<Queue>()); }
+
+        // Reads the job system options from a json object then starts the workers, for example:
+        //      { "workers": 15 }
+        // "workers" is the number of worker threads (-1 picks one less than the number of hardware threads)
+        void configure(const nlohmann::json& data);
+        // Starts "workerCount" worker threads (the running workers are stopped first)
+        void start(int workerCount);
+        // Runs the remaining jobs then stops and joins the worker threads
+        void stop();
+
+        // Queues a job. The counter is incremented now and decremented once the job is done.
+        // NOTE: The counter must outlive the job.
+        void submit(Job job, JobCounter& counter);
+        // Runs pending jobs until the counter is done
+        void wait(JobCounter& counter);
+        // Runs one pending job (own queue first, then the others). Returns false if there was nothing to run.
+        // This is used by threads that wait for something that is not a counter.
+        bool runPendingJob();
+
+        // Calls "body(begin, end)" on consecutive chunks that cover [0, count) then waits for all of them.
+        // The chunk size is picked from the number of threads but it is never smaller than "minChunkSize"
+        // (use it to keep cheap iterations from being split into chunks that cost less than scheduling them).
+        // The calling thread runs the first chunk itself. Chunks may run in any order and on any thread.
+        template<typename Body>
+        void parallelFor(size_t count, Body&& body, size_t minChunkSize = 1) {
+            if(count == 0) return;
+            size_t chunks = getThreadCount() * CHUNKS_PER_THREAD;
+            size_t chunkSize = std::max(std::max<size_t>(minChunkSize, 1), (count + chunks - 1) / chunks);
+            if(workers.empty() || chunkSize >= count) {
+                body(size_t(0), count);
+                return;
+            }
+            JobCounter counter;
+            for(size_t begin = chunkSize; begin < count; begin += chunkSize) {
+                size_t end = std::min(begin + chunkSize, count);
+                submit([&body, begin, end](){ body(begin, end); }, counter);
+            }
+            body(size_t(0), chunkSize);
+            wait(counter);
+        }
+
+        // Returns the number of worker threads
+        size_t getWorkerCount() const { return workers.size(); }
+        // Returns the number of threads that run jobs (the workers and the thread that waits)
+        size_t getThreadCount() const { return workers.size() + 1; }
+        JobSystemStats getStats() const { return { executed.load(), stolen.load() }; }
+
+        // Returns the index of the calling thread: 1 to N for the workers of any job system, 0 for the other threads
+        static size_t getCurrentThreadIndex();
+
+        // The job system shared by the application (it is configured from the "jobs" section of the app config)
+        static JobSystem& get();
+
+        ~JobSystem() { stop(); }
+
+        // The job system owns threads so it should not be copyable
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+    };
+
+}
@@ -5,11 +5,21 @@
 
 namespace our {
 
+    // The handles of the uniforms set by the materials (see "UniformHandle")
+    constexpr UniformHandle TINT_UNIFORM("tint");
+    constexpr UniformHandle ALPHA_THRESHOLD_UNIFORM("alphaThreshold");
+    constexpr UniformHandle TEX_UNIFORM("tex");
+    constexpr UniformHandle ALBEDO_UNIFORM("material.albedo");
+    constexpr UniformHandle SPECULAR_UNIFORM("material.specular");
+    constexpr UniformHandle ROUGHNESS_UNIFORM("material.roughness");
+    constexpr UniformHandle AMBIENT_OCCLUSION_UNIFORM("material.ambientOcclusion");
+    constexpr UniformHandle EMISSION_UNIFORM("material.emission");
+
     // This function should setup the pipeline state and set the shader to be used
-    void Material::setup() const {
+    void Material::setup(bool instanced) const {
         //TODO: (Req 7) Write this function
         pipelineState.setup();
-        shader->use();
+        getProgram(instanced)->use();
     }
 
     // This function read the material data from a json object
@@ -21,14 +31,16 @@ namespace our {
         }
         shader = AssetLoader<ShaderProgram>::get(data["shader"].get<std::string>());
         transparent = data.value("transparent", false);
+        maxDrawDistance = data.value("maxDrawDistance", std::numeric_limits<float>::infinity());
     }
 
     // This function should call the setup of its parent and
     // set the "tint" uniform to the value in the member variable tint 
-    void TintedMaterial::setup() const {
+    void TintedMaterial::setup(bool instanced) const {
         //TODO: (Req 7) Write this function
-        Material::setup();
-        shader->set("tint", tint);
+        Material::setup(instanced);
+        ShaderProgram* program = getProgram(instanced);
+        program->set(TINT_UNIFORM, tint);
     }
 
     // This function read the material data from a json object
@@ -41,20 +53,21 @@ namespace our {
     // This function should call the setup of its parent and
     // set the "alphaThreshold" uniform to the value in the member variable alphaThreshold
     // Then it should bind the texture and sampler to a texture unit and send the unit number to the uniform variable "tex" 
-    void TexturedMaterial::setup() const {
+    void TexturedMaterial::setup(bool instanced) const {
         //TODO: (Req 7) Write this function
-        TintedMaterial::setup();
-        shader->set("alphaThreshold", alphaThreshold);
+        TintedMaterial::setup(instanced);
+        ShaderProgram* program = getProgram(instanced);
+        program->set(ALPHA_THRESHOLD_UNIFORM, alphaThreshold);
         
         // Bind the texture to unit 0
-        glActiveTexture(GL_TEXTURE0);
+        GLStateCache::get().setActiveTexture(0);
         texture->bind();
         if (sampler) {
             sampler->bind(0);
         }
         
         // Send the texture unit to the uniform
-        shader->set("tex", 0);
+        program->set(TEX_UNIFORM, 0);
     }
 
     // This function read the material data from a json object
@@ -66,39 +79,40 @@ namespace our {
         sampler = AssetLoader<Sampler>::get(data.value("sampler", ""));
     }
     //////////////////////////////////////////////////////////////////////
-    void LitMaterial::setup() const {
-        TexturedMaterial::setup();
+    void LitMaterial::setup(bool instanced) const {
+        TexturedMaterial::setup(instanced);
+        ShaderProgram* program = getProgram(instanced);
         if (albedo) {
-            glActiveTexture(GL_TEXTURE0);
+            GLStateCache::get().setActiveTexture(0);
             albedo->bind();
             sampler->bind(0);
-            shader->set("material.albedo", 0);
+            program->set(ALBEDO_UNIFORM, 0);
         }
         if (specular) {
-            glActiveTexture(GL_TEXTURE1);
+            GLStateCache::get().setActiveTexture(1);
             specular->bind();
             sampler->bind(1);
-            shader->set("material.specular", 1);
+            program->set(SPECULAR_UNIFORM, 1);
         }
         if (roughness) {
-            glActiveTexture(GL_TEXTURE2);
+            GLStateCache::get().setActiveTexture(2);
             roughness->bind();
             sampler->bind(2);
-            shader->set("material.roughness", 2);
+            program->set(ROUGHNESS_UNIFORM, 2);
         }
         if (ambientOcclusion) {
-            glActiveTexture(GL_TEXTURE3);
+            GLStateCache::get().setActiveTexture(3);
             ambientOcclusion->bind();
             sampler->bind(3);
-            shader->set("material.ambientOcclusion", 3);
+            program->set(AMBIENT_OCCLUSION_UNIFORM, 3);
         }
         if (emission) {
-            glActiveTexture(GL_TEXTURE4);
+            GLStateCache::get().setActiveTexture(4);
             emission->bind();
             sampler->bind(4);
-            shader->set("material.emission", 4);
+            program->set(EMISSION_UNIFORM, 4);
         }
-        glActiveTexture(GL_TEXTURE0);
+        GLStateCache::get().setActiveTexture(0);
     }
 
     void LitMaterial::deserialize(const nlohmann::json& data) {
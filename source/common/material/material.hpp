@@ -8,6 +8,8 @@
 #include <glm/vec4.hpp>
 #include <json/json.hpp>
 
+#include <limits>
+
 namespace our {
 
     // This is the base class for all the materials
@@ -21,14 +23,24 @@ namespace our {
         PipelineState pipelineState;
         ShaderProgram* shader;
         bool transparent;
+        // The objects farther than this from the camera are not drawn (measured to their bounding sphere)
+        float maxDrawDistance = std::numeric_limits<float>::infinity();
 
         // Virtual destructor to ensure proper cleanup of derived classes
         virtual ~Material() = default;
 
         // This function does 2 things: setup the pipeline state and set the shader program to be used
-        virtual void setup() const;
+        // If "instanced" is true, the instanced variant of the shader is used (if it has one, see "ShaderProgram::getInstancedVariant")
+        virtual void setup(bool instanced = false) const;
         // This function read a material from a json object
         virtual void deserialize(const nlohmann::json& data);
+        // Returns the OpenGL name of the main texture of the material (0 if it has none)
+        // The renderer groups the draws sharing it (see "systems/render-queue.hpp")
+        virtual GLuint getMainTexture() const { return 0; }
+        // Returns the program used by "setup"
+        ShaderProgram* getProgram(bool instanced) const {
+            return instanced && shader->getInstancedVariant() ? shader->getInstancedVariant() : shader;
+        }
     };
 
     // This material adds a uniform for a tint (a color that will be sent to the shader)
@@ -37,7 +49,7 @@ namespace our {
     public:
         glm::vec4 tint;
 
-        void setup() const override;
+        void setup(bool instanced = false) const override;
         void deserialize(const nlohmann::json& data) override;
     };
 
@@ -52,8 +64,9 @@ namespace our {
         Sampler* sampler;
         float alphaThreshold;
 
-        void setup() const override;
+        void setup(bool instanced = false) const override;
         void deserialize(const nlohmann::json& data) override;
+        GLuint getMainTexture() const override { return texture ? texture->getOpenGLName() : 0; }
     };
     // This material adds 4 more textures to the TexturedMaterial
     // The textures are:
@@ -70,8 +83,9 @@ namespace our {
         Texture2D* ambientOcclusion;
         Texture2D* emission;
 
-        void setup() const override;
+        void setup(bool instanced = false) const override;
         void deserialize(const nlohmann::json& data) override;
+        GLuint getMainTexture() const override { return albedo ? albedo->getOpenGLName() : TexturedMaterial::getMainTexture(); }
     };
     // This function returns a new material instance based on the given type
     inline Material* createMaterialFromType(const std::string& type){
@@ -0,0 +1,192 @@
+#include "geometry-arena.hpp"
+#include "mesh.hpp"
+#include "../gl-state-cache.hpp"
+
+#include <algorithm>
+
+namespace our
+{
+
+    size_t RangeAllocator::allocate(size_t size)
+    {
+        for (auto range = freeRanges.begin(); range != freeRanges.end(); range++)
+        {
+            if (range->size < size)
+                continue;
+            size_t offset = range->offset;
+            range->offset += size;
+            range->size -= size;
+            if (range->size == 0)
+                freeRanges.erase(range);
+            return offset;
+        }
+        return FAILED;
+    }
+
+    void RangeAllocator::release(size_t offset, size_t size)
+    {
+        if (size == 0)
+            return;
+        auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), offset,
+                                     [](const Range &range, size_t offset) { return range.offset < offset; });
+        // The released range is merged with the free range before it and the one after it if they touch it
+        if (next != freeRanges.begin())
+        {
+            auto previous = next - 1;
+            if (previous->offset + previous->size == offset)
+            {
+                previous->size += size;
+                if (next != freeRanges.end() && offset + size == next->offset)
+                {
+                    previous->size += next->size;
+                    freeRanges.erase(next);
+                }
+                return;
+            }
+        }
+        if (next != freeRanges.end() && offset + size == next->offset)
+        {
+            next->offset = offset;
+            next->size += size;
+            return;
+        }
+        freeRanges.insert(next, {offset, size});
+    }
+
+    void RangeAllocator::grow(size_t newCapacity)
+    {
+        if (newCapacity <= capacity)
+            return;
+        size_t oldCapacity = capacity;
+        capacity = newCapacity;
+        release(oldCapacity, newCapacity - oldCapacity);
+    }
+
+    void RangeAllocator::reset()
+    {
+        freeRanges.clear();
+        capacity = 0;
+    }
+
+    GeometryArena &GeometryArena::get()
+    {
+        static GeometryArena arena;
+        return arena;
+    }
+
+    GeometryAllocation GeometryArena::allocate(const std::vector<Vertex> &vertices, const std::vector<GLuint> &elements)
+    {
+        size_t vertexOffset = vertexRanges.allocate(vertices.size());
+        size_t elementOffset = elementRanges.allocate(elements.size());
+        if (vertexOffset == RangeAllocator::FAILED || elementOffset == RangeAllocator::FAILED)
+        {
+            // The ranges taken before growing are given back so the mesh lands in the new space in one piece
+            if (vertexOffset != RangeAllocator::FAILED)
+                vertexRanges.release(vertexOffset, vertices.size());
+            if (elementOffset != RangeAllocator::FAILED)
+                elementRanges.release(elementOffset, elements.size());
+            // The buffers at least double so a long run of loads only copies each vertex a few times
+            size_t vertexCapacity = vertexRanges.getCapacity(), elementCapacity = elementRanges.getCapacity();
+            if (vertexOffset == RangeAllocator::FAILED)
+                vertexCapacity = std::max({INITIAL_VERTEX_CAPACITY, 2 * vertexCapacity, vertexRanges.getUsedEnd() + vertices.size()});
+            if (elementOffset == RangeAllocator::FAILED)
+                elementCapacity = std::max({INITIAL_ELEMENT_CAPACITY, 2 * elementCapacity, elementRanges.getUsedEnd() + elements.size()});
+            reserve(vertexCapacity, elementCapacity);
+            vertexOffset = vertexRanges.allocate(vertices.size());
+            elementOffset = elementRanges.allocate(elements.size());
+        }
+
+        GeometryAllocation allocation;
+        allocation.id = nextId++;
+        allocation.baseVertex = GLint(vertexOffset);
+        allocation.vertexCount = GLsizei(vertices.size());
+        allocation.firstElement = elementOffset;
+        allocation.elementCount = GLsizei(elements.size());
+        allocationCount++;
+
+        // The data goes through the copy target so the element buffer bound to the current vertex array is left alone
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, vertexOffset * sizeof(Vertex), vertices.size() * sizeof(Vertex), vertices.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, elementOffset * sizeof(GLuint), elements.size() * sizeof(GLuint), elements.data());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return allocation;
+    }
+
+    void GeometryArena::release(const GeometryAllocation &allocation)
+    {
+        if (allocation.id == 0)
+            return;
+        vertexRanges.release(size_t(allocation.baseVertex), size_t(allocation.vertexCount));
+        elementRanges.release(allocation.firstElement, size_t(allocation.elementCount));
+        if (--allocationCount == 0)
+            destroy();
+    }
+
+    void GeometryArena::bind()
+    {
+        GLStateCache::get().bindVertexArray(VAO);
+    }
+
+    void GeometryArena::reserve(size_t vertexCapacity, size_t elementCapacity)
+    {
+        if (VAO == 0)
+            glGenVertexArrays(1, &VAO);
+        // Each buffer that is too small is replaced by a larger one holding a copy of its used part
+        auto resize = [](GLuint &buffer, RangeAllocator &ranges, size_t capacity, size_t unitSize)
+        {
+            if (buffer != 0 && capacity <= ranges.getCapacity())
+                return;
+            GLuint larger;
+            glGenBuffers(1, &larger);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, larger);
+            glBufferData(GL_COPY_WRITE_BUFFER, capacity * unitSize, nullptr, GL_STATIC_DRAW);
+            if (buffer != 0)
+            {
+                size_t used = ranges.getUsedEnd();
+                if (used > 0)
+                {
+                    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+                    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used * unitSize);
+                    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+                }
+                glDeleteBuffers(1, &buffer);
+            }
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            buffer = larger;
+            ranges.grow(capacity);
+        };
+        resize(VBO, vertexRanges, vertexCapacity, sizeof(Vertex));
+        resize(EBO, elementRanges, elementCapacity, sizeof(GLuint));
+        setupVertexArray();
+    }
+
+    void GeometryArena::setupVertexArray()
+    {
+        bind();
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        // The element buffer binding is part of the vertex array state
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+        glEnableVertexAttribArray(ATTRIB_LOC_POSITION);
+        glVertexAttribPointer(ATTRIB_LOC_POSITION, 3, GL_FLOAT, false, sizeof(Vertex), (void *)offsetof(Vertex, position));
+        glEnableVertexAttribArray(ATTRIB_LOC_COLOR);
+        glVertexAttribPointer(ATTRIB_LOC_COLOR, 4, GL_UNSIGNED_BYTE, true, sizeof(Vertex), (void *)offsetof(Vertex, color));
+        glEnableVertexAttribArray(ATTRIB_LOC_TEXCOORD);
+        glVertexAttribPointer(ATTRIB_LOC_TEXCOORD, 2, GL_FLOAT, false, sizeof(Vertex), (void *)offsetof(Vertex, tex_coord));
+        glEnableVertexAttribArray(ATTRIB_LOC_NORMAL);
+        glVertexAttribPointer(ATTRIB_LOC_NORMAL, 3, GL_FLOAT, false, sizeof(Vertex), (void *)offsetof(Vertex, normal));
+    }
+
+    void GeometryArena::destroy()
+    {
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        GLStateCache::get().forgetVertexArray(VAO);
+        glDeleteVertexArrays(1, &VAO);
+        VAO = VBO = EBO = 0;
+        vertexRanges.reset();
+        elementRanges.reset();
+    }
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glad/gl.h>
+#include "vertex.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace our
+{
+
+    // A first fit allocator of ranges in "[0, capacity)" (it only does the bookkeeping, the memory is elsewhere)
+    // The free ranges are kept sorted by offset and a released range is merged with the free ranges next to it.
+    class RangeAllocator
+    {
+        struct Range
+        {
+            size_t offset, size;
+        };
+        std::vector<Range> freeRanges;
+        size_t capacity = 0;
+
+    public:
+        static constexpr size_t FAILED = SIZE_MAX;
+
+        // Returns the offset of a free range of "size" units, or FAILED if there is none (the allocator must then grow)
+        size_t allocate(size_t size);
+        // Gives back a range returned by "allocate"
+        void release(size_t offset, size_t size);
+        // Adds "[capacity, newCapacity)" to the free ranges
+        void grow(size_t newCapacity);
+        // Forgets all the ranges
+        void reset();
+
+        size_t getCapacity() const { return capacity; }
+        // Returns the end of the last allocated range (everything that must be kept when the storage is moved)
+        size_t getUsedEnd() const
+        {
+            if (!freeRanges.empty() && freeRanges.back().offset + freeRanges.back().size == capacity)
+                return freeRanges.back().offset;
+            return capacity;
+        }
+        // Returns the number of free ranges (1 when the allocated ranges are packed at the start)
+        size_t getFreeRangeCount() const { return freeRanges.size(); }
+    };
+
+    // Where a mesh lives in the geometry arena
+    struct GeometryAllocation
+    {
+        std::uint32_t id = 0;      // Tells the allocations apart (0 if nothing was allocated)
+        GLint baseVertex = 0;      // Added to the elements of the mesh to find its vertices in the shared vertex buffer
+        GLsizei vertexCount = 0;
+        size_t firstElement = 0;   // The first element of the mesh in the shared element buffer
+        GLsizei elementCount = 0;
+    };
+
+    // Every mesh stores its vertices and its elements in the same two large buffers, described by a single vertex array.
+    // The elements stay relative to the first vertex of their mesh, so a mesh is drawn with "glDrawElementsBaseVertex" and
+    // going from a mesh to the next one binds nothing.
+    // The buffers start with room for a few large meshes and double when they are full (the content is copied on the GPU).
+    // The ranges of a deleted mesh are reused by the next ones, and the buffers are deleted with the last mesh, so they are
+    // gone before the context is.
+    // NOTE: Like OpenGL itself, it must only be used by the thread that owns the context.
+    class GeometryArena
+    {
+    public:
+        // The size of the buffers when the first mesh is added (they are larger if the first mesh doesn't fit)
+        static constexpr size_t INITIAL_VERTEX_CAPACITY = 1 << 18;
+        static constexpr size_t INITIAL_ELEMENT_CAPACITY = 1 << 20;
+
+    private:
+        GLuint VAO = 0, VBO = 0, EBO = 0;
+        RangeAllocator vertexRanges, elementRanges;
+        size_t allocationCount = 0;
+        std::uint32_t nextId = 1;
+
+        GeometryArena() = default;
+
+        // Creates the buffers (or moves their content to larger ones) so they hold the given number of vertices and elements
+        void reserve(size_t vertexCapacity, size_t elementCapacity);
+        // Points the attributes of the vertex array at the current buffers
+        void setupVertexArray();
+        // Deletes the buffers and the vertex array
+        void destroy();
+
+    public:
+        // The arena shared by all the meshes (there is a single GL context)
+        static GeometryArena &get();
+
+        // Copies the vertices and the elements of a mesh to the shared buffers
+        GeometryAllocation allocate(const std::vector<Vertex> &vertices, const std::vector<GLuint> &elements);
+        // Gives back the ranges of a mesh (the buffers are deleted with the last mesh)
+        void release(const GeometryAllocation &allocation);
+
+        // Binds the vertex array shared by all the meshes (skipped if it is already bound)
+        void bind();
+
+        // Returns the OpenGL name of the shared vertex array (0 if there is no mesh)
+        GLuint getVertexArray() const { return VAO; }
+        size_t getVertexCapacity() const { return vertexRanges.getCapacity(); }
+        size_t getElementCapacity() const { return elementRanges.getCapacity(); }
+        size_t getAllocationCount() const { return allocationCount; }
+
+        GeometryArena(const GeometryArena &) = delete;
+        GeometryArena &operator=(const GeometryArena &) = delete;
+    };
+
+}
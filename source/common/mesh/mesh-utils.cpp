@@ -4,15 +4,18 @@
 
 #include <tinyobj/tiny_obj_loader.h>
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <unordered_map>
 
-our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename) {
+our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename, bool occluder, const std::vector<std::string>& occluderObjects) {
 
     // The data that we will use to initialize our mesh
     std::vector<our::Vertex> vertices;
     std::vector<GLuint> elements;
+    // The elements of the triangles kept for the occlusion culling (if the mesh is an occluder)
+    std::vector<GLuint> occluderElements;
 
     // Since the OBJ can have duplicated vertices, we make them unique using this map
     // The key is the vertex, the value is its index in the vector "vertices".
@@ -37,6 +40,7 @@ our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename) {
     // Ideally, we would load each shape into a separate mesh or store the start and end of it in the element buffer to be able to draw each shape separately
     // But we ignored this fact since we don't plan to use multiple materials in the examples
     for (const auto &shape : shapes) {
+        size_t firstElement = elements.size();
         for (const auto &index : shape.mesh.indices) {
             Vertex vertex = {};
 
@@ -79,8 +83,15 @@ our::Mesh* our::mesh_utils::loadOBJ(const std::string& filename) {
                 elements.push_back(it->second);
             }
         }
+        if (occluder && (occluderObjects.empty() ||
+                         std::find(occluderObjects.begin(), occluderObjects.end(), shape.name) != occluderObjects.end())) {
+            occluderElements.insert(occluderElements.end(), elements.begin() + firstElement, elements.end());
+        }
     }
 
+    if (occluder) {
+        return new our::Mesh(vertices, elements, our::OccluderGeometry::fromVertices(vertices, occluderElements));
+    }
     return new our::Mesh(vertices, elements);
 }
 
@@ -2,10 +2,13 @@
 
 #include "mesh.hpp"
 #include <string>
+#include <vector>
 
 namespace our::mesh_utils {
     // Load an ".obj" file into the mesh
-    Mesh* loadOBJ(const std::string& filename);
+    // An occluder keeps the triangles of the objects named in "occluderObjects" (all of them if it is empty) on the RAM
+    // (see "OccluderGeometry")
+    Mesh* loadOBJ(const std::string& filename, bool occluder = false, const std::vector<std::string>& occluderObjects = {});
     // Create a sphere (the vertex order in the triangles are CCW from the outside)
     // Segments define the number of divisions on the both the latitude and the longitude
     Mesh* sphere(const glm::ivec2& segments);
@@ -2,6 +2,14 @@
 
 #include <glad/gl.h>
 #include "vertex.hpp"
+#include "geometry-arena.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace our
 {
@@ -10,84 +18,195 @@ namespace our
 #define ATTRIB_LOC_COLOR 1
 #define ATTRIB_LOC_TEXCOORD 2
 #define ATTRIB_LOC_NORMAL 3
+// The per-instance attributes of the instanced draws (a mat4 takes 4 locations)
+#define ATTRIB_LOC_INSTANCE_M 4
+#define ATTRIB_LOC_INSTANCE_M_IT 8
+
+    // The bounding volumes of a mesh in its local space: an axis aligned box and a sphere that encloses it
+    // The sphere is centered on the box and reaches the farthest vertex, so it is never larger than the box's circumsphere
+    struct MeshBounds
+    {
+        glm::vec3 min = glm::vec3(0.0f), max = glm::vec3(0.0f);
+        glm::vec3 sphereCenter = glm::vec3(0.0f);
+        float sphereRadius = 0.0f;
+
+        // Returns the bounds of the given vertices (a mesh without vertices gets an empty box at the origin)
+        static MeshBounds fromVertices(const std::vector<Vertex> &vertices)
+        {
+            MeshBounds bounds;
+            if (vertices.empty())
+                return bounds;
+            bounds.min = bounds.max = vertices[0].position;
+            for (const Vertex &vertex : vertices)
+            {
+                bounds.min = glm::min(bounds.min, vertex.position);
+                bounds.max = glm::max(bounds.max, vertex.position);
+            }
+            bounds.sphereCenter = (bounds.min + bounds.max) * 0.5f;
+            float radiusSquared = 0.0f;
+            for (const Vertex &vertex : vertices)
+            {
+                glm::vec3 offset = vertex.position - bounds.sphereCenter;
+                radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+            }
+            bounds.sphereRadius = std::sqrt(radiusSquared);
+            return bounds;
+        }
+    };
+
+    // The triangles an occluder mesh keeps on the RAM (see "systems/occlusion-culling.hpp"). The vertices sharing a position
+    // are merged, so the triangles on both sides of a texture seam are still found to be neighbours.
+    // "neighbours[3 * t + e]" is the triangle across the edge "e" of the triangle "t" (from its vertex e to its vertex
+    // e + 1), or -1 if that edge is on the border of the mesh or is shared by more than 2 triangles.
+    struct OccluderGeometry
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<unsigned int> elements;
+        std::vector<std::int32_t> neighbours;
+
+        bool empty() const { return elements.empty(); }
+
+        // Returns the triangles of the given mesh data (the triangles left without area by the merge are dropped)
+        static OccluderGeometry fromVertices(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &elements)
+        {
+            OccluderGeometry geometry;
+            std::unordered_map<glm::vec3, unsigned int> indexOf;
+            std::vector<unsigned int> merged(vertices.size());
+            for (size_t vertex = 0; vertex < vertices.size(); vertex++)
+            {
+                auto [it, inserted] = indexOf.try_emplace(vertices[vertex].position, (unsigned int)geometry.positions.size());
+                if (inserted)
+                    geometry.positions.push_back(vertices[vertex].position);
+                merged[vertex] = it->second;
+            }
+            for (size_t element = 0; element + 3 <= elements.size(); element += 3)
+            {
+                unsigned int a = merged[elements[element]], b = merged[elements[element + 1]], c = merged[elements[element + 2]];
+                if (a != b && b != c && c != a)
+                    geometry.elements.insert(geometry.elements.end(), {a, b, c});
+            }
+
+            // The edges are matched by their 2 vertices (in any order), the first 2 triangles found on an edge are linked
+            // and a third one unlinks them
+            struct EdgeUse
+            {
+                std::int32_t first, second;
+            };
+            std::unordered_map<std::uint64_t, EdgeUse> edges;
+            geometry.neighbours.assign(geometry.elements.size(), -1);
+            for (size_t slot = 0; slot < geometry.elements.size(); slot++)
+            {
+                std::uint64_t from = geometry.elements[slot], to = geometry.elements[slot - slot % 3 + (slot + 1) % 3];
+                std::uint64_t key = (std::min(from, to) << 32) | std::max(from, to);
+                auto [it, inserted] = edges.try_emplace(key, EdgeUse{std::int32_t(slot), -1});
+                if (inserted)
+                    continue;
+                EdgeUse &use = it->second;
+                if (use.second == -1)
+                {
+                    use.second = std::int32_t(slot);
+                    geometry.neighbours[use.first] = std::int32_t(slot / 3);
+                    geometry.neighbours[slot] = use.first / 3;
+                }
+                else if (use.first >= 0)
+                {
+                    geometry.neighbours[use.first] = geometry.neighbours[use.second] = -1;
+                    use.first = -1;
+                }
+            }
+            return geometry;
+        }
+    };
+
+    // An element of an instance buffer: the model matrix of an instance and its inverse transpose
+    struct InstanceData
+    {
+        glm::mat4 localToWorld;
+        glm::mat4 normalMatrix;
+    };
 
     class Mesh
     {
-        // Here, we store the object names of the 3 main components of a mesh:
-        // A vertex array object, A vertex buffer and an element buffer
-        unsigned int VBO, EBO;
-        unsigned int VAO;
-        // We need to remember the number of elements that will be draw by glDrawElements
-        GLsizei elementCount;
+        // Here, we store where the mesh lives in the geometry arena: the vertex and element buffers and the vertex array
+        // object are shared by all the meshes (see "geometry-arena.hpp")
+        GeometryAllocation allocation;
+        // The bounds are computed from the vertices before they leave the RAM (the renderer culls the meshes with them)
+        MeshBounds bounds;
+        // An occluder keeps a copy of its triangles on the RAM, the CPU rasterizes them to hide the objects behind it
+        // (see "systems/occlusion-culling.hpp"). It is empty for the other meshes.
+        OccluderGeometry occluder;
+
+        // Returns the byte offset of the first element of the mesh in the shared element buffer
+        const void *getElementOffset() const { return (const void *)(allocation.firstElement * sizeof(GLuint)); }
 
     public:
         // The constructor takes two vectors:
         // - vertices which contain the vertex data.
         // - elements which contain the indices of the vertices out of which each rectangle will be constructed.
-        // The mesh class does not keep a these data on the RAM. Instead, it should create
-        // a vertex buffer to store the vertex data on the VRAM,
-        // an element buffer to store the element data on the VRAM,
-        // a vertex array object to define how to read the vertex & element buffer during rendering
-        Mesh(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &elements)
+        // The mesh class does not keep a these data on the RAM. Instead, it copies them to the vertex and element buffers
+        // of the geometry arena on the VRAM, whose vertex array object defines how to read them during rendering.
+        // The only exception is an occluder, which is given the triangles it keeps (see "OccluderGeometry")
+        Mesh(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &elements, OccluderGeometry occluder = {})
         {
             // TODO: (Req 2) Write this function
-            //  remember to store the number of elements in "elementCount" since you will need it for drawing
-            //  For the attribute locations, use the constants defined above: ATTRIB_LOC_POSITION, ATTRIB_LOC_COLOR, etc
-            elementCount = elements.size();
-
-            // Create and bind the Vertex Array Object (VAO)
-            glGenVertexArrays(1, &VAO);
-            glBindVertexArray(VAO);
-
-            // Create and bind the Vertex Buffer Object (VBO)
-            glGenBuffers(1, &VBO);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
-            // Copy vertex data to VBO
-            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
-            // Create and bind the Element Buffer Object (EBO)
-            glGenBuffers(1, &EBO);
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-            // Copy element data to EBO
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, elements.size() * sizeof(unsigned int), elements.data(), GL_STATIC_DRAW);
-
-            // Set up vertex attribute pointers
-            // Position attribute
-            glEnableVertexAttribArray(ATTRIB_LOC_POSITION);
-            glVertexAttribPointer(ATTRIB_LOC_POSITION, 3, GL_FLOAT, false, sizeof(Vertex), (void *)offsetof(Vertex, position));
-
-            // Color attribute
-            glEnableVertexAttribArray(ATTRIB_LOC_COLOR);
-            glVertexAttribPointer(ATTRIB_LOC_COLOR, 4, GL_UNSIGNED_BYTE, true, sizeof(Vertex), (void *)offsetof(Vertex, color));
-
-            // Texture coordinate attribute
-            glEnableVertexAttribArray(ATTRIB_LOC_TEXCOORD);
-            glVertexAttribPointer(ATTRIB_LOC_TEXCOORD, 2, GL_FLOAT, false, sizeof(Vertex), (void *)offsetof(Vertex, tex_coord));
-
-            // Normal attribute
-            glEnableVertexAttribArray(ATTRIB_LOC_NORMAL);
-            glVertexAttribPointer(ATTRIB_LOC_NORMAL, 3, GL_FLOAT, false, sizeof(Vertex), (void *)offsetof(Vertex, normal));
-
-            // Unbind the VAO to prevent accidental modifications
-            glBindVertexArray(0);
+            bounds = MeshBounds::fromVertices(vertices);
+            this->occluder = std::move(occluder);
+            allocation = GeometryArena::get().allocate(vertices, elements);
         }
 
         // this function should render the mesh
         void draw()
         {
             // TODO: (Req 2) Write this function
-            glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
+            // All the meshes share the vertex array, so it is only bound again after something else was drawn
+            GeometryArena::get().bind();
+            glDrawElementsBaseVertex(GL_TRIANGLES, allocation.elementCount, GL_UNSIGNED_INT, getElementOffset(), allocation.baseVertex);
         }
 
-        // this function should delete the vertex & element buffers and the vertex array object
+        // Draws "count" instances of the mesh. Their data is read from "buffer" (an array of InstanceData) starting at the
+        // byte "offset". OpenGL 3.3 has no base instance, so the instance attributes are pointed at the offset for each call.
+        void drawInstanced(GLuint buffer, size_t offset, GLsizei count)
+        {
+            GeometryArena::get().bind();
+            glBindBuffer(GL_ARRAY_BUFFER, buffer);
+            for (GLuint column = 0; column < 4; column++)
+            {
+                const size_t columnOffset = offset + column * sizeof(glm::vec4);
+                glEnableVertexAttribArray(ATTRIB_LOC_INSTANCE_M + column);
+                glVertexAttribPointer(ATTRIB_LOC_INSTANCE_M + column, 4, GL_FLOAT, false, sizeof(InstanceData),
+                                      (void *)(columnOffset + offsetof(InstanceData, localToWorld)));
+                glVertexAttribDivisor(ATTRIB_LOC_INSTANCE_M + column, 1);
+                glEnableVertexAttribArray(ATTRIB_LOC_INSTANCE_M_IT + column);
+                glVertexAttribPointer(ATTRIB_LOC_INSTANCE_M_IT + column, 4, GL_FLOAT, false, sizeof(InstanceData),
+                                      (void *)(columnOffset + offsetof(InstanceData, normalMatrix)));
+                glVertexAttribDivisor(ATTRIB_LOC_INSTANCE_M_IT + column, 1);
+            }
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, allocation.elementCount, GL_UNSIGNED_INT, getElementOffset(), count,
+                                              allocation.baseVertex);
+            // The instance attributes are turned off so the regular draws (of every mesh since they share the vertex array)
+            // don't read them
+            for (GLuint location = ATTRIB_LOC_INSTANCE_M; location < ATTRIB_LOC_INSTANCE_M_IT + 4; location++)
+                glDisableVertexAttribArray(location);
+        }
+
+        // Returns the bounding volumes of the mesh in its local space
+        const MeshBounds &getBounds() const { return bounds; }
+
+        // Returns true if the mesh kept its triangles to be used as an occluder
+        bool isOccluder() const { return !occluder.empty(); }
+        // Returns the triangles kept by an occluder (empty for the other meshes)
+        const OccluderGeometry &getOccluderGeometry() const { return occluder; }
+
+        // Returns a number that tells the meshes apart (the render queue sorts by it)
+        std::uint32_t getId() const { return allocation.id; }
+        // Returns where the mesh lives in the geometry arena
+        const GeometryAllocation &getAllocation() const { return allocation; }
+
+        // this function should give the vertex & element ranges back to the geometry arena
         ~Mesh()
         {
             // TODO: (Req 2) Write this function
-            glDeleteBuffers(1, &VBO);
-            glDeleteBuffers(1, &EBO);
-            glDeleteVertexArrays(1, &VAO);
+            GeometryArena::get().release(allocation);
         }
 
         Mesh(Mesh const &) = delete;
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <utility>
 
 //Forward definition for error checking functions
 std::string checkForShaderCompilationErrors(GLuint shader);
@@ -48,7 +49,7 @@ bool our::ShaderProgram::attach(const std::string &filename, GLenum type) const
 
 
 
-bool our::ShaderProgram::link() const {
+bool our::ShaderProgram::link() {
     //TODO: Complete this function
     //Note: The function "checkForLinkingErrors" checks if there is
     // an error in the given program. You should use it to check if there is a
@@ -56,15 +57,75 @@ bool our::ShaderProgram::link() const {
     // program. The returned string will be empty if there is no errors.
     glLinkProgram(program);
     std::string error = checkForLinkingErrors(program);
-    if (error == "")
+    if (error == "") {
+        reflectUniforms();
+        bindSharedUniformBlocks();
         return true;
+    }
     else {
+        uniforms.clear();
+        drawBlock = false;
         std::cerr << error;
         return false;
     }
     //return true;
 }
 
+void our::ShaderProgram::reflectUniforms() {
+    // Collect the name and location of every active uniform. The arrays of basic types are reported once (as "name[0]")
+    // so every element is added, along with the bare name of the array. The arrays of structs report each member of
+    // each element on its own ("lights[1].color"). The members of uniform blocks have no location and are skipped.
+    std::vector<std::pair<std::string, GLint>> found;
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::string buffer(size_t(maxLength > 0 ? maxLength : 1), '\0');
+    for (GLint index = 0; index < count; index++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type;
+        glGetActiveUniform(program, GLuint(index), GLsizei(buffer.size()), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), size_t(length));
+        GLint location = glGetUniformLocation(program, name.c_str());
+        if (location < 0) continue;
+        found.emplace_back(name, location);
+        if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            std::string base = name.substr(0, name.size() - 3);
+            found.emplace_back(base, location);
+            for (GLint element = 1; element < size; element++) {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                found.emplace_back(elementName, glGetUniformLocation(program, elementName.c_str()));
+            }
+        }
+    }
+
+    // Keep the table at most half full so the probes stay short
+    size_t capacity = 8;
+    while (capacity < found.size() * 2) capacity *= 2;
+    uniforms.assign(capacity, UniformSlot{});
+    size_t mask = capacity - 1;
+    for (auto& [name, location] : found) {
+        Symbol symbol = hashSymbol(name);
+        size_t index = symbol & mask;
+        while (uniforms[index].name != NO_SYMBOL && uniforms[index].name != symbol) index = (index + 1) & mask;
+        if (uniforms[index].name == symbol) {
+            std::cerr << "ERROR: The uniform \"" << name << "\" has the same hash as another uniform of the program, rename one of them" << std::endl;
+            continue;
+        }
+        uniforms[index] = {symbol, location};
+    }
+}
+
+void our::ShaderProgram::bindSharedUniformBlocks() {
+    drawBlock = false;
+    for (const SharedUniformBlock& block : SHARED_UNIFORM_BLOCKS) {
+        GLuint index = glGetUniformBlockIndex(program, block.name);
+        if (index == GL_INVALID_INDEX) continue;
+        glUniformBlockBinding(program, index, block.binding);
+        if (block.binding == DRAW_BLOCK_BINDING) drawBlock = true;
+    }
+}
+
 ////////////////////////////////////////////////////////////////////
 // Function to check for compilation and linking error in shaders //
 ////////////////////////////////////////////////////////////////////
@@ -2,20 +2,83 @@
 #define SHADER_HPP
 
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <glad/gl.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glad/gl.h> // for GL_INVALID_INDEX
 
+#include "../ecs/symbol.hpp"
+#include "../gl-state-cache.hpp"
+
 namespace our {
 
+    // A uniform handle is the hashed name of a uniform (see "hashSymbol"). It is constexpr so the hot paths can keep
+    // their handles in constants, e.g.:
+    //      constexpr UniformHandle TRANSFORM_UNIFORM("transform");
+    //      shader->set(TRANSFORM_UNIFORM, VP * M);
+    // The elements of an array are named like GLSL does: "lights[2].color", "weights[3]" ("weights" is the first one).
+    struct UniformHandle {
+        Symbol name = NO_SYMBOL;
+
+        constexpr UniformHandle() = default;
+        constexpr explicit UniformHandle(std::string_view name) : name(hashSymbol(name)) {}
+    };
+
+    // The binding points of the uniform blocks shared by several programs. When a program is linked, each of its blocks
+    // named in "SHARED_UNIFORM_BLOCKS" is bound to its point, so a buffer bound there once feeds every program.
+    constexpr GLuint LIGHTS_BLOCK_BINDING = 0;
+    constexpr GLuint FRAME_BLOCK_BINDING = 1;
+    constexpr GLuint DRAW_BLOCK_BINDING = 2;
+
+    struct SharedUniformBlock {
+        const char* name;
+        GLuint binding;
+    };
+    inline constexpr SharedUniformBlock SHARED_UNIFORM_BLOCKS[] = {
+        {"Lights", LIGHTS_BLOCK_BINDING}, // The lights of the frame (see "ForwardRenderer")
+        {"Frame", FRAME_BLOCK_BINDING}, // The camera of the frame (see "FrameBlock" in "systems/forward-renderer.hpp")
+        {"Draw", DRAW_BLOCK_BINDING}, // The model matrices of the current draw (see "DrawBlock" in "systems/forward-renderer.hpp")
+    };
+
     class ShaderProgram {
 
     private:
         //Shader Program Handle (OpenGL object name)
         GLuint program;
 
+        // The active uniforms of the program, reflected once by "link" into a flat hash table (open addressing with
+        // linear probing, the size is a power of two). A slot whose name is NO_SYMBOL is empty.
+        struct UniformSlot {
+            Symbol name = NO_SYMBOL;
+            GLint location = -1;
+        };
+        std::vector<UniformSlot> uniforms;
+
+        // True if the program reads its model matrices from the "Draw" block instead of uniforms (see "readsDrawBlock")
+        bool drawBlock = false;
+
+        // The program that draws the same material with instancing (null if there is none, see "getInstancedVariant")
+        ShaderProgram* instancedVariant = nullptr;
+
+        // Fills the uniform table with the active uniforms of the linked program
+        void reflectUniforms();
+        // Binds the shared uniform blocks of the linked program to their binding points
+        void bindSharedUniformBlocks();
+
+        // Returns the location of the uniform with the given hashed name (-1 if the program has no such active uniform)
+        GLint findLocation(Symbol name) const {
+            if (uniforms.empty()) return -1;
+            size_t mask = uniforms.size() - 1;
+            for (size_t index = name & mask;; index = (index + 1) & mask) {
+                const UniformSlot& slot = uniforms[index];
+                if (slot.name == name) return slot.location;
+                if (slot.name == NO_SYMBOL) return -1;
+            }
+        }
+
     public:
         ShaderProgram(){
             //TODO: (Req 1) Create A shader program
@@ -23,20 +86,77 @@ namespace our {
         }
         ~ShaderProgram(){
             //TODO: (Req 1) Delete a shader program
+            GLStateCache::get().forgetProgram(program);
             glDeleteProgram(program);
+            delete instancedVariant;
         }
 
         bool attach(const std::string &filename, GLenum type) const;
 
-        bool link() const;
+        // Links the program and reflects its active uniforms (see "UniformHandle")
+        bool link();
 
         void use() { 
-            glUseProgram(program);
+            GLStateCache::get().useProgram(program);
+        }
+
+        // Returns the OpenGL name of the program
+        GLuint getOpenGLName() const { return program; }
+
+        // Returns true if the program has a "Draw" uniform block. The renderer then writes the per-draw data ("transform",
+        // "M" and "M_IT") to its uniform ring and binds the block of each draw, otherwise it sets them as uniforms.
+        bool readsDrawBlock() const { return drawBlock; }
+
+        // The instanced variant reads the model matrix (and its inverse transpose) of each instance from the instance
+        // attributes (see "ATTRIB_LOC_INSTANCE_M" in "mesh/mesh.hpp") instead of the uniforms. It must use the same
+        // uniforms as this program otherwise. This program owns the variant and deletes it with itself.
+        ShaderProgram* getInstancedVariant() const { return instancedVariant; }
+        void setInstancedVariant(ShaderProgram* variant) {
+            if (variant != instancedVariant) delete instancedVariant;
+            instancedVariant = variant;
         }
 
         GLuint getUniformLocation(const std::string &name) {
             //TODO: (Req 1) Return the location of the uniform with the given name
-            return glGetUniformLocation(program, name.c_str());
+            // The location comes from the reflected table, so the driver is not asked again
+            return GLuint(findLocation(hashSymbol(name)));
+        }
+
+        // The "set" functions send a value to a uniform. The ones taking a handle are meant for the draw loops since
+        // they neither build a string nor hash one. Setting a uniform the program doesn't have does nothing.
+        void set(UniformHandle uniform, GLfloat value) {
+            GLint location = findLocation(uniform.name);
+            if (location >= 0) glUniform1f(location, value);
+        }
+
+        void set(UniformHandle uniform, GLuint value) {
+            GLint location = findLocation(uniform.name);
+            if (location >= 0) glUniform1ui(location, value);
+        }
+
+        void set(UniformHandle uniform, GLint value) {
+            GLint location = findLocation(uniform.name);
+            if (location >= 0) glUniform1i(location, value);
+        }
+
+        void set(UniformHandle uniform, glm::vec2 value) {
+            GLint location = findLocation(uniform.name);
+            if (location >= 0) glUniform2f(location, value.x, value.y);
+        }
+
+        void set(UniformHandle uniform, glm::vec3 value) {
+            GLint location = findLocation(uniform.name);
+            if (location >= 0) glUniform3f(location, value.x, value.y, value.z);
+        }
+
+        void set(UniformHandle uniform, glm::vec4 value) {
+            GLint location = findLocation(uniform.name);
+            if (location >= 0) glUniform4f(location, value.x, value.y, value.z, value.w);
+        }
+
+        void set(UniformHandle uniform, const glm::mat4& matrix) {
+            GLint location = findLocation(uniform.name);
+            if (location >= 0) glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(matrix));
         }
 
         void set(const std::string &uniform, GLfloat value) {
@@ -3,6 +3,8 @@
 #include "../ecs/world.hpp"
 #include "../components/collider.hpp"
 #include "../components/input.hpp"
+#include "../ecs/scheduler.hpp"
+#include "../jobs/job-system.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
@@ -14,11 +16,18 @@ namespace our
 
     class ColliderSystem
     {
+        // Clearing a collider is too cheap to be worth a job on its own
+        static constexpr size_t MIN_CHUNK_SIZE = 64;
+
     public:
-        bool checkCollision(ColliderComponent *colliderA, ColliderComponent *colliderB)
+        // The collider system reads the transforms and writes the colliders
+        static SystemAccess getAccess()
         {
-            std::cout << "Checking collision between " << colliderA->id << " and " << colliderB->id << std::endl;
+            return SystemAccess().read<Transform>().write<ColliderComponent>();
+        }
 
+        bool checkCollision(ColliderComponent *colliderA, ColliderComponent *colliderB)
+        {
             glm::vec3 minA = colliderA->center - colliderA->size * 0.5f;
             glm::vec3 maxA = colliderA->center + colliderA->size * 0.5f;
             glm::vec3 minB = colliderB->center - colliderB->size * 0.5f;
@@ -32,40 +41,33 @@ namespace our
         }
         void update(World *world, float deltaTime)
         {
+            auto &colliders = world->getPool<ColliderComponent>();
+            auto &jobs = JobSystem::get();
 
-            for (auto entity : world->getEntities())
-            {
-                ColliderComponent *collider = entity->getComponent<ColliderComponent>();
-                if (collider)
+            jobs.parallelFor(colliders.size(), [&](size_t begin, size_t end)
+                             {
+                for (size_t index = begin; index < end; index++)
                 {
-
+                    auto collider = static_cast<ColliderComponent *>(colliders[index]);
                     collider->collidingWith.clear();
-                    collider->center = entity->localTransform.position;
-                }
-            }
-            for (auto entityA : world->getEntities())
-            {
-                ColliderComponent *colliderA = entityA->getComponent<ColliderComponent>();
-                if (!colliderA)
-                    continue;
+                    collider->center = collider->getOwner()->localTransform.position;
+                } }, MIN_CHUNK_SIZE);
 
-                for (auto entityB : world->getEntities())
+            // Every collider only writes its own list so the colliders can be tested in parallel
+            jobs.parallelFor(colliders.size(), [&](size_t begin, size_t end)
+                             {
+                for (size_t indexA = begin; indexA < end; indexA++)
                 {
-                    if (entityA == entityB)
-                        continue;
-
-                    ColliderComponent *colliderB = entityB->getComponent<ColliderComponent>();
-                    if (!colliderB)
-                        continue;
-
-                    if (checkCollision(colliderA, colliderB))
+                    auto colliderA = static_cast<ColliderComponent *>(colliders[indexA]);
+                    for (size_t indexB = 0; indexB < colliders.size(); indexB++)
                     {
-
-                        colliderA->collidingWith.push_back(colliderB->id);
-                        colliderB->collidingWith.push_back(colliderA->id);
+                        if (indexA == indexB)
+                            continue;
+                        auto colliderB = static_cast<ColliderComponent *>(colliders[indexB]);
+                        if (checkCollision(colliderA, colliderB))
+                            colliderA->collidingWith.push_back(colliderB->id);
                     }
-                }
-            }
+                } });
         }
     };
 
@@ -1,10 +1,25 @@
 #include "forward-renderer.hpp"
 #include "../mesh/mesh-utils.hpp"
 #include "../texture/texture-utils.hpp"
+#include "../jobs/job-system.hpp"
+#include "../deserialize-utils.hpp"
+#include <cstddef>
+#include <cstring>
 #include <iostream>
+#include <limits>
 
 namespace our
 {
+    // The handles of the uniforms set for every draw
+    constexpr UniformHandle TRANSFORM_UNIFORM("transform");
+    constexpr UniformHandle CAMERA_POSITION_UNIFORM("camera_position");
+    constexpr UniformHandle VP_UNIFORM("VP");
+    constexpr UniformHandle M_UNIFORM("M");
+    constexpr UniformHandle M_IT_UNIFORM("M_IT");
+    constexpr UniformHandle TEXT_COLOR_UNIFORM("textColor");
+    constexpr UniformHandle TEXT_UNIFORM("text");
+    constexpr UniformHandle PROJECTION_UNIFORM("projection");
+
     void ForwardRenderer::initialize(glm::ivec2 windowSize, const nlohmann::json &config)
     {
         // First, we store the window size for later use
@@ -12,6 +27,13 @@ namespace our
 
         // Read debug configuration
         debug = config.value("debug", false);
+        // The smallest batch drawn with instancing (0 disables instancing)
+        instancingThreshold = config.value("instancing", instancingThreshold);
+        frustumCulling = config.value("frustumCulling", true);
+        useStaticScene = config.value("staticBVH", true);
+        occlusionCulling = config.value("occlusionCulling", true);
+        glm::ivec2 occlusionResolution = config.value("occlusionResolution", glm::ivec2(256, 128));
+        occlusionBuffer.resize(occlusionResolution.x, occlusionResolution.y);
 
         // Then we check if there is a sky texture in the configuration
         if (config.contains("sky"))
@@ -67,7 +89,7 @@ namespace our
         {
             // TODO: (Req 11) Create a framebuffer
             glGenFramebuffers(1, &postprocessFrameBuffer);
-            glBindFramebuffer(GL_FRAMEBUFFER, postprocessFrameBuffer);
+            GLStateCache::get().bindFramebuffer(postprocessFrameBuffer);
 
             // TODO: (Req 11) Create a color and a depth texture and attach them to the framebuffer
             //  Hints: The color format can be (Red, Green, Blue and Alpha components with 8 bits for each channel).
@@ -78,7 +100,7 @@ namespace our
             glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTarget->getOpenGLName(), 0);
 
             // TODO: (Req 11) Unbind the framebuffer just to be safe
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            GLStateCache::get().bindFramebuffer(0);
 
             // Create a vertex array to use for drawing the texture
             glGenVertexArrays(1, &postProcessVertexArray);
@@ -105,6 +127,16 @@ namespace our
             // so it is more performant to disable the depth mask
             postprocessMaterial->pipelineState.depthMask = false;
         }
+        // Create the uniform buffer of the lights (see "uploadLights")
+        glGenBuffers(1, &lightBuffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, lightBuffer);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(LightBlock), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        // Create the buffer of the instanced draws (it is refilled every frame, see "batchOpaqueCommands")
+        glGenBuffers(1, &instanceBuffer);
+        // Create the ring of the frame and draw blocks (see "uploadDrawBlocks"), it grows with the scene
+        drawRing.create(64 * 1024);
+
         if (debug == true)
         {
             debugDrawer.setDebugMode(btIDebugDraw::DBG_DrawWireframe);
@@ -125,13 +157,13 @@ namespace our
         // Configure VAO/VBO for texture quads
         glGenVertexArrays(1, &textVAO);
         glGenBuffers(1, &textVBO);
-        glBindVertexArray(textVAO);
+        GLStateCache::get().bindVertexArray(textVAO);
         glBindBuffer(GL_ARRAY_BUFFER, textVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        GLStateCache::get().bindVertexArray(0);
 
         // Load text shader
         textShader = new ShaderProgram();
@@ -156,6 +188,8 @@ namespace our
         // Delete all objects related to post processing
         if (postprocessMaterial)
         {
+            GLStateCache::get().forgetFramebuffer(postprocessFrameBuffer);
+            GLStateCache::get().forgetVertexArray(postProcessVertexArray);
             glDeleteFramebuffers(1, &postprocessFrameBuffer);
             glDeleteVertexArrays(1, &postProcessVertexArray);
             delete colorTarget;
@@ -165,9 +199,17 @@ namespace our
             delete postprocessMaterial;
         }
 
+        // Delete the light buffer
+        glDeleteBuffers(1, &lightBuffer);
+        lightBuffer = 0;
+        glDeleteBuffers(1, &instanceBuffer);
+        instanceBuffer = 0;
+        drawRing.destroy();
+
         // Clean up character textures
         for (auto &pair : characters)
         {
+            GLStateCache::get().forgetTexture(pair.second.textureID);
             glDeleteTextures(1, &pair.second.textureID);
         }
         characters.clear();
@@ -177,6 +219,7 @@ namespace our
         FT_Done_FreeType(ft);
 
         // Clean up OpenGL resources
+        GLStateCache::get().forgetVertexArray(textVAO);
         glDeleteVertexArrays(1, &textVAO);
         glDeleteBuffers(1, &textVBO);
         if (textShader)
@@ -186,71 +229,302 @@ namespace our
         }
     }
 
-    void ForwardRenderer::render(World *world)
+    void ForwardRenderer::uploadLights()
     {
-        // First of all, we search for a camera and for all the mesh renderers
-        CameraComponent *camera = nullptr;
-        opaqueCommands.clear();
-        transparentCommands.clear();
-        lightCommands.clear();
-        for (auto entity : world->getEntities())
+        // The shader only has room for MAX_LIGHTS lights, the others are dropped
+        size_t count = std::min(lightCommands.size(), LightBlock::MAX_LIGHTS);
+        for (size_t i = 0; i < count; i++)
         {
-            // If we hadn't found a camera yet, we look for a camera in this entity
-            if (!camera)
-                camera = entity->getComponent<CameraComponent>(); // If this entity has a mesh renderer component
-            if (auto meshRenderer = entity->getComponent<MeshRendererComponent>(); meshRenderer)
+            LightComponent *light = lightCommands[i];
+            LightData &data = lightBlock.lights[i];
+            if (light->getOwner()->parent)
             {
-                // Check if this entity has a checkpoint component and if it's visible
-                if (auto checkpoint = entity->getComponent<CheckpointComponent>(); checkpoint)
-                {
-                    // Skip rendering if checkpoint is not visible
-                    if (!checkpoint->isVisible)
-                        continue;
-                }
+                data.position = light->getOwner()->parent->localTransform.position + light->getOwner()->localTransform.position;
+            }
+            else
+            {
+                data.position = light->getOwner()->localTransform.position;
+            }
+            data.direction = glm::length(light->direction) > 0.0f ? glm::normalize(light->direction) : light->direction;
+            data.innerConeAngle = light->inner_cone_angle;
+            data.outerConeAngle = light->outer_cone_angle;
+            data.color = light->color;
+            data.type = (GLint)light->lightType;
+            data.attenuation = light->attenuation;
+            data.padding = 0.0f;
+        }
+        lightBlock.count = (GLint)count;
+        // Only the used part of the array is sent along with the count
+        glBindBuffer(GL_UNIFORM_BUFFER, lightBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, count * sizeof(LightData), lightBlock.lights);
+        glBufferSubData(GL_UNIFORM_BUFFER, offsetof(LightBlock, count), sizeof(GLint), &lightBlock.count);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTS_BLOCK_BINDING, lightBuffer);
+    }
 
-                // We construct a command from it
-                RenderCommand command;
-                command.localToWorld = meshRenderer->getOwner()->getLocalToWorldMatrix();
-                command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
-                command.mesh = meshRenderer->mesh;
-                command.material = meshRenderer->material;
-                // if it is transparent, we add it to the transparent commands list
-                if (command.material->transparent)
-                {
-                    transparentCommands.push_back(command);
-                }
-                else
-                {
-                    // Otherwise, we add it to the opaque command list
-                    opaqueCommands.push_back(command);
-                }
+    void ForwardRenderer::setupLighting(ShaderProgram *shader, const RenderCommand &command, const glm::vec3 &eye, const glm::mat4 &VP)
+    {
+        shader->set(CAMERA_POSITION_UNIFORM, eye);
+        shader->set(VP_UNIFORM, VP);
+        shader->set(M_UNIFORM, command.localToWorld);
+        shader->set(M_IT_UNIFORM, command.normalMatrix);
+    }
+
+    void ForwardRenderer::uploadDrawBlocks(size_t firstTransparent, const glm::vec3 &eye, const glm::mat4 &VP)
+    {
+        // The blocks go in draw order: the frame block then one draw block per command drawn alone whose shader reads it
+        auto needsBlock = [](const RenderCommand &command)
+        { return command.material->shader->readsDrawBlock(); };
+        size_t count = 0;
+        for (const DrawBatch &batch : opaqueBatches)
+            if (batch.firstInstance == NOT_INSTANCED)
+                for (size_t entry = batch.begin; entry < batch.end; entry++)
+                    count += needsBlock(extractedCommands[renderQueue[entry].index]);
+        for (size_t entry = firstTransparent; entry < renderQueue.size(); entry++)
+            count += needsBlock(extractedCommands[renderQueue[entry].index]);
+
+        const size_t frameStride = drawRing.align(sizeof(FrameBlock)), drawStride = drawRing.align(sizeof(DrawBlock));
+        unsigned char *data = static_cast<unsigned char *>(drawRing.map(frameStride + count * drawStride));
+        FrameBlock frame{VP, eye, 0.0f};
+        std::memcpy(data, &frame, sizeof(FrameBlock));
+        size_t offset = frameStride;
+        auto write = [&](RenderCommand &command)
+        {
+            if (!needsBlock(command))
+            {
+                command.drawBlock = NO_DRAW_BLOCK;
+                return;
+            }
+            DrawBlock block{VP * command.localToWorld, command.localToWorld, command.normalMatrix};
+            std::memcpy(data + offset, &block, sizeof(DrawBlock));
+            command.drawBlock = offset;
+            offset += drawStride;
+        };
+        for (const DrawBatch &batch : opaqueBatches)
+            if (batch.firstInstance == NOT_INSTANCED)
+                for (size_t entry = batch.begin; entry < batch.end; entry++)
+                    write(extractedCommands[renderQueue[entry].index]);
+        for (size_t entry = firstTransparent; entry < renderQueue.size(); entry++)
+            write(extractedCommands[renderQueue[entry].index]);
+        drawRing.unmap();
+        drawRing.bindRange(FRAME_BLOCK_BINDING, 0, sizeof(FrameBlock));
+    }
+
+    void ForwardRenderer::drawCommand(const RenderCommand &command, const glm::vec3 &eye, const glm::mat4 &VP)
+    {
+        // The uniforms of a material stay in its program, so they are only sent again when another material was used
+        if (command.material != currentMaterial)
+        {
+            command.material->setup();
+            currentMaterial = command.material;
+        }
+        if (command.drawBlock != NO_DRAW_BLOCK)
+        {
+            drawRing.bindRange(DRAW_BLOCK_BINDING, command.drawBlock, sizeof(DrawBlock));
+        }
+        else
+        {
+            command.material->shader->set(TRANSFORM_UNIFORM, VP * command.localToWorld);
+            /////////////////////////// ADD LIGHT COMPONENT HERE ///////////////////////////
+            if (dynamic_cast<LitMaterial *>(command.material))
+                setupLighting(command.material->shader, command, eye, VP);
+            /////////////////////////// LIGHT COMPONENT ///////////////////////////
+        }
+        command.mesh->draw();
+    }
+
+    void ForwardRenderer::batchOpaqueCommands(size_t firstTransparent)
+    {
+        opaqueBatches.clear();
+        instanceData.clear();
+        // The sort key orders the opaque commands by shader, texture, material then mesh, so the commands sharing a mesh
+        // and a material are next to each other
+        for (size_t begin = 0; begin < firstTransparent;)
+        {
+            const RenderCommand &first = extractedCommands[renderQueue[begin].index];
+            size_t end = begin + 1;
+            while (end < firstTransparent)
+            {
+                const RenderCommand &next = extractedCommands[renderQueue[end].index];
+                if (next.mesh != first.mesh || next.material != first.material)
+                    break;
+                end++;
             }
-            // Add LightComponent to the entity
-            if (auto light = entity->getComponent<LightComponent>(); light)
+            bool instanced = instancingThreshold > 0 && end - begin >= instancingThreshold && first.material->shader->getInstancedVariant();
+            opaqueBatches.push_back({begin, end, instanced ? instanceData.size() : NOT_INSTANCED});
+            if (instanced)
             {
-                lightCommands.push_back(light);
+                for (size_t entry = begin; entry < end; entry++)
+                {
+                    const RenderCommand &command = extractedCommands[renderQueue[entry].index];
+                    instanceData.push_back({command.localToWorld, command.normalMatrix});
+                }
             }
+            begin = end;
         }
+        if (instanceData.empty())
+            return;
+        // The buffer is respecified every frame so the driver gives it new memory instead of waiting for the last frame's draws
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, instanceData.size() * sizeof(InstanceData), instanceData.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
 
+    void ForwardRenderer::render(World *world)
+    {
+        // First of all, we search for a camera and for all the mesh renderers
+        CameraComponent *camera = nullptr;
+        renderQueue.clear();
+        lightCommands.clear();
+        // Bring the cached world matrices up to date (only the changed subtrees are recomputed)
+        world->updateTransforms();
+        // The first camera in the camera pool is used for rendering
+        if (world->count<CameraComponent>() > 0)
+            camera = static_cast<CameraComponent *>(world->getPool<CameraComponent>()[0]);
         // If there is no camera, we return (we cannot render without a camera)
         if (camera == nullptr)
             return;
 
         // TODO: (Req 9) Modify the following line such that "cameraForward" contains a vector pointing the camera forward direction
         //  HINT: See how you wrote the CameraComponent::getViewMatrix, it should help you solve this one
-        auto M = camera->getOwner()->getLocalToWorldMatrix();
+        auto M = camera->getOwner()->getCachedLocalToWorldMatrix();
         glm::vec3 eye = M * glm::vec4(0, 0, 0, 1);
         glm::vec3 center = M * glm::vec4(0, 0, -1, 1);
         glm::vec3 cameraForward = glm::normalize(center - eye);
 
-        std::sort(transparentCommands.begin(), transparentCommands.end(), [cameraForward](const RenderCommand &first, const RenderCommand &second)
-                  {
-                      // TODO: (Req 9) Finish this function
-                      // HINT: the following return should return true "first" should be drawn before "second". 
-                      return glm::dot(first.center, cameraForward) > glm::dot(second.center, cameraForward); });
-
         // TODO: (Req 9) Get the camera ViewProjection matrix and store it in VP
         glm::mat4 VP = camera->getProjectionMatrix(windowSize) * camera->getViewMatrix();
+        Frustum frustum = Frustum::fromViewProjection(VP);
+
+        // Only the entities holding a mesh renderer are visited
+        // The static ones come out of the BVH already culled, the dynamic ones are culled below
+        candidates.clear();
+        size_t dynamicCount;
+        if (useStaticScene)
+        {
+            staticScene.update(world);
+            candidates = staticScene.getDynamicRenderers();
+            dynamicCount = candidates.size();
+            if (frustumCulling)
+                staticScene.cull(frustum, candidates);
+            else
+                staticScene.collect(candidates);
+        }
+        else
+        {
+            for (auto component : world->getPool<MeshRendererComponent>())
+                candidates.push_back(static_cast<MeshRendererComponent *>(component));
+            dynamicCount = candidates.size();
+        }
+
+        // The occluders in view are rasterized before the extraction tests the candidates against them
+        // (like the other candidates, the hidden checkpoints don't hide anything)
+        occlusionBuffer.begin(VP);
+        if (occlusionCulling)
+        {
+            for (auto meshRenderer : candidates)
+            {
+                auto checkpoint = meshRenderer->getOwner()->getComponent<CheckpointComponent>();
+                if (meshRenderer->mesh->isOccluder() && (!checkpoint || checkpoint->isVisible))
+                    occlusionBuffer.addOccluder(*meshRenderer->mesh, meshRenderer->getOwner()->getCachedLocalToWorldMatrix());
+            }
+            occlusionBuffer.rasterize();
+        }
+        bool occlusionTests = occlusionBuffer.hasOccluders();
+
+        // Each candidate fills its own slot, so the commands are extracted in parallel
+        extractedCommands.resize(candidates.size());
+        extractedVisible.resize(candidates.size());
+        extractedBounds.resize(candidates.size());
+        JobSystem::get().parallelFor(candidates.size(), [&](size_t begin, size_t end)
+                                     {
+            // First, the hidden checkpoints and the objects beyond their material's draw distance are dropped,
+            // and the world bounds of the dynamic ones (of all of them if there are occluders) are computed
+            for (size_t index = begin; index < end; index++)
+            {
+                auto meshRenderer = candidates[index];
+                Entity *entity = meshRenderer->getOwner();
+                // Check if this entity has a checkpoint component and if it's visible
+                // Skip rendering if checkpoint is not visible
+                auto checkpoint = entity->getComponent<CheckpointComponent>();
+                extractedVisible[index] = !checkpoint || checkpoint->isVisible;
+                if (!extractedVisible[index])
+                    continue;
+
+                const glm::mat4 &localToWorld = entity->getCachedLocalToWorldMatrix();
+                const MeshBounds &bounds = meshRenderer->mesh->getBounds();
+                float maxDrawDistance = meshRenderer->material->maxDrawDistance;
+                if (maxDrawDistance < std::numeric_limits<float>::infinity())
+                {
+                    // The radius of the sphere grows with the largest scale of the transform
+                    float scale = std::max({glm::length(glm::vec3(localToWorld[0])), glm::length(glm::vec3(localToWorld[1])),
+                                            glm::length(glm::vec3(localToWorld[2]))});
+                    glm::vec3 sphereCenter = glm::vec3(localToWorld * glm::vec4(bounds.sphereCenter, 1.0f));
+                    if (glm::distance(sphereCenter, eye) - bounds.sphereRadius * scale > maxDrawDistance)
+                    {
+                        extractedVisible[index] = false;
+                        continue;
+                    }
+                }
+                if (index < dynamicCount || occlusionTests)
+                    extractedBounds[index] = transformBounds(bounds, localToWorld);
+            }
+            // Then the boxes of the dynamic candidates of the chunk are tested against the frustum together
+            size_t cullEnd = std::min(end, dynamicCount);
+            if (frustumCulling && begin < cullEnd)
+                cullBoxes(frustum, extractedBounds.data() + begin, cullEnd - begin, extractedVisible.data() + begin);
+            // and the boxes left are tested against the occluders
+            if (occlusionTests)
+                occlusionBuffer.cullBoxes(extractedBounds.data() + begin, end - begin, extractedVisible.data() + begin);
+
+            // Finally, the commands of the visible objects are built
+            for (size_t index = begin; index < end; index++)
+            {
+                if (!extractedVisible[index])
+                    continue;
+                auto meshRenderer = candidates[index];
+                Entity *entity = meshRenderer->getOwner();
+
+                // We construct a command from it
+                RenderCommand &command = extractedCommands[index];
+                command.localToWorld = entity->getCachedLocalToWorldMatrix();
+                command.normalMatrix = entity->getCachedNormalMatrix();
+                command.center = glm::vec3(command.localToWorld * glm::vec4(0, 0, 0, 1));
+                command.mesh = meshRenderer->mesh;
+                command.material = meshRenderer->material;
+
+                // The opaque commands are grouped by state and drawn front to back, the transparent ones are drawn back to front
+                // The material is identified by its address (its low bits are always zero so they are dropped)
+                float depth = glm::dot(command.center - eye, cameraForward);
+                std::uint32_t shader = command.material->shader->getOpenGLName();
+                std::uint32_t texture = command.material->getMainTexture();
+                std::uint32_t material = std::uint32_t(reinterpret_cast<std::uintptr_t>(command.material) >> 4);
+                std::uint32_t mesh = command.mesh->getId();
+                command.sortKey = command.material->transparent ? makeTransparentSortKey(shader, texture, material, mesh, depth)
+                                                                : makeOpaqueSortKey(shader, texture, material, mesh, depth);
+            } }, EXTRACTION_CHUNK_SIZE);
+        // Only the keys and the indices of the visible commands are sorted, the commands themselves stay in place
+        for (size_t index = 0; index < extractedCommands.size(); index++)
+        {
+            if (extractedVisible[index])
+                renderQueue.push_back({extractedCommands[index].sortKey, std::uint32_t(index)});
+        }
+        radixSort(renderQueue, renderQueueScratch);
+        // The transparent commands come after all the opaque ones
+        size_t firstTransparent = 0;
+        while (firstTransparent < renderQueue.size() && getSortPass(renderQueue[firstTransparent].key) == RenderPass::OPAQUE_PASS)
+            firstTransparent++;
+        batchOpaqueCommands(firstTransparent);
+
+        // Collect the light components
+        for (auto [entity, light] : world->view<LightComponent>())
+        {
+            lightCommands.push_back(light);
+        }
+
+        // The lights, the camera and the model matrices are sent once for the whole frame
+        uploadLights();
+        uploadDrawBlocks(firstTransparent, eye, VP);
 
         // TODO: (Req 9) Set the OpenGL viewport using viewportStart and viewportSize
         glViewport(0, 0, windowSize.x, windowSize.y);
@@ -260,19 +534,19 @@ namespace our
         glClearDepth(1.0f);
 
         // TODO: (Req 9) Set the color mask to true and the depth mask to true (to ensure the glClear will affect the framebuffer)
-        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-        glDepthMask(GL_TRUE);
+        GLStateCache::get().setColorMask(glm::bvec4(true));
+        GLStateCache::get().setDepthMask(true);
 
         // If there is a postprocess material, bind the framebuffer
         if (postprocessMaterial)
         {
             // TODO: (Req 11) bind the framebuffer
-            glBindFramebuffer(GL_FRAMEBUFFER, postprocessFrameBuffer);
+            GLStateCache::get().bindFramebuffer(postprocessFrameBuffer);
         }
         else
         {
             // Ensure we're using the default framebuffer when no postprocessing
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            GLStateCache::get().bindFramebuffer(0);
         }
 
         // TODO: (Req 9) Clear the color and depth buffers
@@ -280,56 +554,23 @@ namespace our
 
         // TODO: (Req 9) Draw all the opaque commands
         //  Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
-        for (const auto &command : opaqueCommands)
+        currentMaterial = nullptr;
+        for (const DrawBatch &batch : opaqueBatches)
         {
-            command.material->setup();
-            command.material->shader->set("transform", VP * command.localToWorld);
-
-            /////////////////////////// ADD LIGHT COMPONENT HERE ///////////////////////////
-            if (dynamic_cast<LitMaterial *>(command.material))
+            if (batch.firstInstance == NOT_INSTANCED)
             {
-                LitMaterial *litMaterial = dynamic_cast<LitMaterial *>(command.material);
-                command.material->shader->set("camera_position", eye);
-                command.material->shader->set("light_count", (int)lightCommands.size());
-                command.material->shader->set("VP", VP);
-                command.material->shader->set("M", command.localToWorld);
-                command.material->shader->set("M_IT", glm::transpose(glm::inverse(command.localToWorld)));
-                // command.material->shader->set("M_IT", glm::inverse(command.localToWorld));
-
-                for (size_t i = 0; i < lightCommands.size(); i++)
-                {
-                    LightComponent *light = lightCommands[i];
-                    glm::vec3 light_position;
-                    std::string light_name = "lights[" + std::to_string(i) + "]";
-
-                    if (light->getOwner()->parent)
-                    {
-                        light_position = light->getOwner()->parent->localTransform.position + light->getOwner()->localTransform.position;
-                    }
-                    else
-                    {
-                        light_position = light->getOwner()->localTransform.position;
-                    }
-
-                    if (light->lightType == lightType::DIRECTIONAL)
-                    {
-                        command.material->shader->set(light_name + ".direction", glm::normalize(light->direction));
-                    }
-                    else if (light->lightType == lightType::SPOT)
-                    {
-                        command.material->shader->set(light_name + ".direction", glm::normalize(light->direction));
-                        command.material->shader->set(light_name + ".inner_cone_angle", light->inner_cone_angle);
-                        command.material->shader->set(light_name + ".outer_cone_angle", light->outer_cone_angle);
-                    }
-                    command.material->shader->set(light_name + ".position", light_position);
-                    command.material->shader->set(light_name + ".color", light->color);
-                    command.material->shader->set(light_name + ".attenuation", light->attenuation);
-                    command.material->shader->set(light_name + ".type", (int)light->lightType);
-                }
+                for (size_t entry = batch.begin; entry < batch.end; entry++)
+                    drawCommand(extractedCommands[renderQueue[entry].index], eye, VP);
+                continue;
             }
-            /////////////////////////// LIGHT COMPONENT ///////////////////////////
-
-            command.mesh->draw();
+            // The model matrices come from the instance buffer, only the camera is sent as uniforms
+            const RenderCommand &command = extractedCommands[renderQueue[batch.begin].index];
+            command.material->setup(true);
+            currentMaterial = nullptr;
+            ShaderProgram *shader = command.material->getProgram(true);
+            shader->set(VP_UNIFORM, VP);
+            shader->set(CAMERA_POSITION_UNIFORM, eye);
+            command.mesh->drawInstanced(instanceBuffer, batch.firstInstance * sizeof(InstanceData), GLsizei(batch.end - batch.begin));
         }
 
         // If there is a sky material, draw the sky
@@ -353,61 +594,19 @@ namespace our
                 0.0f, 0.0f, 1.0f, 1.0f);
 
             // TODO: (Req 10) set the "transform" uniform
-            skyMaterial->shader->set("transform", alwaysBehindTransform * VP * modelMatrix);
+            skyMaterial->shader->set(TRANSFORM_UNIFORM, alwaysBehindTransform * VP * modelMatrix);
 
             // TODO: (Req 10) draw the sky sphere
             skySphere->draw();
+            currentMaterial = nullptr;
         }
 
         // TODO: (Req 9) Draw all the transparent commands
         //  Don't forget to set the "transform" uniform to be equal the model-view-projection matrix for each render command
-        for (const auto &command : transparentCommands)
-        {
-            command.material->setup();
-            command.material->shader->set("transform", VP * command.localToWorld);
-            /////////////////////////// ADD LIGHT COMPONENT HERE ///////////////////////////
-            if (dynamic_cast<LitMaterial *>(command.material))
-            {
-                LitMaterial *litMaterial = dynamic_cast<LitMaterial *>(command.material);
-                command.material->shader->set("camera_position", eye);
-                command.material->shader->set("light_count", (int)lightCommands.size());
-                command.material->shader->set("VP", VP);
-                command.material->shader->set("M", command.localToWorld);
-                command.material->shader->set("M_IT", glm::transpose(glm::inverse(command.localToWorld)));
-
-                for (size_t i = 0; i < lightCommands.size(); i++)
-                {
-                    LightComponent *light = lightCommands[i];
-                    glm::vec3 light_position;
-                    std::string light_name = "lights[" + std::to_string(i) + "]";
-                    if (light->getOwner()->parent)
-                    {
-                        light_position = light->getOwner()->parent->localTransform.position + light->getOwner()->localTransform.position;
-                    }
-                    else
-                    {
-                        light_position = light->getOwner()->localTransform.position;
-                    }
-
-                    if (light->lightType == lightType::DIRECTIONAL)
-                    {
-                        command.material->shader->set(light_name + ".direction", light->direction);
-                    }
-                    else if (light->lightType == lightType::SPOT)
-                    {
-                        command.material->shader->set(light_name + ".direction", light->direction);
-                        command.material->shader->set(light_name + ".inner_cone_angle", light->inner_cone_angle);
-                        command.material->shader->set(light_name + ".outer_cone_angle", light->outer_cone_angle);
-                    }
-                    command.material->shader->set(light_name + ".position", light_position);
-                    command.material->shader->set(light_name + ".color", light->color);
-                    command.material->shader->set(light_name + ".attenuation", light->attenuation);
-                    command.material->shader->set(light_name + ".type", (int)light->lightType);
-                }
-            }
-            /////////////////////////// LIGHT COMPONENT ///////////////////////////
-            command.mesh->draw();
-        }
+        for (size_t entry = firstTransparent; entry < renderQueue.size(); entry++)
+            drawCommand(extractedCommands[renderQueue[entry].index], eye, VP);
+        // The region of the ring written this frame is reused once the GPU is done with these draws
+        drawRing.fence();
         if (debug == true)
         {
             // Option 1: Show only wireframes (kart will appear white/gray, wheels blue)
@@ -421,12 +620,14 @@ namespace our
 
             dynWorld->debugDrawWorld();
             debugDrawer.glfw3_device_render(glm::value_ptr(VP));
+            // The debug drawer binds its program and vertex array directly
+            GLStateCache::get().invalidate();
         }
         // If there is a postprocess material, apply postprocessing
         if (postprocessMaterial)
         {
             // First, bind the default framebuffer for postprocessing output
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            GLStateCache::get().bindFramebuffer(0);
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
             // Set viewport to full window
@@ -434,9 +635,8 @@ namespace our
 
             // Render postprocess quad
             postprocessMaterial->setup();
-            glBindVertexArray(postProcessVertexArray);
+            GLStateCache::get().bindVertexArray(postProcessVertexArray);
             glDrawArrays(GL_TRIANGLES, 0, 3);
-            glBindVertexArray(0);
         }
     }
     void ForwardRenderer::loadFont(const std::string &fontPath)
@@ -466,7 +666,7 @@ namespace our
             // Generate texture
             GLuint texture;
             glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
+            GLStateCache::get().bindTexture2D(texture);
             glTexImage2D(
                 GL_TEXTURE_2D,
                 0,
@@ -490,7 +690,7 @@ namespace our
                 static_cast<GLuint>(face->glyph->advance.x)};
             characters.insert(std::pair<char, Character>(c, character));
         }
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLStateCache::get().bindTexture2D(0);
     }
 
     void ForwardRenderer::initializeTextRendering()
@@ -508,13 +708,13 @@ namespace our
         // Configure VAO/VBO for texture quads
         glGenVertexArrays(1, &textVAO);
         glGenBuffers(1, &textVBO);
-        glBindVertexArray(textVAO);
+        GLStateCache::get().bindVertexArray(textVAO);
         glBindBuffer(GL_ARRAY_BUFFER, textVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        GLStateCache::get().bindVertexArray(0);
 
         // Load text shader
         textShader = new ShaderProgram();
@@ -528,6 +728,7 @@ namespace our
         // Clean up character textures
         for (auto &pair : characters)
         {
+            GLStateCache::get().forgetTexture(pair.second.textureID);
             glDeleteTextures(1, &pair.second.textureID);
         }
         characters.clear();
@@ -537,6 +738,7 @@ namespace our
         FT_Done_FreeType(ft);
 
         // Clean up OpenGL resources
+        GLStateCache::get().forgetVertexArray(textVAO);
         glDeleteVertexArrays(1, &textVAO);
         glDeleteBuffers(1, &textVBO);
         if (textShader)
@@ -548,41 +750,30 @@ namespace our
 
     void ForwardRenderer::renderText(const std::string &text, float x, float y, float scale, const glm::vec3 &color)
     {
-        // Save current OpenGL state
-        GLboolean depthTestEnabled = glIsEnabled(GL_DEPTH_TEST);
-        GLboolean blendEnabled = glIsEnabled(GL_BLEND);
-        GLint blendSrcRGB, blendDstRGB, blendSrcAlpha, blendDstAlpha;
-        glGetIntegerv(GL_BLEND_SRC_RGB, &blendSrcRGB);
-        glGetIntegerv(GL_BLEND_DST_RGB, &blendDstRGB);
-        glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendSrcAlpha);
-        glGetIntegerv(GL_BLEND_DST_ALPHA, &blendDstAlpha);
-
-        GLint currentProgram, currentVAO, currentTexture, currentFramebuffer;
-        glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
-        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &currentVAO);
-        glGetIntegerv(GL_TEXTURE_BINDING_2D, &currentTexture);
-        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &currentFramebuffer);
+        // The state goes through the state cache, so nothing has to be read back and restored afterwards:
+        // the next draws set whatever they need (and only pay for what differs)
+        GLStateCache &state = GLStateCache::get();
 
         // FORCE text to render to default framebuffer
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        state.bindFramebuffer(0);
 
         // Set up text rendering state
-        glDisable(GL_DEPTH_TEST); // Disable depth testing for text (render on top)
-        glEnable(GL_BLEND);       // Enable blending for transparency
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        state.setEnabled(GL_DEPTH_TEST, false); // Disable depth testing for text (render on top)
+        state.setEnabled(GL_BLEND, true);       // Enable blending for transparency
+        state.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
         // Use shader and set uniforms
         textShader->use();
-        textShader->set("textColor", color);
-        textShader->set("text", 0); // Explicitly set sampler to texture unit 0
+        textShader->set(TEXT_COLOR_UNIFORM, color);
+        textShader->set(TEXT_UNIFORM, 0); // Explicitly set sampler to texture unit 0
 
         // Set up projection matrix for 2D rendering
         glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(windowSize.x),
                                           0.0f, static_cast<float>(windowSize.y));
-        textShader->set("projection", projection);
+        textShader->set(PROJECTION_UNIFORM, projection);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindVertexArray(textVAO);
+        state.setActiveTexture(0);
+        state.bindVertexArray(textVAO);
 
         // Iterate through all characters
         for (auto c = text.begin(); c != text.end(); c++)
@@ -606,7 +797,7 @@ namespace our
                 {xpos + w, ypos + h, 1.0f, 0.0f}};
 
             // Render glyph texture over quad
-            glBindTexture(GL_TEXTURE_2D, ch.textureID);
+            state.bindTexture2D(ch.textureID);
 
             // Update content of VBO memory
             glBindBuffer(GL_ARRAY_BUFFER, textVBO);
@@ -619,33 +810,6 @@ namespace our
             // Advance cursors for next glyph
             x += (ch.advance >> 6) * scale;
         }
-
-        // Restore OpenGL state
-        glBindVertexArray(currentVAO);
-        glBindTexture(GL_TEXTURE_2D, currentTexture);
-        glUseProgram(currentProgram);
-        glBindFramebuffer(GL_FRAMEBUFFER, currentFramebuffer);
-
-        // Restore blending state
-        if (blendEnabled)
-        {
-            glEnable(GL_BLEND);
-            glBlendFuncSeparate(blendSrcRGB, blendDstRGB, blendSrcAlpha, blendDstAlpha);
-        }
-        else
-        {
-            glDisable(GL_BLEND);
-        }
-
-        // Restore depth testing state
-        if (depthTestEnabled)
-        {
-            glEnable(GL_DEPTH_TEST);
-        }
-        else
-        {
-            glDisable(GL_DEPTH_TEST);
-        }
     }
 
     void ForwardRenderer::renderTextCentered(const std::string &text, float x, float y, float scale, const glm::vec3 &color)
@@ -9,8 +9,14 @@
 #include "BulletDebugDrawer.hpp"
 // #include "rigidbodySystem.hpp"
 #include "../components/rigidbody.hpp"
+#include "render-queue.hpp"
+#include "frustum-culling.hpp"
+#include "static-bvh.hpp"
+#include "occlusion-culling.hpp"
+#include "../uniform-ring.hpp"
 
 #include <glad/gl.h>
+#include <cstdint>
 #include <vector>
 #include <algorithm>
 #include <map>
@@ -38,11 +44,58 @@ namespace our
     struct RenderCommand
     {
         glm::mat4 localToWorld;
+        glm::mat4 normalMatrix; // The inverse transpose of localToWorld (used to transform normals)
         glm::vec3 center;
         Mesh *mesh;
         Material *material;
+        std::uint64_t sortKey; // The order in which the command is drawn (see "systems/render-queue.hpp")
+        size_t drawBlock;      // The offset of its "Draw" block in the uniform ring (see "uploadDrawBlocks")
     };
 
+    // A light as stored in the "Lights" uniform block of "assets/shaders/light.frag" (std140 layout: each scalar fills the
+    // 4th component of the vec3 before it so a light takes 4 vec4s)
+    struct LightData
+    {
+        glm::vec3 direction;
+        float innerConeAngle;
+        glm::vec3 position;
+        float outerConeAngle;
+        glm::vec3 color;
+        GLint type;
+        glm::vec3 attenuation;
+        float padding;
+    };
+    static_assert(sizeof(LightData) == 64, "LightData must match the std140 layout of the Light struct");
+
+    // The content of the "Lights" uniform block (bound at LIGHTS_BLOCK_BINDING)
+    struct LightBlock
+    {
+        // Must match MAX_LIGHTS in "assets/shaders/light.frag"
+        static constexpr size_t MAX_LIGHTS = 8;
+        LightData lights[MAX_LIGHTS];
+        GLint count;
+        GLint padding[3];
+    };
+    static_assert(sizeof(LightBlock) == LightBlock::MAX_LIGHTS * 64 + 16, "LightBlock must match the std140 layout of the Lights block");
+
+    // The content of the "Frame" uniform block of "assets/shaders/light-ubo.vert" (bound at FRAME_BLOCK_BINDING)
+    struct FrameBlock
+    {
+        glm::mat4 VP;
+        glm::vec3 cameraPosition;
+        float padding;
+    };
+    static_assert(sizeof(FrameBlock) == 80, "FrameBlock must match the std140 layout of the Frame block");
+
+    // The content of the "Draw" uniform block of the "*-ubo.vert" shaders (bound at DRAW_BLOCK_BINDING for each draw)
+    struct DrawBlock
+    {
+        glm::mat4 transform; // VP * M
+        glm::mat4 M;
+        glm::mat4 M_IT;
+    };
+    static_assert(sizeof(DrawBlock) == 192, "DrawBlock must match the std140 layout of the Draw block");
+
     // A forward renderer is a renderer that draw the object final color directly to the framebuffer
     // In other words, the fragment shader in the material should output the color that we should see on the screen
     // This is different from more complex renderers that could draw intermediate data to a framebuffer before computing the final color
@@ -51,12 +104,54 @@ namespace our
     {
         // These window size will be used on multiple occasions (setting the viewport, computing the aspect ratio, etc.)
         glm::ivec2 windowSize;
-        // These are two vectors in which we will store the opaque and the transparent commands.
+        // The static mesh renderers are kept in a BVH that rejects whole sections of the scene at once (see "StaticScene").
+        // The renderers left by it and the dynamic renderers are the candidates of the frame (the dynamic ones first).
+        StaticScene staticScene;
+        bool useStaticScene = true;
+        std::vector<MeshRendererComponent *> candidates;
+        // The commands are extracted in parallel (one slot per candidate) along with their sort key
+        // "extractedVisible[i]" tells whether "extractedCommands[i]" should be drawn
         // We define them here (instead of being local to the "render" function) as an optimization to prevent reallocating them every frame
-        std::vector<RenderCommand> opaqueCommands;
-        std::vector<RenderCommand> transparentCommands;
+        std::vector<RenderCommand> extractedCommands;
+        std::vector<char> extractedVisible;
+        // The world bounds of the mesh renderers, tested against the camera frustum before the commands are built
+        // ("frustumCulling" can be turned off to compare the cost of drawing everything)
+        std::vector<CullBox> extractedBounds;
+        bool frustumCulling = true;
+        // The occluder meshes among the candidates are rasterized by the CPU into a small depth buffer, then the candidates
+        // hidden behind them are dropped too (see "OcclusionBuffer")
+        OcclusionBuffer occlusionBuffer;
+        bool occlusionCulling = true;
+        // The keys and indices of the visible commands, radix sorted into draw order (the opaque commands then the transparent ones)
+        std::vector<RenderQueueEntry> renderQueue, renderQueueScratch;
+        // Extracting a command is cheap so small scenes are extracted by the calling thread alone
+        static constexpr size_t EXTRACTION_CHUNK_SIZE = 256;
+        // The sorted opaque commands sharing a mesh and a material are drawn in batches. A batch of at least
+        // "instancingThreshold" commands (0 disables instancing) whose shader has an instanced variant is drawn with one
+        // instanced draw, its instances being read from "instanceBuffer" at "firstInstance". The other batches are drawn
+        // one command at a time.
+        struct DrawBatch
+        {
+            size_t begin, end; // The range of the batch in the render queue
+            size_t firstInstance;
+        };
+        static constexpr size_t NOT_INSTANCED = ~size_t(0);
+        std::vector<DrawBatch> opaqueBatches;
+        std::vector<InstanceData> instanceData;
+        GLuint instanceBuffer = 0;
+        size_t instancingThreshold = 4;
         // This vector will store all the light components in the world
         std::vector<LightComponent *> lightCommands;
+        // The lights are packed once per frame into this uniform buffer, which every lit draw reads
+        LightBlock lightBlock;
+        GLuint lightBuffer = 0;
+        // The camera and the model matrices of the commands drawn one at a time are written to this ring once per frame
+        // when their shader reads them from the "Frame" and "Draw" blocks (see "ShaderProgram::readsDrawBlock"). A draw
+        // then binds its block instead of setting each matrix as a uniform.
+        UniformRing drawRing;
+        static constexpr size_t NO_DRAW_BLOCK = ~size_t(0);
+        // The material set up by the last command, the next commands of the same material skip its setup
+        const Material *currentMaterial = nullptr;
         // Objects used for rendering a skybox
         Mesh *skySphere;
         TexturedMaterial *skyMaterial;
@@ -76,6 +171,17 @@ namespace our
         GLuint textVAO, textVBO;
         ShaderProgram *textShader;
 
+        // Packs the lights of the frame into the light buffer and binds it to LIGHTS_BLOCK_BINDING
+        void uploadLights();
+        // Sends the camera and the model matrices to the shader of a lit material (the lights come from the light buffer)
+        void setupLighting(ShaderProgram *shader, const RenderCommand &command, const glm::vec3 &eye, const glm::mat4 &VP);
+        // Writes the frame block and the draw blocks of the commands drawn one at a time to the uniform ring
+        void uploadDrawBlocks(size_t firstTransparent, const glm::vec3 &eye, const glm::mat4 &VP);
+        // Draws one command
+        void drawCommand(const RenderCommand &command, const glm::vec3 &eye, const glm::mat4 &VP);
+        // Splits the opaque part of the render queue into batches and uploads the instances of the instanced ones
+        void batchOpaqueCommands(size_t firstTransparent);
+
         // Helper methods for text rendering
         void initializeTextRendering();
         void loadFont(const std::string &fontPath);
@@ -97,6 +203,9 @@ namespace our
         // Text rendering methods
         void renderText(const std::string &text, float x, float y, float scale, const glm::vec3 &color);
         void renderTextCentered(const std::string &text, float x, float y, float scale, const glm::vec3 &color);
+
+        // Returns the BVH of the static mesh renderers (it can serve picks and proximity queries, up to date as of the last frame)
+        StaticScene &getStaticScene() { return staticScene; }
     };
 
 }
\ No newline at end of file
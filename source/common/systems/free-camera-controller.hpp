@@ -3,6 +3,7 @@
 #include "../ecs/world.hpp"
 #include "../components/camera.hpp"
 #include "../components/free-camera-controller.hpp"
+#include "../ecs/scheduler.hpp"
 
 #include "../application.hpp"
 
@@ -23,6 +24,13 @@ namespace our
         bool mouse_locked = false; // Is the mouse locked
 
     public:
+        // The controller reads the input and writes the camera and its transform
+        // NOTE: It must run on the main thread since it locks/unlocks the mouse through GLFW
+        static SystemAccess getAccess()
+        {
+            return SystemAccess().read<FreeCameraControllerComponent, Keyboard, Mouse>().write<CameraComponent, Transform>();
+        }
+
         // When a state enters, it should call this function and give it the pointer to the application
         void enter(Application *app)
         {
@@ -33,15 +41,14 @@ namespace our
         void update(World *world, float deltaTime)
         {
             // First of all, we search for an entity containing both a CameraComponent and a FreeCameraControllerComponent
-            // As soon as we find one, we break
+            // As soon as we find one, we break (the view only visits the entities holding both)
             CameraComponent *camera = nullptr;
             FreeCameraControllerComponent *controller = nullptr;
-            for (auto entity : world->getEntities())
+            for (auto [entity, entityCamera, entityController] : world->view<CameraComponent, FreeCameraControllerComponent>())
             {
-                camera = entity->getComponent<CameraComponent>();
-                controller = entity->getComponent<FreeCameraControllerComponent>();
-                if (camera && controller)
-                    break;
+                camera = entityCamera;
+                controller = entityController;
+                break;
             }
             // If there is no entity with both a CameraComponent and a FreeCameraControllerComponent, we can do nothing so we return
             if (!(camera && controller))
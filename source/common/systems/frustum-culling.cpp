@@ -0,0 +1,100 @@
+#include "frustum-culling.hpp"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OUR_CULLING_KERNEL_SSE2
+#endif
+
+namespace our {
+
+    Frustum Frustum::fromViewProjection(const glm::mat4& VP) {
+        // glm is column major, so the row "i" of VP is (VP[0][i], VP[1][i], VP[2][i], VP[3][i])
+        glm::vec4 rows[4];
+        for(int row = 0; row < 4; row++) rows[row] = glm::vec4(VP[0][row], VP[1][row], VP[2][row], VP[3][row]);
+        Frustum frustum;
+        frustum.planes[0] = rows[3] + rows[0]; // Left
+        frustum.planes[1] = rows[3] - rows[0]; // Right
+        frustum.planes[2] = rows[3] + rows[1]; // Bottom
+        frustum.planes[3] = rows[3] - rows[1]; // Top
+        frustum.planes[4] = rows[3] + rows[2]; // Near
+        frustum.planes[5] = rows[3] - rows[2]; // Far
+        // The planes are normalized so that the box tests compare distances
+        for(auto& plane : frustum.planes) {
+            float length = glm::length(glm::vec3(plane));
+            if(length > 0.0f) plane /= length;
+        }
+        return frustum;
+    }
+
+    CullBox transformBounds(const MeshBounds& bounds, const glm::mat4& M) {
+        glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+        glm::vec3 extents = (bounds.max - bounds.min) * 0.5f;
+        glm::mat3 linear(M);
+        glm::mat3 absolute(glm::abs(linear[0]), glm::abs(linear[1]), glm::abs(linear[2]));
+        return { glm::vec3(M * glm::vec4(center, 1.0f)), absolute * extents };
+    }
+
+    void cullBoxesScalar(const Frustum& frustum, const CullBox* boxes, size_t count, char* visible) {
+        for(size_t index = 0; index < count; index++) {
+            const CullBox& box = boxes[index];
+            for(const auto& plane : frustum.planes) {
+                glm::vec3 normal(plane);
+                float distance = glm::dot(normal, box.center) + plane.w;
+                float radius = glm::dot(glm::abs(normal), box.extents);
+                if(distance + radius < 0.0f) {
+                    visible[index] = 0;
+                    break;
+                }
+            }
+        }
+    }
+
+#if defined(OUR_CULLING_KERNEL_SSE2)
+
+    void cullBoxes(const Frustum& frustum, const CullBox* boxes, size_t count, char* visible) {
+        size_t index = 0;
+        for(; index + 4 <= count; index += 4) {
+            // The 4 boxes are transposed so each register holds one coordinate of all of them
+            const CullBox* box = boxes + index;
+            __m128 cx = _mm_setr_ps(box[0].center.x, box[1].center.x, box[2].center.x, box[3].center.x);
+            __m128 cy = _mm_setr_ps(box[0].center.y, box[1].center.y, box[2].center.y, box[3].center.y);
+            __m128 cz = _mm_setr_ps(box[0].center.z, box[1].center.z, box[2].center.z, box[3].center.z);
+            __m128 ex = _mm_setr_ps(box[0].extents.x, box[1].extents.x, box[2].extents.x, box[3].extents.x);
+            __m128 ey = _mm_setr_ps(box[0].extents.y, box[1].extents.y, box[2].extents.y, box[3].extents.y);
+            __m128 ez = _mm_setr_ps(box[0].extents.z, box[1].extents.z, box[2].extents.z, box[3].extents.z);
+            __m128 outside = _mm_setzero_ps();
+            for(const auto& plane : frustum.planes) {
+                // The sums are in the same order as the scalar version so both give the same answers
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), cx), _mm_mul_ps(_mm_set1_ps(plane.y), cy)),
+                                                        _mm_mul_ps(_mm_set1_ps(plane.z), cz)), _mm_set1_ps(plane.w));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(plane.x)), ex), _mm_mul_ps(_mm_set1_ps(std::abs(plane.y)), ey)),
+                                           _mm_mul_ps(_mm_set1_ps(std::abs(plane.z)), ez));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+            }
+            int mask = _mm_movemask_ps(outside);
+            for(int lane = 0; lane < 4; lane++)
+                if(mask & (1 << lane)) visible[index + lane] = 0;
+        }
+        // The remainder (less than a full register) is done using the scalar version
+        cullBoxesScalar(frustum, boxes + index, count - index, visible + index);
+    }
+
+    const char* getCullingKernelName() {
+        return "SSE2";
+    }
+
+#else
+
+    void cullBoxes(const Frustum& frustum, const CullBox* boxes, size_t count, char* visible) {
+        cullBoxesScalar(frustum, boxes, count, visible);
+    }
+
+    const char* getCullingKernelName() {
+        return "Scalar";
+    }
+
+#endif
+
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../mesh/mesh.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+namespace our {
+
+    // An axis aligned box given by its center and its half size (the form the plane tests need)
+    struct CullBox {
+        glm::vec3 center;
+        glm::vec3 extents;
+    };
+
+    // The 6 planes of a view frustum. Each plane is (normal, distance) with a unit normal pointing inside the frustum,
+    // so a point p is inside a plane if dot(normal, p) + distance >= 0.
+    struct Frustum {
+        glm::vec4 planes[6];
+
+        // Extracts the planes from a view projection matrix (the frustum is then in world space).
+        // The planes are the rows of the clip space inequalities: -w <= x, y, z <= w.
+        static Frustum fromViewProjection(const glm::mat4& VP);
+    };
+
+    // Returns the world space box enclosing the local box of the mesh bounds after the transformation "M"
+    // (its extents are the local extents through the absolute value of the linear part of "M")
+    CullBox transformBounds(const MeshBounds& bounds, const glm::mat4& M);
+
+    // Clears "visible[i]" for each box "boxes[i]" that is entirely outside one of the planes of the frustum (the others
+    // are left as they were). The test is conservative: a box near a corner of the frustum may be kept while outside.
+    // The kernel tests 4 boxes per step using SSE2, on other architectures it falls back to the scalar version below.
+    void cullBoxes(const Frustum& frustum, const CullBox* boxes, size_t count, char* visible);
+
+    // The scalar version of "cullBoxes" (used for the remainder of the batch and on non x86 architectures)
+    void cullBoxesScalar(const Frustum& frustum, const CullBox* boxes, size_t count, char* visible);
+
+    // Returns the name of the instruction set used by "cullBoxes" ("SSE2" or "Scalar")
+    const char* getCullingKernelName();
+
+}
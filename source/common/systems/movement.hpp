@@ -2,6 +2,8 @@
 
 #include "../ecs/world.hpp"
 #include "../components/movement.hpp"
+#include "../ecs/scheduler.hpp"
+#include "update-lod.hpp"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
@@ -16,24 +18,36 @@ namespace our
     // For more information, see "common/components/movement.hpp"
     class MovementSystem
     {
+        UpdateLOD<MovementComponent> lod; // The far entities move less often (by bigger steps)
+
     public:
+        // The movement system reads the velocities (and the camera and the cached transforms for the update LOD) and writes the transforms
+        static SystemAccess getAccess()
+        {
+            return SystemAccess().read<MovementComponent, CameraComponent, TransformNode>().write<Transform>();
+        }
+
+        // Reads the update LOD tiers (see "UpdateTiers::deserialize"). Without tiers, every entity moves every frame.
+        void configure(const nlohmann::json &config)
+        {
+            lod.deserialize(config);
+        }
+
         // This should be called every frame to update all entities containing a MovementComponent.
         void update(World *world, float deltaTime)
         {
-            // For each entity in the world
-            for (auto entity : world->getEntities())
+            // For each movement component due in this frame (with the time since it last moved)
+            for (auto [movement, elapsed] : lod.collect(world, deltaTime))
             {
-                // Get the movement component if it exists
-                MovementComponent *movement = entity->getComponent<MovementComponent>();
-                // If the movement component exists
-                if (movement)
-                {
-                    // Change the position and rotation based on the linear & angular velocity and delta time.
-                    entity->localTransform.position += deltaTime * movement->linearVelocity;
-                    entity->localTransform.rotation += deltaTime * movement->angularVelocity;
-                }
+                Entity *entity = movement->getOwner();
+                // Change the position and rotation based on the linear & angular velocity and delta time.
+                entity->localTransform.position += elapsed * movement->linearVelocity;
+                entity->localTransform.rotation += elapsed * movement->angularVelocity;
             }
         }
+
+        // Returns the number of entities moved in the last update
+        size_t getUpdatedCount() const { return lod.getUpdatedCount(); }
     };
 
 }
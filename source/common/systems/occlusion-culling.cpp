@@ -0,0 +1,303 @@
+#include "occlusion-culling.hpp"
+#include "../jobs/job-system.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OUR_OCCLUSION_KERNEL_SSE2
+#endif
+
+namespace our {
+
+    namespace {
+        constexpr float FLOAT_INFINITY = std::numeric_limits<float>::infinity();
+        // The triangles reaching farther than this many pixels out of the screen are skipped, since the float rounding
+        // of their edges could exceed the margin kept by the coverage test
+        constexpr double GUARD_BAND = 4096.0;
+        // Beyond a silhouette edge, a bit more than half a pixel is asked of the pixel centers to absorb the rounding.
+        // The neighbours overlap a little across their shared edges so the rounding leaves no cracks between them.
+        constexpr double SILHOUETTE_MARGIN = 0.5 + 2e-3;
+        constexpr double SHARED_EDGE_MARGIN = -1e-3;
+        // The vertices and the triangles are projected by chunks of this size on the job system
+        constexpr size_t ITEM_CHUNK_SIZE = 1024;
+    }
+
+    void OcclusionBuffer::resize(int width, int height) {
+        this->width = (std::max(width, 4) + 3) & ~3;
+        this->height = std::max(height, 1);
+        tilesX = (this->width + TILE_WIDTH - 1) / TILE_WIDTH;
+        tilesY = (this->height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+        depth.assign(size_t(this->width) * this->height, FLOAT_INFINITY);
+        tileMaxDepth.assign(size_t(tilesX) * tilesY, FLOAT_INFINITY);
+        bins.resize(size_t(tilesX) * tilesY);
+    }
+
+    void OcclusionBuffer::begin(const glm::mat4& VP) {
+        if(width == 0) resize(256, 128);
+        this->VP = VP;
+        occluders.clear();
+        vertices.clear();
+        triangles.clear();
+        drawnTriangles = 0;
+        std::fill(depth.begin(), depth.end(), FLOAT_INFINITY);
+        std::fill(tileMaxDepth.begin(), tileMaxDepth.end(), FLOAT_INFINITY);
+    }
+
+    void OcclusionBuffer::addOccluder(const OccluderGeometry& geometry, const glm::mat4& localToWorld) {
+        size_t triangleCount = geometry.elements.size() / 3;
+        if(triangleCount == 0) return;
+        occluders.push_back({&geometry, VP * localToWorld, vertices.size(), triangles.size()});
+        vertices.resize(vertices.size() + geometry.positions.size());
+        triangles.resize(triangles.size() + triangleCount);
+    }
+
+    void OcclusionBuffer::projectTriangle(const glm::dvec4& a, const glm::dvec4& b, const glm::dvec4& c, Triangle& triangle) const {
+        triangle.minX = triangle.maxX = triangle.minY = triangle.maxY = 0;
+        triangle.facing = 0;
+        // A vertex behind the near plane can't be projected, the triangle is skipped
+        if(a.w == 0.0 || b.w == 0.0 || c.w == 0.0) return;
+        // The setup is done in double precision since the edges are found from differences of screen positions
+        glm::dvec3 screen[3] = {glm::dvec3(a), glm::dvec3(b), glm::dvec3(c)};
+        double area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+        if(!(area != 0.0)) return;
+        // Both sides are drawn, so the vertices are put in counter clockwise order (the edges 0 and 2 trade places)
+        triangle.facing = area > 0.0 ? 1 : -1;
+        if(area < 0.0) {
+            std::swap(screen[1], screen[2]);
+            area = -area;
+        }
+
+        // The edge from "from" to "to" is positive on the side of the triangle
+        for(int edge = 0; edge < 3; edge++) {
+            const glm::dvec3& from = screen[edge];
+            const glm::dvec3& to = screen[(edge + 1) % 3];
+            double edgeA = from.y - to.y, edgeB = to.x - from.x;
+            triangle.edgeA[edge] = float(edgeA);
+            triangle.edgeB[edge] = float(edgeB);
+            triangle.edgeC[edge] = float(-(edgeA * from.x + edgeB * from.y));
+        }
+        glm::dvec3 side1 = screen[1] - screen[0], side2 = screen[2] - screen[0];
+        double depthX = (side1.z * side2.y - side2.z * side1.y) / area;
+        double depthY = (side2.z * side1.x - side1.z * side2.x) / area;
+        triangle.depthX = float(depthX);
+        triangle.depthY = float(depthY);
+        triangle.planeDepthC = float(screen[0].z - depthX * screen[0].x - depthY * screen[0].y);
+        triangle.farthestVertex = float(std::max({screen[0].z, screen[1].z, screen[2].z}));
+
+        glm::dvec3 lower = glm::min(glm::min(screen[0], screen[1]), screen[2]);
+        glm::dvec3 upper = glm::max(glm::max(screen[0], screen[1]), screen[2]);
+        triangle.minX = std::max(0, int(std::floor(lower.x)));
+        triangle.minY = std::max(0, int(std::floor(lower.y)));
+        triangle.maxX = std::min(width, int(std::ceil(upper.x)));
+        triangle.maxY = std::min(height, int(std::ceil(upper.y)));
+        if(triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY)
+            triangle.minX = triangle.maxX = triangle.minY = triangle.maxY = 0;
+    }
+
+    void OcclusionBuffer::finishTriangle(const Occluder& occluder, size_t index) {
+        Triangle& triangle = triangles[index];
+        if(triangle.minX >= triangle.maxX) return;
+        const std::int32_t* neighbours = occluder.geometry->neighbours.data() + (index - occluder.firstTriangle) * 3;
+        float slopeX = std::abs(triangle.depthX), slopeY = std::abs(triangle.depthY);
+        float farthest = triangle.farthestVertex;
+        for(int edge = 0; edge < 3; edge++) {
+            // The edges of a clockwise triangle were reordered by the projection
+            std::int32_t neighbour = neighbours[triangle.facing > 0 ? edge : 2 - edge];
+            const Triangle* other = neighbour >= 0 ? &triangles[occluder.firstTriangle + neighbour] : nullptr;
+            bool shared = other && other->facing == triangle.facing;
+            // A pixel lies entirely on the inner side of an edge if its center is farther from the edge than its
+            // farthest corner, which is half a pixel away along each axis
+            double size = std::abs(double(triangle.edgeA[edge])) + std::abs(double(triangle.edgeB[edge]));
+            triangle.edgeMargin[edge] = float((shared ? SHARED_EDGE_MARGIN : SILHOUETTE_MARGIN) * size);
+            if(shared) {
+                // The part of the pixel beyond the edge belongs to the neighbour
+                slopeX = std::max(slopeX, std::abs(other->depthX));
+                slopeY = std::max(slopeY, std::abs(other->depthY));
+                farthest = std::max(farthest, other->farthestVertex);
+            }
+        }
+        // The plane is raised by the most the depth grows within half a pixel of the center
+        triangle.depthC = triangle.planeDepthC + 0.5f * (slopeX + slopeY);
+        triangle.maxDepth = farthest;
+    }
+
+    template<typename Body>
+    void OcclusionBuffer::forEachItem(bool parallel, size_t count, size_t Occluder::*first, Body body) {
+        auto chunk = [this, first, &body](size_t begin, size_t end) {
+            // The occluder holding the first item of the chunk (an occluder can be split between chunks)
+            auto occluder = std::upper_bound(occluders.begin(), occluders.end(), begin,
+                                             [first](size_t item, const Occluder& next) { return item < next.*first; }) - 1;
+            for(size_t index = begin; index < end; index++) {
+                while(occluder + 1 != occluders.end() && index >= (*(occluder + 1)).*first) ++occluder;
+                body(*occluder, index);
+            }
+        };
+        if(parallel) JobSystem::get().parallelFor(count, chunk, ITEM_CHUNK_SIZE);
+        else chunk(0, count);
+    }
+
+    void OcclusionBuffer::rasterizeTile(int tile) {
+        int tileX = (tile % tilesX) * TILE_WIDTH, tileY = (tile / tilesX) * TILE_HEIGHT;
+        int tileEndX = std::min(width, tileX + TILE_WIDTH), tileEndY = std::min(height, tileY + TILE_HEIGHT);
+        for(std::uint32_t index : bins[tile]) {
+            const Triangle& triangle = triangles[index];
+            int startX = std::max(triangle.minX, tileX), endX = std::min(triangle.maxX, tileEndX);
+            int startY = std::max(triangle.minY, tileY), endY = std::min(triangle.maxY, tileEndY);
+#if defined(OUR_OCCLUSION_KERNEL_SSE2)
+            // The rows start on a group of 4 pixels (the pixels of the group outside the triangle fail the edge tests)
+            startX &= ~3;
+            const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            __m128 edgeA[3], margin[3];
+            for(int edge = 0; edge < 3; edge++) {
+                edgeA[edge] = _mm_set1_ps(triangle.edgeA[edge]);
+                margin[edge] = _mm_set1_ps(triangle.edgeMargin[edge]);
+            }
+            __m128 depthX = _mm_set1_ps(triangle.depthX), maxDepth = _mm_set1_ps(triangle.maxDepth);
+#endif
+            for(int y = startY; y < endY; y++) {
+                float centerY = float(y) + 0.5f;
+                float rowEdge[3];
+                for(int edge = 0; edge < 3; edge++) rowEdge[edge] = triangle.edgeB[edge] * centerY + triangle.edgeC[edge];
+                float rowDepth = triangle.depthY * centerY + triangle.depthC;
+                float* row = depth.data() + size_t(y) * width;
+#if defined(OUR_OCCLUSION_KERNEL_SSE2)
+                for(int x = startX; x < endX; x += 4) {
+                    __m128 centerX = _mm_add_ps(_mm_set1_ps(float(x)), pixelOffsets);
+                    __m128 covered = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], centerX), _mm_set1_ps(rowEdge[0])), margin[0]);
+                    covered = _mm_and_ps(covered, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], centerX), _mm_set1_ps(rowEdge[1])), margin[1]));
+                    covered = _mm_and_ps(covered, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], centerX), _mm_set1_ps(rowEdge[2])), margin[2]));
+                    if(_mm_movemask_ps(covered) == 0) continue;
+                    __m128 pixelDepth = _mm_min_ps(_mm_add_ps(_mm_mul_ps(depthX, centerX), _mm_set1_ps(rowDepth)), maxDepth);
+                    __m128 current = _mm_loadu_ps(row + x);
+                    __m128 nearest = _mm_min_ps(current, pixelDepth);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(covered, nearest), _mm_andnot_ps(covered, current)));
+                }
+#else
+                for(int x = startX; x < endX; x++) {
+                    float centerX = float(x) + 0.5f;
+                    bool covered = true;
+                    for(int edge = 0; edge < 3; edge++)
+                        covered = covered && triangle.edgeA[edge] * centerX + rowEdge[edge] >= triangle.edgeMargin[edge];
+                    if(covered) row[x] = std::min(row[x], std::min(triangle.depthX * centerX + rowDepth, triangle.maxDepth));
+                }
+#endif
+            }
+        }
+        // The farthest depth of the tile
+        float farthest = 0.0f;
+        for(int y = tileY; y < tileEndY; y++) {
+            const float* row = depth.data() + size_t(y) * width;
+            farthest = std::max(farthest, *std::max_element(row + tileX, row + tileEndX));
+        }
+        tileMaxDepth[tile] = farthest;
+    }
+
+    bool OcclusionBuffer::isVisible(const CullBox& box) const {
+        // The corners of the box are projected, it covers the pixels of their screen rectangle from their nearest depth
+        glm::vec2 lower(FLOAT_INFINITY), upper(-FLOAT_INFINITY);
+        float nearestDepth = FLOAT_INFINITY;
+        // The projection is linear before the division, so the corners are the projected center plus or minus the projected extents
+        glm::vec4 center = VP * glm::vec4(box.center, 1.0f);
+        glm::vec4 axes[3] = {VP[0] * box.extents.x, VP[1] * box.extents.y, VP[2] * box.extents.z};
+        for(int corner = 0; corner < 8; corner++) {
+            glm::vec4 clip = center + ((corner & 1) ? axes[0] : -axes[0]) + ((corner & 2) ? axes[1] : -axes[1]) + ((corner & 4) ? axes[2] : -axes[2]);
+            // A box reaching the near plane may cover any part of the screen
+            if(!(clip.w > 0.0f) || clip.z < -clip.w) return true;
+            float inverseW = 1.0f / clip.w;
+            glm::vec2 screen((clip.x * inverseW * 0.5f + 0.5f) * width, (clip.y * inverseW * 0.5f + 0.5f) * height);
+            lower = glm::min(lower, screen);
+            upper = glm::max(upper, screen);
+            nearestDepth = std::min(nearestDepth, clip.z * inverseW * 0.5f + 0.5f);
+        }
+        // The rectangle is clamped to the screen before leaving the floats (the corners near the eye project very far)
+        int startX = int(std::max(0.0f, std::floor(lower.x))), endX = int(std::min(float(width), std::ceil(upper.x)));
+        int startY = int(std::max(0.0f, std::floor(lower.y))), endY = int(std::min(float(height), std::ceil(upper.y)));
+        // A box out of the screen is left to the frustum culling
+        if(startX >= endX || startY >= endY) return true;
+
+        // First, the box is hidden if it is behind the farthest depth of all the tiles it covers
+        bool behindTiles = true;
+        for(int tileY = startY / TILE_HEIGHT; tileY <= (endY - 1) / TILE_HEIGHT && behindTiles; tileY++)
+            for(int tileX = startX / TILE_WIDTH; tileX <= (endX - 1) / TILE_WIDTH && behindTiles; tileX++)
+                behindTiles = tileMaxDepth[size_t(tileY) * tilesX + tileX] < nearestDepth;
+        if(behindTiles) return false;
+
+        // Otherwise, the box is visible as soon as one of its pixels is not in front of it
+        for(int y = startY; y < endY; y++) {
+            const float* row = depth.data() + size_t(y) * width;
+            int x = startX;
+#if defined(OUR_OCCLUSION_KERNEL_SSE2)
+            __m128 boxDepth = _mm_set1_ps(nearestDepth);
+            for(; x + 4 <= endX; x += 4)
+                if(_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth)) != 0) return true;
+#endif
+            for(; x < endX; x++)
+                if(row[x] >= nearestDepth) return true;
+        }
+        return false;
+    }
+
+    const char* getOcclusionKernelName() {
+#if defined(OUR_OCCLUSION_KERNEL_SSE2)
+        return "SSE2";
+#else
+        return "Scalar";
+#endif
+    }
+
+    void OcclusionBuffer::rasterize(bool parallel) {
+        // First, the vertices are projected, then each triangle is set up in its own slot and looks at its neighbours
+        forEachItem(parallel, vertices.size(), &Occluder::firstVertex, [this](const Occluder& occluder, size_t index) {
+            glm::vec4 clip = occluder.MVP * glm::vec4(occluder.geometry->positions[index - occluder.firstVertex], 1.0f);
+            glm::dvec4& vertex = vertices[index];
+            if(!(clip.w > 0.0f) || clip.z < -clip.w) {
+                vertex = glm::dvec4(0.0);
+                return;
+            }
+            double inverseW = 1.0 / clip.w;
+            vertex = glm::dvec4((clip.x * inverseW * 0.5 + 0.5) * width, (clip.y * inverseW * 0.5 + 0.5) * height, clip.z * inverseW * 0.5 + 0.5, 1.0);
+            // The vertices far out of the screen are treated as if they were behind the near plane
+            if(std::abs(vertex.x) > GUARD_BAND || std::abs(vertex.y) > GUARD_BAND) vertex.w = 0.0;
+        });
+        forEachItem(parallel, triangles.size(), &Occluder::firstTriangle, [this](const Occluder& occluder, size_t index) {
+            const unsigned int* element = occluder.geometry->elements.data() + (index - occluder.firstTriangle) * 3;
+            const glm::dvec4* projected = vertices.data() + occluder.firstVertex;
+            projectTriangle(projected[element[0]], projected[element[1]], projected[element[2]], triangles[index]);
+        });
+        forEachItem(parallel, triangles.size(), &Occluder::firstTriangle, [this](const Occluder& occluder, size_t index) {
+            finishTriangle(occluder, index);
+        });
+
+        // Then the triangles are listed in the tiles they touch, in order, so each tile draws them in the same order every run
+        for(auto& bin : bins) bin.clear();
+        drawnTriangles = 0;
+        for(size_t index = 0; index < triangles.size(); index++) {
+            const Triangle& triangle = triangles[index];
+            if(triangle.minX >= triangle.maxX) continue;
+            drawnTriangles++;
+            for(int tileY = triangle.minY / TILE_HEIGHT; tileY <= (triangle.maxY - 1) / TILE_HEIGHT; tileY++)
+                for(int tileX = triangle.minX / TILE_WIDTH; tileX <= (triangle.maxX - 1) / TILE_WIDTH; tileX++)
+                    bins[size_t(tileY) * tilesX + tileX].push_back(std::uint32_t(index));
+        }
+
+        // Finally, the tiles are filled (each by one job)
+        int tileCount = tilesX * tilesY;
+        if(parallel) {
+            JobSystem::get().parallelFor(size_t(tileCount), [this](size_t begin, size_t end) {
+                for(size_t tile = begin; tile < end; tile++) rasterizeTile(int(tile));
+            });
+        } else {
+            for(int tile = 0; tile < tileCount; tile++) rasterizeTile(tile);
+        }
+    }
+
+    void OcclusionBuffer::cullBoxes(const CullBox* boxes, size_t count, char* visible) const {
+        for(size_t index = 0; index < count; index++)
+            if(visible[index] && !isVisible(boxes[index])) visible[index] = 0;
+    }
+
+}
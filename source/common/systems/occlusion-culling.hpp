@@ -0,0 +1,117 @@
+#pragma once
+
+#include "frustum-culling.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace our {
+
+    // A small depth buffer the CPU fills with the triangles of a few large meshes (the occluders: the track, the hills, the
+    // walls) so the renderer can drop the objects hidden behind them before submitting their draws. It needs no GPU.
+    // A frame goes through 3 steps:
+    // - "begin" takes the view projection matrix of the camera and empties the buffer.
+    // - "addOccluder" lists the triangles of an occluder (they are not copied, they must live until "rasterize" returns).
+    // - "rasterize" projects the triangles, sorts them into the screen tiles they touch, then fills the tiles in parallel
+    //   on the job system. Each tile is only written by one job and a pixel keeps the nearest depth written to it, so the
+    //   result does not depend on the number of threads or on the order in which the jobs run.
+    // Then "isVisible" tests the boxes of the objects against the buffer: a box is hidden if its nearest corner is behind
+    // the occluders over all the pixels its screen rectangle covers.
+    // At this low resolution, an object peeking over a hill by less than a pixel of the buffer is still a lot of pixels on
+    // the screen, so a triangle only writes a pixel if the occluder covers all of it:
+    // - Across an edge shared with a neighbour facing the same way, the two triangles cover the pixel together, so a
+    //   triangle writes the pixels whose center it covers (like the GPU does).
+    // - Across a silhouette edge (on the border of the mesh or where the surface folds away from the camera), it only
+    //   writes the pixels lying entirely on its side.
+    // The depth written is the farthest the triangle and these neighbours reach within the pixel. The triangles crossing the
+    // near plane are skipped. Both sides of the triangles are rasterized, so the occluders needn't be closed but they must
+    // be opaque.
+    // The pixels are rasterized and tested 4 at a time using SSE2, on other architectures it falls back to scalar code.
+    class OcclusionBuffer {
+    public:
+        // The size of a tile in pixels (the width of the buffer is rounded up to a multiple of 4 so a row of a tile is
+        // made of whole groups of 4 pixels)
+        static constexpr int TILE_WIDTH = 32, TILE_HEIGHT = 16;
+
+    private:
+        // A triangle ready to be rasterized. A pixel is covered if "edgeA[i] * x + edgeB[i] * y + edgeC[i]" is at least
+        // "edgeMargin[i]" at its center (x, y) for the 3 edges. Its depth there is at most "depthX * x + depthY * y + depthC"
+        // (the plane of the triangle raised to its farthest value over the pixel) and "maxDepth". The pixels
+        // "[minX, maxX) x [minY, maxY)" enclose it, they are empty for a triangle that is not drawn.
+        struct Triangle {
+            float edgeA[3], edgeB[3], edgeC[3], edgeMargin[3];
+            float depthX, depthY, depthC, maxDepth;
+            int minX, minY, maxX, maxY;
+            // Found by the projection for the neighbours: the side facing the screen (1 for counter clockwise, -1 for
+            // clockwise, 0 if the triangle is not drawn), the depth plane through the pixel centers and the farthest vertex
+            int facing;
+            float planeDepthC, farthestVertex;
+        };
+        // The triangles given by "addOccluder"
+        struct Occluder {
+            const OccluderGeometry* geometry;
+            glm::mat4 MVP; // From its local space to the clip space of the camera
+            size_t firstVertex, firstTriangle; // Its first slots in "vertices" and "triangles"
+        };
+        int width = 0, height = 0;
+        int tilesX = 0, tilesY = 0;
+        // The depth of each pixel (row by row from the bottom of the screen) in the [0, 1] range of the depth buffer.
+        // The pixels without occluders are at infinity, so nothing is hidden by an empty buffer.
+        std::vector<float> depth;
+        // The farthest depth of each tile (it lets the box test skip the tiles that cannot hide anything)
+        std::vector<float> tileMaxDepth;
+        glm::mat4 VP = glm::mat4(1.0f);
+        std::vector<Occluder> occluders;
+        // The screen position and the depth of the vertices of the occluders (w is 0 for a vertex behind the near plane)
+        std::vector<glm::dvec4> vertices;
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<std::uint32_t>> bins; // The triangles touching each tile
+        size_t drawnTriangles = 0;
+
+        // Finds the screen edges and the depth plane of a triangle from its projected vertices (it is left empty if it
+        // can't be drawn)
+        void projectTriangle(const glm::dvec4& a, const glm::dvec4& b, const glm::dvec4& c, Triangle& triangle) const;
+        // Picks the margin of each edge and the depth bounds once the neighbours of the triangle are projected
+        void finishTriangle(const Occluder& occluder, size_t index);
+        // Calls "body(occluder, index)" on the items "[0, count)" where the items of an occluder start at "occluder.*first"
+        // (its vertices or its triangles), using the job system if "parallel" is set
+        template<typename Body>
+        void forEachItem(bool parallel, size_t count, size_t Occluder::*first, Body body);
+        void rasterizeTile(int tile);
+
+    public:
+        // Sets the resolution of the buffer (the width is rounded up to a multiple of 4 and the buffer is cleared)
+        void resize(int width, int height);
+        // Starts a new frame seen through the given view projection matrix (the buffer is cleared and the occluders are forgotten)
+        void begin(const glm::mat4& VP);
+        // Adds the triangles of an occluder placed in the world by "localToWorld"
+        void addOccluder(const OccluderGeometry& geometry, const glm::mat4& localToWorld);
+        // Adds the triangles kept by an occluder mesh (see "Mesh::isOccluder")
+        void addOccluder(const Mesh& mesh, const glm::mat4& localToWorld) { addOccluder(mesh.getOccluderGeometry(), localToWorld); }
+        // Fills the buffer with the occluders. "parallel" can be turned off to use the calling thread alone.
+        void rasterize(bool parallel = true);
+
+        // Returns false if the box is certainly hidden by the occluders
+        bool isVisible(const CullBox& box) const;
+        // Clears "visible[i]" for each box "boxes[i]" that is hidden (the others are left as they were)
+        void cullBoxes(const CullBox* boxes, size_t count, char* visible) const;
+
+        int getWidth() const { return width; }
+        int getHeight() const { return height; }
+        // Returns the depth of the pixels (row by row from the bottom of the screen, "getWidth()" per row)
+        const float* getDepth() const { return depth.data(); }
+        // Returns the number of triangles given since "begin" and how many of them were drawn (the others were facing
+        // the screen edge-on, crossing the near plane or outside the screen)
+        size_t getTriangleCount() const { return triangles.size(); }
+        size_t getDrawnTriangleCount() const { return drawnTriangles; }
+        // Returns true if "begin" was followed by at least one occluder triangle
+        bool hasOccluders() const { return !triangles.empty(); }
+    };
+
+    // Returns the name of the instruction set used to rasterize and test the pixels ("SSE2" or "Scalar")
+    const char* getOcclusionKernelName();
+
+}
@@ -55,20 +55,30 @@ namespace our
         std::cout << "Race System: Sound system reference set" << std::endl;
     }
 
+    SystemAccess RaceSystem::getAccess()
+    {
+        return SystemAccess()
+            .read<Keyboard, Transform>()
+            .write<RaceManagerComponent, RacePlayerComponent, CheckpointComponent, soundSystem>();
+    }
+
     void RaceSystem::update(World *world, float deltaTime)
     {
         this->deltaTime = deltaTime;
+        // Forget the race manager if it was removed since the last update
+        if (raceManager)
+        {
+            for (auto entity : world->removed<RaceManagerComponent>(lastRunTick))
+                if (entity == raceManager)
+                    raceManager = nullptr;
+        }
         // Find race manager
         if (!raceManager)
         {
-            for (auto entity : world->getEntities())
+            if (world->count<RaceManagerComponent>() > 0)
             {
-                if (entity->getComponent<RaceManagerComponent>())
-                {
-                    raceManager = entity;
-                    std::cout << "Race System: Found race manager" << std::endl;
-                    break;
-                }
+                raceManager = world->getPool<RaceManagerComponent>()[0]->getOwner();
+                std::cout << "Race System: Found race manager" << std::endl;
             }
         }
 
@@ -78,21 +88,9 @@ namespace our
         auto manager = raceManager->getComponent<RaceManagerComponent>();
         if (!manager)
             return;
-        // Collect players and checkpoints
-        players.clear();
-        checkpoints.clear();
-
-        for (auto entity : world->getEntities())
-        {
-            if (entity->getComponent<RacePlayerComponent>())
-            {
-                players.push_back(entity);
-            }
-            if (entity->getComponent<CheckpointComponent>())
-            {
-                checkpoints.push_back(entity);
-            }
-        } // Debug output for first frame and initialization
+        // Collect players and checkpoints (only when they changed since the last update)
+        collectRaceEntities(world);
+        // Debug output for first frame and initialization
         if (!systemInitialized)
         {
             std::cout << "Race System: Found " << players.size() << " players and " << checkpoints.size() << " checkpoints" << std::endl;
@@ -120,20 +118,8 @@ namespace our
             startRace();
         }
 
-        // Sort checkpoints by index
-        std::sort(checkpoints.begin(), checkpoints.end(),
-                  [](Entity *a, Entity *b)
-                  {
-                      auto checkA = a->getComponent<CheckpointComponent>();
-                      auto checkB = b->getComponent<CheckpointComponent>();
-                      return checkA->checkpointIndex < checkB->checkpointIndex;
-                  });
-
         manager->totalCheckpoints = checkpoints.size();
 
-        // Update checkpoint visibility
-        updateCheckpointVisibility();
-
         // Handle race states
         switch (manager->state)
         {
@@ -261,8 +247,9 @@ namespace our
             // Play checkpoint sound
             playCheckpointSound();
 
-            // Move to next checkpoint
+            // Move to next checkpoint (the change moves the visible checkpoint on the next update)
             racePlayer->nextCheckpoint++;
+            racePlayer->markChanged();
             // Check if this was the finish line AND player has completed a full circuit
             // (nextCheckpoint will be 1 after incrementing from 0, meaning player just hit checkpoint 0)
             if (checkpoint->isFinishLine && racePlayer->nextCheckpoint == 1)
@@ -366,29 +353,66 @@ namespace our
             }
         }
     }
-    void RaceSystem::updateCheckpointVisibility()
+    void RaceSystem::collectRaceEntities(World *world)
     {
-        // Hide all checkpoints first
-        for (auto checkpoint : checkpoints)
+        Tick since = lastRunTick;
+        lastRunTick = world->getTick();
+        // The lists are only collected and sorted again when players or checkpoints were added, removed or changed
+        // (or when the changes since the last update are not all logged anymore)
+        bool rebuild = !world->hasChangeHistory(since) ||
+                       !world->added<RacePlayerComponent>(since).empty() ||
+                       !world->removed<RacePlayerComponent>(since).empty() ||
+                       !world->changed<CheckpointComponent>(since).empty() ||
+                       !world->removed<CheckpointComponent>(since).empty();
+        if (rebuild)
         {
-            auto checkpointComponent = checkpoint->getComponent<CheckpointComponent>();
-            if (checkpointComponent)
+            players.clear();
+            checkpoints.clear();
+            for (auto [entity, player] : world->view<RacePlayerComponent>())
             {
-                checkpointComponent->isVisible = false;
+                players.push_back(entity);
             }
+            for (auto [entity, checkpoint] : world->view<CheckpointComponent>())
+            {
+                checkpoints.push_back(entity);
+            }
+            // Sort checkpoints by index
+            std::sort(checkpoints.begin(), checkpoints.end(),
+                      [](Entity *a, Entity *b)
+                      {
+                          auto checkA = a->getComponent<CheckpointComponent>();
+                          auto checkB = b->getComponent<CheckpointComponent>();
+                          return checkA->checkpointIndex < checkB->checkpointIndex;
+                      });
         }
+        // The visible checkpoints only depend on the players' next checkpoints
+        if (rebuild || !world->changed<RacePlayerComponent>(since).empty())
+        {
+            updateCheckpointVisibility();
+        }
+    }
 
+    void RaceSystem::updateCheckpointVisibility()
+    {
         // Show only the next checkpoint for each player
+        visibleCheckpoints.assign(checkpoints.size(), false);
         for (auto player : players)
         {
             auto racePlayer = player->getComponent<RacePlayerComponent>();
-            if (racePlayer && racePlayer->nextCheckpoint < static_cast<int>(checkpoints.size()))
+            if (racePlayer && racePlayer->nextCheckpoint >= 0 && racePlayer->nextCheckpoint < static_cast<int>(checkpoints.size()))
             {
-                auto checkpointComponent = checkpoints[racePlayer->nextCheckpoint]->getComponent<CheckpointComponent>();
-                if (checkpointComponent)
-                {
-                    checkpointComponent->isVisible = true;
-                }
+                visibleCheckpoints[racePlayer->nextCheckpoint] = true;
+            }
+        }
+
+        // Hide the others (the flags are only written when they change)
+        for (size_t index = 0; index < checkpoints.size(); ++index)
+        {
+            auto checkpointComponent = checkpoints[index]->getComponent<CheckpointComponent>();
+            if (checkpointComponent && checkpointComponent->isVisible != visibleCheckpoints[index])
+            {
+                checkpointComponent->isVisible = visibleCheckpoints[index];
+                checkpointComponent->markChanged();
             }
         }
     }
@@ -417,82 +441,24 @@ namespace our
     }
     void RaceSystem::resetRace()
     {
-        if (raceManager)
-        {
-            auto manager = raceManager->getComponent<RaceManagerComponent>();
-            if (manager)
-            {
-                manager->state = RaceManagerComponent::RaceState::WAITING;
-                manager->raceStarted = false;
-                manager->countdownTime = 3.0f; // Reset countdown timer
-            }
-        }
+        // The world (race components, transforms and physics bodies) is put back to the start of the race by restoring
+        // the snapshot taken by the play state. It is restored after all the systems are done (see "consumeResetRequest").
+        resetRequested = true;
+
         // Reset initialization timer for proper restart behavior
         initializationTime = glfwGetTime();
         lastCountdownValue = 4; // Reset countdown display state
 
-        // Reset all players
-        for (auto player : players)
-        {
-            auto racePlayer = player->getComponent<RacePlayerComponent>();
-            if (racePlayer)
-            {
-                racePlayer->currentLap = 1;
-                racePlayer->nextCheckpoint = 1; // Start targeting checkpoint 1, not 0
-                racePlayer->raceTime = 0.0f;
-                racePlayer->currentLapTime = 0.0f;
-                racePlayer->raceCompleted = false;
-                racePlayer->position = 1;
-                racePlayer->lapTimes.clear();
-            }
-            // Reset player position to initial spawn location
-            auto rigidbody = player->getComponent<RigidbodyComponent>();
-            if (rigidbody)
-            {
-                // Use the initial spawn position stored during deserialization
-                glm::vec3 spawnPosition = rigidbody->initialPosition;
-                glm::vec3 spawnRotation = rigidbody->initialRotation;
-
-                // Reset entity transform to initial position
-                player->localTransform.position = spawnPosition;
-                player->localTransform.rotation = spawnRotation;
-
-                // Reset physics body if it exists
-                if (rigidbody->rigidbody)
-                {
-                    // Convert to Bullet's coordinate system
-                    btVector3 initialPos(spawnPosition.x, spawnPosition.y, spawnPosition.z);
-                    // Create new transform with initial position and rotation
-                    btTransform resetTransform;
-                    resetTransform.setRotation(btQuaternion(spawnRotation.x, spawnRotation.y, spawnRotation.z));
-                    resetTransform.setOrigin(initialPos);
-
-                    // Reset the rigidbody position and clear velocities
-                    rigidbody->rigidbody->setWorldTransform(resetTransform);
-                    rigidbody->rigidbody->setLinearVelocity(btVector3(0, 0, 0));
-                    rigidbody->rigidbody->setAngularVelocity(btVector3(0, 0, 0));
-                    rigidbody->rigidbody->clearForces();
-
-                    // Also update the motion state
-                    btMotionState *motionState = rigidbody->rigidbody->getMotionState();
-                    if (motionState)
-                    {
-                        motionState->setWorldTransform(resetTransform);
-                    }
-
-                    // Update the rigidbody component's position to match the initial spawn
-                    rigidbody->position = spawnPosition;
-                    rigidbody->rotation = spawnRotation;
-
-                    std::cout << "Reset player position to spawn coordinates (" << spawnPosition.x
-                              << ", " << spawnPosition.y << ", " << spawnPosition.z << ")" << std::endl;
-                }
-            }
-        }
-
         std::cout << "Race reset! Press R to start a new race." << std::endl;
     }
 
+    bool RaceSystem::consumeResetRequest()
+    {
+        bool requested = resetRequested;
+        resetRequested = false;
+        return requested;
+    }
+
     bool RaceSystem::isRaceActive() const
     {
         if (!raceManager)
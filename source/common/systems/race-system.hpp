@@ -4,6 +4,7 @@
 #include "../components/race.hpp"
 #include "../components/sound.hpp"
 #include "../application.hpp"
+#include "../ecs/scheduler.hpp"
 #include <glm/glm.hpp>
 #include <vector>
 #include <algorithm>
@@ -20,12 +21,15 @@ namespace our
         Application *app;
         Entity *raceManager;
         std::vector<Entity *> players;
-        std::vector<Entity *> checkpoints;
+        std::vector<Entity *> checkpoints;     // Sorted by checkpoint index
+        std::vector<bool> visibleCheckpoints;  // Scratch buffer of "updateCheckpointVisibility"
+        Tick lastRunTick = 0;                  // The world tick of the last update (the changes are queried since then)
         float deltaTime;
         bool systemInitialized = false;
         float initializationTime = 0.0f;
         int lastCountdownValue = 4;
         soundSystem *soundSystemRef = nullptr; // Reference to sound system
+        bool resetRequested = false;           // Set by "resetRace" till the play state restores the start of the race
 
         // Sound configuration
         struct SoundConfig {
@@ -41,6 +45,7 @@ namespace our
         void updateCountdown(RaceManagerComponent *manager, float dt);
         void checkPlayerProgress(Entity *player, RacePlayerComponent *racePlayer);
         void updateRacePositions();
+        void collectRaceEntities(World *world);
         void updateCheckpointVisibility();
         float calculateDistanceToNextCheckpoint(Entity *player, RacePlayerComponent *racePlayer);
         
@@ -54,14 +59,20 @@ namespace our
         // Set sound system reference for audio feedback
         void setSoundSystem(soundSystem *soundSys);
 
+        // The race system reads the input and the transforms, writes the race components and plays sounds
+        // (a reset is only requested here, the play state restores the start of the race at the sync point)
+        static SystemAccess getAccess();
+
         // Main update function called every frame
         void update(World *world, float deltaTime);
 
         // Start the race
         void startRace();
 
-        // Reset race to beginning
+        // Reset race to beginning (the world is restored to the start of the race at the end of the frame)
         void resetRace();
+        // Returns true (once) if the race was reset since the last call. The caller restores the world to the start of the race.
+        bool consumeResetRequest();
         // Get race statistics for display
         bool isRaceActive() const;
         bool isRaceCompleted() const;
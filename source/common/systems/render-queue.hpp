@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace our
+{
+
+    // An entry of the render queue: the sort key of a draw and the index of its render command.
+    // The queue sorts these 16-byte entries instead of the commands themselves.
+    struct RenderQueueEntry
+    {
+        std::uint64_t key;
+        std::uint32_t index;
+    };
+
+    // The sort key of a draw packs everything its order depends on, so sorting the queue is sorting integers.
+    // The opaque draws are grouped by state, the most expensive switch first, and drawn front to back within a group:
+    //      pass (2) | shader (10) | texture (10) | material (12) | mesh (12) | depth (18)
+    // The transparent draws must be drawn back to front, so the depth comes first and the state only breaks ties:
+    //      pass (2) | far-to-near depth (18) | shader (10) | texture (10) | material (12) | mesh (12)
+    // The IDs are masked to their width. Two objects sharing an ID are only interleaved, the draws stay correct.
+    enum class RenderPass : std::uint64_t
+    {
+        OPAQUE_PASS = 0,
+        TRANSPARENT_PASS = 1
+    };
+
+    constexpr int SORT_DEPTH_BITS = 18;
+    constexpr std::uint64_t SORT_DEPTH_MASK = (std::uint64_t(1) << SORT_DEPTH_BITS) - 1;
+    constexpr int SORT_PASS_SHIFT = 62;
+
+    // Returns the depth reduced to SORT_DEPTH_BITS while keeping its order. The top bits of a positive float are its
+    // exponent and the top of its mantissa, so the precision is relative to the distance (fine up close, coarse far away).
+    // The negative depths (behind the camera) become 0.
+    inline std::uint64_t quantizeSortDepth(float depth)
+    {
+        if (!(depth > 0.0f))
+            return 0;
+        std::uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return (bits >> (31 - SORT_DEPTH_BITS)) & SORT_DEPTH_MASK;
+    }
+
+    // Packs the state of a draw (the 44 bits that sit below the pass and the depth)
+    inline std::uint64_t packSortState(std::uint32_t shader, std::uint32_t texture, std::uint32_t material, std::uint32_t mesh)
+    {
+        return (std::uint64_t(shader & 0x3FF) << 34) | (std::uint64_t(texture & 0x3FF) << 24) |
+               (std::uint64_t(material & 0xFFF) << 12) | std::uint64_t(mesh & 0xFFF);
+    }
+
+    // Returns the key of an opaque draw (the depth is the distance along the camera's forward axis)
+    inline std::uint64_t makeOpaqueSortKey(std::uint32_t shader, std::uint32_t texture, std::uint32_t material, std::uint32_t mesh, float depth)
+    {
+        return (std::uint64_t(RenderPass::OPAQUE_PASS) << SORT_PASS_SHIFT) | (packSortState(shader, texture, material, mesh) << SORT_DEPTH_BITS) |
+               quantizeSortDepth(depth);
+    }
+
+    // Returns the key of a transparent draw (the depth is the distance along the camera's forward axis)
+    inline std::uint64_t makeTransparentSortKey(std::uint32_t shader, std::uint32_t texture, std::uint32_t material, std::uint32_t mesh, float depth)
+    {
+        return (std::uint64_t(RenderPass::TRANSPARENT_PASS) << SORT_PASS_SHIFT) | ((SORT_DEPTH_MASK - quantizeSortDepth(depth)) << 44) |
+               packSortState(shader, texture, material, mesh);
+    }
+
+    // Returns the pass of a sort key
+    inline RenderPass getSortPass(std::uint64_t key) { return RenderPass(key >> SORT_PASS_SHIFT); }
+
+    // Sorts the entries by ascending key (the entries with equal keys keep their order). This is an LSD radix sort on the
+    // 8 bytes of the keys. The histograms of all the bytes are counted in one read of the entries, and a byte that is the
+    // same for every key costs no pass (e.g. the pass bits when there are no transparent draws).
+    // "scratch" is a buffer that can be kept across calls to avoid reallocating it.
+    inline void radixSort(std::vector<RenderQueueEntry> &entries, std::vector<RenderQueueEntry> &scratch)
+    {
+        if (entries.size() < 2)
+            return;
+        std::array<std::array<std::uint32_t, 256>, 8> counts{};
+        for (const auto &entry : entries)
+            for (int byte = 0; byte < 8; byte++)
+                counts[byte][(entry.key >> (byte * 8)) & 0xFF]++;
+
+        scratch.resize(entries.size());
+        for (int byte = 0; byte < 8; byte++)
+        {
+            auto &count = counts[byte];
+            if (count[(entries.front().key >> (byte * 8)) & 0xFF] == entries.size())
+                continue;
+            std::uint32_t offset = 0;
+            for (auto &bucket : count)
+            {
+                std::uint32_t size = bucket;
+                bucket = offset;
+                offset += size;
+            }
+            for (const auto &entry : entries)
+                scratch[count[(entry.key >> (byte * 8)) & 0xFF]++] = entry;
+            entries.swap(scratch);
+        }
+    }
+
+}
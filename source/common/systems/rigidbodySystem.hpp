@@ -2,6 +2,7 @@
 
 #include "../ecs/world.hpp"
 #include "../components/rigidbody.hpp"
+#include "../components/tags.hpp"
 #include "../application.hpp" // Add this line to include Application type
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tinyobj/tiny_obj_loader.h>
@@ -17,6 +18,8 @@
 #include <BulletDynamics/Vehicle/btRaycastVehicle.h>
 #include "../components/movement.hpp"
 #include "race-system.hpp"
+#include "../ecs/scheduler.hpp"
+#include "update-lod.hpp"
 
 namespace our
 {
@@ -25,6 +28,7 @@ namespace our
     {
     private:
         btDiscreteDynamicsWorld *dynWorld = nullptr; // Vehicle tuning parameters loaded from config
+        UpdateLOD<RigidbodyComponent> tireLOD;       // The tires of the far vehicles are animated less often
         struct VehicleTuningConfig
         {
             // Bullet3D btVehicleTuning parameters
@@ -262,6 +266,15 @@ namespace our
     public:
         Application *app;
         RaceSystem *raceSystem = nullptr;
+
+        // The rigidbody system reads the input and the race state, then drives the vehicles and
+        // copies the physics results into the transforms (and the tire movement components)
+        static SystemAccess getAccess()
+        {
+            return SystemAccess()
+                .read<Keyboard, RaceManagerComponent, CameraComponent, TransformNode>()
+                .write<RigidbodyComponent, MovementComponent, Transform, btDiscreteDynamicsWorld>();
+        }
         void enter(btDiscreteDynamicsWorld *world, Application *app, const nlohmann::json &vehicleTuningConfig = nlohmann::json{})
         {
             this->app = app;
@@ -343,83 +356,96 @@ namespace our
                                   1.0f - 2.0f * (yy + zz));
             }
         }
+
+        // Creates the physics body of the component and adds it to the physics world
+        // If the component is controlled by input and has a non-zero mass, its raycast vehicle is created too
+        // This is called by "update" for new components, or earlier to spread the loading over several frames
+        void createBody(RigidbodyComponent *rigidbodyComponent)
+        {
+            if (rigidbodyComponent->addedToWorld)
+                return;
+            rigidbodyComponent->addedToWorld = true;
+            std::string path = "./assets/models/" + rigidbodyComponent->mesh + ".obj";
+            rigidbodyComponent->rigidbody = createRigidBody(
+                path,
+                btVector3(rigidbodyComponent->position.x, rigidbodyComponent->position.y, rigidbodyComponent->position.z),
+                btVector3(rigidbodyComponent->rotation.x, rigidbodyComponent->rotation.y, rigidbodyComponent->rotation.z),
+                rigidbodyComponent->mass, btVector3(rigidbodyComponent->scale.x, rigidbodyComponent->scale.y, rigidbodyComponent->scale.z));
+
+            // Set friction for the rigid body using config values
+            rigidbodyComponent->rigidbody->setFriction(vehicleTuning.rigidbodyFriction);
+            rigidbodyComponent->rigidbody->setRollingFriction(vehicleTuning.rigidbodyRollingFriction);
+
+            // Create the RaycastVehicle once
+            if (rigidbodyComponent->input == 1 && rigidbodyComponent->mass != 0.0f && !rigidbodyComponent->vehicle)
+            { // Vehicle tuning and setup using config values
+                btRaycastVehicle::btVehicleTuning tuning;
+                tuning.m_suspensionStiffness = vehicleTuning.suspensionStiffness;
+                tuning.m_suspensionCompression = vehicleTuning.suspensionCompression;
+                tuning.m_suspensionDamping = vehicleTuning.suspensionDamping;
+                tuning.m_maxSuspensionTravelCm = vehicleTuning.maxSuspensionTravelCm;
+                tuning.m_frictionSlip = vehicleTuning.frictionSlip;
+                tuning.m_maxSuspensionForce = vehicleTuning.maxSuspensionForce;
+
+                // Configure vehicle rigid body
+                rigidbodyComponent->rigidbody->setActivationState(DISABLE_DEACTIVATION);
+                // Add angular and linear damping using config values
+                rigidbodyComponent->rigidbody->setDamping(vehicleTuning.linearDamping, vehicleTuning.angularDamping);
+
+                btVehicleRaycaster *raycaster = new btDefaultVehicleRaycaster(dynWorld);
+                rigidbodyComponent->vehicle = new btRaycastVehicle(tuning, rigidbodyComponent->rigidbody, raycaster);
+                rigidbodyComponent->vehicle->setCoordinateSystem(0, 1, 2);
+
+                btBoxShape *boxShape = static_cast<btBoxShape *>(rigidbodyComponent->rigidbody->getCollisionShape());
+                btVector3 chassisHalfExtents = boxShape->getHalfExtentsWithoutMargin();
+                btVector3 wheelDir(0, -1, 0);
+                btVector3 wheelAxle(-1, 0, 0);
+                float restLength = vehicleTuning.wheelRestLength;
+                float radius = vehicleTuning.wheelRadius;
+                float offsetX = vehicleTuning.wheelOffsetX;
+                float offsetZ = vehicleTuning.wheelOffsetZ;
+                //(y,z,x)
+                btVector3 wheelPositions[] = {
+                    btVector3(chassisHalfExtents.x() + radius + offsetX, 0, chassisHalfExtents.z() + radius + offsetZ),
+                    btVector3(-chassisHalfExtents.x() - radius - offsetX, 0, chassisHalfExtents.z() + radius + offsetZ),
+                    btVector3(chassisHalfExtents.x() + radius + offsetX, 0, -chassisHalfExtents.z() - radius - offsetZ),
+                    btVector3(-chassisHalfExtents.x() - radius - offsetX, 0, -chassisHalfExtents.z() - radius - offsetZ)}; // Add wheels with friction using config values
+                for (int i = 0; i < 4; i++)
+                {
+                    bool isFrontWheel = (i < 2);
+                    rigidbodyComponent->vehicle->addWheel(wheelPositions[i], wheelDir, wheelAxle, restLength, radius, tuning, isFrontWheel);
+
+                    // Set wheel friction using config values
+                    btWheelInfo &wheel = rigidbodyComponent->vehicle->getWheelInfo(i);
+                    wheel.m_frictionSlip = vehicleTuning.wheelFrictionSlip;
+                    wheel.m_rollInfluence = vehicleTuning.wheelRollInfluence;
+                }
+                dynWorld->addVehicle(rigidbodyComponent->vehicle);
+            }
+        }
+
+        // Reads the update LOD tiers of the tire animation (see "UpdateTiers::deserialize")
+        // Without tiers, the tires of every vehicle are animated every frame.
+        void configureTireLOD(const nlohmann::json &config)
+        {
+            tireLOD.deserialize(config);
+        }
+
         void update(World *world, float deltaTime)
         {
             if (!world)
                 return;
 
-            for (auto entity : world->getEntities())
+            for (auto [entity, rigidbodyComponent] : world->view<RigidbodyComponent>())
             {
-                auto *rigidbodyComponent = entity->getComponent<RigidbodyComponent>();
-                if (!rigidbodyComponent)
-                    continue;
 
-                // Create the rigid body if not already in the world
+                // Create the rigid body (and the vehicle) if not already in the world (the loading usually created it already)
                 if (!rigidbodyComponent->addedToWorld)
-                {
-                    rigidbodyComponent->addedToWorld = true;
-                    std::string path = "./assets/models/" + rigidbodyComponent->mesh + ".obj";
-                    rigidbodyComponent->rigidbody = createRigidBody(
-                        path,
-                        btVector3(rigidbodyComponent->position.x, rigidbodyComponent->position.y, rigidbodyComponent->position.z),
-                        btVector3(rigidbodyComponent->rotation.x, rigidbodyComponent->rotation.y, rigidbodyComponent->rotation.z),
-                        rigidbodyComponent->mass, btVector3(rigidbodyComponent->scale.x, rigidbodyComponent->scale.y, rigidbodyComponent->scale.z));
-
-                    // Set friction for the rigid body using config values
-                    rigidbodyComponent->rigidbody->setFriction(vehicleTuning.rigidbodyFriction);
-                    rigidbodyComponent->rigidbody->setRollingFriction(vehicleTuning.rigidbodyRollingFriction);
-                }
+                    createBody(rigidbodyComponent);
 
                 // If this object needs a vehicle and has non-zero mass
-                if (rigidbodyComponent->input == 1 && rigidbodyComponent->mass != 0.0f)
+                if (rigidbodyComponent->input == 1 && rigidbodyComponent->mass != 0.0f && rigidbodyComponent->vehicle)
                 {
-                    // Create RaycastVehicle once
-                    if (!rigidbodyComponent->vehicle)
-                    { // Vehicle tuning and setup using config values
-                        btRaycastVehicle::btVehicleTuning tuning;
-                        tuning.m_suspensionStiffness = vehicleTuning.suspensionStiffness;
-                        tuning.m_suspensionCompression = vehicleTuning.suspensionCompression;
-                        tuning.m_suspensionDamping = vehicleTuning.suspensionDamping;
-                        tuning.m_maxSuspensionTravelCm = vehicleTuning.maxSuspensionTravelCm;
-                        tuning.m_frictionSlip = vehicleTuning.frictionSlip;
-                        tuning.m_maxSuspensionForce = vehicleTuning.maxSuspensionForce;
-
-                        // Configure vehicle rigid body
-                        rigidbodyComponent->rigidbody->setActivationState(DISABLE_DEACTIVATION);
-                        // Add angular and linear damping using config values
-                        rigidbodyComponent->rigidbody->setDamping(vehicleTuning.linearDamping, vehicleTuning.angularDamping);
-
-                        btVehicleRaycaster *raycaster = new btDefaultVehicleRaycaster(dynWorld);
-                        rigidbodyComponent->vehicle = new btRaycastVehicle(tuning, rigidbodyComponent->rigidbody, raycaster);
-                        rigidbodyComponent->vehicle->setCoordinateSystem(0, 1, 2);
-
-                        btBoxShape *boxShape = static_cast<btBoxShape *>(rigidbodyComponent->rigidbody->getCollisionShape());
-                        btVector3 chassisHalfExtents = boxShape->getHalfExtentsWithoutMargin();
-                        btVector3 wheelDir(0, -1, 0);
-                        btVector3 wheelAxle(-1, 0, 0);
-                        float restLength = vehicleTuning.wheelRestLength;
-                        float radius = vehicleTuning.wheelRadius;
-                        float offsetX = vehicleTuning.wheelOffsetX;
-                        float offsetZ = vehicleTuning.wheelOffsetZ;
-                        //(y,z,x)
-                        btVector3 wheelPositions[] = {
-                            btVector3(chassisHalfExtents.x() + radius + offsetX, 0, chassisHalfExtents.z() + radius + offsetZ),
-                            btVector3(-chassisHalfExtents.x() - radius - offsetX, 0, chassisHalfExtents.z() + radius + offsetZ),
-                            btVector3(chassisHalfExtents.x() + radius + offsetX, 0, -chassisHalfExtents.z() - radius - offsetZ),
-                            btVector3(-chassisHalfExtents.x() - radius - offsetX, 0, -chassisHalfExtents.z() - radius - offsetZ)}; // Add wheels with friction using config values
-                        for (int i = 0; i < 4; i++)
-                        {
-                            bool isFrontWheel = (i < 2);
-                            rigidbodyComponent->vehicle->addWheel(wheelPositions[i], wheelDir, wheelAxle, restLength, radius, tuning, isFrontWheel);
-
-                            // Set wheel friction using config values
-                            btWheelInfo &wheel = rigidbodyComponent->vehicle->getWheelInfo(i);
-                            wheel.m_frictionSlip = vehicleTuning.wheelFrictionSlip;
-                            wheel.m_rollInfluence = vehicleTuning.wheelRollInfluence;
-                        }
-                        dynWorld->addVehicle(rigidbodyComponent->vehicle);
-                    }
-
                     btVector3 velocity = rigidbodyComponent->rigidbody->getLinearVelocity();
                     // Limit maximum velocity to prevent excessive speeds using config value
                     if (velocity.length() > vehicleTuning.maxSpeed)
@@ -430,8 +456,9 @@ namespace our
                         rigidbodyComponent->rigidbody->setLinearVelocity(velocity);
                     }
 
-                    static float engineForce = 0.0f;
-                    static float steeringValue = 0.0f;
+                    // The driving state lives in the component so each vehicle has its own (and the world snapshots capture it)
+                    float &engineForce = rigidbodyComponent->engineForce;
+                    float &steeringValue = rigidbodyComponent->steeringAngle;
                     float brakeForce = 0.0f;
                     // Check if the vehicle is in the air by examining the wheel contact points
                     bool isInAir = true;
@@ -537,41 +564,6 @@ namespace our
                     entity->localTransform.position = rigidbodyComponent->position;
                     entity->localTransform.position.y -= 0.07f;
                     entity->localTransform.rotation = rigidbodyComponent->rotation;
-
-                    btVector3 velocity = rigidbodyComponent->rigidbody->getLinearVelocity();
-                    float steeringValue = rigidbodyComponent->vehicle->getSteeringValue(0);
-                    for (auto child : world->getEntities())
-                    {
-                        if (child->parent == entity)
-                        {
-                            std::string name = child->name;
-                            if (name.find("tire") != std::string::npos)
-                            {
-                                MovementComponent *movement = child->getComponent<MovementComponent>();
-                                if (movement)
-                                {
-                                    float groundSpeed = velocity.length();
-                                    // Get forward direction from velocity
-                                    float forwardSpeed = velocity.dot(rigidbodyComponent->rigidbody->getWorldTransform().getBasis().getColumn(2));
-
-                                    if (rigidbodyComponent->vehicle->getWheelInfo(0).m_raycastInfo.m_isInContact)
-                                    {
-                                        // Apply rotation based on forward/backward movement
-                                        float rotationSpeed = groundSpeed * 2 * (forwardSpeed >= 0 ? 1 : -1);
-                                        movement->angularVelocity = glm::vec3(rotationSpeed, 0.0f, 0.0f);
-                                    }
-                                    else
-                                    {
-                                        movement->angularVelocity = glm::vec3(0.0f, 0.0f, 0.0f);
-                                    }
-                                }
-                                if (name == "tireFront")
-                                {
-                                    child->localTransform.rotation = glm::vec3(child->localTransform.rotation.x, steeringValue, 0.0f);
-                                }
-                            }
-                        }
-                    }
                 }
                 else if (rigidbodyComponent->rigidbody)
                 {
@@ -589,6 +581,46 @@ namespace our
                     entity->localTransform.rotation = rigidbodyComponent->rotation;
                 }
             }
+
+            // The tires of the vehicles due in this frame follow the speed and the steering of their vehicle
+            // The far vehicles are refreshed less often (see "configureTireLOD") and their tires keep turning meanwhile
+            for (auto [rigidbodyComponent, elapsed] : tireLOD.collect(world, deltaTime))
+            {
+                if (!rigidbodyComponent->vehicle)
+                    continue;
+                Entity *entity = rigidbodyComponent->getOwner();
+                btVector3 velocity = rigidbodyComponent->rigidbody->getLinearVelocity();
+                float steeringValue = rigidbodyComponent->vehicle->getSteeringValue(0);
+                for (auto child : entity->getChildren())
+                {
+                    // The tires are marked by tag components so these checks are bit tests (no string compares)
+                    if (child->hasComponent<TireTag>())
+                    {
+                        MovementComponent *movement = child->getComponent<MovementComponent>();
+                        if (movement)
+                        {
+                            float groundSpeed = velocity.length();
+                            // Get forward direction from velocity
+                            float forwardSpeed = velocity.dot(rigidbodyComponent->rigidbody->getWorldTransform().getBasis().getColumn(2));
+
+                            if (rigidbodyComponent->vehicle->getWheelInfo(0).m_raycastInfo.m_isInContact)
+                            {
+                                // Apply rotation based on forward/backward movement
+                                float rotationSpeed = groundSpeed * 2 * (forwardSpeed >= 0 ? 1 : -1);
+                                movement->angularVelocity = glm::vec3(rotationSpeed, 0.0f, 0.0f);
+                            }
+                            else
+                            {
+                                movement->angularVelocity = glm::vec3(0.0f, 0.0f, 0.0f);
+                            }
+                        }
+                        if (child->hasComponent<SteeringTag>())
+                        {
+                            child->localTransform.rotation = glm::vec3(child->localTransform.rotation.x, steeringValue, 0.0f);
+                        }
+                    }
+                }
+            }
         }
     };
 
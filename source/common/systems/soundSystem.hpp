@@ -2,6 +2,8 @@
 
 #include "../ecs/world.hpp"
 #include "../components/sound.hpp"
+#include "../ecs/scheduler.hpp"
+#include "update-lod.hpp"
 #include "miniaudio.h"
 #include <vector>
 #include <iostream>
@@ -17,8 +19,21 @@ namespace our
         ma_engine engine;
         // Store pointers to heap-allocated sounds for proper cleanup
         std::vector<ma_sound *> oneShotSounds;
+        UpdateLOD<SoundComponent> lod; // The far sounds are checked less often
 
     public:
+        // The sound system writes the sound components and the audio engine (the sound system itself)
+        static SystemAccess getAccess()
+        {
+            return SystemAccess().read<CameraComponent, Transform, TransformNode>().write<SoundComponent, soundSystem>();
+        }
+
+        // Reads the update LOD tiers (see "UpdateTiers::deserialize"). Without tiers, every sound is checked every frame.
+        void configure(const nlohmann::json &config)
+        {
+            lod.deserialize(config);
+        }
+
         void initialize()
         {
             ma_result result = ma_engine_init(NULL, &engine);
@@ -36,32 +51,26 @@ namespace our
             // Clean up finished one-shot sounds
             cleanupFinishedSounds();
 
-            // For each entity in the world
-            for (auto entity : world->getEntities())
+            // For each sound component due in this frame (the far sounds are only checked on some frames)
+            for (auto [soundComp, elapsed] : lod.collect(world, deltaTime))
             {
-                // Get the sound component if it exists
-                SoundComponent *soundComp = entity->getComponent<SoundComponent>();
-                // If the sound component exists
-                if (soundComp)
+                if (!soundComp->playing)
                 {
-                    if (!soundComp->playing)
+                    const char *soundFile = soundComp->soundPath.c_str();
+                    ma_result result = ma_sound_init_from_file(&engine, soundFile, MA_SOUND_FLAG_DECODE, NULL, NULL, &soundComp->sound);
+                    if (result != MA_SUCCESS)
                     {
-                        const char *soundFile = soundComp->soundPath.c_str();
-                        ma_result result = ma_sound_init_from_file(&engine, soundFile, MA_SOUND_FLAG_DECODE, NULL, NULL, &soundComp->sound);
-                        if (result != MA_SUCCESS)
-                        {
-                            std::cerr << "Failed to initialize sound from file." << std::endl;
-                        }
-                        else
+                        std::cerr << "Failed to initialize sound from file." << std::endl;
+                    }
+                    else
+                    {
+                        ma_sound_set_volume(&soundComp->sound, soundComp->volume / 100.0);
+                        if (soundComp->looped)
                         {
-                            ma_sound_set_volume(&soundComp->sound, soundComp->volume / 100.0);
-                            if (soundComp->looped)
-                            {
-                                ma_sound_set_looping(&soundComp->sound, true); // Loop the sound
-                            }
-                            ma_sound_start(&soundComp->sound);
-                            soundComp->playing = true;
+                            ma_sound_set_looping(&soundComp->sound, true); // Loop the sound
                         }
+                        ma_sound_start(&soundComp->sound);
+                        soundComp->playing = true;
                     }
                 }
             }
@@ -0,0 +1,415 @@
+#include "static-bvh.hpp"
+#include "../components/rigidbody.hpp"
+#include "../components/movement.hpp"
+#include "../components/input.hpp"
+#include "../components/free-camera-controller.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace our {
+
+    namespace {
+        constexpr float FLOAT_INFINITY = std::numeric_limits<float>::infinity();
+
+        // The result of testing a box against a frustum
+        enum class Containment { OUTSIDE, INTERSECTING, INSIDE };
+
+        Containment classifyBox(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max) {
+            glm::vec3 center = (min + max) * 0.5f, extents = (max - min) * 0.5f;
+            Containment result = Containment::INSIDE;
+            for(const auto& plane : frustum.planes) {
+                glm::vec3 normal(plane);
+                float distance = glm::dot(normal, center) + plane.w;
+                float radius = glm::dot(glm::abs(normal), extents);
+                if(distance + radius < 0.0f) return Containment::OUTSIDE;
+                if(distance - radius < 0.0f) result = Containment::INTERSECTING;
+            }
+            return result;
+        }
+
+        // Returns the distance at which the ray enters the box (0 if it starts inside) or infinity if it misses it
+        // before "maxDistance". "inverseDirection" is 1 / direction (the slabs of a zero component give infinities).
+        float intersectRayBox(const glm::vec3& origin, const glm::vec3& inverseDirection, const glm::vec3& min, const glm::vec3& max, float maxDistance) {
+            glm::vec3 t1 = (min - origin) * inverseDirection, t2 = (max - origin) * inverseDirection;
+            glm::vec3 lower = glm::min(t1, t2), upper = glm::max(t1, t2);
+            float enter = std::max({lower.x, lower.y, lower.z, 0.0f});
+            float exit = std::min({upper.x, upper.y, upper.z, maxDistance});
+            return enter <= exit ? enter : FLOAT_INFINITY;
+        }
+
+        // Returns the squared distance between a point and a box (0 if the point is inside)
+        float distanceSquaredToBox(const glm::vec3& point, const glm::vec3& min, const glm::vec3& max) {
+            glm::vec3 offset = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+            return glm::dot(offset, offset);
+        }
+
+        // Returns half the surface area of a box (the SAH only compares areas)
+        float halfArea(const glm::vec3& min, const glm::vec3& max) {
+            glm::vec3 size = max - min;
+            return size.x * size.y + size.y * size.z + size.z * size.x;
+        }
+
+        bool isEmpty(const glm::vec3& min, const glm::vec3& max) { return min.x > max.x; }
+
+        // Returns true if components of type T were added or removed since the given tick
+        template<typename T>
+        bool membershipChanged(World* world, Tick since) {
+            return !world->added<T>(since).empty() || !world->removed<T>(since).empty();
+        }
+    }
+
+    void BoundingVolumeHierarchy::build(const std::vector<CullBox>& boxes) {
+        size_t count = boxes.size();
+        itemMin.resize(count);
+        itemMax.resize(count);
+        std::vector<glm::vec3> centers(count);
+        for(size_t item = 0; item < count; item++) {
+            itemMin[item] = boxes[item].center - boxes[item].extents;
+            itemMax[item] = boxes[item].center + boxes[item].extents;
+            centers[item] = boxes[item].center;
+        }
+        order.resize(count);
+        std::iota(order.begin(), order.end(), 0u);
+        nodes.clear();
+        if(count == 0) return;
+        nodes.reserve(2 * count);
+        nodes.push_back({glm::vec3(0.0f), 0, glm::vec3(0.0f), std::uint32_t(count), 0});
+        // The nodes are split in the order they are created, so the children always come after their parent
+        for(std::uint32_t nodeIndex = 0; nodeIndex < nodes.size(); nodeIndex++) subdivide(nodeIndex, centers);
+    }
+
+    void BoundingVolumeHierarchy::fitLeaf(Node& node) const {
+        node.min = glm::vec3(FLOAT_INFINITY);
+        node.max = glm::vec3(-FLOAT_INFINITY);
+        for(std::uint32_t index = node.begin; index < node.end; index++) {
+            std::uint32_t item = order[index];
+            if(isEmpty(itemMin[item], itemMax[item])) continue;
+            node.min = glm::min(node.min, itemMin[item]);
+            node.max = glm::max(node.max, itemMax[item]);
+        }
+    }
+
+    void BoundingVolumeHierarchy::subdivide(std::uint32_t nodeIndex, std::vector<glm::vec3>& centers) {
+        fitLeaf(nodes[nodeIndex]);
+        std::uint32_t begin = nodes[nodeIndex].begin, end = nodes[nodeIndex].end;
+        std::uint32_t count = end - begin;
+        if(count <= LEAF_SIZE) return;
+
+        glm::vec3 centerMin(FLOAT_INFINITY), centerMax(-FLOAT_INFINITY);
+        for(std::uint32_t index = begin; index < end; index++) {
+            centerMin = glm::min(centerMin, centers[order[index]]);
+            centerMax = glm::max(centerMax, centers[order[index]]);
+        }
+
+        // The centers are binned along each axis and every boundary between two bins is a candidate split
+        struct Bin {
+            glm::vec3 min = glm::vec3(FLOAT_INFINITY), max = glm::vec3(-FLOAT_INFINITY);
+            std::uint32_t count = 0;
+        };
+        // The cost of keeping a leaf (a node too big for a leaf is split even if its area says otherwise, e.g. flat items)
+        float bestCost = count > 4 * LEAF_SIZE ? FLOAT_INFINITY : halfArea(nodes[nodeIndex].min, nodes[nodeIndex].max) * float(count);
+        int bestAxis = -1, bestSplit = 0;
+        for(int axis = 0; axis < 3; axis++) {
+            float extent = centerMax[axis] - centerMin[axis];
+            if(!(extent > 0.0f)) continue;
+            float scale = float(SAH_BINS) / extent;
+            Bin bins[SAH_BINS];
+            for(std::uint32_t index = begin; index < end; index++) {
+                std::uint32_t item = order[index];
+                int bin = std::min(int((centers[item][axis] - centerMin[axis]) * scale), SAH_BINS - 1);
+                bins[bin].min = glm::min(bins[bin].min, itemMin[item]);
+                bins[bin].max = glm::max(bins[bin].max, itemMax[item]);
+                bins[bin].count++;
+            }
+            // The costs of the left sides are swept forward, then the right sides backward
+            // (a split leaving a side empty is skipped)
+            float leftCost[SAH_BINS - 1];
+            std::uint32_t leftCount[SAH_BINS - 1];
+            Bin side;
+            for(int split = 0; split < SAH_BINS - 1; split++) {
+                side.min = glm::min(side.min, bins[split].min);
+                side.max = glm::max(side.max, bins[split].max);
+                side.count += bins[split].count;
+                leftCount[split] = side.count;
+                leftCost[split] = side.count ? halfArea(side.min, side.max) * float(side.count) : 0.0f;
+            }
+            side = Bin();
+            for(int split = SAH_BINS - 2; split >= 0; split--) {
+                side.min = glm::min(side.min, bins[split + 1].min);
+                side.max = glm::max(side.max, bins[split + 1].max);
+                side.count += bins[split + 1].count;
+                if(leftCount[split] == 0 || side.count == 0) continue;
+                float cost = leftCost[split] + halfArea(side.min, side.max) * float(side.count);
+                if(cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = split;
+                }
+            }
+        }
+        if(bestAxis < 0) return;
+
+        float scale = float(SAH_BINS) / (centerMax[bestAxis] - centerMin[bestAxis]);
+        auto middle = std::partition(order.begin() + begin, order.begin() + end, [&](std::uint32_t item) {
+            return std::min(int((centers[item][bestAxis] - centerMin[bestAxis]) * scale), SAH_BINS - 1) <= bestSplit;
+        });
+        std::uint32_t split = std::uint32_t(middle - order.begin());
+        if(split == begin || split == end) return;
+        std::uint32_t left = std::uint32_t(nodes.size());
+        nodes[nodeIndex].left = left;
+        nodes.push_back({glm::vec3(0.0f), begin, glm::vec3(0.0f), split, 0});
+        nodes.push_back({glm::vec3(0.0f), split, glm::vec3(0.0f), end, 0});
+    }
+
+    void BoundingVolumeHierarchy::setBox(std::uint32_t item, const CullBox& box) {
+        itemMin[item] = box.center - box.extents;
+        itemMax[item] = box.center + box.extents;
+    }
+
+    void BoundingVolumeHierarchy::remove(std::uint32_t item) {
+        itemMin[item] = glm::vec3(FLOAT_INFINITY);
+        itemMax[item] = glm::vec3(-FLOAT_INFINITY);
+    }
+
+    void BoundingVolumeHierarchy::refit() {
+        for(size_t nodeIndex = nodes.size(); nodeIndex-- > 0;) {
+            Node& node = nodes[nodeIndex];
+            if(node.left == 0) {
+                fitLeaf(node);
+            } else {
+                node.min = glm::min(nodes[node.left].min, nodes[node.left + 1].min);
+                node.max = glm::max(nodes[node.left].max, nodes[node.left + 1].max);
+            }
+        }
+    }
+
+    void BoundingVolumeHierarchy::cull(const Frustum& frustum, std::vector<std::uint32_t>& out) const {
+        if(nodes.empty()) return;
+        std::vector<std::uint32_t> stack;
+        stack.reserve(64);
+        stack.push_back(0);
+        while(!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            if(isEmpty(node.min, node.max)) continue;
+            Containment containment = classifyBox(frustum, node.min, node.max);
+            if(containment == Containment::OUTSIDE) continue;
+            if(containment == Containment::INSIDE || node.left == 0) {
+                // The items of a node are the contiguous range of its leaves
+                for(std::uint32_t index = node.begin; index < node.end; index++) {
+                    std::uint32_t item = order[index];
+                    if(isEmpty(itemMin[item], itemMax[item])) continue;
+                    if(containment == Containment::INSIDE || classifyBox(frustum, itemMin[item], itemMax[item]) != Containment::OUTSIDE)
+                        out.push_back(item);
+                }
+                continue;
+            }
+            stack.push_back(node.left);
+            stack.push_back(node.left + 1);
+        }
+    }
+
+    BVHRayHit BoundingVolumeHierarchy::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+        BVHRayHit hit;
+        hit.distance = maxDistance;
+        if(nodes.empty()) return {};
+        glm::vec3 inverseDirection = 1.0f / direction;
+        // Each stack entry keeps the distance at which the ray enters the node so the far nodes can be skipped
+        std::vector<std::pair<std::uint32_t, float>> stack;
+        stack.reserve(64);
+        float rootDistance = intersectRayBox(origin, inverseDirection, nodes[0].min, nodes[0].max, hit.distance);
+        if(rootDistance < FLOAT_INFINITY) stack.push_back({0, rootDistance});
+        while(!stack.empty()) {
+            auto [nodeIndex, enter] = stack.back();
+            stack.pop_back();
+            if(enter > hit.distance) continue;
+            const Node& node = nodes[nodeIndex];
+            if(node.left == 0) {
+                for(std::uint32_t index = node.begin; index < node.end; index++) {
+                    std::uint32_t item = order[index];
+                    if(isEmpty(itemMin[item], itemMax[item])) continue;
+                    float distance = intersectRayBox(origin, inverseDirection, itemMin[item], itemMax[item], hit.distance);
+                    if(distance < FLOAT_INFINITY && (hit.item == NO_ITEM || distance < hit.distance)) {
+                        hit.distance = distance;
+                        hit.item = item;
+                    }
+                }
+                continue;
+            }
+            // The nearer child is pushed last so it is visited first
+            float first = intersectRayBox(origin, inverseDirection, nodes[node.left].min, nodes[node.left].max, hit.distance);
+            float second = intersectRayBox(origin, inverseDirection, nodes[node.left + 1].min, nodes[node.left + 1].max, hit.distance);
+            if(first > second) {
+                if(first < FLOAT_INFINITY) stack.push_back({node.left, first});
+                if(second < FLOAT_INFINITY) stack.push_back({node.left + 1, second});
+            } else {
+                if(second < FLOAT_INFINITY) stack.push_back({node.left + 1, second});
+                if(first < FLOAT_INFINITY) stack.push_back({node.left, first});
+            }
+        }
+        if(hit.item == NO_ITEM) return {};
+        return hit;
+    }
+
+    void BoundingVolumeHierarchy::queryRadius(const glm::vec3& center, float radius, std::vector<std::uint32_t>& out) const {
+        if(nodes.empty()) return;
+        float radiusSquared = radius * radius;
+        std::vector<std::uint32_t> stack;
+        stack.reserve(64);
+        stack.push_back(0);
+        while(!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            if(isEmpty(node.min, node.max) || distanceSquaredToBox(center, node.min, node.max) > radiusSquared) continue;
+            if(node.left == 0) {
+                for(std::uint32_t index = node.begin; index < node.end; index++) {
+                    std::uint32_t item = order[index];
+                    if(!isEmpty(itemMin[item], itemMax[item]) && distanceSquaredToBox(center, itemMin[item], itemMax[item]) <= radiusSquared)
+                        out.push_back(item);
+                }
+                continue;
+            }
+            stack.push_back(node.left);
+            stack.push_back(node.left + 1);
+        }
+    }
+
+    bool StaticScene::isStatic(Entity* entity) {
+        for(; entity; entity = entity->parent) {
+            if(entity->hasComponent<RigidbodyComponent>() || entity->hasComponent<MovementComponent>() ||
+               entity->hasComponent<InputComponent>() || entity->hasComponent<FreeCameraControllerComponent>())
+                return false;
+        }
+        return true;
+    }
+
+    CullBox StaticScene::getWorldBox(MeshRendererComponent* renderer) {
+        return transformBounds(renderer->mesh->getBounds(), renderer->getOwner()->getCachedLocalToWorldMatrix());
+    }
+
+    void StaticScene::update(World* world) {
+        Tick since = lastUpdateTick;
+        lastUpdateTick = world->getTick();
+        if(world != this->world) {
+            // The entries of another world must not be matched with the renderers of this one
+            entries.clear();
+            itemOf.clear();
+            pending.clear();
+            removedCount = 0;
+            bvh.build({});
+            this->world = world;
+            classify(world);
+            return;
+        }
+        if(!world->hasChangeHistory(since) || membershipChanged<MeshRendererComponent>(world, since) ||
+           membershipChanged<RigidbodyComponent>(world, since) || membershipChanged<MovementComponent>(world, since) ||
+           membershipChanged<InputComponent>(world, since) || membershipChanged<FreeCameraControllerComponent>(world, since)) {
+            classify(world);
+        }
+
+        // The static entities can still be moved by the game code, their boxes follow them
+        bool moved = false;
+        for(Entity* entity : world->getMovedEntities()) {
+            auto renderer = entity->getComponent<MeshRendererComponent>();
+            if(!renderer) continue;
+            auto it = itemOf.find(renderer);
+            if(it == itemOf.end() || !entries[it->second].alive) continue;
+            bvh.setBox(it->second, getWorldBox(renderer));
+            moved = true;
+        }
+        if(moved) bvh.refit();
+    }
+
+    void StaticScene::classify(World* world) {
+        pending.clear();
+        dynamic.clear();
+        std::vector<char> kept(entries.size(), 0);
+        std::vector<MeshRendererComponent*> statics;
+        for(auto component : world->getPool<MeshRendererComponent>()) {
+            auto renderer = static_cast<MeshRendererComponent*>(component);
+            if(!isStatic(renderer->getOwner())) {
+                dynamic.push_back(renderer);
+                continue;
+            }
+            statics.push_back(renderer);
+            auto it = itemOf.find(renderer);
+            if(it != itemOf.end() && entries[it->second].alive && entries[it->second].addedTick == renderer->getAddedTick())
+                kept[it->second] = 1;
+            else
+                pending.push_back(renderer);
+        }
+        bool removed = false;
+        for(std::uint32_t item = 0; item < entries.size(); item++) {
+            if(entries[item].alive && !kept[item]) {
+                entries[item].alive = false;
+                bvh.remove(item);
+                removedCount++;
+                removed = true;
+            }
+        }
+        if((removedCount + pending.size()) * 4 > entries.size()) rebuild(statics);
+        else if(removed) bvh.refit();
+    }
+
+    void StaticScene::rebuild(const std::vector<MeshRendererComponent*>& renderers) {
+        entries.clear();
+        itemOf.clear();
+        std::vector<CullBox> boxes;
+        boxes.reserve(renderers.size());
+        for(auto renderer : renderers) {
+            itemOf[renderer] = std::uint32_t(entries.size());
+            entries.push_back({renderer, renderer->getAddedTick(), true});
+            boxes.push_back(getWorldBox(renderer));
+        }
+        bvh.build(boxes);
+        pending.clear();
+        removedCount = 0;
+    }
+
+    void StaticScene::cull(const Frustum& frustum, std::vector<MeshRendererComponent*>& out) {
+        hits.clear();
+        bvh.cull(frustum, hits);
+        for(auto item : hits) out.push_back(entries[item].renderer);
+        for(auto renderer : pending) {
+            CullBox box = getWorldBox(renderer);
+            char visible = 1;
+            cullBoxesScalar(frustum, &box, 1, &visible);
+            if(visible) out.push_back(renderer);
+        }
+    }
+
+    void StaticScene::collect(std::vector<MeshRendererComponent*>& out) const {
+        for(auto& entry : entries)
+            if(entry.alive) out.push_back(entry.renderer);
+        out.insert(out.end(), pending.begin(), pending.end());
+    }
+
+    MeshRendererComponent* StaticScene::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, float* distance) {
+        BVHRayHit hit = bvh.raycast(origin, direction, maxDistance);
+        MeshRendererComponent* nearest = hit.item != BoundingVolumeHierarchy::NO_ITEM ? entries[hit.item].renderer : nullptr;
+        float nearestDistance = nearest ? hit.distance : maxDistance;
+        glm::vec3 inverseDirection = 1.0f / direction;
+        for(auto renderer : pending) {
+            CullBox box = getWorldBox(renderer);
+            float boxDistance = intersectRayBox(origin, inverseDirection, box.center - box.extents, box.center + box.extents, nearestDistance);
+            if(boxDistance < FLOAT_INFINITY && (!nearest || boxDistance < nearestDistance)) {
+                nearest = renderer;
+                nearestDistance = boxDistance;
+            }
+        }
+        if(distance && nearest) *distance = nearestDistance;
+        return nearest;
+    }
+
+    void StaticScene::queryRadius(const glm::vec3& center, float radius, std::vector<MeshRendererComponent*>& out) {
+        hits.clear();
+        bvh.queryRadius(center, radius, hits);
+        for(auto item : hits) out.push_back(entries[item].renderer);
+        for(auto renderer : pending) {
+            CullBox box = getWorldBox(renderer);
+            if(distanceSquaredToBox(center, box.center - box.extents, box.center + box.extents) <= radius * radius) out.push_back(renderer);
+        }
+    }
+
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "frustum-culling.hpp"
+#include "../ecs/world.hpp"
+#include "../components/mesh-renderer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace our {
+
+    // The nearest item hit by a ray (see "BoundingVolumeHierarchy::raycast")
+    struct BVHRayHit {
+        std::uint32_t item = std::numeric_limits<std::uint32_t>::max(); // NO_ITEM if nothing was hit
+        float distance = std::numeric_limits<float>::infinity();
+    };
+
+    // A bounding volume hierarchy over a set of boxes (the items). The items are identified by their index in the boxes
+    // given to "build". The tree is built top-down, each node being split where the surface area heuristic (SAH) finds it
+    // cheapest among a few bins of the item centers along each axis. The nodes are stored in one array, the children of
+    // an inner node are next to each other and always come after it.
+    // An item can be moved or removed without rebuilding, the tree is then refitted (its splits may get worse, so a
+    // user that moves many items should rebuild it instead).
+    class BoundingVolumeHierarchy {
+    public:
+        static constexpr std::uint32_t NO_ITEM = std::numeric_limits<std::uint32_t>::max();
+        // The largest number of items in a leaf and the number of SAH bins per axis
+        static constexpr std::uint32_t LEAF_SIZE = 4;
+        static constexpr int SAH_BINS = 12;
+
+    private:
+        // A node holds the items "order[begin .. end)". It is a leaf if "left" is 0, otherwise its children are
+        // "nodes[left]" and "nodes[left + 1]" (the root is never a child). An empty node has min > max.
+        struct Node {
+            glm::vec3 min;
+            std::uint32_t begin;
+            glm::vec3 max;
+            std::uint32_t end;
+            std::uint32_t left;
+        };
+        std::vector<Node> nodes;
+        std::vector<std::uint32_t> order; // The items in leaf order
+        std::vector<glm::vec3> itemMin, itemMax; // The boxes of the items (by item)
+
+        void subdivide(std::uint32_t nodeIndex, std::vector<glm::vec3>& centers);
+        void fitLeaf(Node& node) const;
+
+    public:
+        // Builds the tree over the given boxes (the items are 0 .. boxes.size() - 1)
+        void build(const std::vector<CullBox>& boxes);
+
+        // Replaces the box of an item, "refit" must be called before the next query
+        void setBox(std::uint32_t item, const CullBox& box);
+        // Removes an item (its box becomes empty), "refit" must be called before the next query
+        void remove(std::uint32_t item);
+        // Recomputes the boxes of all the nodes from the boxes of their items (bottom-up)
+        void refit();
+
+        // Appends the items whose box is not entirely outside the frustum. A node entirely inside the frustum yields all of
+        // its items without testing them.
+        void cull(const Frustum& frustum, std::vector<std::uint32_t>& out) const;
+        // Returns the item whose box is hit first by the ray (the direction needn't be normalized, the distance is in its
+        // units) within "maxDistance"
+        BVHRayHit raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance = std::numeric_limits<float>::infinity()) const;
+        // Appends the items whose box is closer than "radius" to "center"
+        void queryRadius(const glm::vec3& center, float radius, std::vector<std::uint32_t>& out) const;
+
+        size_t getItemCount() const { return itemMin.size(); }
+        size_t getNodeCount() const { return nodes.size(); }
+    };
+
+    // The static scene keeps a bounding volume hierarchy over the mesh renderers that never move, so the renderer rejects
+    // whole sections of the track at once, and the game can pick and search them without visiting every entity.
+    // A mesh renderer is static if neither its entity nor any of its ancestors is moved by a system (it has no rigid body,
+    // movement, input or free camera controller component). The others are listed in "getDynamicRenderers".
+    // "update" follows the world through its change logs, so a frame without changes costs nothing:
+    // - The static entities that moved anyway (see "World::getMovedEntities") get their box updated and the tree is refitted.
+    // - When mesh renderers or moving components are added or removed, the renderers are classified again. The removed
+    //   static renderers are dropped from the tree (which is refitted) and the new ones wait in a list tested one by one.
+    //   Once these changes reach a quarter of the tree, it is rebuilt.
+    // WARNING: The renderers are found through the cached world matrices, so call "World::updateTransforms" first.
+    class StaticScene {
+        BoundingVolumeHierarchy bvh;
+        struct Entry {
+            MeshRendererComponent* renderer; // Only valid while "alive"
+            Tick addedTick; // Tells the renderer from a new one that reused its memory
+            bool alive;
+        };
+        std::vector<Entry> entries; // By item of the tree
+        std::unordered_map<const MeshRendererComponent*, std::uint32_t> itemOf;
+        std::vector<MeshRendererComponent*> pending; // The static renderers added since the tree was built
+        std::vector<MeshRendererComponent*> dynamic;
+        size_t removedCount = 0; // The number of dead entries in the tree
+        std::vector<std::uint32_t> hits; // Scratch buffer of the queries
+        const World* world = nullptr;
+        Tick lastUpdateTick = 0;
+
+        // Sorts the renderers of the world into the tree, the pending list and the dynamic list
+        void classify(World* world);
+        void rebuild(const std::vector<MeshRendererComponent*>& renderers);
+        static CullBox getWorldBox(MeshRendererComponent* renderer);
+
+    public:
+        // Returns true if the entity and all its ancestors have none of the components that move an entity
+        static bool isStatic(Entity* entity);
+
+        // Brings the tree up to date with the world
+        void update(World* world);
+
+        // Appends the static renderers whose box is not entirely outside the frustum
+        void cull(const Frustum& frustum, std::vector<MeshRendererComponent*>& out);
+        // Appends all the static renderers
+        void collect(std::vector<MeshRendererComponent*>& out) const;
+        // Returns the static renderer whose world box is hit first by the ray (null if none) and sets "distance" to the
+        // distance of the hit. The boxes stand for the meshes, so a hit may miss the mesh itself.
+        MeshRendererComponent* raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance = std::numeric_limits<float>::infinity(),
+                                       float* distance = nullptr);
+        // Appends the static renderers whose world box is closer than "radius" to "center"
+        void queryRadius(const glm::vec3& center, float radius, std::vector<MeshRendererComponent*>& out);
+
+        // Returns the mesh renderers that may move (they are not in the tree)
+        const std::vector<MeshRendererComponent*>& getDynamicRenderers() const { return dynamic; }
+        // Returns the number of static renderers (in the tree or pending)
+        size_t getStaticCount() const { return entries.size() - removedCount + pending.size(); }
+    };
+
+}
@@ -0,0 +1,305 @@
+#pragma once
+
+#include "../ecs/world.hpp"
+#include "../components/camera.hpp"
+
+#include <glm/glm.hpp>
+#include <json/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace our
+{
+
+    // A tier of an update LOD: the entities closer than "distance" to the camera are updated every "interval" frames
+    struct UpdateTier
+    {
+        float distance = std::numeric_limits<float>::infinity();
+        std::uint32_t interval = 1;
+    };
+
+    // The tiers of an update LOD and the viewer they are measured from (see "UpdateLOD")
+    class UpdateTiers
+    {
+        std::vector<UpdateTier> tiers;         // Sorted by distance
+        std::uint32_t offscreenMultiplier = 1; // The intervals of the entities outside the view cone are multiplied by this
+        float cosHalfViewAngle = -1.0f;        // The cosine of half the angle of the view cone (-1 puts everything inside)
+        glm::vec3 viewer = glm::vec3(0.0f), forward = glm::vec3(0.0f, 0.0f, -1.0f);
+
+    public:
+        // Reads the tiers from a json object, for example:
+        //      { "tiers": [ { "distance": 40, "interval": 1 }, { "distance": 120, "interval": 2 }, { "interval": 4 } ],
+        //        "viewAngle": 120, "offscreenMultiplier": 2 }
+        // A tier without a distance holds everything farther. "viewAngle" (in degrees) is the full angle of the view cone.
+        void deserialize(const nlohmann::json &data)
+        {
+            tiers.clear();
+            if (!data.is_object())
+                return;
+            if (auto it = data.find("tiers"); it != data.end() && it->is_array())
+            {
+                for (auto &tierData : *it)
+                {
+                    UpdateTier tier;
+                    tier.distance = tierData.value("distance", tier.distance);
+                    tier.interval = std::max(tierData.value("interval", 1u), 1u);
+                    tiers.push_back(tier);
+                }
+            }
+            std::sort(tiers.begin(), tiers.end(), [](const UpdateTier &a, const UpdateTier &b)
+                      { return a.distance < b.distance; });
+            offscreenMultiplier = std::max(data.value("offscreenMultiplier", 1u), 1u);
+            cosHalfViewAngle = std::cos(glm::radians(std::clamp(data.value("viewAngle", 360.0f), 0.0f, 360.0f) * 0.5f));
+        }
+
+        // Returns true if some entities may be skipped (there are tiers)
+        bool isEnabled() const { return !tiers.empty(); }
+
+        // Returns the longest interval an entity may get
+        std::uint32_t getLongestInterval() const
+        {
+            std::uint32_t longest = 1;
+            for (auto &tier : tiers)
+                longest = std::max(longest, tier.interval);
+            return longest * offscreenMultiplier;
+        }
+
+        // Places the viewer at the first camera of the world (if there is none, it stays where it was)
+        // The camera's cached matrix is used (see "World::updateTransforms"), so the viewer may lag a frame behind.
+        void locateViewer(World *world)
+        {
+            const auto &cameras = world->getPool<CameraComponent>();
+            if (cameras.empty())
+                return;
+            const glm::mat4 &matrix = cameras[0]->getOwner()->getCachedLocalToWorldMatrix();
+            viewer = glm::vec3(matrix[3]);
+            forward = glm::vec3(matrix * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f));
+            float length = glm::length(forward);
+            forward = length > 0.0f ? forward / length : glm::vec3(0.0f, 0.0f, -1.0f);
+        }
+
+        // Returns the interval of the tier of an entity at the given world position
+        std::uint32_t pickInterval(const glm::vec3 &position) const
+        {
+            glm::vec3 offset = position - viewer;
+            float distance = glm::length(offset);
+            std::uint32_t interval = tiers.back().interval;
+            for (auto &tier : tiers)
+            {
+                if (distance < tier.distance)
+                {
+                    interval = tier.interval;
+                    break;
+                }
+            }
+            if (offscreenMultiplier > 1 && distance > 0.0f && glm::dot(offset, forward) < cosHalfViewAngle * distance)
+                interval *= offscreenMultiplier;
+            return interval;
+        }
+
+        // Returns the world position of the entity (from the transform cache if it has a parent)
+        static glm::vec3 getWorldPosition(Entity *entity)
+        {
+            return entity->parent ? glm::vec3(entity->getCachedLocalToWorldMatrix()[3]) : entity->localTransform.position;
+        }
+    };
+
+    // An update LOD lets a system update the far (or off-screen) components of type T less often than the close ones.
+    // Every frame, "collect" returns the components to update with the time since their last update, for example:
+    //      for (auto [movement, elapsed] : lod.collect(world, deltaTime)) { ... }
+    // The components are kept in a timing wheel (one bucket per frame) so a frame only visits the components that are due,
+    // not the whole pool. After each update, a component is put back in the bucket of its next update, which depends on
+    // its distance to the camera. The first delay of a component is offset by its pool index so the components of a tier
+    // are spread over the frames.
+    // The wheel follows the pool through the world's change logs: the components added since the last "collect" are
+    // updated right away, and the removed ones are marked dead (by address) then dropped unread when their bucket comes due.
+    // The wheel is only rebuilt from the pool if the logs don't reach back to the last "collect" (see "World::hasChangeHistory").
+    // NOTE: A second component of type T that takes over the pool entry of a removed one (see "Entity::eraseComponentAt")
+    // is not logged as added, so it joins the wheel at the next rebuild.
+    // Without tiers, every component is returned every frame with the frame's delta time.
+    template <typename T>
+    class UpdateLOD
+    {
+        struct Entry
+        {
+            T *component;
+            double lastTime;    // The time of its last update
+            Tick addedTick;     // Tells a component from a new one that reused its memory when the wheel is rebuilt
+            std::uint64_t born; // The frame it joined the wheel (it is dead if its component's removal was seen after that)
+            bool fresh;         // True till its first update (its next delay is then offset to spread the tier)
+        };
+        UpdateTiers tiers;
+        std::vector<std::vector<Entry>> wheel; // The components due in each of the next frames (indexed by frame % size)
+        std::vector<Entry> bucket;             // The bucket of the current frame (swapped out of the wheel)
+        std::vector<std::pair<T *, float>> due;
+        // The removed components with the frame their removal was seen. A removal is forgotten once every bucket was
+        // visited since then ("expiries" holds the frame it may be forgotten at, in order).
+        std::unordered_map<const Component *, std::uint64_t> removedAt;
+        std::deque<std::pair<std::uint64_t, const Component *>> expiries;
+        // The next "collect" queries the logs from the tick of the last one, so it skips what the last one already saw:
+        // the components added in that tick that joined the wheel and the removals logged in that tick
+        std::unordered_set<const Component *> addedThisTick;
+        size_t removalsThisTick = 0;
+        Tick lastRunTick = 0;
+        double time = 0;
+        std::uint64_t frame = 0;
+        bool scheduled = false;
+
+        // Returns the bucket of the frame that comes "delay" frames after the current one
+        std::vector<Entry> &bucketAfter(std::uint64_t delay) { return wheel[(frame + delay) % wheel.size()]; }
+
+        // Puts an entry in the bucket of the given index
+        void place(size_t index, const Entry &entry)
+        {
+            wheel[index].push_back(entry);
+            if (entry.addedTick == lastRunTick)
+                addedThisTick.insert(entry.component);
+        }
+
+        // Puts every component of the pool in the wheel. The components that were already there keep their bucket and
+        // their last update time (the map is keyed by address only, the removed components are never read).
+        void rebuild(const ComponentPool &pool, float deltaTime)
+        {
+            struct Place
+            {
+                size_t bucket;
+                double lastTime;
+                Tick addedTick;
+                bool fresh;
+            };
+            std::unordered_map<const T *, Place> places;
+            for (size_t index = 0; index < wheel.size(); index++)
+                for (auto &entry : wheel[index])
+                    places[entry.component] = {index, entry.lastTime, entry.addedTick, entry.fresh};
+            wheel.assign(size_t(tiers.getLongestInterval()) + 1, {});
+            removedAt.clear();
+            expiries.clear();
+            addedThisTick.clear();
+            size_t now = frame % wheel.size();
+            for (auto component : pool)
+            {
+                T *typed = static_cast<T *>(component);
+                auto found = places.find(typed);
+                if (found != places.end() && found->second.addedTick == typed->getAddedTick())
+                    place(found->second.bucket, {typed, found->second.lastTime, found->second.addedTick, frame, found->second.fresh});
+                else
+                    place(now, {typed, time - deltaTime, typed->getAddedTick(), frame, true});
+            }
+            scheduled = true;
+        }
+
+        // Applies the changes of the pool since the given tick to the wheel
+        void follow(World *world, const ComponentPool &pool, Tick since, float deltaTime)
+        {
+            // Forget the removals that every entry has been checked against
+            while (!expiries.empty() && expiries.front().first <= frame)
+            {
+                auto found = removedAt.find(expiries.front().second);
+                if (found != removedAt.end() && found->second + wheel.size() == expiries.front().first)
+                    removedAt.erase(found);
+                expiries.pop_front();
+            }
+            // The removed components are marked dead (the first removals were logged in the tick of the last "collect",
+            // which saw some of them already)
+            auto removals = world->removed<T>(since);
+            for (size_t index = removalsThisTick; index < removals.size(); index++)
+            {
+                const Component *component = removals[index].component;
+                removedAt[component] = frame;
+                expiries.emplace_back(frame + wheel.size(), component);
+                addedThisTick.erase(component); // Its memory may be reused by a new component
+            }
+            // The added components join the wheel, due now
+            std::unordered_set<const Component *> seen;
+            std::swap(seen, addedThisTick);
+            size_t now = frame % wheel.size();
+            for (auto [owner, component] : world->added<T>(since))
+            {
+                if (component->getAddedTick() == since && seen.count(component))
+                    continue;
+                // Only the component holding the pool entry of its type is updated (see "Entity::addComponent")
+                size_t poolIndex = component->getPoolIndex();
+                if (poolIndex >= pool.size() || pool[poolIndex] != component)
+                    continue;
+                place(now, {component, time - deltaTime, component->getAddedTick(), frame, true});
+            }
+            if (since == lastRunTick)
+                addedThisTick.merge(seen);
+        }
+
+    public:
+        // Reads the tiers (see "UpdateTiers::deserialize")
+        void deserialize(const nlohmann::json &data)
+        {
+            tiers.deserialize(data);
+            wheel.clear();
+            removedAt.clear();
+            expiries.clear();
+            addedThisTick.clear();
+            removalsThisTick = 0;
+            scheduled = false;
+        }
+
+        // Returns true if some components may be skipped (there are tiers)
+        bool isEnabled() const { return tiers.isEnabled(); }
+
+        // Returns the components to update in this frame with the time since their last update
+        // WARNING: The system calling it must be allowed to read T, the transforms, the transform cache ("TransformNode")
+        // and the cameras (see "SystemAccess"). The cache must be up to date before the systems run (see "World::updateTransforms"),
+        // otherwise reading it would update it.
+        const std::vector<std::pair<T *, float>> &collect(World *world, float deltaTime)
+        {
+            time += deltaTime;
+            frame++;
+            due.clear();
+            const ComponentPool &pool = world->getPool<T>();
+            if (!tiers.isEnabled())
+            {
+                due.reserve(pool.size());
+                for (auto component : pool)
+                    due.emplace_back(static_cast<T *>(component), deltaTime);
+                return due;
+            }
+            tiers.locateViewer(world);
+
+            Tick since = lastRunTick;
+            lastRunTick = world->getTick();
+            if (!scheduled || !world->hasChangeHistory(since))
+                rebuild(pool, deltaTime);
+            else
+                follow(world, pool, since, deltaTime);
+            removalsThisTick = world->removed<T>(lastRunTick).size();
+
+            bucket.clear();
+            std::swap(bucket, bucketAfter(0));
+            for (auto &entry : bucket)
+            {
+                if (!removedAt.empty())
+                {
+                    auto removal = removedAt.find(entry.component);
+                    if (removal != removedAt.end() && removal->second > entry.born)
+                        continue; // Its component was removed, so it leaves the wheel without being read
+                }
+                due.emplace_back(entry.component, float(time - entry.lastTime));
+                entry.lastTime = time;
+                std::uint32_t interval = tiers.pickInterval(UpdateTiers::getWorldPosition(entry.component->getOwner()));
+                std::uint64_t delay = entry.fresh ? 1 + entry.component->getPoolIndex() % interval : interval;
+                entry.fresh = false;
+                bucketAfter(delay).push_back(entry);
+            }
+            return due;
+        }
+
+        // Returns the number of components returned by the last "collect"
+        size_t getUpdatedCount() const { return due.size(); }
+    };
+
+}
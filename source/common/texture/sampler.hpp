@@ -4,6 +4,8 @@
 #include <json/json.hpp>
 #include <glm/vec4.hpp>
 
+#include "../gl-state-cache.hpp"
+
 namespace our {
 
     // This class defined an OpenGL sampler
@@ -20,19 +22,20 @@ namespace our {
         // This deconstructor deletes the underlying OpenGL sampler
         ~Sampler() { 
             //TODO: (Req 6) Complete this function
+            GLStateCache::get().forgetSampler(name);
             glDeleteSamplers(1, &name);
          }
 
         // This method binds this sampler to the given texture unit
         void bind(GLuint textureUnit) const {
             //TODO: (Req 6) Complete this function
-            glBindSampler(textureUnit, name);
+            GLStateCache::get().bindSampler(textureUnit, name);
         }
 
         // This static method ensures that no sampler is bound to the given texture unit
         static void unbind(GLuint textureUnit){
             //TODO: (Req 6) Complete this function
-            glBindSampler(textureUnit, 0);
+            GLStateCache::get().bindSampler(textureUnit, 0);
         }
 
         // This function sets a sampler paramter where the value is of type "GLint"
@@ -14,11 +14,17 @@ our::Texture2D* our::texture_utils::empty(GLenum format, glm::ivec2 size){
 }
 
 our::Texture2D* our::texture_utils::loadImage(const std::string& filename, bool generate_mipmap) {
-    glm::ivec2 size;
+    DecodedImage image = decodeImage(filename);
+    return uploadImage(image, generate_mipmap);
+}
+
+our::texture_utils::DecodedImage our::texture_utils::decodeImage(const std::string& filename) {
+    DecodedImage image;
     int channels;
     //Since OpenGL puts the texture origin at the bottom left while images typically has the origin at the top left,
     //We need to till stb to flip images vertically after loading them
-    stbi_set_flip_vertically_on_load(true);
+    //(the flag is set per thread since the images may be decoded on the job system workers)
+    stbi_set_flip_vertically_on_load_thread(true);
     //Load image data and retrieve width, height and number of channels in the image
     //The last argument is the number of channels we want and it can have the following values:
     //- 0: Keep number of channels the same as in the image file
@@ -27,22 +33,32 @@ our::Texture2D* our::texture_utils::loadImage(const std::string& filename, bool
     //- 3: RGB
     //- 4: RGB and Alpha (RGBA)
     //Note: channels (the 4th argument) always returns the original number of channels in the file
-    unsigned char* pixels = stbi_load(filename.c_str(), &size.x, &size.y, &channels, 4);
-    if(pixels == nullptr){
+    image.pixels = stbi_load(filename.c_str(), &image.size.x, &image.size.y, &channels, 4);
+    if(image.pixels == nullptr){
         std::cerr << "Failed to load image: " << filename << std::endl;
-        return nullptr;
     }
+    return image;
+}
+
+our::Texture2D* our::texture_utils::uploadImage(DecodedImage& image, bool generate_mipmap) {
+    if(image.pixels == nullptr) return nullptr;
     // Create a texture
     our::Texture2D* texture = new our::Texture2D();
     //Bind the texture such that we upload the image data to its storage
     //TODO: (Req 5) Finish this function to fill the texture with the data found in "pixels"
     texture->bind();
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.size.x, image.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.pixels);
     
     if(generate_mipmap) {
         glGenerateMipmap(GL_TEXTURE_2D);
     }
     
-    stbi_image_free(pixels); //Free image data after uploading to GPU
+    stbi_image_free(image.pixels); //Free image data after uploading to GPU
+    image.pixels = nullptr;
     return texture;
+}
+
+void our::texture_utils::freeImage(DecodedImage& image) {
+    if(image.pixels) stbi_image_free(image.pixels);
+    image.pixels = nullptr;
 }
\ No newline at end of file
@@ -11,4 +11,17 @@ namespace our::texture_utils {
     Texture2D* empty(GLenum format, glm::ivec2 size);
     // This function loads an image and sends its data to the given Texture2D 
     Texture2D* loadImage(const std::string& filename, bool generate_mipmap = true);
+
+    // The pixels of an image decoded by "decodeImage" (4 channels of 8 bits each, null if the decoding failed)
+    struct DecodedImage {
+        glm::ivec2 size = {0, 0};
+        unsigned char* pixels = nullptr;
+    };
+    // This function decodes an image file into memory. It doesn't call OpenGL so it can run on any thread.
+    DecodedImage decodeImage(const std::string& filename);
+    // This function creates a texture from a decoded image then frees the pixels
+    // It calls OpenGL so it must run on the thread that owns the context. Returns null if the image was not decoded.
+    Texture2D* uploadImage(DecodedImage& image, bool generate_mipmap = true);
+    // This function frees the pixels of a decoded image that won't be uploaded
+    void freeImage(DecodedImage& image);
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <glad/gl.h>
 
+#include "../gl-state-cache.hpp"
+
 namespace our {
 
     // This class defined an OpenGL texture which will be used as a GL_TEXTURE_2D
@@ -22,6 +24,7 @@ namespace our {
         // This deconstructor deletes the underlying OpenGL texture
         ~Texture2D() { 
             //TODO: (Req 5) Complete this function
+            GLStateCache::get().forgetTexture(name);
             glDeleteTextures(1, &name);
         }
 
@@ -30,16 +33,16 @@ namespace our {
             return name;
         }
 
-        // This method binds this texture to GL_TEXTURE_2D
+        // This method binds this texture to GL_TEXTURE_2D (on the active texture unit of the state cache)
         void bind() const {
             //TODO: (Req 5) Complete this function
-            glBindTexture(GL_TEXTURE_2D, name);
+            GLStateCache::get().bindTexture2D(name);
         }
 
         // This static method ensures that no texture is bound to GL_TEXTURE_2D
         static void unbind(){
             //TODO: (Req 5) Complete this function
-            glBindTexture(GL_TEXTURE_2D, 0);
+            GLStateCache::get().bindTexture2D(0);
         }
 
         Texture2D(const Texture2D&) = delete;
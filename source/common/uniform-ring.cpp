@@ -0,0 +1,88 @@
+#include "uniform-ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace our {
+
+    void UniformRing::create(size_t regionSize) {
+        GLint offsetAlignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+        if (offsetAlignment > 0) alignment = size_t(offsetAlignment);
+        this->regionSize = align(std::max(regionSize, size_t(1)));
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(this->regionSize * REGION_COUNT), nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        region = 0;
+    }
+
+    void UniformRing::destroy() {
+        for (GLsync& sync : fences) {
+            if (sync) glDeleteSync(sync);
+            sync = nullptr;
+        }
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+        regionSize = 0;
+    }
+
+    void UniformRing::waitFor(int index) {
+        GLsync& sync = fences[index];
+        if (!sync) return;
+        // The commands are flushed on the first try so the fence is certain to be signaled eventually
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        for (;;) {
+            GLenum status = glClientWaitSync(sync, flags, 1000000000);
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED) break;
+            flags = 0;
+        }
+        glDeleteSync(sync);
+        sync = nullptr;
+    }
+
+    void* UniformRing::map(size_t size) {
+        region = (region + 1) % REGION_COUNT;
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        if (size > regionSize) {
+            // The new storage is not read by any frame yet, so the fences of the old one are dropped
+            for (GLsync& sync : fences) {
+                if (sync) glDeleteSync(sync);
+                sync = nullptr;
+            }
+            regionSize = align(std::max(size, regionSize * 2));
+            glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(regionSize * REGION_COUNT), nullptr, GL_STREAM_DRAW);
+        } else {
+            waitFor(region);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        writeSize = size;
+        staging.resize(std::max(size, size_t(1)));
+        return staging.data();
+    }
+
+    void UniformRing::unmap() {
+        if (writeSize == 0) return;
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        GLintptr offset = GLintptr(size_t(region) * regionSize);
+        // The GPU is done with the region, so there is nothing for the driver to synchronize
+        void* data = glMapBufferRange(GL_UNIFORM_BUFFER, offset, GLsizeiptr(writeSize),
+                                      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        bool sent = false;
+        if (data) {
+            std::memcpy(data, staging.data(), writeSize);
+            // GL_FALSE means the content of the mapping became undefined (e.g. the video memory was lost)
+            sent = glUnmapBuffer(GL_UNIFORM_BUFFER) == GL_TRUE;
+        }
+        if (!sent)
+            glBufferSubData(GL_UNIFORM_BUFFER, offset, GLsizeiptr(writeSize), staging.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        writeSize = 0;
+    }
+
+    void UniformRing::fence() {
+        if (fences[region]) glDeleteSync(fences[region]);
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace our {
+
+    // A uniform buffer split into REGION_COUNT regions used in turn by the frames, so the CPU writes the blocks of a frame
+    // while the GPU still reads the blocks of the previous ones. Each frame:
+    // - "map" waits for the GPU to be done with the region of the frame (it almost never has to with 3 regions) and returns
+    //   a CPU staging copy where the blocks of the frame are written in one linear pass.
+    // - "unmap" maps the region without synchronization and copies the blocks in one go. If the mapping fails, or if
+    //   "glUnmapBuffer" reports that the mapped content was lost, the region is sent again from the staging copy with
+    //   "glBufferSubData". The draws then select their block with "bindRange".
+    // - "fence" is called after the last draw reading the region, the region is reused once the GPU passes the fence.
+    // OpenGL 3.3 has no persistent mapping (glBufferStorage is 4.4), so the region is mapped and unmapped every frame.
+    // A frame that needs more than a region grows the buffer (the old storage is orphaned, so the frames in flight keep it).
+    // NOTE: Like OpenGL itself, it must only be used by the thread that owns the context.
+    class UniformRing {
+    public:
+        static constexpr int REGION_COUNT = 3;
+
+    private:
+        GLuint buffer = 0;
+        GLsync fences[REGION_COUNT] = {};
+        size_t regionSize = 0;
+        size_t alignment = 256; // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+        int region = 0; // The region of the current frame
+        size_t writeSize = 0; // The size written by the current frame
+        std::vector<unsigned char> staging; // The blocks of the current frame (kept till they safely reached the buffer)
+
+        // Waits for the GPU to pass the fence of a region and deletes it
+        void waitFor(int index);
+
+    public:
+        // Creates the buffer (each region starts with "regionSize" bytes)
+        void create(size_t regionSize);
+        void destroy();
+
+        // Returns the given size rounded up to the alignment of the block offsets
+        size_t align(size_t size) const { return (size + alignment - 1) / alignment * alignment; }
+
+        // Moves to the next region and returns where to write its first "size" bytes (valid until "unmap")
+        void* map(size_t size);
+        // Sends the bytes written since "map" to the region of the frame
+        void unmap();
+        // Binds "size" bytes found at "offset" in the region of the frame to a uniform block binding point
+        // (the offset must be a multiple of the alignment, see "align")
+        void bindRange(GLuint binding, size_t offset, size_t size) const {
+            glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, GLintptr(size_t(region) * regionSize + offset), GLsizeiptr(size));
+        }
+        // Marks the end of the draws reading the region of the frame
+        void fence();
+
+        size_t getRegionSize() const { return regionSize; }
+    };
+
+}
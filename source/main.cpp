@@ -17,6 +17,7 @@
 #include "states/entity-test-state.hpp"
 #include "states/renderer-test-state.hpp"
 #include "states/text-demo-state.hpp"
+#include "benchmarks/benchmarks.hpp"
 
 int main(int argc, char **argv)
 {
@@ -41,6 +42,12 @@ int main(int argc, char **argv)
     nlohmann::json app_config = nlohmann::json::parse(file_in, nullptr, true, true);
     file_in.close();
 
+    // If the config describes a benchmark, we run it without creating the application (no window is needed)
+    if (app_config.contains("benchmark"))
+    {
+        return our::benchmarks::run(app_config["benchmark"]);
+    }
+
     // Create the application
     our::Application app(app_config);
 
@@ -3,12 +3,16 @@
 #include <application.hpp>
 
 #include <ecs/world.hpp>
+#include <ecs/scheduler.hpp>
+#include <ecs/compiled-scene.hpp>
+#include <ecs/world-snapshot.hpp>
 #include <systems/forward-renderer.hpp>
 #include <systems/free-camera-controller.hpp>
 #include <systems/rigidbodySystem.hpp>
 #include <systems/ColliderSystem.hpp>
 #include <systems/movement.hpp>
 #include <asset-loader.hpp>
+#include <incremental-loader.hpp>
 #include <systems/InputMovement.hpp>
 #include <btBulletCollisionCommon.h>
 #include <systems/soundSystem.hpp>
@@ -31,21 +35,35 @@ class Playstate : public our::State
     our::ColliderSystem colliderSystem;
     our::RaceSystem raceSystem;
     our::HUDSystem hudSystem;
+    our::SystemScheduler scheduler;
+    our::WorldSnapshot raceStart; // The world at the start of the race (restored when the race is reset)
+    // The assets, the entities, the physics bodies and the renderer are loaded over several frames (see "onDraw")
+    our::IncrementalLoader loader;
+    double loadingBudget = 8.0; // The milliseconds of each frame spent loading
+    bool rendererInitialized = false;
     btDiscreteDynamicsWorld *dynamicsWorld;
     void onInitialize() override
     {
 
         // First of all, we get the scene configuration from the app config
         auto &config = getApp()->getConfig()["scene"];
-        // If we have assets in the scene config, we deserialize them
+        // The loading runs a few milliseconds per frame so the loading screen keeps drawing
+        // "loading.budget" is the number of milliseconds spent loading in each frame
+        loadingBudget = getApp()->getConfig().value("loading", nlohmann::json::object()).value("budget", 8.0);
+        // If we have assets in the scene config, we deserialize them (one asset per loading step)
         if (config.contains("assets"))
         {
-            our::deserializeAllAssets(config["assets"]);
+            our::queueAllAssets(loader, config["assets"]);
         }
         // If we have a world in the scene config, we use it to populate our world
+        // It is either the array of entities or the path of a scene file (which is compiled to a binary scene on the first load)
         if (config.contains("world"))
         {
-            world.deserialize(config["world"]);
+            if (config["world"].is_string())
+                our::queueSceneLoad(loader, world, config["world"].get<std::string>());
+            else
+                loader.add("Loading the world", [this, scene = &config]()
+                           { world.deserialize((*scene)["world"]); });
         }
         btBroadphaseInterface *broadphase = new btDbvtBroadphase();
         btDefaultCollisionConfiguration *collisionConfiguration = new btDefaultCollisionConfiguration();
@@ -102,33 +120,95 @@ class Playstate : public our::State
         // Connect race system with sound system for audio feedback
         raceSystem.setSoundSystem(&soundSystem);
 
+        // Once the entities exist, their physics bodies are created (one body per loading step since they load meshes)
+        loader.add("Creating the physics bodies", [this]()
+                   {
+                       for (auto [entity, rigidbody] : world.view<our::RigidbodyComponent>())
+                           loader.add("Creating the physics body of \"" + entity->getName() + "\"", [this, rigidbody = rigidbody]()
+                                      { rigidbodySystem.createBody(rigidbody); }); });
+
         // Then we initialize the renderer
-        auto size = getApp()->getFrameBufferSize();
-        renderer.setWorld(dynamicsWorld);
-        renderer.initialize(size, config["renderer"]);
+        loader.add("Initializing the renderer", [this, scene = &config]()
+                   {
+                       auto size = getApp()->getFrameBufferSize();
+                       renderer.setWorld(dynamicsWorld);
+                       renderer.initialize(size, (*scene)["renderer"]);
+                       rendererInitialized = true; });
 
         // Initialize HUD system with renderer reference
         hudSystem.enter(appPtr, &raceSystem, &renderer);
-    }
-
-    void onDraw(double deltaTime) override
-    { // Here, we just run a bunch of systems to control the world logic
-        // Update physics with optimized timestep for better performance
-
-        // Use adaptive timestep with more substeps for better performance and stability
-        dynamicsWorld->stepSimulation((float)deltaTime, 10, 1.0f / 120.0f);
-
-        movementSystem.update(&world, (float)deltaTime);
-        cameraController.update(&world, (float)deltaTime);
 
+        // Register the logic systems in the order they used to run in. Systems that don't conflict (see "getAccess")
+        // may run concurrently, while the conflicting ones keep this order.
+        scheduler.add("Physics Step", our::SystemAccess().write<btDiscreteDynamicsWorld>(), [this](our::World *, float deltaTime)
+                      {
+                          // Use adaptive timestep with more substeps for better performance and stability
+                          dynamicsWorld->stepSimulation(deltaTime, 10, 1.0f / 120.0f); });
+        scheduler.add("Movement", our::MovementSystem::getAccess(), [this](our::World *world, float deltaTime)
+                      { movementSystem.update(world, deltaTime); });
+        // The camera controller locks the mouse through GLFW so it has to stay on the main thread
+        scheduler.add("Free Camera Controller", our::FreeCameraControllerSystem::getAccess(), [this](our::World *world, float deltaTime)
+                      { cameraController.update(world, deltaTime); }, true);
         // Only use RigidbodySystem for physics-based movement
         // InputMovementSystem is disabled to avoid conflicts
-        rigidbodySystem.update(&world, (float)deltaTime);
-        soundSystem.update(&world, (float)deltaTime);
-        colliderSystem.update(&world, (float)deltaTime);
+        scheduler.add("Rigidbody", our::RigidbodySystem::getAccess(), [this](our::World *world, float deltaTime)
+                      { rigidbodySystem.update(world, deltaTime); });
+        scheduler.add("Sound", our::soundSystem::getAccess(), [this](our::World *world, float deltaTime)
+                      { soundSystem.update(world, deltaTime); });
+        scheduler.add("Collider", our::ColliderSystem::getAccess(), [this](our::World *world, float deltaTime)
+                      { colliderSystem.update(world, deltaTime); });
+        scheduler.add("Race", our::RaceSystem::getAccess(), [this](our::World *world, float deltaTime)
+                      { raceSystem.update(world, deltaTime); });
+        // The scheduler options are optional (the systems run on the workers of the application job system)
+        scheduler.configure(fullConfig.value("scheduler", nlohmann::json::object()));
+        // The update LOD tiers are optional too (without them, every entity is updated every frame)
+        auto updateLOD = fullConfig.value("updateLOD", nlohmann::json::object());
+        movementSystem.configure(updateLOD.value("movement", nlohmann::json::object()));
+        soundSystem.configure(updateLOD.value("sound", nlohmann::json::object()));
+        rigidbodySystem.configureTireLOD(updateLOD.value("tires", nlohmann::json::object()));
+    }
 
-        // Update race system
-        raceSystem.update(&world, (float)deltaTime);
+    void onImmediateGui() override
+    {
+        if (loader.isDone())
+            return;
+        // The loading screen is a progress bar in the middle of the window
+        auto size = getApp()->getFrameBufferSize();
+        ImGui::SetNextWindowPos(ImVec2(size.x * 0.5f, size.y * 0.5f), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
+        ImGui::SetNextWindowSize(ImVec2(size.x * 0.5f, 0));
+        ImGui::Begin("Loading", nullptr, ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings);
+        ImGui::TextUnformatted(loader.getStatus().c_str());
+        ImGui::ProgressBar(loader.getProgress());
+        ImGui::End();
+    }
+
+    void onDraw(double deltaTime) override
+    {
+        // While loading, the frame only runs the next loading steps (the progress bar is drawn by "onImmediateGui")
+        if (!loader.isDone())
+        {
+            loader.update(loadingBudget);
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            if (getApp()->getKeyboard().justPressed(GLFW_KEY_ESCAPE))
+                getApp()->changeState("menu");
+            return;
+        }
+        // Here, we just run a bunch of systems to control the world logic
+        // The physics step and the logic systems are run by the scheduler (see onInitialize)
+        // The transform cache is brought up to date first (the spawns of the last frame are not in it yet),
+        // so the systems that read it in parallel never update it
+        world.updateTransforms();
+        scheduler.run(&world, (float)deltaTime);
+        // The systems record their spawns and despawns in command buffers, they are applied here once all of them are done
+        world.deleteMarkedEntities();
+        // The start of the race is captured once the first frame created the physics bodies
+        if (raceStart.isEmpty())
+            raceStart.capture(world);
+        else if (raceSystem.consumeResetRequest() && !raceStart.restore(world))
+            std::cerr << "Couldn't reset the race since entities were added or removed after it started" << std::endl;
+        // The changes made from now on belong to the next tick (see "World::changed")
+        world.advanceTick();
 
         // And finally we use the renderer system to draw the scene
         renderer.render(&world);
@@ -148,14 +228,23 @@ class Playstate : public our::State
 
     void onDestroy() override
     {
+        // Remove the systems (they are registered again if the state is entered again)
+        if (!scheduler.getTimelinePath().empty())
+            scheduler.writeTimeline(scheduler.getTimelinePath());
+        scheduler.clear();
         // We destroy the sound system
         soundSystem.destroy();
-        // Don't forget to destroy the renderer
-        renderer.destroy();
+        // Don't forget to destroy the renderer (if the loading got that far)
+        if (rendererInitialized)
+            renderer.destroy();
+        rendererInitialized = false;
+        // Drop the rest of the loading if the state is left before it is done
+        loader.clear();
         // On exit, we call exit for the camera controller system to make sure that the mouse is unlocked
         cameraController.exit();
         // Clear the world
         world.clear();
+        raceStart.clear();
         // and we delete all the loaded assets to free memory on the RAM and the VRAM
         our::clearAllAssets();
     }